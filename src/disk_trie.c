@@ -0,0 +1,729 @@
+/** @file
+ * Implementacja drzew przekierowań przechowywanych w pliku
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+#define _POSIX_C_SOURCE 200809L /**< Udostępnia pread, pwrite, strnlen, fsync i wątki. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include "disk_trie.h"
+#include "linked_list.h"
+
+#define MAGIC "PFDT" /**< Nagłówek pliku drzew. */
+#define MAGIC_SIZE 4 /**< Długość nagłówka pliku drzew. */
+#define VERSION 1 /**< Wersja formatu pliku. */
+#define HEADER_SIZE 48 /**< Liczba używanych bajtów pierwszego bloku pliku. */
+#define NODE_SIZE 64 /**< Rozmiar zapisanego wierzchołka w bajtach. */
+#define NO_FRAME SIZE_MAX /**< Oznaczenie braku ramki pamięci podręcznej. */
+#define NO_BLOCK UINT64_MAX /**< Oznaczenie ramki bez wczytanego bloku. */
+#define TEMP_SUFFIX ".tmp" /**< Przyrostek nazwy pliku zapisywanego przed podmianą. */
+
+/*
+ * Format pliku, wszystkie liczby są zapisane od najmłodszego bajtu.
+ * Blok 0: MAGIC, wersja, rozmiar bloku, liczba wierzchołków, numery korzeni
+ * drzew forward i reverse, przesunięcia obszarów wierzchołków i numerów oraz
+ * długość obszaru numerów. Od bloku 1: wierzchołki po NODE_SIZE bajtów,
+ * numerowane od 0; wierzchołek 0 jest pusty, a numer 0 oznacza brak dziecka.
+ * Od następnego pełnego bloku: numery zakończone znakiem '\0'.
+ */
+
+/**
+ * To jest struktura reprezentująca odczytany wierzchołek.
+ */
+typedef struct DiskNode {
+    uint32_t child[N]; /**< Numery dzieci lub 0. */
+    uint64_t data; /**< Przesunięcie numerów wierzchołka w obszarze numerów. */
+    uint32_t bytes; /**< Łączna długość numerów wierzchołka ze znakami '\0'. */
+    uint32_t count; /**< Liczba numerów wierzchołka. */
+} DiskNode;
+
+/**
+ * To jest struktura przechowująca otwarty plik z drzewami.
+ */
+struct DiskTrie {
+    int fd; /**< Deskryptor pliku. */
+    uint32_t nodeCount; /**< Liczba wierzchołków razem z pustym wierzchołkiem 0. */
+    uint32_t forwardRoot; /**< Numer korzenia drzewa forward. */
+    uint32_t reverseRoot; /**< Numer korzenia drzewa reverse. */
+    uint64_t nodeOffset; /**< Przesunięcie obszaru wierzchołków w pliku. */
+    uint64_t stringOffset; /**< Przesunięcie obszaru numerów w pliku. */
+    uint64_t stringBytes; /**< Długość obszaru numerów. */
+    unsigned char *pinned; /**< Początkowe bloki pliku trzymane stale w pamięci. */
+    uint64_t pinnedBlocks; /**< Liczba bloków w tablicy pinned. */
+    unsigned char *frames; /**< Ramki pamięci podręcznej. */
+    uint64_t *frameBlock; /**< Numery bloków w ramkach lub NO_BLOCK. */
+    size_t *frameNext; /**< Następne ramki w łańcuchach tablicy haszującej. */
+    bool *referenced; /**< Flagi użycia ramek od ostatniego przejścia wskazówki zegara. */
+    size_t frameCount; /**< Liczba ramek. */
+    size_t used; /**< Liczba ramek, które były już zajęte. */
+    size_t hand; /**< Wskazówka zegara, czyli kandydat do usunięcia z pamięci. */
+    size_t *buckets; /**< Pierwsze ramki łańcuchów tablicy haszującej. */
+    size_t bucketMask; /**< Liczba łańcuchów pomniejszona o 1. */
+    atomic_uint_least64_t hits; /**< Liczba odczytów bloków z pamięci. */
+    atomic_uint_least64_t misses; /**< Liczba odczytów bloków z pliku. */
+    pthread_mutex_t mutex; /**< Blokada pamięci podręcznej. */
+};
+
+/**
+ * To jest struktura reprezentująca buforowany zapis fragmentu pliku.
+ */
+typedef struct DiskWriter {
+    int fd; /**< Deskryptor pliku. */
+    uint64_t offset; /**< Przesunięcie w pliku pierwszego bajtu bufora. */
+    size_t used; /**< Liczba bajtów w buforze. */
+    bool failed; /**< Flaga mówiąca czy wystąpił błąd zapisu. */
+    unsigned char block[DISK_TRIE_BLOCK]; /**< Bufor. */
+} DiskWriter;
+
+/**
+ * To jest unia przechowująca wierzchołek jednego z drzew.
+ */
+typedef union QueuedNode {
+    TrieNode const *forward; /**< Wierzchołek drzewa forward. */
+    ReverseNode const *reverse; /**< Wierzchołek drzewa reverse. */
+} QueuedNode;
+
+/**
+ * To jest struktura przechowująca wierzchołki w kolejności przechodzenia wszerz.
+ * Wierzchołki drzewa forward poprzedzają wierzchołki drzewa reverse.
+ */
+typedef struct NodeQueue {
+    QueuedNode *nodes; /**< Tablica wierzchołków. */
+    size_t count; /**< Liczba wierzchołków. */
+    size_t capacity; /**< Rozmiar tablicy nodes. */
+} NodeQueue;
+
+/** @brief Zapisuje liczbę 32-bitową.
+ * @param[out] dst - wskaźnik na 4 bajty;
+ * @param[in] value - liczba zapisywana od najmłodszego bajtu.
+ */
+static void storeWord(unsigned char *dst, uint32_t value) {
+    for (int i = 0; i < 4; ++i)
+        dst[i] = (unsigned char) (value >> (8 * i));
+}
+
+/** @brief Zapisuje liczbę 64-bitową.
+ * @param[out] dst - wskaźnik na 8 bajtów;
+ * @param[in] value - liczba zapisywana od najmłodszego bajtu.
+ */
+static void storeLong(unsigned char *dst, uint64_t value) {
+    for (int i = 0; i < 8; ++i)
+        dst[i] = (unsigned char) (value >> (8 * i));
+}
+
+/** @brief Odczytuje liczbę 32-bitową.
+ * @param[in] src - wskaźnik na 4 bajty.
+ * @return Liczba zapisana od najmłodszego bajtu.
+ */
+static uint32_t loadWord(unsigned char const *src) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i)
+        value |= (uint32_t) src[i] << (8 * i);
+    return value;
+}
+
+/** @brief Odczytuje liczbę 64-bitową.
+ * @param[in] src - wskaźnik na 8 bajtów.
+ * @return Liczba zapisana od najmłodszego bajtu.
+ */
+static uint64_t loadLong(unsigned char const *src) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i)
+        value |= (uint64_t) src[i] << (8 * i);
+    return value;
+}
+
+/** @brief Zapisuje cały bufor w danym miejscu pliku.
+ * @param[in] fd - deskryptor pliku;
+ * @param[in] data - wskaźnik na dane;
+ * @param[in] size - liczba bajtów;
+ * @param[in] offset - przesunięcie w pliku.
+ * @return Wartość @p false, jeśli wystąpił błąd zapisu.
+ */
+static bool writeAt(int fd, void const *data, size_t size, uint64_t offset) {
+    unsigned char const *ptr = data;
+    while (size > 0) {
+        ssize_t written = pwrite(fd, ptr, size, (off_t) offset);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        ptr += written;
+        offset += (uint64_t) written;
+        size -= (size_t) written;
+    }
+    return true;
+}
+
+/** @brief Zapisuje bufor do pliku i opróżnia go.
+ * @param[in,out] writer - wskaźnik na bufor zapisu.
+ */
+static void writerFlush(DiskWriter *writer) {
+    if (!writer->failed && !writeAt(writer->fd, writer->block, writer->used, writer->offset))
+        writer->failed = true;
+    writer->offset += writer->used;
+    writer->used = 0;
+}
+
+/** @brief Dopisuje bajty do bufora.
+ * @param[in,out] writer - wskaźnik na bufor zapisu;
+ * @param[in] data - wskaźnik na dane;
+ * @param[in] size - liczba bajtów.
+ */
+static void writerPut(DiskWriter *writer, void const *data, size_t size) {
+    unsigned char const *ptr = data;
+    while (size > 0) {
+        size_t part = DISK_TRIE_BLOCK - writer->used;
+        if (part > size)
+            part = size;
+        memcpy(writer->block + writer->used, ptr, part);
+        writer->used += part;
+        ptr += part;
+        size -= part;
+        if (writer->used == DISK_TRIE_BLOCK)
+            writerFlush(writer);
+    }
+}
+
+/** @brief Zwraca przesunięcie w pliku następnego dopisywanego bajtu.
+ * @param[in] writer - wskaźnik na bufor zapisu.
+ * @return Przesunięcie w pliku.
+ */
+static uint64_t writerPosition(DiskWriter const *writer) {
+    return writer->offset + writer->used;
+}
+
+/** @brief Dopisuje wierzchołek do kolejki.
+ * @param[in,out] queue - wskaźnik na kolejkę;
+ * @param[in] node - wierzchołek.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci lub
+ *         wierzchołków jest za dużo.
+ */
+static bool pushNode(NodeQueue *queue, QueuedNode node) {
+    if (queue->count == queue->capacity) {
+        if (queue->capacity >= UINT32_MAX / 2)
+            return false;
+        size_t capacity = 2 * queue->capacity;
+        QueuedNode *temp = realloc(queue->nodes, capacity * sizeof(QueuedNode));
+        if (!temp)
+            return false;
+        queue->nodes = temp;
+        queue->capacity = capacity;
+    }
+    queue->nodes[queue->count++] = node;
+    return true;
+}
+
+/** @brief Dodaje wierzchołki drzewa forward do kolejki.
+ * Dopisuje korzeń @p root i wszystkie jego potomki w kolejności przechodzenia
+ * drzewa wszerz.
+ * @param[in,out] queue - wskaźnik na kolejkę;
+ * @param[in] root - wskaźnik na korzeń drzewa lub NULL.
+ * @return Numer korzenia w kolejce, 0, gdy @p root ma wartość NULL, lub
+ *         UINT32_MAX, gdy nie udało się alokować pamięci albo wierzchołków
+ *         jest za dużo.
+ */
+static uint32_t collectNodes(NodeQueue *queue, TrieNode const *root) {
+    if (!root)
+        return 0;
+
+    size_t first = queue->count;
+    if (!pushNode(queue, (QueuedNode) {.forward = root}))
+        return UINT32_MAX;
+    for (size_t i = first; i < queue->count; ++i) {
+        for (int c = 0; c < N; ++c) {
+            TrieNode const *child = queue->nodes[i].forward->child[c];
+            if (child && !pushNode(queue, (QueuedNode) {.forward = child}))
+                return UINT32_MAX;
+        }
+    }
+    return (uint32_t) first;
+}
+
+/** @brief Dodaje wierzchołki drzewa reverse do kolejki.
+ * Działa tak jak collectNodes dla drzewa reverse.
+ * @param[in,out] queue - wskaźnik na kolejkę;
+ * @param[in] root - wskaźnik na korzeń drzewa lub NULL.
+ * @return Wynik taki jak dla collectNodes.
+ */
+static uint32_t collectReverse(NodeQueue *queue, ReverseNode const *root) {
+    if (!root)
+        return 0;
+
+    size_t first = queue->count;
+    if (!pushNode(queue, (QueuedNode) {.reverse = root}))
+        return UINT32_MAX;
+    for (size_t i = first; i < queue->count; ++i) {
+        for (int c = 0; c < N; ++c) {
+            ReverseNode const *child = queue->nodes[i].reverse->child[c];
+            if (child && !pushNode(queue, (QueuedNode) {.reverse = child}))
+                return UINT32_MAX;
+        }
+    }
+    return (uint32_t) first;
+}
+
+/** @brief Zapisuje numery wierzchołka.
+ * @param[in,out] strings - wskaźnik na bufor obszaru numerów;
+ * @param[in] node - wierzchołek;
+ * @param[in] isReverse - flaga mówiąca czy wierzchołek należy do drzewa reverse;
+ * @param[out] bytes - wskaźnik na łączną długość numerów ze znakami '\0';
+ * @param[out] count - wskaźnik na liczbę numerów.
+ * @return Wartość @p false, jeśli numery wierzchołka są za długie.
+ */
+static bool putStrings(DiskWriter *strings, QueuedNode node, bool isReverse, uint32_t *bytes,
+                       uint32_t *count) {
+    uint64_t total = 0;
+    *count = 0;
+    if (!isReverse) {
+        if (node.forward->forward) {
+            total = strlen(node.forward->forward) + 1;
+            writerPut(strings, node.forward->forward, (size_t) total);
+            *count = 1;
+        }
+    } else {
+        for (Node const *head = node.reverse->forwardsList; head; head = head->next) {
+            size_t length = strlen(head->data) + 1;
+            writerPut(strings, head->data, length);
+            total += length;
+            ++*count;
+        }
+    }
+    *bytes = (uint32_t) total;
+    return total <= UINT32_MAX;
+}
+
+bool diskTrieExport(TrieNode const *forwardRoot, ReverseNode const *reverseRoot, char const *path) {
+    NodeQueue queue = {malloc(1024 * sizeof(QueuedNode)), 1, 1024};
+    if (!queue.nodes)
+        return false;
+    queue.nodes[0].forward = NULL;
+
+    uint32_t forwardId = collectNodes(&queue, forwardRoot);
+    uint32_t reverseId = forwardId == UINT32_MAX ? UINT32_MAX : collectReverse(&queue, reverseRoot);
+    DiskWriter *nodes = malloc(sizeof(DiskWriter));
+    DiskWriter *strings = malloc(sizeof(DiskWriter));
+    char *temp = malloc((strlen(path) + strlen(TEMP_SUFFIX) + 1) * sizeof(char));
+    int fd = -1;
+    bool res = reverseId != UINT32_MAX && nodes && strings && temp;
+    if (res) {
+        strcpy(temp, path);
+        strcat(temp, TEMP_SUFFIX);
+        fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        res = fd >= 0;
+    }
+
+    uint64_t nodeOffset = DISK_TRIE_BLOCK;
+    uint64_t stringOffset = nodeOffset + (uint64_t) queue.count * NODE_SIZE;
+    stringOffset = (stringOffset + DISK_TRIE_BLOCK - 1) / DISK_TRIE_BLOCK * DISK_TRIE_BLOCK;
+    if (res) {
+        *nodes = (DiskWriter) {.fd = fd, .offset = nodeOffset, .used = 0, .failed = false};
+        *strings = (DiskWriter) {.fd = fd, .offset = stringOffset, .used = 0, .failed = false};
+    }
+
+    unsigned char record[NODE_SIZE];
+    uint32_t next = 0;
+    for (size_t i = 0; res && i < queue.count; ++i) {
+        QueuedNode node = queue.nodes[i];
+        bool isReverse = reverseId != 0 && i >= reverseId;
+        memset(record, 0, NODE_SIZE);
+        if (i > 0) {
+            if (i == forwardId || i == reverseId)
+                next = (uint32_t) i + 1;
+            for (int c = 0; c < N; ++c) {
+                if (isReverse ? node.reverse->child[c] != NULL : node.forward->child[c] != NULL)
+                    storeWord(record + 4 * c, next++);
+            }
+            uint32_t bytes, count;
+            storeLong(record + 4 * N, writerPosition(strings) - stringOffset);
+            res = putStrings(strings, node, isReverse, &bytes, &count);
+            storeWord(record + 4 * N + 8, bytes);
+            storeWord(record + 4 * N + 12, count);
+        }
+        writerPut(nodes, record, NODE_SIZE);
+    }
+
+    if (res) {
+        writerFlush(nodes);
+        writerFlush(strings);
+        unsigned char header[HEADER_SIZE] = {0};
+        memcpy(header, MAGIC, MAGIC_SIZE);
+        storeWord(header + 4, VERSION);
+        storeWord(header + 8, DISK_TRIE_BLOCK);
+        storeWord(header + 12, (uint32_t) queue.count);
+        storeWord(header + 16, forwardId);
+        storeWord(header + 20, reverseId);
+        storeLong(header + 24, nodeOffset);
+        storeLong(header + 32, stringOffset);
+        storeLong(header + 40, strings->offset - stringOffset);
+        res = !nodes->failed && !strings->failed && writeAt(fd, header, HEADER_SIZE, 0) &&
+              ftruncate(fd, (off_t) strings->offset) == 0 && fsync(fd) == 0;
+    }
+
+    if (fd >= 0) {
+        if (close(fd) != 0 || !res || rename(temp, path) != 0) {
+            res = false;
+            unlink(temp);
+        }
+    }
+    free(temp);
+    free(queue.nodes);
+    free(nodes);
+    free(strings);
+    return res;
+}
+
+/** @brief Wczytuje blok pliku.
+ * Uzupełnia zerami część bloku leżącą za końcem pliku.
+ * @param[in] fd - deskryptor pliku;
+ * @param[in] block - numer bloku;
+ * @param[out] dst - wskaźnik na bufor o rozmiarze bloku.
+ * @return Wartość @p false, jeśli wystąpił błąd odczytu.
+ */
+static bool readBlock(int fd, uint64_t block, unsigned char *dst) {
+    size_t done = 0;
+    while (done < DISK_TRIE_BLOCK) {
+        ssize_t part = pread(fd, dst + done, DISK_TRIE_BLOCK - done,
+                             (off_t) (block * DISK_TRIE_BLOCK + done));
+        if (part < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        if (part == 0)
+            break;
+        done += (size_t) part;
+    }
+    memset(dst + done, 0, DISK_TRIE_BLOCK - done);
+    return true;
+}
+
+DiskTrie *diskTrieOpen(char const *path, size_t cacheBytes, size_t pinnedBytes) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    unsigned char header[DISK_TRIE_BLOCK];
+    DiskTrie *disk = malloc(sizeof(DiskTrie));
+    if (!disk || fstat(fd, &st) != 0 || !readBlock(fd, 0, header) ||
+        memcmp(header, MAGIC, MAGIC_SIZE) != 0 || loadWord(header + 4) != VERSION ||
+        loadWord(header + 8) != DISK_TRIE_BLOCK) {
+        free(disk);
+        close(fd);
+        return NULL;
+    }
+
+    disk->fd = fd;
+    disk->nodeCount = loadWord(header + 12);
+    disk->forwardRoot = loadWord(header + 16);
+    disk->reverseRoot = loadWord(header + 20);
+    disk->nodeOffset = loadLong(header + 24);
+    disk->stringOffset = loadLong(header + 32);
+    disk->stringBytes = loadLong(header + 40);
+    uint64_t fileSize = (uint64_t) st.st_size;
+    if (disk->nodeCount == 0 || disk->forwardRoot >= disk->nodeCount ||
+        disk->reverseRoot >= disk->nodeCount || disk->nodeOffset < HEADER_SIZE ||
+        disk->stringOffset < disk->nodeOffset ||
+        (disk->stringOffset - disk->nodeOffset) / NODE_SIZE < disk->nodeCount ||
+        disk->stringOffset > fileSize || fileSize - disk->stringOffset < disk->stringBytes) {
+        free(disk);
+        close(fd);
+        return NULL;
+    }
+
+    uint64_t fileBlocks = (fileSize + DISK_TRIE_BLOCK - 1) / DISK_TRIE_BLOCK;
+    disk->pinnedBlocks = pinnedBytes / DISK_TRIE_BLOCK;
+    if (disk->pinnedBlocks > fileBlocks)
+        disk->pinnedBlocks = fileBlocks;
+    disk->frameCount = cacheBytes / DISK_TRIE_BLOCK;
+    if (disk->frameCount > fileBlocks - disk->pinnedBlocks)
+        disk->frameCount = (size_t) (fileBlocks - disk->pinnedBlocks);
+    if (disk->frameCount == 0)
+        disk->frameCount = 1;
+    size_t buckets = 1;
+    while (buckets < disk->frameCount)
+        buckets *= 2;
+
+    disk->pinned = disk->pinnedBlocks ? malloc((size_t) disk->pinnedBlocks * DISK_TRIE_BLOCK) : NULL;
+    disk->frames = malloc(disk->frameCount * DISK_TRIE_BLOCK);
+    disk->frameBlock = malloc(disk->frameCount * sizeof(uint64_t));
+    disk->frameNext = malloc(disk->frameCount * sizeof(size_t));
+    disk->referenced = malloc(disk->frameCount * sizeof(bool));
+    disk->buckets = malloc(buckets * sizeof(size_t));
+    disk->bucketMask = buckets - 1;
+    disk->used = 0;
+    disk->hand = 0;
+    atomic_init(&(disk->hits), 0);
+    atomic_init(&(disk->misses), 0);
+
+    bool res = (disk->pinned || !disk->pinnedBlocks) && disk->frames && disk->frameBlock &&
+               disk->frameNext && disk->referenced && disk->buckets;
+    for (uint64_t b = 0; res && b < disk->pinnedBlocks; ++b)
+        res = readBlock(fd, b, disk->pinned + b * DISK_TRIE_BLOCK);
+    for (size_t b = 0; res && b < buckets; ++b)
+        disk->buckets[b] = NO_FRAME;
+    if (!res || pthread_mutex_init(&(disk->mutex), NULL) != 0) {
+        free(disk->pinned);
+        free(disk->frames);
+        free(disk->frameBlock);
+        free(disk->frameNext);
+        free(disk->referenced);
+        free(disk->buckets);
+        free(disk);
+        close(fd);
+        return NULL;
+    }
+    return disk;
+}
+
+void diskTrieClose(DiskTrie *disk) {
+    if (!disk)
+        return;
+    pthread_mutex_destroy(&(disk->mutex));
+    close(disk->fd);
+    free(disk->pinned);
+    free(disk->frames);
+    free(disk->frameBlock);
+    free(disk->frameNext);
+    free(disk->referenced);
+    free(disk->buckets);
+    free(disk);
+}
+
+/** @brief Usuwa ramkę z tablicy haszującej.
+ * Nic nie robi, jeśli ramka nie zawiera bloku.
+ * @param[in,out] disk - wskaźnik na strukturę;
+ * @param[in] frame - numer ramki.
+ */
+static void unlinkFrame(DiskTrie *disk, size_t frame) {
+    if (disk->frameBlock[frame] == NO_BLOCK)
+        return;
+    size_t *link = &(disk->buckets[disk->frameBlock[frame] & disk->bucketMask]);
+    while (*link != frame)
+        link = &(disk->frameNext[*link]);
+    *link = disk->frameNext[frame];
+    disk->frameBlock[frame] = NO_BLOCK;
+}
+
+/** @brief Zwraca blok z pamięci podręcznej.
+ * Wczytuje blok z pliku, jeśli nie ma go w pamięci, zastępując ramkę
+ * wybraną algorytmem zegarowym. Wymaga zajętej blokady struktury.
+ * @param[in,out] disk - wskaźnik na strukturę;
+ * @param[in] block - numer bloku, nie mniejszy niż liczba bloków stałych.
+ * @return Wskaźnik na zawartość bloku lub NULL, gdy wystąpił błąd odczytu.
+ */
+static unsigned char const *cachedBlock(DiskTrie *disk, uint64_t block) {
+    for (size_t f = disk->buckets[block & disk->bucketMask]; f != NO_FRAME; f = disk->frameNext[f]) {
+        if (disk->frameBlock[f] == block) {
+            disk->referenced[f] = true;
+            atomic_fetch_add_explicit(&(disk->hits), 1, memory_order_relaxed);
+            return disk->frames + f * DISK_TRIE_BLOCK;
+        }
+    }
+    atomic_fetch_add_explicit(&(disk->misses), 1, memory_order_relaxed);
+
+    size_t frame;
+    if (disk->used < disk->frameCount) {
+        frame = disk->used++;
+    } else {
+        while (disk->referenced[disk->hand]) {
+            disk->referenced[disk->hand] = false;
+            disk->hand = (disk->hand + 1) % disk->frameCount;
+        }
+        frame = disk->hand;
+        disk->hand = (disk->hand + 1) % disk->frameCount;
+        unlinkFrame(disk, frame);
+    }
+
+    disk->frameBlock[frame] = NO_BLOCK;
+    disk->referenced[frame] = false;
+    unsigned char *data = disk->frames + frame * DISK_TRIE_BLOCK;
+    if (!readBlock(disk->fd, block, data))
+        return NULL;
+
+    size_t *bucket = &(disk->buckets[block & disk->bucketMask]);
+    disk->frameBlock[frame] = block;
+    disk->frameNext[frame] = *bucket;
+    *bucket = frame;
+    disk->referenced[frame] = true;
+    return data;
+}
+
+/** @brief Odczytuje bajty pliku.
+ * @param[in,out] disk - wskaźnik na strukturę;
+ * @param[in] offset - przesunięcie w pliku;
+ * @param[out] dst - wskaźnik na bufor;
+ * @param[in] size - liczba bajtów.
+ * @return Wartość @p false, jeśli wystąpił błąd odczytu.
+ */
+static bool readBytes(DiskTrie *disk, uint64_t offset, void *dst, size_t size) {
+    unsigned char *ptr = dst;
+    while (size > 0) {
+        uint64_t block = offset / DISK_TRIE_BLOCK;
+        size_t start = (size_t) (offset % DISK_TRIE_BLOCK), part = DISK_TRIE_BLOCK - start;
+        if (part > size)
+            part = size;
+
+        if (block < disk->pinnedBlocks) {
+            atomic_fetch_add_explicit(&(disk->hits), 1, memory_order_relaxed);
+            memcpy(ptr, disk->pinned + block * DISK_TRIE_BLOCK + start, part);
+        } else {
+            pthread_mutex_lock(&(disk->mutex));
+            unsigned char const *data = cachedBlock(disk, block);
+            if (data)
+                memcpy(ptr, data + start, part);
+            pthread_mutex_unlock(&(disk->mutex));
+            if (!data)
+                return false;
+        }
+        ptr += part;
+        offset += part;
+        size -= part;
+    }
+    return true;
+}
+
+/** @brief Odczytuje wierzchołek.
+ * @param[in,out] disk - wskaźnik na strukturę;
+ * @param[in] id - numer wierzchołka;
+ * @param[out] node - wskaźnik na odczytany wierzchołek.
+ * @return Wartość @p false, jeśli wystąpił błąd odczytu lub wierzchołek jest
+ *         niepoprawny.
+ */
+static bool readNode(DiskTrie *disk, uint32_t id, DiskNode *node) {
+    unsigned char record[NODE_SIZE];
+    if (id >= disk->nodeCount || !readBytes(disk, disk->nodeOffset + (uint64_t) id * NODE_SIZE, record, NODE_SIZE))
+        return false;
+    for (int c = 0; c < N; ++c)
+        node->child[c] = loadWord(record + 4 * c);
+    node->data = loadLong(record + 4 * N);
+    node->bytes = loadWord(record + 4 * N + 8);
+    node->count = loadWord(record + 4 * N + 12);
+    return node->data <= disk->stringBytes && node->bytes <= disk->stringBytes - node->data &&
+           (node->count == 0 || node->bytes > 0);
+}
+
+/** @brief Odczytuje numery wierzchołka.
+ * @param[in,out] disk - wskaźnik na strukturę;
+ * @param[in] node - wskaźnik na wierzchołek z niezerową liczbą numerów;
+ * @param[out] dst - wskaźnik na bufor o długości node->bytes.
+ * @return Wartość @p false, jeśli wystąpił błąd odczytu lub ostatni numer nie
+ *         jest zakończony znakiem '\0'.
+ */
+static bool readStrings(DiskTrie *disk, DiskNode const *node, char *dst) {
+    return readBytes(disk, disk->stringOffset + node->data, dst, node->bytes) && dst[node->bytes - 1] == '\0';
+}
+
+char *diskTrieFindForward(DiskTrie *disk, char const *num) {
+    size_t length = strlen(num), bestLen = 0;
+    DiskNode node, best = {.bytes = 0, .count = 0};
+    uint32_t id = disk->forwardRoot;
+    if (id && !readNode(disk, id, &node))
+        return NULL;
+
+    for (size_t i = 0; id && i < length; ++i) {
+        id = node.child[trieIndex(num[i])];
+        if (id && !readNode(disk, id, &node))
+            return NULL;
+        if (id && node.count > 0) {
+            best = node;
+            bestLen = i + 1;
+        }
+    }
+
+    size_t prefix = best.count > 0 ? best.bytes - 1 : 0;
+    char *res = malloc((prefix + length - bestLen + 1) * sizeof(char));
+    if (!res)
+        return NULL;
+    if (best.count > 0 && (!readStrings(disk, &best, res) || strlen(res) != prefix)) {
+        free(res);
+        return NULL;
+    }
+    strcpy(res + prefix, num + bestLen);
+    return res;
+}
+
+/** @brief Dopisuje numer do tablicy wyników.
+ * @param[in,out] arr - wskaźnik na tablicę numerów;
+ * @param[in,out] size - wskaźnik na liczbę numerów;
+ * @param[in,out] capacity - wskaźnik na rozmiar tablicy;
+ * @param[in] prefix - wskaźnik na początek numeru;
+ * @param[in] prefixLength - długość początku numeru;
+ * @param[in] suffix - wskaźnik na napis dopisywany za początkiem.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool appendNumber(char ***arr, size_t *size, size_t *capacity, char const *prefix,
+                         size_t prefixLength, char const *suffix) {
+    if (*size == *capacity) {
+        char **temp = realloc(*arr, 2 * *capacity * sizeof(char *));
+        if (!temp)
+            return false;
+        *arr = temp;
+        *capacity *= 2;
+    }
+    char *num = malloc((prefixLength + strlen(suffix) + 1) * sizeof(char));
+    if (!num)
+        return false;
+    memcpy(num, prefix, prefixLength);
+    strcpy(num + prefixLength, suffix);
+    (*arr)[(*size)++] = num;
+    return true;
+}
+
+char **diskTrieFindReverse(DiskTrie *disk, char const *num, size_t *size) {
+    size_t length = strlen(num), count = 0, capacity = 8;
+    char **arr = malloc(capacity * sizeof(char *));
+    char *buffer = NULL;
+    bool res = arr && appendNumber(&arr, &count, &capacity, num, length, "");
+
+    DiskNode node;
+    uint32_t id = disk->reverseRoot;
+    if (res && id)
+        res = readNode(disk, id, &node);
+    for (size_t i = 0; res && id && i < length; ++i) {
+        id = node.child[trieIndex(num[i])];
+        if (!id)
+            break;
+        res = readNode(disk, id, &node);
+        if (!res || node.count == 0)
+            continue;
+
+        char *temp = realloc(buffer, node.bytes * sizeof(char));
+        res = temp && readStrings(disk, &node, temp);
+        if (temp)
+            buffer = temp;
+        char const *ptr = buffer, *end = buffer + node.bytes;
+        for (uint32_t k = 0; res && k < node.count; ++k) {
+            size_t forwardLength = ptr < end ? strnlen(ptr, (size_t) (end - ptr)) : 0;
+            res = ptr + forwardLength < end &&
+                  appendNumber(&arr, &count, &capacity, ptr, forwardLength, num + i + 1);
+            ptr += forwardLength + 1;
+        }
+    }
+    free(buffer);
+
+    if (!res) {
+        for (size_t i = 0; i < count; ++i)
+            free(arr[i]);
+        free(arr);
+        return NULL;
+    }
+    return uniqueNumbers(arr, count, size);
+}
+
+void diskTrieStats(DiskTrie const *disk, uint64_t *hits, uint64_t *misses) {
+    *hits = atomic_load_explicit(&(disk->hits), memory_order_relaxed);
+    *misses = atomic_load_explicit(&(disk->misses), memory_order_relaxed);
+}
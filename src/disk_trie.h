@@ -0,0 +1,89 @@
+/** @file
+ * Interfejs drzew przekierowań przechowywanych w pliku
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __DISK_TRIE_H__
+#define __DISK_TRIE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "trie.h"
+
+#define DISK_TRIE_BLOCK 4096 /**< Rozmiar bloku pliku w bajtach. */
+
+/**
+ * To jest struktura reprezentująca otwarty plik z drzewami forward i reverse.
+ * Wierzchołki leżą w pliku w kolejności przechodzenia drzew wszerz, więc
+ * górne poziomy zajmują pierwsze bloki. Początkowe bloki pliku są trzymane
+ * w pamięci przez cały czas, a pozostałe są wczytywane do pamięci podręcznej
+ * o ograniczonym rozmiarze i usuwane z niej algorytmem zegarowym.
+ */
+struct DiskTrie;
+typedef struct DiskTrie DiskTrie;
+
+/** @brief Zapisuje drzewa do pliku.
+ * Zapisuje drzewa do pliku tymczasowego o nazwie @p path z przyrostkiem
+ * ".tmp", utrwala go i zastępuje nim plik @p path, więc plik @p path nigdy
+ * nie jest zapisany częściowo. Drzew nie wolno zmieniać w trakcie zapisu.
+ * @param[in] forwardRoot – wskaźnik na korzeń drzewa forward;
+ * @param[in] reverseRoot – wskaźnik na korzeń drzewa reverse;
+ * @param[in] path        – ścieżka do pliku.
+ * @return Wartość @p true, jeśli plik został zapisany. Wartość @p false,
+ *         jeśli wystąpił błąd zapisu lub nie udało się alokować pamięci.
+ */
+bool diskTrieExport(TrieNode const *forwardRoot, ReverseNode const *reverseRoot, char const *path);
+
+/** @brief Otwiera plik z drzewami.
+ * @param[in] path        – ścieżka do pliku zapisanego przez diskTrieExport;
+ * @param[in] cacheBytes  – rozmiar pamięci podręcznej bloków w bajtach,
+ *                          zaokrąglany w dół do wielokrotności bloku, ale nie
+ *                          mniejszy niż jeden blok;
+ * @param[in] pinnedBytes – liczba bajtów z początku pliku trzymanych stale
+ *                          w pamięci, zaokrąglana w dół do wielokrotności
+ *                          bloku.
+ * @return Wskaźnik na strukturę lub NULL, gdy plik nie istnieje, ma
+ *         niepoprawny format lub nie udało się alokować pamięci.
+ */
+DiskTrie *diskTrieOpen(char const *path, size_t cacheBytes, size_t pinnedBytes);
+
+/** @brief Zamyka plik z drzewami.
+ * Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param[in] disk – wskaźnik na zamykaną strukturę.
+ */
+void diskTrieClose(DiskTrie *disk);
+
+/** @brief Zwraca przekierowanie numeru.
+ * Działa tak jak trieFindForward, ale wynik jest zawsze nowo alokowanym
+ * napisem. Może być wywoływana jednocześnie z wielu wątków.
+ * @param[in,out] disk – wskaźnik na strukturę;
+ * @param[in] num      – wskaźnik na napis reprezentujący poprawny numer.
+ * @return Wskaźnik na przekierowanie lub NULL, gdy nie udało się alokować
+ *         pamięci lub odczytać pliku.
+ */
+char *diskTrieFindForward(DiskTrie *disk, char const *num);
+
+/** @brief Zwraca numery przekierowywane na dany numer.
+ * Działa tak jak findReverseForwards. Może być wywoływana jednocześnie
+ * z wielu wątków.
+ * @param[in,out] disk – wskaźnik na strukturę;
+ * @param[in] num      – wskaźnik na napis reprezentujący poprawny numer;
+ * @param[out] size    – wskaźnik na rozmiar wynikowej tablicy.
+ * @return Posortowana tablica numerów bez powtórzeń lub NULL, gdy nie udało
+ *         się alokować pamięci lub odczytać pliku.
+ */
+char **diskTrieFindReverse(DiskTrie *disk, char const *num, size_t *size);
+
+/** @brief Zwraca liczniki pamięci podręcznej.
+ * Odczyt bloku trzymanego stale w pamięci jest liczony jako trafienie.
+ * @param[in] disk    – wskaźnik na strukturę;
+ * @param[out] hits   – wskaźnik na liczbę odczytów bloków z pamięci;
+ * @param[out] misses – wskaźnik na liczbę odczytów bloków z pliku.
+ */
+void diskTrieStats(DiskTrie const *disk, uint64_t *hits, uint64_t *misses);
+
+#endif /* __DISK_TRIE_H__ */
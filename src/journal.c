@@ -0,0 +1,461 @@
+/** @file
+ * Implementacja dziennika zmian przekierowań
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+#define _POSIX_C_SOURCE 200809L /**< Udostępnia open, fsync, ftruncate i wątki. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "journal.h"
+#include "trie.h"
+
+#define MAGIC "PFJ1" /**< Nagłówek pliku dziennika. */
+#define MAGIC_SIZE 4 /**< Długość nagłówka pliku dziennika. */
+#define GROUP_HEADER 8 /**< Rozmiar nagłówka grupy: długość i suma kontrolna. */
+#define BUFFER_SIZE (1 << 16) /**< Początkowy rozmiar bufora grupy. */
+#define OP_ADD 1 /**< Kod rekordu dodania przekierowania. */
+#define OP_REMOVE 2 /**< Kod rekordu usunięcia przekierowań. */
+#define COMPACT_SUFFIX ".compact" /**< Przyrostek nazwy dziennika tymczasowego. */
+
+/**
+ * To jest struktura reprezentująca otwarty do dopisywania plik dziennika.
+ */
+struct Journal {
+    int fd; /**< Deskryptor pliku. */
+    char *path; /**< Ścieżka pliku. */
+    unsigned char *buffer; /**< Bufor bieżącej grupy, zaczynający się miejscem na nagłówek. */
+    size_t size; /**< Zajęta część bufora. */
+    size_t capacity; /**< Rozmiar bufora. */
+    size_t records; /**< Liczba rekordów w bieżącej grupie. */
+    size_t batch; /**< Liczba rekordów, po której grupa jest zapisywana. */
+    bool failed; /**< Flaga mówiąca czy wystąpił błąd zapisu. */
+    pthread_mutex_t mutex; /**< Blokada dopisywania z wielu wątków. */
+};
+
+/** @brief Liczy sumę kontrolną.
+ * Liczy 32-bitowy skrót FNV-1a bajtów @p data.
+ * @param[in] data - wskaźnik na dane;
+ * @param[in] size - liczba bajtów.
+ * @return Suma kontrolna.
+ */
+static uint32_t checksum(unsigned char const *data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/** @brief Zapisuje liczbę 32-bitową.
+ * @param[out] dst - wskaźnik na 4 bajty;
+ * @param[in] value - liczba zapisywana od najmłodszego bajtu.
+ */
+static void storeWord(unsigned char *dst, uint32_t value) {
+    for (int i = 0; i < 4; ++i)
+        dst[i] = (unsigned char) (value >> (8 * i));
+}
+
+/** @brief Odczytuje liczbę 32-bitową.
+ * @param[in] src - wskaźnik na 4 bajty.
+ * @return Liczba zapisana od najmłodszego bajtu.
+ */
+static uint32_t loadWord(unsigned char const *src) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i)
+        value |= (uint32_t) src[i] << (8 * i);
+    return value;
+}
+
+/** @brief Zapisuje cały bufor do pliku.
+ * @param[in] fd - deskryptor pliku;
+ * @param[in] data - wskaźnik na dane;
+ * @param[in] size - liczba bajtów.
+ * @return Wartość @p false, jeśli wystąpił błąd zapisu.
+ */
+static bool writeAll(int fd, void const *data, size_t size) {
+    unsigned char const *ptr = data;
+    while (size > 0) {
+        ssize_t written = write(fd, ptr, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        ptr += written;
+        size -= (size_t) written;
+    }
+    return true;
+}
+
+/** @brief Odczytuje dokładnie zadaną liczbę bajtów.
+ * @param[in] fd - deskryptor pliku;
+ * @param[out] data - wskaźnik na bufor;
+ * @param[in] size - liczba bajtów.
+ * @return Wartość 1, jeśli odczytano wszystkie bajty, 0 przy końcu pliku
+ *         i -1 przy błędzie odczytu.
+ */
+static int readAll(int fd, void *data, size_t size) {
+    unsigned char *ptr = data;
+    while (size > 0) {
+        ssize_t got = read(fd, ptr, size);
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (got == 0)
+            return 0;
+        ptr += got;
+        size -= (size_t) got;
+    }
+    return 1;
+}
+
+/** @brief Odczytuje kolejną grupę.
+ * @param[in] fd - deskryptor pliku ustawiony na początek grupy;
+ * @param[in,out] buffer - wskaźnik na bufor, powiększany w razie potrzeby;
+ * @param[in,out] capacity - wskaźnik na rozmiar bufora;
+ * @param[out] size - wskaźnik na rozmiar odczytanych rekordów.
+ * @return Wartość 1, jeśli odczytano poprawną grupę, 0 przy końcu pliku lub
+ *         niekompletnej grupie i -1 przy błędzie odczytu lub alokacji.
+ */
+static int readGroup(int fd, unsigned char **buffer, size_t *capacity, size_t *size) {
+    unsigned char header[GROUP_HEADER];
+    int res = readAll(fd, header, GROUP_HEADER);
+    if (res <= 0)
+        return res;
+
+    *size = loadWord(header);
+    if (*size > *capacity) {
+        unsigned char *temp = realloc(*buffer, *size);
+        if (!temp)
+            return -1;
+        *buffer = temp;
+        *capacity = *size;
+    }
+    res = readAll(fd, *buffer, *size);
+    if (res <= 0)
+        return res;
+    return checksum(*buffer, *size) == loadWord(header + 4) ? 1 : 0;
+}
+
+/** @brief Otwiera plik dziennika.
+ * Sprawdza nagłówek istniejącego pliku i obcina niekompletną ostatnią grupę,
+ * a do pustego pliku zapisuje nagłówek.
+ * @param[in] path - wskaźnik na ścieżkę pliku;
+ * @param[in] truncate - flaga mówiąca czy wyczyścić plik.
+ * @return Deskryptor pliku ustawiony na jego koniec lub -1 w przypadku błędu.
+ */
+static int openFile(char const *path, bool truncate) {
+    int fd = open(path, O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0), 0644);
+    if (fd < 0)
+        return -1;
+
+    char magic[MAGIC_SIZE];
+    int res = readAll(fd, magic, MAGIC_SIZE);
+    if (res < 0 || (res > 0 && memcmp(magic, MAGIC, MAGIC_SIZE) != 0)) {
+        close(fd);
+        return -1;
+    }
+
+    off_t end = MAGIC_SIZE;
+    if (res == 0) {
+        if (lseek(fd, 0, SEEK_END) != 0 || !writeAll(fd, MAGIC, MAGIC_SIZE)) {
+            close(fd);
+            return -1;
+        }
+    } else {
+        unsigned char *buffer = NULL;
+        size_t capacity = 0, size;
+        while ((res = readGroup(fd, &buffer, &capacity, &size)) > 0)
+            end += GROUP_HEADER + (off_t) size;
+        free(buffer);
+        if (res < 0 || ftruncate(fd, end) != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    if (lseek(fd, end, SEEK_SET) != end) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/** @brief Tworzy dziennik dla otwartego pliku.
+ * @param[in] path - wskaźnik na ścieżkę pliku;
+ * @param[in] batch - liczba rekordów w grupie;
+ * @param[in] truncate - flaga mówiąca czy wyczyścić plik.
+ * @return Wskaźnik na dziennik lub NULL w przypadku błędu.
+ */
+static Journal *journalNew(char const *path, size_t batch, bool truncate) {
+    Journal *journal = malloc(sizeof(Journal));
+    if (!journal) return NULL;
+
+    journal->path = malloc((strlen(path) + 1) * sizeof(char));
+    journal->buffer = malloc(BUFFER_SIZE);
+    if (!journal->path || !journal->buffer) {
+        free(journal->path);
+        free(journal->buffer);
+        free(journal);
+        return NULL;
+    }
+    strcpy(journal->path, path);
+
+    journal->fd = openFile(path, truncate);
+    if (journal->fd >= 0 && pthread_mutex_init(&(journal->mutex), NULL) != 0) {
+        close(journal->fd);
+        journal->fd = -1;
+    }
+    if (journal->fd < 0) {
+        free(journal->path);
+        free(journal->buffer);
+        free(journal);
+        return NULL;
+    }
+    journal->size = GROUP_HEADER;
+    journal->capacity = BUFFER_SIZE;
+    journal->records = 0;
+    journal->batch = batch;
+    journal->failed = false;
+    return journal;
+}
+
+/** @brief Zapisuje bieżącą grupę na dysk.
+ * @param[in,out] journal - wskaźnik na dziennik.
+ * @return Wartość @p false, jeśli wystąpił błąd zapisu teraz lub wcześniej.
+ */
+static bool flushGroup(Journal *journal) {
+    if (journal->records == 0 || journal->failed)
+        return !journal->failed;
+
+    size_t payload = journal->size - GROUP_HEADER;
+    storeWord(journal->buffer, (uint32_t) payload);
+    storeWord(journal->buffer + 4, checksum(journal->buffer + GROUP_HEADER, payload));
+    if (!writeAll(journal->fd, journal->buffer, journal->size) || fsync(journal->fd) != 0)
+        journal->failed = true;
+
+    journal->size = GROUP_HEADER;
+    journal->records = 0;
+    return !journal->failed;
+}
+
+/** @brief Dopisuje numer do bufora.
+ * Zapisuje długość numeru jako liczbę o zmiennej długości, a potem cyfry po
+ * dwie w bajcie, uzupełniając nieparzystą liczbę cyfr wartością 0xF.
+ * @param[in,out] dst - wskaźnik na miejsce w buforze;
+ * @param[in] num - wskaźnik na napis reprezentujący poprawny numer.
+ * @return Wskaźnik na miejsce za zapisanym numerem.
+ */
+static unsigned char *encodeNumber(unsigned char *dst, char const *num) {
+    size_t len = strlen(num);
+    size_t value = len;
+    do {
+        *dst++ = (unsigned char) ((value & 0x7F) | (value > 0x7F ? 0x80 : 0));
+        value >>= 7;
+    } while (value > 0);
+
+    for (size_t i = 0; i < len; i += 2) {
+        unsigned high = (unsigned) trieIndex(num[i]);
+        unsigned low = i + 1 < len ? (unsigned) trieIndex(num[i + 1]) : 0xF;
+        *dst++ = (unsigned char) ((high << 4) | low);
+    }
+    return dst;
+}
+
+/** @brief Odczytuje numer z bufora.
+ * @param[in,out] src - wskaźnik na pozycję w buforze;
+ * @param[in] end - wskaźnik na koniec rekordów;
+ * @param[in,out] num - wskaźnik na bufor numeru, powiększany w razie potrzeby;
+ * @param[in,out] capacity - wskaźnik na rozmiar bufora numeru.
+ * @return Wartość @p false, jeśli rekord jest uszkodzony lub nie udało się
+ *         alokować pamięci.
+ */
+static bool decodeNumber(unsigned char const **src, unsigned char const *end,
+                         char **num, size_t *capacity) {
+    size_t len = 0;
+    for (unsigned shift = 0; ; shift += 7) {
+        if (*src == end || shift >= 8 * sizeof(size_t))
+            return false;
+        unsigned char byte = *(*src)++;
+        len |= (size_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            break;
+    }
+    if ((size_t) (end - *src) < (len + 1) / 2 || len == 0)
+        return false;
+
+    if (len + 1 > *capacity) {
+        char *temp = realloc(*num, len + 1);
+        if (!temp)
+            return false;
+        *num = temp;
+        *capacity = len + 1;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        unsigned nibble = i % 2 == 0 ? (*src)[i / 2] >> 4 : (*src)[i / 2] & 0xF;
+        if (nibble >= N)
+            return false;
+        (*num)[i] = trieSymbol((int) nibble);
+    }
+    (*num)[len] = '\0';
+    *src += (len + 1) / 2;
+    return true;
+}
+
+Journal *journalOpen(char const *path, size_t batch) {
+    if (!path) return NULL;
+    return journalNew(path, batch, false);
+}
+
+void journalClose(Journal *journal) {
+    if (!journal) return;
+    flushGroup(journal);
+    close(journal->fd);
+    pthread_mutex_destroy(&(journal->mutex));
+    free(journal->path);
+    free(journal->buffer);
+    free(journal);
+}
+
+/** @brief Dopisuje rekord.
+ * Działa tak jak @ref journalAppend, zakładając, że blokada dziennika jest zajęta.
+ * @param[in,out] journal – wskaźnik na dziennik;
+ * @param[in] add  – @p true dla dodania przekierowania, @p false dla usunięcia;
+ * @param[in] num1 – wskaźnik na napis reprezentujący poprawny numer;
+ * @param[in] num2 – wskaźnik na napis reprezentujący poprawny numer lub NULL.
+ * @return Wartość @p false, jeśli wystąpił błąd zapisu lub alokacji pamięci.
+ */
+static bool appendRecord(Journal *journal, bool add, char const *num1, char const *num2) {
+    if (journal->failed)
+        return false;
+
+    size_t need = 1 + 2 * sizeof(size_t) + strlen(num1) / 2 + 1;
+    if (add)
+        need += sizeof(size_t) + strlen(num2) / 2 + 1;
+
+    if (journal->size + need > journal->capacity) {
+        if (!flushGroup(journal))
+            return false;
+        if (GROUP_HEADER + need > journal->capacity) {
+            unsigned char *temp = realloc(journal->buffer, GROUP_HEADER + need);
+            if (!temp) {
+                journal->failed = true;
+                return false;
+            }
+            journal->buffer = temp;
+            journal->capacity = GROUP_HEADER + need;
+        }
+    }
+
+    unsigned char *dst = journal->buffer + journal->size;
+    *dst++ = add ? OP_ADD : OP_REMOVE;
+    dst = encodeNumber(dst, num1);
+    if (add)
+        dst = encodeNumber(dst, num2);
+    journal->size = (size_t) (dst - journal->buffer);
+    ++journal->records;
+
+    if (journal->batch > 0 && journal->records >= journal->batch)
+        return flushGroup(journal);
+    return true;
+}
+
+bool journalAppend(Journal *journal, bool add, char const *num1, char const *num2) {
+    pthread_mutex_lock(&(journal->mutex));
+    bool res = appendRecord(journal, add, num1, num2);
+    pthread_mutex_unlock(&(journal->mutex));
+    return res;
+}
+
+bool journalSync(Journal *journal) {
+    pthread_mutex_lock(&(journal->mutex));
+    bool res = flushGroup(journal);
+    pthread_mutex_unlock(&(journal->mutex));
+    return res;
+}
+
+Journal *journalCompactBegin(Journal const *journal) {
+    char *path = malloc((strlen(journal->path) + strlen(COMPACT_SUFFIX) + 1) * sizeof(char));
+    if (!path) return NULL;
+    strcpy(path, journal->path);
+    strcat(path, COMPACT_SUFFIX);
+
+    Journal *compacted = journalNew(path, 0, true);
+    free(path);
+    return compacted;
+}
+
+bool journalCompactEnd(Journal *journal, Journal *compacted, bool commit) {
+    pthread_mutex_lock(&(journal->mutex));
+    if (commit && flushGroup(compacted) && rename(compacted->path, journal->path) == 0) {
+        close(journal->fd);
+        journal->fd = compacted->fd;
+        journal->size = GROUP_HEADER;
+        journal->records = 0;
+        journal->failed = false;
+        compacted->fd = -1;
+    } else {
+        commit = false;
+        unlink(compacted->path);
+    }
+    pthread_mutex_unlock(&(journal->mutex));
+
+    if (compacted->fd >= 0)
+        close(compacted->fd);
+    pthread_mutex_destroy(&(compacted->mutex));
+    free(compacted->path);
+    free(compacted->buffer);
+    free(compacted);
+    return commit;
+}
+
+bool journalReplay(char const *path, JournalApply apply, void *ctx) {
+    if (!path) return false;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    char magic[MAGIC_SIZE];
+    if (readAll(fd, magic, MAGIC_SIZE) <= 0 || memcmp(magic, MAGIC, MAGIC_SIZE) != 0) {
+        close(fd);
+        return false;
+    }
+
+    unsigned char *buffer = NULL;
+    size_t capacity = 0, size, capacity1 = 0, capacity2 = 0;
+    char *num1 = NULL, *num2 = NULL;
+    bool ok = true;
+    int res = 0;
+    while (ok && (res = readGroup(fd, &buffer, &capacity, &size)) > 0) {
+        unsigned char const *src = buffer, *end = buffer + size;
+        while (ok && src < end) {
+            unsigned char op = *src++;
+            ok = (op == OP_ADD || op == OP_REMOVE) && decodeNumber(&src, end, &num1, &capacity1);
+            if (ok && op == OP_ADD)
+                ok = decodeNumber(&src, end, &num2, &capacity2);
+            if (ok)
+                ok = apply(ctx, op == OP_ADD, num1, op == OP_ADD ? num2 : NULL);
+        }
+    }
+    if (res < 0)
+        ok = false;
+
+    free(buffer);
+    free(num1);
+    free(num2);
+    close(fd);
+    return ok;
+}
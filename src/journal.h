@@ -0,0 +1,101 @@
+/** @file
+ * Interfejs dziennika zmian przekierowań
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __JOURNAL_H__
+#define __JOURNAL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * To jest struktura reprezentująca otwarty do dopisywania plik dziennika.
+ * Plik zaczyna się nagłówkiem, po którym następują grupy rekordów. Grupa ma
+ * długość i sumę kontrolną, więc niedokończony zapis ostatniej grupy jest
+ * wykrywany przy odtwarzaniu. Rekord to kod operacji i numery zapisane po dwie
+ * cyfry w bajcie.
+ */
+struct Journal;
+typedef struct Journal Journal;
+
+/** @brief Funkcja wykonująca odtwarzaną operację.
+ * @param[in,out] ctx – wskaźnik przekazany do @ref journalReplay;
+ * @param[in] add     – @p true dla dodania przekierowania, @p false dla usunięcia;
+ * @param[in] num1    – wskaźnik na pierwszy numer operacji;
+ * @param[in] num2    – wskaźnik na drugi numer lub NULL dla usunięcia.
+ * @return Wartość @p false, jeśli odtwarzanie ma zostać przerwane.
+ */
+typedef bool (*JournalApply)(void *ctx, bool add, char const *num1, char const *num2);
+
+/** @brief Otwiera dziennik.
+ * Otwiera plik @p path do dopisywania, tworząc go z nagłówkiem, jeśli nie
+ * istnieje lub jest pusty. Rekordy są zapisywane na dysk grupami po @p batch.
+ * @param[in] path  – wskaźnik na ścieżkę pliku;
+ * @param[in] batch – liczba rekordów w grupie lub 0, jeśli grupy mają być
+ *                    zapisywane tylko przy @ref journalSync i zapełnieniu bufora.
+ * @return Wskaźnik na dziennik lub NULL, gdy nie udało się otworzyć pliku,
+ *         plik nie jest dziennikiem lub nie udało się alokować pamięci.
+ */
+Journal *journalOpen(char const *path, size_t batch);
+
+/** @brief Zamyka dziennik.
+ * Zapisuje buforowane rekordy i zamyka plik. Nic nie robi, jeśli wskaźnik
+ * @p journal ma wartość NULL.
+ * @param[in] journal – wskaźnik na dziennik.
+ */
+void journalClose(Journal *journal);
+
+/** @brief Dopisuje rekord.
+ * @param[in,out] journal – wskaźnik na dziennik;
+ * @param[in] add  – @p true dla dodania przekierowania, @p false dla usunięcia;
+ * @param[in] num1 – wskaźnik na napis reprezentujący poprawny numer;
+ * @param[in] num2 – wskaźnik na napis reprezentujący poprawny numer lub NULL
+ *                   dla usunięcia.
+ * @return Wartość @p false, jeśli wystąpił błąd zapisu lub alokacji pamięci
+ *         teraz lub przy którymś z wcześniejszych zapisów.
+ */
+bool journalAppend(Journal *journal, bool add, char const *num1, char const *num2);
+
+/** @brief Zapisuje buforowane rekordy na dysk.
+ * Zapisuje bieżącą grupę i czeka, aż trafi ona na dysk.
+ * @param[in,out] journal – wskaźnik na dziennik.
+ * @return Wartość @p false, jeśli wystąpił błąd zapisu teraz lub wcześniej.
+ */
+bool journalSync(Journal *journal);
+
+/** @brief Zaczyna przepisywanie dziennika.
+ * Tworzy pusty dziennik tymczasowy obok pliku dziennika @p journal. Rekordy
+ * należy dopisywać do dziennika tymczasowego, a następnie wywołać
+ * @ref journalCompactEnd.
+ * @param[in] journal – wskaźnik na dziennik.
+ * @return Wskaźnik na dziennik tymczasowy lub NULL w przypadku błędu.
+ */
+Journal *journalCompactBegin(Journal const *journal);
+
+/** @brief Kończy przepisywanie dziennika.
+ * Jeśli @p commit jest prawdą i zapis się powiódł, zastępuje plik dziennika
+ * @p journal plikiem dziennika tymczasowego @p compacted i dalej dopisuje do
+ * niego rekordy. W przeciwnym razie usuwa dziennik tymczasowy.
+ * @param[in,out] journal   – wskaźnik na dziennik;
+ * @param[in] compacted     – wskaźnik na dziennik tymczasowy, zawsze zamykany;
+ * @param[in] commit        – flaga mówiąca czy zastąpić dziennik.
+ * @return Wartość @p true, jeśli dziennik został zastąpiony.
+ */
+bool journalCompactEnd(Journal *journal, Journal *compacted, bool commit);
+
+/** @brief Odtwarza dziennik.
+ * Wywołuje @p apply dla kolejnych rekordów wszystkich kompletnych grup
+ * z pliku @p path. Niekompletna lub uszkodzona ostatnia grupa jest pomijana.
+ * @param[in] path    – wskaźnik na ścieżkę pliku;
+ * @param[in] apply   – funkcja wykonująca operację;
+ * @param[in,out] ctx – wskaźnik przekazywany do @p apply.
+ * @return Wartość @p false, jeśli nie udało się odczytać pliku, plik nie jest
+ *         dziennikiem, nie udało się alokować pamięci lub @p apply zwróciła @p false.
+ */
+bool journalReplay(char const *path, JournalApply apply, void *ctx);
+
+#endif /* __JOURNAL_H__ */
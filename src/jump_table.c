@@ -0,0 +1,143 @@
+/** @file
+ * Implementacja tablicy skoków do górnych poziomów drzewa przekierowań
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+#include <stdlib.h>
+#include "jump_table.h"
+
+/**
+ * To jest struktura reprezentująca element tablicy skoków.
+ */
+typedef struct JumpEntry {
+    TrieNode const *node; /**< Najgłębszy istniejący wierzchołek na ścieżce napisu. */
+    TrieNode const *best; /**< Najgłębszy wierzchołek z przekierowaniem na tej ścieżce lub NULL. */
+    unsigned char depth; /**< Głębokość wierzchołka node. */
+    unsigned char bestLen; /**< Głębokość wierzchołka best. */
+} JumpEntry;
+
+/**
+ * To jest struktura reprezentująca tablicę skoków.
+ */
+struct JumpTable {
+    unsigned levels; /**< Liczba poziomów. */
+    size_t size; /**< Liczba elementów, czyli N do potęgi levels. */
+    JumpEntry entry[]; /**< Elementy indeksowane napisem w systemie o podstawie N. */
+};
+
+/** @brief Zwraca liczbę napisów danej długości.
+ * @param[in] length – długość napisu.
+ * @return N do potęgi @p length.
+ */
+static size_t power(unsigned length) {
+    size_t res = 1;
+    while (length-- > 0)
+        res *= N;
+    return res;
+}
+
+/** @brief Wypełnia elementy poddrzewa.
+ * Ustawia elementy wszystkich napisów o indeksach od @p idx * N^(levels - depth)
+ * zaczynających się ścieżką do wierzchołka @p node.
+ * @param[in,out] table – wskaźnik na tablicę;
+ * @param[in] node      – wskaźnik na wierzchołek na głębokości @p depth;
+ * @param[in] depth     – głębokość wierzchołka;
+ * @param[in] idx       – indeks napisu wierzchołka w systemie o podstawie N;
+ * @param[in] best      – najgłębszy wierzchołek z przekierowaniem na ścieżce lub NULL;
+ * @param[in] bestLen   – głębokość wierzchołka @p best.
+ */
+static void fill(JumpTable *table, TrieNode const *node, unsigned depth, size_t idx,
+                 TrieNode const *best, unsigned bestLen) {
+    if (depth == table->levels) {
+        table->entry[idx] = (JumpEntry) {node, best, (unsigned char) depth, (unsigned char) bestLen};
+        return;
+    }
+
+    size_t span = power(table->levels - depth - 1);
+    for (int i = 0; i < N; ++i) {
+        size_t next = idx * N + (size_t) i;
+        TrieNode const *child = node->child[i];
+        if (child) {
+            if (child->forward)
+                fill(table, child, depth + 1, next, child, depth + 1);
+            else
+                fill(table, child, depth + 1, next, best, bestLen);
+        } else {
+            JumpEntry entry = {node, best, (unsigned char) depth, (unsigned char) bestLen};
+            for (size_t j = next * span; j < (next + 1) * span; ++j)
+                table->entry[j] = entry;
+        }
+    }
+}
+
+JumpTable *jumpTableNew(TrieNode *root, unsigned levels) {
+    if (levels == 0 || levels > JUMP_TABLE_MAX_LEVELS)
+        return NULL;
+
+    size_t size = power(levels);
+    JumpTable *table = malloc(sizeof(JumpTable) + size * sizeof(JumpEntry));
+    if (!table) return NULL;
+
+    table->levels = levels;
+    table->size = size;
+    jumpTableRebuild(table, root);
+    return table;
+}
+
+void jumpTableDelete(JumpTable *table) {
+    free(table);
+}
+
+void jumpTableRebuild(JumpTable *table, TrieNode *root) {
+    fill(table, root, 0, 0, NULL, 0);
+}
+
+void jumpTableRefresh(JumpTable *table, TrieNode *root, char const *num, size_t prefix) {
+    if (!table)
+        return;
+
+    unsigned length = 0;
+    while (length < table->levels && length < prefix && num[length] != '\0')
+        ++length;
+    TrieNode const *node = root, *best = NULL;
+    unsigned depth = 0, bestLen = 0;
+    size_t idx = 0;
+    while (depth < length) {
+        TrieNode const *child = node->child[trieIndex(num[depth])];
+        if (!child)
+            break;
+        idx = idx * N + (size_t) trieIndex(num[depth]);
+        node = child;
+        ++depth;
+        if (node->forward) {
+            best = node;
+            bestLen = depth;
+        }
+    }
+
+    if (depth == length) {
+        fill(table, node, depth, idx, best, bestLen);
+        return;
+    }
+
+    for (unsigned i = depth; i < length; ++i)
+        idx = idx * N + (size_t) trieIndex(num[i]);
+    size_t span = power(table->levels - length);
+    JumpEntry entry = {node, best, (unsigned char) depth, (unsigned char) bestLen};
+    for (size_t j = idx * span; j < (idx + 1) * span; ++j)
+        table->entry[j] = entry;
+}
+
+char *jumpTableFindForward(JumpTable const *table, TrieNode *root, char const *num) {
+    size_t idx = 0;
+    for (unsigned i = 0; i < table->levels; ++i) {
+        if (num[i] == '\0')
+            return trieFindForward(&root, num);
+        idx = idx * N + (size_t) trieIndex(num[i]);
+    }
+
+    JumpEntry const *entry = &(table->entry[idx]);
+    return trieFindForwardFrom(entry->node, num, entry->depth, entry->best, entry->bestLen);
+}
@@ -0,0 +1,72 @@
+/** @file
+ * Interfejs tablicy skoków do górnych poziomów drzewa przekierowań
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __JUMP_TABLE_H__
+#define __JUMP_TABLE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "trie.h"
+
+#define JUMP_TABLE_MAX_LEVELS 5 /**< Największa liczba poziomów tablicy skoków. */
+
+/**
+ * To jest struktura reprezentująca tablicę skoków.
+ * Tablica ma po jednym elemencie dla każdego napisu złożonego z pierwszych
+ * @p k znaków numeru. Element wskazuje najgłębszy istniejący wierzchołek na
+ * ścieżce tego napisu oraz najgłębsze przekierowanie na tej ścieżce, więc
+ * wyszukiwanie przekierowania zaczyna się @p k poziomów pod korzeniem.
+ */
+struct JumpTable;
+typedef struct JumpTable JumpTable;
+
+/** @brief Tworzy tablicę skoków.
+ * Tworzy tablicę dla @p levels pierwszych poziomów drzewa forward @p root.
+ * @param[in] root   – wskaźnik na korzeń drzewa forward;
+ * @param[in] levels – liczba poziomów od 1 do @ref JUMP_TABLE_MAX_LEVELS.
+ * @return Wskaźnik na tablicę lub NULL, gdy liczba poziomów jest niepoprawna
+ *         lub nie udało się alokować pamięci.
+ */
+JumpTable *jumpTableNew(TrieNode *root, unsigned levels);
+
+/** @brief Usuwa tablicę skoków.
+ * Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param[in] table – wskaźnik na usuwaną tablicę.
+ */
+void jumpTableDelete(JumpTable *table);
+
+/** @brief Wyznacza ponownie wszystkie elementy tablicy.
+ * Wywoływana, gdy wierzchołki drzewa zostały przeniesione.
+ * @param[in,out] table – wskaźnik na tablicę;
+ * @param[in] root      – wskaźnik na korzeń drzewa forward.
+ */
+void jumpTableRebuild(JumpTable *table, TrieNode *root);
+
+/** @brief Wyznacza ponownie elementy tablicy dla prefiksu.
+ * Nic nie robi, jeśli wskaźnik @p table ma wartość NULL. Wyznacza elementy wszystkich napisów zaczynających się od pierwszych
+ * @p prefix znaków numeru @p num. Wywoływana po zmianie drzewa, która mogła
+ * dodać lub usunąć wierzchołki albo przekierowania tylko pod tym prefiksem.
+ * @param[in,out] table – wskaźnik na tablicę;
+ * @param[in] root      – wskaźnik na korzeń drzewa forward;
+ * @param[in] num       – wskaźnik na napis reprezentujący numer;
+ * @param[in] prefix    – długość prefiksu; dłuższy prefiks jest skracany do
+ *                        długości @p num.
+ */
+void jumpTableRefresh(JumpTable *table, TrieNode *root, char const *num, size_t prefix);
+
+/** @brief Zwraca przekierowanie numeru.
+ * Działa tak jak trieFindForward, ale korzysta z tablicy skoków dla numerów
+ * nie krótszych niż liczba jej poziomów.
+ * @param[in] table – wskaźnik na tablicę;
+ * @param[in] root  – wskaźnik na korzeń drzewa forward;
+ * @param[in] num   – wskaźnik na napis reprezentujący poprawny numer.
+ * @return Wynik taki jak dla trieFindForward.
+ */
+char *jumpTableFindForward(JumpTable const *table, TrieNode *root, char const *num);
+
+#endif /* __JUMP_TABLE_H__ */
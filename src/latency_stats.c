@@ -0,0 +1,197 @@
+/** @file
+ * Implementacja histogramów opóźnień operacji
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+#define _POSIX_C_SOURCE 200809L /**< Udostępnia clock_gettime. */
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "latency_stats.h"
+
+#define SUB_BITS 3 /**< Liczba bitów wartości wyznaczających kubełek w ramach potęgi dwójki. */
+#define SUB_BUCKETS (1 << SUB_BITS) /**< Liczba kubełków na potęgę dwójki. */
+#define MAX_MAGNITUDE 40 /**< Wykładnik potęgi dwójki, od której wartości trafiają do ostatniego kubełka. */
+#define BUCKETS ((MAX_MAGNITUDE - SUB_BITS + 2) * SUB_BUCKETS) /**< Liczba kubełków histogramu. */
+
+/**
+ * To jest struktura reprezentująca histogram opóźnień.
+ */
+typedef struct LatencyHistogram {
+    atomic_uint_least64_t count[BUCKETS]; /**< Liczby pomiarów w kubełkach. */
+} LatencyHistogram;
+
+/**
+ * To jest struktura przechowująca histogramy opóźnień.
+ */
+struct LatencyStats {
+    LatencyHistogram histogram[LATENCY_OPS][LATENCY_LENGTH_CLASSES][LATENCY_COUNT_CLASSES]; /**< Histogramy operacji. */
+};
+
+/** @brief Wyznacza wykładnik najwyższego ustawionego bitu.
+ * @param[in] value – niezerowa wartość.
+ * @return Wykładnik najwyższej potęgi dwójki nie większej niż @p value.
+ */
+static int magnitude(uint64_t value) {
+    return 63 - __builtin_clzll(value);
+}
+
+/** @brief Wyznacza kubełek wartości.
+ * Wartości mniejsze niż @ref SUB_BUCKETS mają własne kubełki, a większe
+ * trafiają do jednego z @ref SUB_BUCKETS kubełków swojej potęgi dwójki.
+ * @param[in] value – wartość w nanosekundach.
+ * @return Indeks kubełka.
+ */
+static int bucketIndex(uint64_t value) {
+    if (value < SUB_BUCKETS)
+        return (int) value;
+    int m = magnitude(value);
+    if (m > MAX_MAGNITUDE)
+        return BUCKETS - 1;
+    return (m - SUB_BITS + 1) * SUB_BUCKETS + (int) ((value >> (m - SUB_BITS)) & (SUB_BUCKETS - 1));
+}
+
+/** @brief Wyznacza górną granicę kubełka.
+ * @param[in] index – indeks kubełka.
+ * @return Największa wartość trafiająca do kubełka.
+ */
+static uint64_t bucketLimit(int index) {
+    if (index < SUB_BUCKETS)
+        return (uint64_t) index;
+    if (index == BUCKETS - 1)
+        return UINT64_MAX;
+    int m = index / SUB_BUCKETS + SUB_BITS - 1, sub = index % SUB_BUCKETS;
+    return ((uint64_t) (SUB_BUCKETS + sub + 1) << (m - SUB_BITS)) - 1;
+}
+
+/** @brief Sumuje kubełki wybranych histogramów.
+ * @param[in] stats       – wskaźnik na strukturę histogramów;
+ * @param[in] op          – indeks operacji;
+ * @param[in] lengthClass – klasa długości numeru lub -1;
+ * @param[in] countClass  – klasa liczby wyników lub -1;
+ * @param[out] sum        – tablica @ref BUCKETS sum kubełków.
+ * @return Łączna liczba pomiarów.
+ */
+static uint64_t sumBuckets(LatencyStats const *stats, int op, int lengthClass, int countClass,
+                           uint64_t *sum) {
+    uint64_t total = 0;
+    for (int b = 0; b < BUCKETS; ++b)
+        sum[b] = 0;
+    for (int l = 0; l < LATENCY_LENGTH_CLASSES; ++l) {
+        if (lengthClass >= 0 && l != lengthClass)
+            continue;
+        for (int c = 0; c < LATENCY_COUNT_CLASSES; ++c) {
+            if (countClass >= 0 && c != countClass)
+                continue;
+            LatencyHistogram const *histogram = &(stats->histogram[op][l][c]);
+            for (int b = 0; b < BUCKETS; ++b) {
+                uint64_t count = atomic_load_explicit(&(histogram->count[b]), memory_order_relaxed);
+                sum[b] += count;
+                total += count;
+            }
+        }
+    }
+    return total;
+}
+
+/** @brief Wyznacza percentyl z sum kubełków.
+ * @param[in] sum        – tablica @ref BUCKETS sum kubełków;
+ * @param[in] total      – łączna liczba pomiarów;
+ * @param[in] percentile – percentyl z przedziału od 0 do 100.
+ * @return Górna granica kubełka zawierającego percentyl lub 0, gdy nie ma pomiarów.
+ */
+static uint64_t findPercentile(uint64_t const *sum, uint64_t total, double percentile) {
+    if (total == 0)
+        return 0;
+    uint64_t rank = (uint64_t) (percentile / 100 * (double) total);
+    if (rank >= total)
+        rank = total - 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < BUCKETS; ++b) {
+        seen += sum[b];
+        if (seen > rank)
+            return bucketLimit(b);
+    }
+    return bucketLimit(BUCKETS - 1);
+}
+
+LatencyStats *latencyStatsNew(void) {
+    LatencyStats *stats = malloc(sizeof(struct LatencyStats));
+    if (!stats) return NULL;
+
+    for (int op = 0; op < LATENCY_OPS; ++op)
+        for (int l = 0; l < LATENCY_LENGTH_CLASSES; ++l)
+            for (int c = 0; c < LATENCY_COUNT_CLASSES; ++c)
+                for (int b = 0; b < BUCKETS; ++b)
+                    atomic_init(&(stats->histogram[op][l][c].count[b]), 0);
+    return stats;
+}
+
+void latencyStatsDelete(LatencyStats *stats) {
+    free(stats);
+}
+
+uint64_t latencyNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+int latencyLengthClass(size_t length) {
+    int res = length < 4 ? 0 : magnitude(length) - 1;
+    return res < LATENCY_LENGTH_CLASSES ? res : LATENCY_LENGTH_CLASSES - 1;
+}
+
+int latencyCountClass(size_t results) {
+    if (results < 2)
+        return (int) results;
+    if (results < 4)
+        return 2;
+    int res = 3 + (magnitude(results) - 2) / 2;
+    return res < LATENCY_COUNT_CLASSES ? res : LATENCY_COUNT_CLASSES - 1;
+}
+
+void latencyRecord(LatencyStats *stats, int op, size_t length, size_t results, uint64_t ns) {
+    LatencyHistogram *histogram =
+            &(stats->histogram[op][latencyLengthClass(length)][latencyCountClass(results)]);
+    atomic_fetch_add_explicit(&(histogram->count[bucketIndex(ns)]), 1, memory_order_relaxed);
+}
+
+uint64_t latencyCount(LatencyStats const *stats, int op, int lengthClass, int countClass) {
+    uint64_t sum[BUCKETS];
+    return sumBuckets(stats, op, lengthClass, countClass, sum);
+}
+
+uint64_t latencyPercentile(LatencyStats const *stats, int op, int lengthClass, int countClass,
+                           double percentile) {
+    uint64_t sum[BUCKETS];
+    uint64_t total = sumBuckets(stats, op, lengthClass, countClass, sum);
+    return findPercentile(sum, total, percentile);
+}
+
+void latencyPrint(LatencyStats const *stats, char const *const *names, FILE *out) {
+    static char const *const lengths[LATENCY_LENGTH_CLASSES] = {"0-3", "4-7", "8-15", "16-31", "32+"};
+    static char const *const counts[LATENCY_COUNT_CLASSES] = {"0", "1", "2-3", "4-15", "16-63", "64+"};
+    double const percentiles[] = {50, 90, 99, 99.9};
+    uint64_t sum[BUCKETS];
+
+    fprintf(out, "%-12s %6s %6s %10s %9s %9s %9s %9s\n",
+            "op", "length", "count", "samples", "p50[us]", "p90[us]", "p99[us]", "p99.9[us]");
+    for (int op = 0; op < LATENCY_OPS; ++op) {
+        for (int l = 0; l < LATENCY_LENGTH_CLASSES; ++l) {
+            for (int c = 0; c < LATENCY_COUNT_CLASSES; ++c) {
+                uint64_t total = sumBuckets(stats, op, l, c, sum);
+                if (total == 0)
+                    continue;
+                fprintf(out, "%-12s %6s %6s %10llu", names[op], lengths[l], counts[c],
+                        (unsigned long long) total);
+                for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); ++i)
+                    fprintf(out, " %9.2f", (double) findPercentile(sum, total, percentiles[i]) / 1e3);
+                fprintf(out, "\n");
+            }
+        }
+    }
+}
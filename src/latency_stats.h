@@ -0,0 +1,104 @@
+/** @file
+ * Interfejs histogramów opóźnień operacji
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __LATENCY_STATS_H__
+#define __LATENCY_STATS_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define LATENCY_OPS 8 /**< Liczba rodzajów mierzonych operacji. */
+#define LATENCY_LENGTH_CLASSES 5 /**< Liczba klas długości numeru. */
+#define LATENCY_COUNT_CLASSES 6 /**< Liczba klas liczby wyników. */
+
+/**
+ * To jest struktura przechowująca histogramy opóźnień.
+ * Każda operacja ma osobny histogram dla każdej pary klasy długości numeru
+ * i klasy liczby wyników. Histogram ma kubełki o szerokości rosnącej
+ * wykładniczo, z ośmioma kubełkami na każdą potęgę dwójki, więc błąd
+ * względny odczytanej wartości nie przekracza 12,5%.
+ */
+struct LatencyStats;
+typedef struct LatencyStats LatencyStats;
+
+/** @brief Tworzy nową strukturę.
+ * Tworzy strukturę z pustymi histogramami.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+LatencyStats *latencyStatsNew(void);
+
+/** @brief Usuwa strukturę.
+ * Usuwa strukturę wskazywaną przez @p stats. Nic nie robi, jeśli wskaźnik ten ma
+ * wartość NULL.
+ * @param[in] stats – wskaźnik na usuwaną strukturę.
+ */
+void latencyStatsDelete(LatencyStats *stats);
+
+/** @brief Zwraca bieżący czas.
+ * @return Czas monotoniczny w nanosekundach.
+ */
+uint64_t latencyNow(void);
+
+/** @brief Wyznacza klasę długości numeru.
+ * Klasy obejmują długości 0–3, 4–7, 8–15, 16–31 i co najmniej 32.
+ * @param[in] length – długość numeru.
+ * @return Indeks klasy.
+ */
+int latencyLengthClass(size_t length);
+
+/** @brief Wyznacza klasę liczby wyników.
+ * Klasy obejmują 0, 1, 2–3, 4–15, 16–63 i co najmniej 64 wyniki.
+ * @param[in] results – liczba wyników.
+ * @return Indeks klasy.
+ */
+int latencyCountClass(size_t results);
+
+/** @brief Zapisuje pomiar.
+ * Może być wywoływana jednocześnie przez wiele wątków.
+ * @param[in,out] stats – wskaźnik na strukturę histogramów;
+ * @param[in] op        – indeks operacji mniejszy od @ref LATENCY_OPS;
+ * @param[in] length    – długość numeru;
+ * @param[in] results   – liczba wyników;
+ * @param[in] ns        – czas trwania operacji w nanosekundach.
+ */
+void latencyRecord(LatencyStats *stats, int op, size_t length, size_t results, uint64_t ns);
+
+/** @brief Zwraca liczbę pomiarów.
+ * @param[in] stats       – wskaźnik na strukturę histogramów;
+ * @param[in] op          – indeks operacji;
+ * @param[in] lengthClass – klasa długości numeru lub -1 dla wszystkich klas;
+ * @param[in] countClass  – klasa liczby wyników lub -1 dla wszystkich klas.
+ * @return Liczba pomiarów z wybranych histogramów.
+ */
+uint64_t latencyCount(LatencyStats const *stats, int op, int lengthClass, int countClass);
+
+/** @brief Zwraca percentyl opóźnień.
+ * @param[in] stats       – wskaźnik na strukturę histogramów;
+ * @param[in] op          – indeks operacji;
+ * @param[in] lengthClass – klasa długości numeru lub -1 dla wszystkich klas;
+ * @param[in] countClass  – klasa liczby wyników lub -1 dla wszystkich klas;
+ * @param[in] percentile  – percentyl z przedziału od 0 do 100.
+ * @return Górna granica kubełka zawierającego percentyl w nanosekundach
+ *         lub 0, gdy wybrane histogramy są puste.
+ */
+uint64_t latencyPercentile(LatencyStats const *stats, int op, int lengthClass, int countClass,
+                           double percentile);
+
+/** @brief Wypisuje histogramy.
+ * Dla każdego niepustego histogramu wypisuje wiersz z nazwą operacji,
+ * klasami, liczbą pomiarów oraz percentylami 50, 90, 99 i 99,9 w mikrosekundach.
+ * @param[in] stats – wskaźnik na strukturę histogramów;
+ * @param[in] names – tablica @ref LATENCY_OPS nazw operacji;
+ * @param[in] out   – strumień wyjściowy.
+ */
+void latencyPrint(LatencyStats const *stats, char const *const *names, FILE *out);
+
+#endif /* __LATENCY_STATS_H__ */
@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
 
 typedef struct Node Node;
 /**
@@ -9,6 +10,7 @@ struct Node {
     char *data; /**< Tablica reprezentująca numer telefonu.*/
     Node *next; /**< Wskaźnik na kolejny element.*/
     Node *prev; /**< Wskaźnik na poprzedni element.*/
+    bool inArena; /**< Flaga mówiąca czy element i jego numer leżą w bloku po kompaktowaniu.*/
 };
 
 
@@ -34,9 +36,23 @@ void deleteNode(Node **head, Node *element) {
     if (element->prev)
         element->prev->next = element->next;
 
-    if (element->data)
+    if (!element->inArena) {
         free(element->data);
-    free(element);
+        free(element);
+    }
+}
+
+void listDelete(Node **head) {
+    Node *ptr = *head;
+    while (ptr) {
+        Node *next = ptr->next;
+        if (!ptr->inArena) {
+            free(ptr->data);
+            free(ptr);
+        }
+        ptr = next;
+    }
+    *head = NULL;
 }
 
 Node *push(Node** head, char const *data) {
@@ -56,6 +72,7 @@ Node *push(Node** head, char const *data) {
         newNode->data[i] = data[i];
 
     newNode->prev = NULL;
+    newNode->inArena = false;
     newNode->next = (*head);
 
     if (*head)
@@ -8,6 +8,8 @@
 #ifndef __LINKED_LIST_H__
 #define __LINKED_LIST_H__
 
+#include <stdbool.h>
+
 typedef struct Node Node;
 /**
  * To jest struktura reprezentująca linked list.
@@ -16,6 +18,7 @@ struct Node {
     char *data; /**< Tablica reprezentująca numer telefonu.*/
     Node *next; /**< Wskaźnik na kolejny element.*/
     Node *prev; /**< Wskaźnik na poprzedni element.*/
+    bool inArena; /**< Flaga mówiąca czy element i jego numer leżą w bloku po kompaktowaniu.*/
 };
 
 /** @brief Zwraca rozmiar listy.
@@ -41,4 +44,10 @@ Node *push(Node **head, char const *data);
  */
 void deleteNode(Node **head, Node *element);
 
+/** @brief Usuwa listę.
+ * Usuwa wszystkie elementy listy wskazywanej przez @p head i ustawia ją na pustą.
+ * @param[in,out] head – wskaźnik na liste czyli na wskaźnik pierwszego elementu.
+ */
+void listDelete(Node **head);
+
 #endif
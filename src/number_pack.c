@@ -0,0 +1,56 @@
+/** @file
+ * Implementacja spakowanego ciągu numerów telefonów
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "number_pack.h"
+
+void numberPackInit(NumberPack *pack) {
+    pack->chars = NULL;
+    pack->length = 0;
+    pack->charsCapacity = 0;
+    pack->offsets = NULL;
+    pack->size = 0;
+    pack->offsetsCapacity = 0;
+}
+
+void numberPackFree(NumberPack *pack) {
+    free(pack->chars);
+    free(pack->offsets);
+    numberPackInit(pack);
+}
+
+bool numberPackAppend(NumberPack *pack, char const *prefix, size_t prefixLength, char const *suffix) {
+    size_t suffixLength = strlen(suffix), needed = pack->length + prefixLength + suffixLength + 1;
+    if (needed > pack->charsCapacity) {
+        size_t capacity = pack->charsCapacity ? 2 * pack->charsCapacity : 256;
+        while (capacity < needed)
+            capacity *= 2;
+        char *temp = realloc(pack->chars, capacity * sizeof(char));
+        if (!temp) return false;
+        pack->chars = temp;
+        pack->charsCapacity = capacity;
+    }
+    if (pack->size == pack->offsetsCapacity) {
+        size_t capacity = pack->offsetsCapacity ? 2 * pack->offsetsCapacity : 16;
+        size_t *temp = realloc(pack->offsets, capacity * sizeof(size_t));
+        if (!temp) return false;
+        pack->offsets = temp;
+        pack->offsetsCapacity = capacity;
+    }
+
+    char *dst = pack->chars + pack->length;
+    memcpy(dst, prefix, prefixLength);
+    memcpy(dst + prefixLength, suffix, suffixLength + 1);
+    pack->offsets[pack->size++] = pack->length;
+    pack->length = needed;
+    return true;
+}
+
+char const *numberPackGet(NumberPack const *pack, size_t idx) {
+    return pack->chars + pack->offsets[idx];
+}
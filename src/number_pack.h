@@ -0,0 +1,60 @@
+/** @file
+ * Interfejs spakowanego ciągu numerów telefonów
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __NUMBER_PACK_H__
+#define __NUMBER_PACK_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct NumberPack NumberPack;
+/**
+ * To jest struktura przechowująca ciąg numerów w jednym buforze znaków.
+ * Numery są zapisane jeden za drugim, każdy zakończony znakiem '\0',
+ * a tablica offsets wskazuje ich początki.
+ */
+struct NumberPack {
+    char *chars; /**< Bufor z numerami. */
+    size_t length; /**< Liczba zajętych znaków bufora. */
+    size_t charsCapacity; /**< Rozmiar bufora. */
+    size_t *offsets; /**< Początki kolejnych numerów w buforze. */
+    size_t size; /**< Liczba numerów. */
+    size_t offsetsCapacity; /**< Rozmiar tablicy offsets. */
+};
+
+/** @brief Inicjuje pusty ciąg.
+ * @param[out] pack – wskaźnik na ciąg.
+ */
+void numberPackInit(NumberPack *pack);
+
+/** @brief Zwalnia pamięć ciągu.
+ * @param[in,out] pack – wskaźnik na ciąg.
+ */
+void numberPackFree(NumberPack *pack);
+
+/** @brief Dopisuje numer.
+ * Dopisuje na koniec ciągu numer złożony z @p prefixLength pierwszych znaków
+ * @p prefix i całego napisu @p suffix.
+ * @param[in,out] pack – wskaźnik na ciąg;
+ * @param[in] prefix – wskaźnik na początek numeru;
+ * @param[in] prefixLength – liczba znaków z @p prefix;
+ * @param[in] suffix – wskaźnik na napis z końcem numeru.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci; ciąg nie
+ *         jest wtedy zmieniany.
+ */
+bool numberPackAppend(NumberPack *pack, char const *prefix, size_t prefixLength, char const *suffix);
+
+/** @brief Udostępnia numer.
+ * Wskaźnik jest ważny do następnej zmiany ciągu.
+ * @param[in] pack – wskaźnik na ciąg;
+ * @param[in] idx – indeks numeru mniejszy od @p pack->size.
+ * @return Wskaźnik na napis reprezentujący numer.
+ */
+char const *numberPackGet(NumberPack const *pack, size_t idx);
+
+#endif /* __NUMBER_PACK_H__ */
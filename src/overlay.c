@@ -0,0 +1,258 @@
+/** @file
+ * Implementacja nakładki zmian na współdzielone drzewa przekierowań
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "overlay.h"
+#include "linked_list.h"
+
+typedef struct MaskNode MaskNode;
+/**
+ * To jest struktura reprezentująca wierzchołek drzewa masek.
+ */
+struct MaskNode {
+    MaskNode *child[N]; /**< Dzieci wierzchołka. */
+    MaskNode *father; /**< Ojciec wierzchołka lub NULL dla korzenia. */
+    unsigned char position; /**< Indeks wierzchołka w tablicy dzieci ojca. */
+    bool masked; /**< Flaga mówiąca czy numer wierzchołka ma maskę. */
+};
+
+/**
+ * To jest struktura opisująca nakładkę na drzewa bazowe.
+ */
+struct Overlay {
+    TrieNode const *baseForward; /**< Korzeń bazowego drzewa forward. */
+    ReverseNode const *baseReverse; /**< Korzeń bazowego drzewa reverse. */
+    MaskNode *masks; /**< Korzeń drzewa masek. */
+};
+
+/** @brief Tworzy wierzchołek drzewa masek.
+ * @param[in] father - wskaźnik na ojca lub NULL;
+ * @param[in] position - indeks wierzchołka w tablicy dzieci ojca.
+ * @return Wskaźnik na wierzchołek lub NULL, gdy nie udało się alokować pamięci.
+ */
+static MaskNode *maskNew(MaskNode *father, int position) {
+    MaskNode *node = calloc(1, sizeof(MaskNode));
+    if (node) {
+        node->father = father;
+        node->position = (unsigned char) position;
+    }
+    return node;
+}
+
+/** @brief Usuwa poddrzewo masek.
+ * Usuwa wierzchołek @p top razem z poddrzewem i odłącza go od ojca.
+ * @param[in] top - wskaźnik na korzeń usuwanego poddrzewa.
+ */
+static void maskDelete(MaskNode *top) {
+    MaskNode *node = top;
+    while (true) {
+        int idx = 0;
+        while (idx < N && !node->child[idx])
+            ++idx;
+        if (idx < N) {
+            node = node->child[idx];
+            continue;
+        }
+
+        bool last = node == top;
+        MaskNode *father = node->father;
+        if (father)
+            father->child[node->position] = NULL;
+        free(node);
+        if (last)
+            return;
+        node = father;
+    }
+}
+
+/** @brief Zwraca długość najkrótszego prefiksu numeru z maską.
+ * @param[in] overlay - wskaźnik na nakładkę;
+ * @param[in] num - wskaźnik na numer;
+ * @param[in] length - długość numeru.
+ * @return Długość najkrótszego prefiksu z maską lub @p length + 1, gdy żaden
+ *         prefiks nie ma maski.
+ */
+static size_t maskedLength(Overlay const *overlay, char const *num, size_t length) {
+    MaskNode const *node = overlay->masks;
+    for (size_t i = 0; i < length; ++i) {
+        node = node->child[trieIndex(num[i])];
+        if (!node)
+            break;
+        if (node->masked)
+            return i + 1;
+    }
+    return length + 1;
+}
+
+/** @brief Wyszukuje najdłuższy prefiks z przekierowaniem.
+ * @param[in] root - wskaźnik na korzeń drzewa forward;
+ * @param[in] num - wskaźnik na numer;
+ * @param[in] limit - największa rozważana długość prefiksu;
+ * @param[out] length - wskaźnik na długość znalezionego prefiksu.
+ * @return Wskaźnik na wierzchołek z przekierowaniem lub NULL, gdy żaden
+ *         prefiks nie ma przekierowania.
+ */
+static TrieNode const *longestForward(TrieNode const *root, char const *num, size_t limit,
+                                      size_t *length) {
+    TrieNode const *best = NULL;
+    *length = 0;
+    for (size_t i = 0; root && i < limit; ++i) {
+        root = root->child[trieIndex(num[i])];
+        if (root && root->forward) {
+            best = root;
+            *length = i + 1;
+        }
+    }
+    return best;
+}
+
+Overlay *overlayNew(TrieNode const *baseForward, ReverseNode const *baseReverse) {
+    Overlay *overlay = malloc(sizeof(Overlay));
+    if (!overlay)
+        return NULL;
+    overlay->masks = maskNew(NULL, 0);
+    if (!overlay->masks) {
+        free(overlay);
+        return NULL;
+    }
+    overlay->baseForward = baseForward;
+    overlay->baseReverse = baseReverse;
+    return overlay;
+}
+
+void overlayDelete(Overlay *overlay) {
+    if (overlay) {
+        maskDelete(overlay->masks);
+        free(overlay);
+    }
+}
+
+bool overlayMask(Overlay *overlay, char const *num, bool *changed) {
+    size_t length = strlen(num);
+    *changed = false;
+    TrieNode const *base = overlay->baseForward;
+    for (size_t i = 0; base && i < length; ++i)
+        base = base->child[trieIndex(num[i])];
+    if (!base || maskedLength(overlay, num, length) <= length)
+        return true;
+
+    MaskNode *node = overlay->masks, *created = NULL;
+    for (size_t i = 0; i < length; ++i) {
+        int idx = trieIndex(num[i]);
+        if (!node->child[idx]) {
+            node->child[idx] = maskNew(node, idx);
+            if (!node->child[idx]) {
+                if (created)
+                    maskDelete(created);
+                return false;
+            }
+            if (!created)
+                created = node->child[idx];
+        }
+        node = node->child[idx];
+    }
+
+    for (int i = 0; i < N; ++i) {
+        if (node->child[i])
+            maskDelete(node->child[i]);
+    }
+    node->masked = true;
+    *changed = true;
+    return true;
+}
+
+char *overlayFindForward(Overlay const *overlay, TrieNode const *local, char const *num) {
+    size_t length = strlen(num), localLen, baseLen;
+    TrieNode const *best = longestForward(local, num, length, &localLen);
+    TrieNode const *base = longestForward(overlay->baseForward, num,
+                                          maskedLength(overlay, num, length) - 1, &baseLen);
+    size_t bestLen = localLen;
+    if (base && baseLen > localLen) {
+        best = base;
+        bestLen = baseLen;
+    }
+
+    size_t prefix = best ? strlen(best->forward) : 0;
+    char *res = malloc((prefix + length - bestLen + 1) * sizeof(char));
+    if (!res)
+        return NULL;
+    if (best)
+        memcpy(res, best->forward, prefix);
+    strcpy(res + prefix, num + bestLen);
+    return res;
+}
+
+/** @brief Sprawdza czy bazowe przekierowanie numeru jest widoczne.
+ * @param[in] overlay - wskaźnik na nakładkę;
+ * @param[in] local - wskaźnik na korzeń lokalnego drzewa forward;
+ * @param[in] num - wskaźnik na numer z bazowym przekierowaniem.
+ * @return Wartość @p true, jeśli numer nie ma prefiksu z maską ani
+ *         lokalnego przekierowania.
+ */
+static bool baseVisible(Overlay const *overlay, TrieNode *local, char const *num) {
+    size_t length = strlen(num);
+    if (maskedLength(overlay, num, length) <= length)
+        return false;
+    TrieNode *node = trieFind(&local, num);
+    return !node || !node->forward;
+}
+
+/** @brief Dopisuje numer do tablicy wyników.
+ * @param[in,out] arr - wskaźnik na tablicę numerów;
+ * @param[in,out] size - wskaźnik na liczbę numerów;
+ * @param[in,out] capacity - wskaźnik na rozmiar tablicy;
+ * @param[in] prefix - wskaźnik na początek numeru;
+ * @param[in] suffix - wskaźnik na napis dopisywany za początkiem.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool appendNumber(char ***arr, size_t *size, size_t *capacity, char const *prefix,
+                         char const *suffix) {
+    if (*size == *capacity) {
+        char **temp = realloc(*arr, 2 * *capacity * sizeof(char *));
+        if (!temp)
+            return false;
+        *arr = temp;
+        *capacity *= 2;
+    }
+    size_t prefixLength = strlen(prefix);
+    char *num = malloc((prefixLength + strlen(suffix) + 1) * sizeof(char));
+    if (!num)
+        return false;
+    memcpy(num, prefix, prefixLength);
+    strcpy(num + prefixLength, suffix);
+    (*arr)[(*size)++] = num;
+    return true;
+}
+
+char **overlayFindReverse(Overlay const *overlay, TrieNode *local, ReverseNode *localReverse,
+                          char const *num, size_t *size) {
+    size_t count = 0;
+    char **arr = findReverseForwards(&localReverse, num, &count);
+    if (!arr)
+        return NULL;
+
+    size_t capacity = count;
+    bool res = true;
+    ReverseNode const *node = overlay->baseReverse;
+    for (size_t i = 0; res && node && num[i] != '\0'; ++i) {
+        node = node->child[trieIndex(num[i])];
+        for (Node const *head = node ? node->forwardsList : NULL; res && head; head = head->next) {
+            if (baseVisible(overlay, local, head->data))
+                res = appendNumber(&arr, &count, &capacity, head->data, num + i + 1);
+        }
+    }
+
+    if (!res) {
+        for (size_t i = 0; i < count; ++i)
+            free(arr[i]);
+        free(arr);
+        return NULL;
+    }
+    return uniqueNumbers(arr, count, size);
+}
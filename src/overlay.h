@@ -0,0 +1,81 @@
+/** @file
+ * Interfejs nakładki zmian na współdzielone drzewa przekierowań
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __OVERLAY_H__
+#define __OVERLAY_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "trie.h"
+
+/**
+ * To jest struktura opisująca nakładkę na drzewa bazowe, których nie zmienia.
+ * Lokalne przekierowania leżą w osobnych drzewach forward i reverse,
+ * przekazywanych do funkcji nakładki. Nakładka przechowuje wskaźniki na
+ * drzewa bazowe i drzewo masek: maska prefiksu ukrywa wszystkie bazowe
+ * przekierowania numerów o tym prefiksie. Lokalne przekierowanie numeru
+ * przesłania bazowe przekierowanie tego samego numeru.
+ */
+struct Overlay;
+typedef struct Overlay Overlay;
+
+/** @brief Tworzy nakładkę bez masek.
+ * @param[in] baseForward – wskaźnik na korzeń bazowego drzewa forward;
+ * @param[in] baseReverse – wskaźnik na korzeń bazowego drzewa reverse.
+ * @return Wskaźnik na nakładkę lub NULL, gdy nie udało się alokować pamięci.
+ */
+Overlay *overlayNew(TrieNode const *baseForward, ReverseNode const *baseReverse);
+
+/** @brief Usuwa nakładkę.
+ * Nie zmienia drzew bazowych. Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param[in] overlay – wskaźnik na nakładkę.
+ */
+void overlayDelete(Overlay *overlay);
+
+/** @brief Ukrywa bazowe przekierowania numerów o danym prefiksie.
+ * Maska jest dodawana tylko wtedy, gdy w bazowym drzewie forward istnieje
+ * wierzchołek @p num, a żaden prefiks @p num nie ma maski. Maski dłuższych
+ * numerów o prefiksie @p num są usuwane.
+ * @param[in,out] overlay – wskaźnik na nakładkę;
+ * @param[in] num         – wskaźnik na napis reprezentujący poprawny numer;
+ * @param[out] changed    – wskaźnik na flagę ustawianą na @p true, jeśli
+ *                          maska została dodana.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci; nakładka
+ *         nie jest wtedy zmieniana.
+ */
+bool overlayMask(Overlay *overlay, char const *num, bool *changed);
+
+/** @brief Zwraca przekierowanie numeru.
+ * Wybiera dłuższy z prefiksów: najdłuższy prefiks z lokalnym przekierowaniem
+ * i najdłuższy prefiks z bazowym przekierowaniem, który nie ma maski. Przy
+ * równych długościach wygrywa lokalne przekierowanie. Wynik jest zawsze nowo
+ * alokowanym napisem.
+ * @param[in] overlay – wskaźnik na nakładkę;
+ * @param[in] local   – wskaźnik na korzeń lokalnego drzewa forward;
+ * @param[in] num     – wskaźnik na napis reprezentujący poprawny numer.
+ * @return Wskaźnik na przekierowanie lub NULL, gdy nie udało się alokować
+ *         pamięci.
+ */
+char *overlayFindForward(Overlay const *overlay, TrieNode const *local, char const *num);
+
+/** @brief Zwraca numery przekierowywane na dany numer.
+ * Łączy wynik findReverseForwards dla lokalnego drzewa reverse z bazowymi
+ * przekierowaniami, które nie są ukryte maską ani przesłonięte lokalnym
+ * przekierowaniem tego samego numeru.
+ * @param[in] overlay      – wskaźnik na nakładkę;
+ * @param[in] local        – wskaźnik na korzeń lokalnego drzewa forward;
+ * @param[in] localReverse – wskaźnik na korzeń lokalnego drzewa reverse;
+ * @param[in] num          – wskaźnik na napis reprezentujący poprawny numer;
+ * @param[out] size        – wskaźnik na rozmiar wynikowej tablicy.
+ * @return Posortowana tablica numerów bez powtórzeń lub NULL, gdy nie udało
+ *         się alokować pamięci.
+ */
+char **overlayFindReverse(Overlay const *overlay, TrieNode *local, ReverseNode *localReverse,
+                          char const *num, size_t *size);
+
+#endif /* __OVERLAY_H__ */
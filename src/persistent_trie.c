@@ -0,0 +1,548 @@
+/** @file
+ * Implementacja klasy reprezentującej trwałe drzewa Trie
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "persistent_trie.h"
+#include "trie.h"
+
+typedef struct PersistentCell PersistentCell;
+/**
+ * To jest struktura reprezentująca element trwałej listy numerów.
+ * Wierzchołek drzewa forward trzyma jeden element z numerem docelowym,
+ * a wierzchołek drzewa reverse listę numerów przekierowywanych. Końcówki
+ * list są współdzielone przez wersje.
+ */
+struct PersistentCell {
+    atomic_size_t refs; /**< Liczba odwołań do elementu. */
+    PersistentCell *next; /**< Wskaźnik na kolejny element. */
+    char number[]; /**< Numer telefonu. */
+};
+
+/**
+ * To jest struktura reprezentująca wierzchołek trwałego drzewa Trie.
+ */
+struct PersistentNode {
+    atomic_size_t refs; /**< Liczba odwołań do wierzchołka. */
+    PersistentNode *child[N]; /**< Tablica dzieci. */
+    PersistentCell *data; /**< Lista numerów lub NULL. */
+};
+
+/** @brief Zwiększa licznik odwołań do elementu listy.
+ * @param[in,out] cell - wskaźnik na element lub NULL.
+ */
+static void cellAcquire(PersistentCell *cell) {
+    if (cell)
+        atomic_fetch_add_explicit(&(cell->refs), 1, memory_order_relaxed);
+}
+
+/** @brief Zmniejsza licznik odwołań do listy.
+ * Zwalnia kolejne elementy listy, do których nie ma już odwołań.
+ * @param[in,out] cell - wskaźnik na pierwszy element lub NULL.
+ */
+static void cellRelease(PersistentCell *cell) {
+    while (cell && atomic_fetch_sub_explicit(&(cell->refs), 1, memory_order_acq_rel) == 1) {
+        PersistentCell *next = cell->next;
+        free(cell);
+        cell = next;
+    }
+}
+
+/** @brief Tworzy element listy.
+ * @param[in] number - wskaźnik na napis reprezentujący numer;
+ * @param[in] next - wskaźnik na dalszą część listy, do której dodawane jest odwołanie.
+ * @return Wskaźnik na element lub NULL, gdy nie udało się alokować pamięci.
+ */
+static PersistentCell *cellNew(char const *number, PersistentCell *next) {
+    size_t size = strlen(number);
+    PersistentCell *cell = malloc(sizeof(PersistentCell) + (size + 1) * sizeof(char));
+    if (!cell) return NULL;
+
+    atomic_init(&(cell->refs), 1);
+    cell->next = next;
+    cellAcquire(next);
+    memcpy(cell->number, number, size + 1);
+    return cell;
+}
+
+/** @brief Zwiększa licznik odwołań do wierzchołka.
+ * @param[in,out] node - wskaźnik na wierzchołek lub NULL.
+ */
+static void nodeAcquire(PersistentNode *node) {
+    if (node)
+        atomic_fetch_add_explicit(&(node->refs), 1, memory_order_relaxed);
+}
+
+/** @brief Zmniejsza licznik odwołań do wierzchołka.
+ * Zwalnia wierzchołek i rekurencyjnie jego poddrzewo, jeśli nie ma już do
+ * niego odwołań.
+ * @param[in,out] node - wskaźnik na wierzchołek lub NULL.
+ */
+static void nodeRelease(PersistentNode *node) {
+    if (!node || atomic_fetch_sub_explicit(&(node->refs), 1, memory_order_acq_rel) != 1)
+        return;
+    for (int i = 0; i < N; ++i)
+        nodeRelease(node->child[i]);
+    cellRelease(node->data);
+    free(node);
+}
+
+/** @brief Kopiuje wierzchołek.
+ * Tworzy nowy wierzchołek o tych samych dzieciach i danych co @p node.
+ * @param[in] node - wskaźnik na wierzchołek lub NULL dla pustego wierzchołka.
+ * @return Wskaźnik na kopię lub NULL, gdy nie udało się alokować pamięci.
+ */
+static PersistentNode *nodeCopy(PersistentNode const *node) {
+    PersistentNode *copy = malloc(sizeof(PersistentNode));
+    if (!copy) return NULL;
+
+    atomic_init(&(copy->refs), 1);
+    for (int i = 0; i < N; ++i) {
+        copy->child[i] = node ? node->child[i] : NULL;
+        nodeAcquire(copy->child[i]);
+    }
+    copy->data = node ? node->data : NULL;
+    cellAcquire(copy->data);
+    return copy;
+}
+
+/** @brief Sprawdza czy wierzchołek jest pusty.
+ * @param[in] node - wskaźnik na wierzchołek.
+ * @return Wartość @p true, jeśli wierzchołek nie ma danych ani dzieci.
+ */
+static bool isEmpty(PersistentNode const *node) {
+    if (node->data)
+        return false;
+    for (int i = 0; i < N; ++i) {
+        if (node->child[i])
+            return false;
+    }
+    return true;
+}
+
+/** @brief Wyszukuje wierzchołek numeru.
+ * @param[in] root - wskaźnik na korzeń lub NULL;
+ * @param[in] num - wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na wierzchołek lub NULL, gdy ścieżka nie istnieje.
+ */
+static PersistentNode *findNode(PersistentNode *root, char const *num) {
+    for (size_t i = 0; root && num[i] != '\0'; ++i)
+        root = root->child[trieIndex(num[i])];
+    return root;
+}
+
+/** @brief Tworzy nową wersję drzewa ze zmienioną ścieżką.
+ * Kopiuje wierzchołki na ścieżce reprezentującej @p num. Jeśli @p cut jest
+ * prawdą, odcina poddrzewo numeru @p num, w przeciwnym razie ustawia w jego
+ * wierzchołku listę @p data. Puste wierzchołki na końcu ścieżki są usuwane.
+ * @param[in] root - wskaźnik na korzeń poprzedniej wersji lub NULL;
+ * @param[in] num - wskaźnik na napis reprezentujący niepusty numer;
+ * @param[in] data - lista ustawiana w wierzchołku lub NULL;
+ * @param[in] cut - flaga mówiąca czy odciąć poddrzewo;
+ * @param[out] result - wskaźnik na korzeń nowej wersji.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool setPath(PersistentNode *root, char const *num, PersistentCell *data,
+                    bool cut, PersistentNode **result) {
+    size_t len = strlen(num);
+    size_t depth = cut ? len - 1 : len;
+    PersistentNode **path = malloc((depth + 1) * sizeof(PersistentNode *));
+    if (!path) return false;
+
+    path[0] = nodeCopy(root);
+    if (!path[0]) {
+        free(path);
+        return false;
+    }
+    for (size_t i = 0; i < depth; ++i) {
+        int position = trieIndex(num[i]);
+        PersistentNode *old = path[i]->child[position];
+        path[i + 1] = nodeCopy(old);
+        if (!path[i + 1]) {
+            nodeRelease(path[0]);
+            free(path);
+            return false;
+        }
+        nodeRelease(old);
+        path[i]->child[position] = path[i + 1];
+    }
+
+    if (cut) {
+        int position = trieIndex(num[depth]);
+        nodeRelease(path[depth]->child[position]);
+        path[depth]->child[position] = NULL;
+    } else {
+        cellRelease(path[depth]->data);
+        cellAcquire(data);
+        path[depth]->data = data;
+    }
+
+    for (size_t i = depth; i > 0 && isEmpty(path[i]); --i) {
+        path[i - 1]->child[trieIndex(num[i - 1])] = NULL;
+        nodeRelease(path[i]);
+    }
+
+    *result = path[0];
+    if (isEmpty(*result)) {
+        nodeRelease(*result);
+        *result = NULL;
+    }
+    free(path);
+    return true;
+}
+
+/** @brief Tworzy listę bez danego numeru.
+ * Kopiuje elementy listy @p list poprzedzające pierwszy element z numerem
+ * @p num i współdzieli elementy następujące po nim.
+ * @param[in] list - wskaźnik na listę;
+ * @param[in] num - wskaźnik na usuwany numer;
+ * @param[out] result - wskaźnik na nową listę.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool listWithout(PersistentCell *list, char const *num, PersistentCell **result) {
+    size_t count = 0;
+    PersistentCell *match = list;
+    while (match && strcmp(match->number, num) != 0) {
+        match = match->next;
+        ++count;
+    }
+    if (!match) {
+        cellAcquire(list);
+        *result = list;
+        return true;
+    }
+
+    PersistentCell **prefix = malloc((count + 1) * sizeof(PersistentCell *));
+    if (!prefix) return false;
+    for (size_t i = 0; i < count; ++i, list = list->next)
+        prefix[i] = list;
+
+    PersistentCell *head = match->next;
+    cellAcquire(head);
+    for (size_t i = count; i > 0; --i) {
+        PersistentCell *cell = cellNew(prefix[i - 1]->number, head);
+        cellRelease(head);
+        if (!cell) {
+            free(prefix);
+            return false;
+        }
+        head = cell;
+    }
+    free(prefix);
+    *result = head;
+    return true;
+}
+
+/** @brief Zmienia listę numerów przekierowywanych na dany numer.
+ * Tworzy nową wersję drzewa reverse, w której do listy numeru @p target
+ * dodano numer @p source lub, gdy @p add jest fałszem, usunięto go z niej.
+ * @param[in,out] reverse - wskaźnik na korzeń drzewa reverse;
+ * @param[in] target - wskaźnik na numer docelowy;
+ * @param[in] source - wskaźnik na numer przekierowywany;
+ * @param[in] add - flaga mówiąca czy numer jest dodawany.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool updateSources(PersistentNode **reverse, char const *target, char const *source, bool add) {
+    PersistentNode *node = findNode(*reverse, target);
+    PersistentCell *list = node ? node->data : NULL;
+    PersistentCell *newList;
+
+    if (add) {
+        newList = cellNew(source, list);
+        if (!newList) return false;
+    } else if (!listWithout(list, source, &newList)) {
+        return false;
+    }
+
+    PersistentNode *result;
+    bool res = setPath(*reverse, target, newList, false, &result);
+    cellRelease(newList);
+    if (res) {
+        nodeRelease(*reverse);
+        *reverse = result;
+    }
+    return res;
+}
+
+/** @brief Usuwa z drzewa reverse przekierowania poddrzewa.
+ * Dla każdego przekierowania w poddrzewie @p node drzewa forward usuwa jego
+ * numer z odpowiedniej listy drzewa reverse.
+ * @param[in,out] reverse - wskaźnik na korzeń drzewa reverse;
+ * @param[in] node - wskaźnik na wierzchołek drzewa forward;
+ * @param[in,out] buf - wskaźnik na bufor z numerem wierzchołka @p node;
+ * @param[in,out] cap - wskaźnik na rozmiar bufora;
+ * @param[in] len - długość numeru wierzchołka @p node.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool removeSources(PersistentNode **reverse, PersistentNode const *node,
+                          char **buf, size_t *cap, size_t len) {
+    if (len + 2 > *cap) {
+        char *temp = realloc(*buf, 2 * (len + 2) * sizeof(char));
+        if (!temp) return false;
+        *buf = temp;
+        *cap = 2 * (len + 2);
+    }
+
+    (*buf)[len] = '\0';
+    if (node->data && !updateSources(reverse, node->data->number, *buf, false))
+        return false;
+
+    for (int i = 0; i < N; ++i) {
+        if (node->child[i]) {
+            (*buf)[len] = trieSymbol(i);
+            if (!removeSources(reverse, node->child[i], buf, cap, len + 1))
+                return false;
+        }
+    }
+    return true;
+}
+
+/** @brief Powiększa stos kursora.
+ * @param[in,out] cursor - wskaźnik na kursor.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool cursorGrow(PersistentCursor *cursor) {
+    size_t capacity = 2 * cursor->capacity;
+    PersistentNode const **stack = realloc(cursor->stack, capacity * sizeof(PersistentNode const *));
+    if (!stack) return false;
+    cursor->stack = stack;
+
+    char *num = realloc(cursor->num, (cursor->prefix + capacity + 1) * sizeof(char));
+    if (!num) return false;
+    cursor->num = num;
+    cursor->capacity = capacity;
+    return true;
+}
+
+bool persistentCursorInit(PersistentCursor *cursor, PersistentTries const *tries, char const *prefix) {
+    size_t len = strlen(prefix);
+    cursor->version.forward = NULL;
+    cursor->version.reverse = NULL;
+    cursor->prefix = len;
+    cursor->depth = 0;
+    cursor->capacity = 16;
+    cursor->stack = malloc(cursor->capacity * sizeof(PersistentNode const *));
+    cursor->num = malloc((len + cursor->capacity + 1) * sizeof(char));
+    if (!cursor->stack || !cursor->num) {
+        persistentCursorFree(cursor);
+        return false;
+    }
+
+    persistentCopy(&(cursor->version), tries);
+    PersistentNode const *ptr = findNode(tries->forward, prefix);
+    memcpy(cursor->num, prefix, len + 1);
+    cursor->stack[0] = ptr;
+    cursor->next = ptr ? (len > 0 && ptr->data ? -1 : 0) : N;
+    return true;
+}
+
+bool persistentCursorNext(PersistentCursor *cursor, char const **num1, char const **num2) {
+    if (!cursor->stack)
+        return false;
+
+    PersistentNode const *ptr = cursor->stack[cursor->depth];
+    if (cursor->next < 0) {
+        cursor->next = 0;
+        *num1 = cursor->num;
+        *num2 = ptr->data->number;
+        return true;
+    }
+
+    int next = cursor->next;
+    while (true) {
+        while (next < N && !ptr->child[next])
+            ++next;
+
+        if (next < N) {
+            if (cursor->depth + 1 == cursor->capacity && !cursorGrow(cursor)) {
+                cursor->next = next;
+                return false;
+            }
+            char *end = cursor->num + cursor->prefix + cursor->depth;
+            end[0] = trieSymbol(next);
+            end[1] = '\0';
+            ptr = ptr->child[next];
+            cursor->stack[++cursor->depth] = ptr;
+            next = 0;
+            if (ptr->data) {
+                cursor->next = 0;
+                *num1 = cursor->num;
+                *num2 = ptr->data->number;
+                return true;
+            }
+        } else if (cursor->depth == 0) {
+            cursor->next = N;
+            return false;
+        } else {
+            char *end = cursor->num + cursor->prefix + --cursor->depth;
+            next = trieIndex(end[0]) + 1;
+            end[0] = '\0';
+            ptr = cursor->stack[cursor->depth];
+        }
+    }
+}
+
+void persistentCursorFree(PersistentCursor *cursor) {
+    free(cursor->stack);
+    free(cursor->num);
+    cursor->stack = NULL;
+    cursor->num = NULL;
+    persistentRelease(&(cursor->version));
+}
+
+bool persistentForEach(PersistentTries const *tries, TrieVisit visit, void *ctx) {
+    PersistentCursor cursor;
+    if (!persistentCursorInit(&cursor, tries, ""))
+        return false;
+
+    char const *num1, *num2;
+    bool res = true;
+    while (res && persistentCursorNext(&cursor, &num1, &num2))
+        res = visit(ctx, num1, num2);
+    if (res && cursor.next != N)
+        res = false;
+    persistentCursorFree(&cursor);
+    return res;
+}
+
+void persistentCopy(PersistentTries *dst, PersistentTries const *src) {
+    nodeAcquire(src->forward);
+    nodeAcquire(src->reverse);
+    persistentRelease(dst);
+    dst->forward = src->forward;
+    dst->reverse = src->reverse;
+}
+
+void persistentRelease(PersistentTries *tries) {
+    nodeRelease(tries->forward);
+    nodeRelease(tries->reverse);
+    tries->forward = NULL;
+    tries->reverse = NULL;
+}
+
+bool persistentAdd(PersistentTries *tries, char const *num1, char const *num2) {
+    PersistentNode *old = findNode(tries->forward, num1);
+    PersistentCell *oldTarget = old ? old->data : NULL;
+
+    PersistentCell *cell = cellNew(num2, NULL);
+    if (!cell) return false;
+    PersistentNode *forward;
+    bool res = setPath(tries->forward, num1, cell, false, &forward);
+    cellRelease(cell);
+    if (!res) return false;
+
+    PersistentNode *reverse = tries->reverse;
+    nodeAcquire(reverse);
+    if ((oldTarget && !updateSources(&reverse, oldTarget->number, num1, false))
+        || !updateSources(&reverse, num2, num1, true)) {
+        nodeRelease(forward);
+        nodeRelease(reverse);
+        return false;
+    }
+
+    persistentRelease(tries);
+    tries->forward = forward;
+    tries->reverse = reverse;
+    return true;
+}
+
+bool persistentRemove(PersistentTries *tries, char const *num) {
+    PersistentNode *node = findNode(tries->forward, num);
+    if (!node)
+        return true;
+
+    size_t len = strlen(num), cap = len + 2;
+    char *buf = malloc(cap * sizeof(char));
+    if (!buf) return false;
+    memcpy(buf, num, len);
+
+    PersistentNode *reverse = tries->reverse;
+    nodeAcquire(reverse);
+    bool res = removeSources(&reverse, node, &buf, &cap, len);
+    free(buf);
+
+    PersistentNode *forward;
+    if (!res || !setPath(tries->forward, num, NULL, true, &forward)) {
+        nodeRelease(reverse);
+        return false;
+    }
+
+    persistentRelease(tries);
+    tries->forward = forward;
+    tries->reverse = reverse;
+    return true;
+}
+
+char *persistentFindForward(PersistentTries const *tries, char const *num) {
+    PersistentNode *ptr = tries->forward;
+    PersistentCell *res = NULL;
+
+    size_t len = 0;
+    for (size_t i = 0; ptr && num[i] != '\0'; ++i) {
+        ptr = ptr->child[trieIndex(num[i])];
+        if (ptr && ptr->data) {
+            res = ptr->data;
+            len = i + 1;
+        }
+    }
+
+    if (!res)
+        return (char *) num;
+
+    size_t size1 = strlen(num);
+    size_t size2 = strlen(res->number);
+    char *info = malloc((size1 - len + size2 + 1) * sizeof(char));
+    if (!info)
+        return NULL;
+    memcpy(info, res->number, size2);
+    memcpy(info + size2, num + len, size1 - len + 1);
+    return info;
+}
+
+char **persistentFindReverse(PersistentTries const *tries, char const *num, size_t *pnumSize) {
+    size_t size = 1, numLength = strlen(num);
+    PersistentNode *ptr = tries->reverse;
+    for (size_t i = 0; ptr && num[i] != '\0'; ++i) {
+        ptr = ptr->child[trieIndex(num[i])];
+        for (PersistentCell *cell = ptr ? ptr->data : NULL; cell; cell = cell->next)
+            ++size;
+    }
+
+    char **arr = malloc(size * sizeof(char *));
+    if (!arr) return NULL;
+
+    size_t idx = 0;
+    ptr = tries->reverse;
+    for (size_t i = 0; ptr && num[i] != '\0'; ++i) {
+        ptr = ptr->child[trieIndex(num[i])];
+        for (PersistentCell *cell = ptr ? ptr->data : NULL; cell; cell = cell->next) {
+            size_t cellLength = strlen(cell->number);
+            arr[idx] = malloc((cellLength + numLength - i) * sizeof(char));
+            if (!arr[idx]) {
+                for (size_t j = 0; j < idx; ++j)
+                    free(arr[j]);
+                free(arr);
+                return NULL;
+            }
+            memcpy(arr[idx], cell->number, cellLength);
+            memcpy(arr[idx] + cellLength, num + i + 1, numLength - i);
+            ++idx;
+        }
+    }
+
+    arr[idx] = malloc((numLength + 1) * sizeof(char));
+    if (!arr[idx]) {
+        for (size_t j = 0; j < idx; ++j)
+            free(arr[j]);
+        free(arr);
+        return NULL;
+    }
+    memcpy(arr[idx], num, numLength + 1);
+
+    return uniqueNumbers(arr, size, pnumSize);
+}
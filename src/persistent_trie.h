@@ -0,0 +1,140 @@
+/** @file
+ * Interfejs klasy reprezentującej trwałe drzewa Trie
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __PERSISTENT_TRIE_H__
+#define __PERSISTENT_TRIE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "trie.h"
+
+/**
+ * To jest struktura reprezentująca wierzchołek trwałego drzewa Trie.
+ * Wierzchołki nie są modyfikowane po utworzeniu, więc mogą być współdzielone
+ * przez wiele wersji drzewa.
+ */
+struct PersistentNode;
+typedef struct PersistentNode PersistentNode;
+
+typedef struct PersistentTries PersistentTries;
+/**
+ * To jest struktura przechowująca jedną wersję drzew forward i reverse.
+ */
+struct PersistentTries {
+    PersistentNode *forward; /**< Korzeń drzewa przekierowań lub NULL, gdy jest puste. */
+    PersistentNode *reverse; /**< Korzeń drzewa przekierowań odwróconych lub NULL, gdy jest puste. */
+};
+
+typedef struct PersistentCursor PersistentCursor;
+/**
+ * To jest struktura reprezentująca kursor przeglądający przekierowania
+ * poddrzewa jednej wersji drzew. Kursor trzyma odwołanie do tej wersji,
+ * więc późniejsze zmiany struktury nie są przez niego widoczne.
+ */
+struct PersistentCursor {
+    PersistentTries version; /**< Przeglądana wersja drzew. */
+    PersistentNode const **stack; /**< Stos wierzchołków od korzenia poddrzewa do bieżącego. */
+    char *num; /**< Numer bieżącego wierzchołka. */
+    size_t prefix; /**< Długość numeru korzenia poddrzewa. */
+    size_t depth; /**< Głębokość bieżącego wierzchołka w poddrzewie. */
+    size_t capacity; /**< Rozmiar stosu. */
+    int next; /**< Indeks następnego dziecka do odwiedzenia lub -1, gdy przekierowanie
+                   bieżącego wierzchołka nie zostało jeszcze zwrócone. */
+};
+
+/** @brief Kopiuje wersję drzew.
+ * Ustawia @p dst na tę samą wersję drzew co @p src w czasie stałym, zwalniając
+ * poprzednią wersję @p dst. Wierzchołki są współdzielone.
+ * @param[in,out] dst – wskaźnik na docelową wersję;
+ * @param[in] src     – wskaźnik na kopiowaną wersję.
+ */
+void persistentCopy(PersistentTries *dst, PersistentTries const *src);
+
+/** @brief Zwalnia wersję drzew.
+ * Zwalnia wierzchołki, które nie są już używane przez żadną inną wersję.
+ * @param[in,out] tries – wskaźnik na zwalnianą wersję.
+ */
+void persistentRelease(PersistentTries *tries);
+
+/** @brief Dodaje przekierowanie numeru telefonu.
+ * Tworzy nową wersję drzew z przekierowaniem @p num1 na @p num2, kopiując
+ * tylko wierzchołki leżące na zmienianych ścieżkach.
+ * @param[in,out] tries – wskaźnik na wersję drzew;
+ * @param[in] num1 – wskaźnik na napis reprezentujący poprawny numer;
+ * @param[in] num2 – wskaźnik na napis reprezentujący poprawny numer.
+ * @return Wartość @p true, jeśli przekierowanie zostało dodane.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci; wersja
+ *         drzew pozostaje wtedy bez zmian.
+ */
+bool persistentAdd(PersistentTries *tries, char const *num1, char const *num2);
+
+/** @brief Usuwa przekierowania numeru telefonu.
+ * Tworzy nową wersję drzew bez przekierowań, których prefiksem jest @p num.
+ * @param[in,out] tries – wskaźnik na wersję drzew;
+ * @param[in] num – wskaźnik na napis reprezentujący poprawny numer.
+ * @return Wartość @p true, jeśli przekierowania zostały usunięte.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci; wersja
+ *         drzew pozostaje wtedy bez zmian.
+ */
+bool persistentRemove(PersistentTries *tries, char const *num);
+
+/** @brief Zwraca przekierowanie numeru telefonu.
+ * Działa tak jak trieFindForward dla drzewa forward wersji @p tries.
+ * @param[in] tries – wskaźnik na wersję drzew;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik @p num, jeśli numer nie jest przekierowany, wskaźnik na
+ *         nowy napis z przekierowaniem lub NULL, gdy nie udało się alokować pamięci.
+ */
+char *persistentFindForward(PersistentTries const *tries, char const *num);
+
+/** @brief Zwraca wskaźnik na tablice numerów.
+ * Działa tak jak findReverseForwards dla drzewa reverse wersji @p tries.
+ * @param[in] tries – wskaźnik na wersję drzew;
+ * @param[in] num – wskaźnik na napis reprezentujący numer;
+ * @param[out] pnumSize – wskaźnik na rozmiar wynikowej tablicy.
+ * @return Wskaźnik na tablice numerów lub NULL, gdy nie udało się alokować pamięci.
+ */
+char **persistentFindReverse(PersistentTries const *tries, char const *num, size_t *pnumSize);
+
+/** @brief Ustawia kursor na poddrzewie.
+ * Działa tak jak trieCursorInit dla drzewa forward wersji @p tries.
+ * @param[out] cursor – wskaźnik na kursor;
+ * @param[in] tries – wskaźnik na wersję drzew;
+ * @param[in] prefix – wskaźnik na napis reprezentujący poprawny numer lub pusty napis.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+bool persistentCursorInit(PersistentCursor *cursor, PersistentTries const *tries, char const *prefix);
+
+/** @brief Przesuwa kursor na następne przekierowanie.
+ * Działa tak jak trieCursorNext. Zwrócone napisy są ważne do następnego
+ * wywołania tej funkcji.
+ * @param[in,out] cursor – wskaźnik na kursor;
+ * @param[out] num1 – wskaźnik na numer przekierowywany;
+ * @param[out] num2 – wskaźnik na numer, na który jest wykonywane przekierowanie.
+ * @return Wartość @p false, jeśli przekierowania się skończyły lub nie udało
+ *         się alokować pamięci.
+ */
+bool persistentCursorNext(PersistentCursor *cursor, char const **num1, char const **num2);
+
+/** @brief Zwalnia kursor.
+ * Zwalnia pamięć kursora i jego odwołanie do wersji drzew.
+ * @param[in,out] cursor – wskaźnik na kursor.
+ */
+void persistentCursorFree(PersistentCursor *cursor);
+
+/** @brief Przegląda przekierowania.
+ * Działa tak jak trieForEach dla drzewa forward wersji @p tries.
+ * @param[in] tries – wskaźnik na wersję drzew;
+ * @param[in] visit – funkcja wywoływana dla przekierowań;
+ * @param[in,out] ctx – wskaźnik przekazywany do @p visit.
+ * @return Wartość @p false, jeśli @p visit przerwała przeglądanie lub nie
+ *         udało się alokować pamięci.
+ */
+bool persistentForEach(PersistentTries const *tries, TrieVisit visit, void *ctx);
+
+#endif /* __PERSISTENT_TRIE_H__ */
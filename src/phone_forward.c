@@ -9,8 +9,33 @@
 #include <string.h>
 #include <stdbool.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "phone_forward.h"
 #include "trie.h"
 #include "linked_list.h"
+#include "shard_lock.h"
+#include "trie_parallel.h"
+#include "persistent_trie.h"
+#include "journal.h"
+#include "latency_stats.h"
+#include "jump_table.h"
+#include "disk_trie.h"
+#include "prefix_hash.h"
+#include "trace_capture.h"
+#include "shm_trie.h"
+#include "overlay.h"
+
+#define SHORT_NUMBER 64 /**< Rozmiar bufora na stosie dla numerów podanych z długością. */
+
+typedef struct LazyReverse LazyReverse;
+/**
+ * To jest struktura opisująca drzewo reverse budowane przy pierwszym użyciu.
+ */
+struct LazyReverse {
+    atomic_bool built; /**< Flaga mówiąca czy drzewo reverse zostało zbudowane. */
+    pthread_mutex_t mutex; /**< Blokada budowania drzewa reverse. */
+};
 
 typedef struct PhoneForward PhoneForward;
 /**
@@ -18,7 +43,47 @@ typedef struct PhoneForward PhoneForward;
  */
 struct PhoneForward {
     TrieNode *forwardRoot; /**< Wskaźnik na drzewo Trie odpowiedzialne za działania na numerach telefonów. */
-    TrieNode *reverseRoot; /**< Wskaźnik na drzewo Trie odpowiedzialne za operacje odwrócone na numerach telefonów. */
+    ReverseNode *reverseRoot; /**< Wskaźnik na drzewo Trie odpowiedzialne za operacje odwrócone na numerach telefonów. */
+    ShardLocks *locks; /**< Blokady fragmentów drzew lub NULL, gdy struktura nie jest współbieżna. */
+    PersistentTries *persistent; /**< Wersja trwałych drzew lub NULL, gdy struktura używa zwykłych drzew. */
+    bool readOnly; /**< Flaga mówiąca czy struktura jest migawką tylko do odczytu. */
+    Journal *journal; /**< Dziennik zmian lub NULL, gdy zmiany nie są zapisywane. */
+    TrieArena *arena; /**< Blok z wierzchołkami po ostatnim kompaktowaniu lub NULL. */
+    LatencyStats *stats; /**< Histogramy opóźnień operacji lub NULL, gdy pomiar jest wyłączony. */
+    PhfwdTraceHook traceHook; /**< Funkcja śledząca operacje lub NULL. */
+    void *traceCtx; /**< Wskaźnik przekazywany do funkcji śledzącej. */
+    JumpTable *jump; /**< Tablica skoków do górnych poziomów drzewa forward lub NULL. */
+    DiskTrie *disk; /**< Drzewa przechowywane w pliku lub NULL, gdy drzewa leżą w pamięci. */
+    PrefixHash *hash; /**< Indeks przekierowań w tablicach haszujących lub NULL. */
+    LazyReverse *lazy; /**< Stan drzewa reverse budowanego przy pierwszym użyciu lub NULL,
+                            gdy drzewo jest zawsze aktualizowane. */
+    TraceCapture *capture; /**< Plik śladu wywołań lub NULL, gdy ślad nie jest zapisywany. */
+    ShmTrie *shm; /**< Drzewa we współdzielonej pamięci lub NULL, gdy drzewa leżą w pamięci procesu. */
+    Overlay *overlay; /**< Nakładka na drzewa struktury bazowej lub NULL, gdy drzewa
+                           zawierają wszystkie przekierowania. */
+};
+
+typedef struct PhoneForwardList PhoneForwardList;
+/**
+ * To jest struktura reprezentująca kursor przeglądający przekierowania.
+ */
+struct PhoneForwardList {
+    bool persistent; /**< Flaga mówiąca czy kursor przegląda trwałe drzewa. */
+    union {
+        TrieCursor trie; /**< Kursor zwykłego drzewa forward. */
+        PersistentCursor persistent; /**< Kursor wersji trwałych drzew. */
+    } cursor; /**< Kursor drzewa. */
+};
+
+typedef struct PhoneNumbersBatch PhoneNumbersBatch;
+/**
+ * To jest struktura przechowująca ciągi numerów wielu zapytań.
+ */
+struct PhoneNumbersBatch {
+    NumberPack pack; /**< Numery wszystkich ciągów. */
+    size_t *start; /**< Indeksy pierwszych numerów ciągów w pack. */
+    size_t *size; /**< Długości ciągów. */
+    size_t count; /**< Liczba ciągów. */
 };
 
 typedef struct PhoneNumbers PhoneNumbers;
@@ -46,6 +111,103 @@ static bool isNumber(char const *num) {
     return true;
 }
 
+/** @brief Sprawdza czy drzewo reverse jest aktualizowane.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania numerów.
+ * @return Wartość @p true, jeśli struktura nie odkłada budowy drzewa reverse
+ *         lub drzewo zostało już zbudowane.
+ */
+static bool reverseMaintained(PhoneForward const *pf) {
+    return !pf->lazy || atomic_load_explicit(&(pf->lazy->built), memory_order_acquire);
+}
+
+/** @brief Buduje drzewo reverse, jeśli nie zostało jeszcze zbudowane.
+ * Może być wywoływana jednocześnie z wielu wątków czytających strukturę.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania numerów.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool ensureReverse(PhoneForward const *pf) {
+    if (reverseMaintained(pf))
+        return true;
+
+    pthread_mutex_lock(&(pf->lazy->mutex));
+    bool res = atomic_load_explicit(&(pf->lazy->built), memory_order_relaxed) ||
+               trieBuildReverse(pf->forwardRoot, pf->reverseRoot);
+    if (res)
+        atomic_store_explicit(&(pf->lazy->built), true, memory_order_release);
+    pthread_mutex_unlock(&(pf->lazy->mutex));
+    return res;
+}
+
+/** @brief Usuwa stan leniwie budowanego drzewa reverse.
+ * Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param[in] lazy – wskaźnik na usuwany stan.
+ */
+static void deleteLazy(LazyReverse *lazy) {
+    if (lazy) {
+        pthread_mutex_destroy(&(lazy->mutex));
+        free(lazy);
+    }
+}
+
+/** @brief Wyznacza przekierowanie numeru.
+ * Wywołuje trieFindForward dla drzewa forward struktury @p pf, zajmując
+ * blokadę czytelnika fragmentu numeru @p num, jeśli struktura jest współbieżna.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący poprawny numer.
+ * @return Wynik funkcji trieFindForward.
+ */
+static char *findForward(PhoneForward const *pf, char const *num) {
+    if (pf->disk)
+        return diskTrieFindForward(pf->disk, num);
+    if (pf->shm)
+        return shmTrieFindForward(pf->shm, num);
+    if (pf->persistent)
+        return persistentFindForward(pf->persistent, num);
+    if (pf->overlay)
+        return overlayFindForward(pf->overlay, pf->forwardRoot, num);
+    if (pf->hash)
+        return prefixHashFindForward(pf->hash, pf->forwardRoot, num);
+    if (!pf->locks)
+        return pf->jump ? jumpTableFindForward(pf->jump, pf->forwardRoot, num)
+                        : trieFindForward(&(pf->forwardRoot), num);
+
+    int shard = trieIndex(num[0]);
+    shardLockForward(pf->locks, shard, false);
+    char *res = pf->jump ? jumpTableFindForward(pf->jump, pf->forwardRoot, num)
+                         : trieFindForward(&(pf->forwardRoot), num);
+    shardUnlockForward(pf->locks, shard);
+    return res;
+}
+
+/** @brief Wyznacza numery przekierowywane na dany numer.
+ * Wywołuje findReverseForwards dla drzewa reverse struktury @p pf, zajmując
+ * blokadę czytelnika fragmentu numeru @p num, jeśli struktura jest współbieżna.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący poprawny numer;
+ * @param[out] size – wskaźnik na rozmiar wynikowej tablicy.
+ * @return Wynik funkcji findReverseForwards.
+ */
+static char **reverseForwards(PhoneForward const *pf, char const *num, size_t *size) {
+    if (pf->disk)
+        return diskTrieFindReverse(pf->disk, num, size);
+    if (pf->shm)
+        return shmTrieFindReverse(pf->shm, num, size);
+    if (pf->persistent)
+        return persistentFindReverse(pf->persistent, num, size);
+    if (!ensureReverse(pf))
+        return NULL;
+    if (pf->overlay)
+        return overlayFindReverse(pf->overlay, pf->forwardRoot, pf->reverseRoot, num, size);
+    if (!pf->locks)
+        return findReverseForwards(&(pf->reverseRoot), num, size);
+
+    unsigned mask = 1u << trieIndex(num[0]);
+    shardLockReverse(pf->locks, mask, false);
+    char **res = findReverseForwards(&(pf->reverseRoot), num, size);
+    shardUnlockReverse(pf->locks, mask);
+    return res;
+}
+
 void phnumDelete(PhoneNumbers *pnum) {
     if (!pnum) return;
     for (size_t i = 0; i < pnum->size; ++i) {
@@ -57,7 +219,67 @@ void phnumDelete(PhoneNumbers *pnum) {
     free(pnum);
 }
 
-PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num) {
+_Static_assert(PHFWD_OP_COUNT == LATENCY_OPS, "every operation needs its histograms");
+
+/** @brief Sprawdza czy operacje struktury są mierzone lub śledzone.
+ * @param[in] pf – wskaźnik na strukturę przechowującą przekierowania numerów.
+ * @return Wartość @p true, jeśli trzeba wywołać @ref traceEnter i @ref traceExit.
+ */
+static inline bool traced(PhoneForward const *pf) {
+    return pf && (pf->stats || pf->traceHook || pf->capture);
+}
+
+/** @brief Rozpoczyna pomiar operacji.
+ * Zapisuje wywołanie w śladzie, wywołuje funkcję śledzącą i zapamiętuje czas
+ * rozpoczęcia. Operacje wsadowe nie są zapisywane w śladzie, a zmiany zapisuje
+ * @ref captureChange.
+ * @param[in] pf   – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] op   – operacja;
+ * @param[in] num  – pierwszy numer operacji lub NULL;
+ * @param[in] num2 – drugi numer operacji lub NULL.
+ * @return Czas rozpoczęcia w nanosekundach lub 0, gdy pomiar jest wyłączony.
+ */
+static uint64_t traceEnter(PhoneForward const *pf, PhfwdOp op, char const *num, char const *num2) {
+    if (pf->capture && op != PHFWD_OP_ADD && op != PHFWD_OP_REMOVE && op != PHFWD_OP_GET_BATCH &&
+        op != PHFWD_OP_REVERSE_BATCH && op != PHFWD_OP_GET_REVERSE_BATCH)
+        traceCaptureRecord(pf->capture, (int) op, false, num, num2);
+    if (pf->traceHook)
+        pf->traceHook(pf->traceCtx, op, false, num, 0);
+    return pf->stats ? latencyNow() : 0;
+}
+
+/** @brief Kończy pomiar operacji.
+ * Zapisuje czas trwania operacji w histogramie i wywołuje funkcję śledzącą.
+ * @param[in] pf      – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] op      – operacja;
+ * @param[in] num     – pierwszy numer operacji lub NULL;
+ * @param[in] length  – długość uwzględniana w klasie długości;
+ * @param[in] start   – wynik @ref traceEnter;
+ * @param[in] results – liczba wyników operacji.
+ */
+static void traceExit(PhoneForward const *pf, PhfwdOp op, char const *num, size_t length,
+                      uint64_t start, size_t results) {
+    if (pf->stats)
+        latencyRecord(pf->stats, (int) op, length, results, latencyNow() - start);
+    if (pf->traceHook)
+        pf->traceHook(pf->traceCtx, op, true, num, results);
+}
+
+/** @brief Zwraca długość numeru dla pomiaru.
+ * @param[in] num – wskaźnik na napis lub NULL.
+ * @return Długość napisu lub 0 dla NULL.
+ */
+static size_t traceLength(char const *num) {
+    return num ? strlen(num) : 0;
+}
+
+/** @brief Wyznacza przekierowanie numeru.
+ * Wykonuje @ref phfwdGet bez pomiaru.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wynik @ref phfwdGet.
+ */
+static PhoneNumbers *getNumbers(PhoneForward const *pf, char const *num) {
     if (!pf) return NULL;
     PhoneNumbers *pnum = malloc(sizeof(struct PhoneNumbers));
     if (!pnum) return NULL;
@@ -73,7 +295,7 @@ PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num) {
         return NULL;
     }
 
-    char *res = trieFindForward(&(pf->forwardRoot), num);
+    char *res = findForward(pf, num);
     if (!res){
         phnumDelete(pnum);
         return NULL;
@@ -96,12 +318,135 @@ PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num) {
     return pnum;
 }
 
+PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num) {
+    if (!traced(pf))
+        return getNumbers(pf, num);
+
+    uint64_t start = traceEnter(pf, PHFWD_OP_GET, num, NULL);
+    PhoneNumbers *pnum = getNumbers(pf, num);
+    traceExit(pf, PHFWD_OP_GET, num, traceLength(num), start, pnum ? pnum->size : 0);
+    return pnum;
+}
+
+/** @brief Wyznacza przekierowania wielu numerów.
+ * Wykonuje @ref phfwdGetBatch bez pomiaru.
+ * @param[in] pf    – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] nums  – tablica wskaźników na napisy reprezentujące numery;
+ * @param[in] count – liczba numerów.
+ * @return Wynik @ref phfwdGetBatch.
+ */
+static PhoneNumbers *getBatchNumbers(PhoneForward const *pf, char const *const *nums, size_t count) {
+    if (!pf || (count > 0 && !nums)) return NULL;
+    PhoneNumbers *pnum = malloc(sizeof(struct PhoneNumbers));
+    if (!pnum) return NULL;
+
+    pnum->size = 0;
+    pnum->data = NULL;
+    if (count == 0)
+        return pnum;
+
+    pnum->data = malloc(count * sizeof(char *));
+    char const **valid = malloc(count * sizeof(char const *));
+    size_t *positions = malloc(count * sizeof(size_t));
+    if (!pnum->data || !valid || !positions) {
+        free(valid);
+        free(positions);
+        phnumDelete(pnum);
+        return NULL;
+    }
+
+    size_t validCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        pnum->data[i] = NULL;
+        if (isNumber(nums[i])) {
+            valid[validCount] = nums[i];
+            positions[validCount++] = i;
+        }
+    }
+    pnum->size = count;
+
+    bool res = true;
+    if (!pf->persistent && !pf->locks && !pf->disk && !pf->shm && !pf->overlay && !pf->hash) {
+        char **results = malloc((validCount ? validCount : 1) * sizeof(char *));
+        res = results && trieFindForwardBatch(&(pf->forwardRoot), valid, validCount, results);
+        for (size_t k = 0; res && k < validCount; ++k)
+            pnum->data[positions[k]] = results[k];
+        free(results);
+    } else {
+        for (size_t k = 0; res && k < validCount; ++k) {
+            char *temp = findForward(pf, valid[k]);
+            if (temp == valid[k]) {
+                temp = malloc((strlen(valid[k]) + 1) * sizeof(char));
+                if (temp)
+                    strcpy(temp, valid[k]);
+            }
+            pnum->data[positions[k]] = temp;
+            res = temp != NULL;
+        }
+    }
+
+    free(valid);
+    free(positions);
+    if (!res) {
+        phnumDelete(pnum);
+        return NULL;
+    }
+    return pnum;
+}
+
+PhoneNumbers *phfwdGetBatch(PhoneForward const *pf, char const *const *nums, size_t count) {
+    if (!traced(pf))
+        return getBatchNumbers(pf, nums, count);
+
+    uint64_t start = traceEnter(pf, PHFWD_OP_GET_BATCH, NULL, NULL);
+    PhoneNumbers *pnum = getBatchNumbers(pf, nums, count);
+    traceExit(pf, PHFWD_OP_GET_BATCH, NULL, count, start, pnum ? pnum->size : 0);
+    return pnum;
+}
+
 char const *phnumGet(PhoneNumbers const *pnum, size_t idx) {
     if (!pnum || idx >= pnum->size)
         return NULL;
     return pnum->data[idx];
 }
 
+size_t phnumSize(PhoneNumbers const *pnum) {
+    return pnum ? pnum->size : 0;
+}
+
+/** @brief Tworzy strukturę bez drzew i bez włączonych trybów.
+ * Wszystkie wskaźniki struktury mają wartość NULL, a flagi wartość @p false.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+static PhoneForward *allocForward(void) {
+    return calloc(1, sizeof(struct PhoneForward));
+}
+
+/** @brief Zwalnia wszystko poza drzewami struktury.
+ * Zamyka dziennik, ślad, plik i segment drzew oraz usuwa indeksy, blokady,
+ * nakładkę, trwałe drzewa i blok wierzchołków po kompaktowaniu.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ */
+static void releaseModes(PhoneForward *pf) {
+    trieArenaFree(pf->arena);
+    latencyStatsDelete(pf->stats);
+    jumpTableDelete(pf->jump);
+    prefixHashDelete(pf->hash);
+    diskTrieClose(pf->disk);
+    shmTrieClose(pf->shm);
+    overlayDelete(pf->overlay);
+    deleteLazy(pf->lazy);
+    traceCaptureClose(pf->capture);
+    shardLocksDelete(pf->locks);
+    journalClose(pf->journal);
+    if (pf->persistent) {
+        persistentRelease(pf->persistent);
+        free(pf->persistent);
+    }
+}
+
 void phfwdDelete(PhoneForward *pf) {
     if (pf) {
         trieDelete(&(pf->forwardRoot));
@@ -109,20 +454,29 @@ void phfwdDelete(PhoneForward *pf) {
         free(pf->reverseRoot);
         pf->forwardRoot = NULL;
         pf->reverseRoot = NULL;
+        releaseModes(pf);
+        free(pf);
+    }
+}
+
+void phfwdDeleteParallel(PhoneForward *pf, size_t threads) {
+    if (pf) {
+        trieDeleteParallel(&(pf->forwardRoot), &(pf->reverseRoot), threads);
+        releaseModes(pf);
         free(pf);
     }
 }
 
 PhoneForward *phfwdNew(void) {
-    PhoneForward *phoneForward = malloc(sizeof(struct PhoneForward));
+    PhoneForward *phoneForward = allocForward();
 
     if (phoneForward) {
-        phoneForward->forwardRoot = trieNew(false);
+        phoneForward->forwardRoot = trieNew();
         if (!phoneForward->forwardRoot) {
             free(phoneForward);
             return NULL;
         }
-        phoneForward->reverseRoot = trieNew(true);
+        phoneForward->reverseRoot = reverseTrieNew();
         if (!phoneForward->reverseRoot) {
             free(phoneForward->forwardRoot);
             free(phoneForward);
@@ -133,13 +487,146 @@ PhoneForward *phfwdNew(void) {
     return phoneForward;
 }
 
-bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2) {
-    if (pf && pf->reverseRoot && pf->forwardRoot && isNumber(num1) && isNumber(num2) && strcmp(num1, num2) != 0) {
-        TrieNode *forwardPtr = trieAdd(&(pf->forwardRoot), num1);
-        if (!forwardPtr)
-            return false;
+/** @brief Tworzy strukturę opartą na trwałych drzewach.
+ * @param[in] tries – wskaźnik na wersję drzew, którą ma współdzielić nowa
+ *                    struktura, lub NULL dla pustych drzew;
+ * @param[in] readOnly – flaga mówiąca czy struktura jest tylko do odczytu.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+static PhoneForward *newPersistent(PersistentTries const *tries, bool readOnly) {
+    PhoneForward *phoneForward = allocForward();
+
+    if (phoneForward) {
+        phoneForward->persistent = malloc(sizeof(PersistentTries));
+        if (!phoneForward->persistent) {
+            free(phoneForward);
+            return NULL;
+        }
+        phoneForward->persistent->forward = NULL;
+        phoneForward->persistent->reverse = NULL;
+        if (tries)
+            persistentCopy(phoneForward->persistent, tries);
+        phoneForward->readOnly = readOnly;
+    }
+
+    return phoneForward;
+}
+
+PhoneForward *phfwdNewPersistent(void) {
+    return newPersistent(NULL, false);
+}
+
+PhoneForward *phfwdSnapshot(PhoneForward const *pf) {
+    if (!pf || !pf->persistent)
+        return NULL;
+    return newPersistent(pf->persistent, true);
+}
+
+bool phfwdRestore(PhoneForward *pf, PhoneForward const *snap) {
+    if (!pf || !snap || !pf->persistent || !snap->persistent || pf->readOnly)
+        return false;
+    persistentCopy(pf->persistent, snap->persistent);
+    return true;
+}
+
+PhoneForward *phfwdNewSharded(void) {
+    PhoneForward *phoneForward = phfwdNew();
+
+    if (phoneForward) {
+        phoneForward->locks = shardLocksNew();
+        if (!phoneForward->locks) {
+            phfwdDelete(phoneForward);
+            return NULL;
+        }
+    }
+
+    return phoneForward;
+}
+
+PhoneForward *phfwdNewLazyReverse(void) {
+    PhoneForward *phoneForward = phfwdNew();
+    if (!phoneForward)
+        return NULL;
+
+    phoneForward->lazy = malloc(sizeof(LazyReverse));
+    if (!phoneForward->lazy || pthread_mutex_init(&(phoneForward->lazy->mutex), NULL) != 0) {
+        free(phoneForward->lazy);
+        phoneForward->lazy = NULL;
+        phfwdDelete(phoneForward);
+        return NULL;
+    }
+    atomic_init(&(phoneForward->lazy->built), false);
+    return phoneForward;
+}
+
+bool phfwdBuildReverse(PhoneForward *pf) {
+    return pf && ensureReverse(pf);
+}
+
+PhoneForward *phfwdNewOverlay(PhoneForward const *base) {
+    if (!base || !base->forwardRoot || base->overlay || !ensureReverse(base))
+        return NULL;
+    PhoneForward *phoneForward = phfwdNew();
 
-        TrieNode *reversePtr = trieAdd(&(pf->reverseRoot), num2);
+    if (phoneForward) {
+        phoneForward->overlay = overlayNew(base->forwardRoot, base->reverseRoot);
+        if (!phoneForward->overlay) {
+            phfwdDelete(phoneForward);
+            return NULL;
+        }
+    }
+
+    return phoneForward;
+}
+
+PhoneForward *phfwdNewBulk(char const *const *num1, char const *const *num2,
+                          size_t count, size_t threads) {
+    if (count > 0 && (!num1 || !num2))
+        return NULL;
+    PhoneForward *phoneForward = phfwdNew();
+    if (!phoneForward || count == 0)
+        return phoneForward;
+
+    bool *valid = malloc(count * sizeof(bool));
+    if (!valid) {
+        phfwdDelete(phoneForward);
+        return NULL;
+    }
+    for (size_t i = 0; i < count; ++i)
+        valid[i] = isNumber(num1[i]) && isNumber(num2[i]) && strcmp(num1[i], num2[i]) != 0;
+
+    bool res = trieAddParallel(&(phoneForward->forwardRoot), &(phoneForward->reverseRoot),
+                               num1, num2, valid, count, threads);
+    free(valid);
+    if (!res) {
+        phfwdDeleteParallel(phoneForward, threads);
+        return NULL;
+    }
+
+    return phoneForward;
+}
+
+/** @brief Dodaje przekierowanie do drzew.
+ * Wstawia przekierowanie @p num1 na @p num2 do drzewa forward i drzewa reverse,
+ * jeśli drzewo reverse jest aktualizowane. Zakłada, że numery są poprawne,
+ * różne i blokady są już zajęte.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] num1   – wskaźnik na napis reprezentujący prefiks numerów
+ *                     przekierowywanych;
+ * @param[in] num2   – wskaźnik na napis reprezentujący prefiks numerów,
+ *                     na które jest wykonywane przekierowanie.
+ * @return Wartość @p true, jeśli przekierowanie zostało dodane.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool addForward(PhoneForward *pf, char const *num1, char const *num2) {
+    TrieNode *forwardPtr = trieAdd(&(pf->forwardRoot), num1);
+    if (!forwardPtr)
+        return false;
+
+    if (reverseMaintained(pf)) {
+        ReverseNode *reversePtr = reverseTrieAdd(&(pf->reverseRoot), num2);
         if (!reversePtr) {
             freeData(forwardPtr);
             deletePath(forwardPtr);
@@ -147,35 +634,515 @@ bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2) {
         }
 
         forwardPtr->reverseNode = reversePtr;
-        forwardPtr->ptrToList = push(&(reversePtr->data.forwardsList), num1);
+        forwardPtr->ptrToList = push(&(reversePtr->forwardsList), num1);
         if (!forwardPtr->ptrToList) {
+            reverseDeletePath(reversePtr);
             freeData(forwardPtr);
             deletePath(forwardPtr);
             return false;
         }
+    }
 
-        size_t size = strlen(num2);
-        forwardPtr->data.forward = malloc((size + 1) * sizeof(char));
-        if (!forwardPtr->data.forward) {
-            freeData(forwardPtr);
-            deletePath(forwardPtr);
+    size_t size = strlen(num2);
+    forwardPtr->forward = malloc((size + 1) * sizeof(char));
+    if (!forwardPtr->forward) {
+        freeData(forwardPtr);
+        deletePath(forwardPtr);
+        return false;
+    }
+
+    for (size_t i = 0; i <= size; ++i)
+        forwardPtr->forward[i] = num2[i];
+    return true;
+}
+
+/** @brief Dodaje przekierowanie i aktualizuje tablicę skoków.
+ * Wywołuje @ref addForward, a następnie wyznacza ponownie elementy tablicy
+ * skoków, na które mogły wpłynąć nowe wierzchołki i przekierowanie, i nanosi
+ * przekierowanie na indeks w tablicach haszujących. Jeśli dodanie się nie
+ * powiodło, indeks jest oznaczany jako nieaktualny, bo wcześniejsze
+ * przekierowanie @p num1 mogło zostać usunięte.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] num1   – wskaźnik na napis reprezentujący prefiks numerów
+ *                     przekierowywanych;
+ * @param[in] num2   – wskaźnik na napis reprezentujący prefiks numerów,
+ *                     na które jest wykonywane przekierowanie.
+ * @return Wynik @ref addForward.
+ */
+static bool insertForward(PhoneForward *pf, char const *num1, char const *num2) {
+    size_t matched = pf->jump ? trieMatch(&(pf->forwardRoot), num1) : 0;
+    bool res = addForward(pf, num1, num2);
+    if (pf->jump)
+        jumpTableRefresh(pf->jump, pf->forwardRoot, num1, matched + 1);
+    if (res)
+        prefixHashAdd(pf->hash, pf->forwardRoot, num1);
+    else
+        prefixHashInvalidate(pf->hash);
+    return res;
+}
+
+/** @brief Usuwa przekierowania z drzew i aktualizuje tablicę skoków.
+ * Zakłada, że numer jest poprawny i blokady są już zajęte. Przekierowania
+ * są usuwane z indeksu w tablicach haszujących przed usunięciem z drzewa.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] num    – wskaźnik na napis reprezentujący prefiks numerów.
+ */
+static void removeForward(PhoneForward *pf, char const *num) {
+    prefixHashRemove(pf->hash, pf->forwardRoot, num);
+    trieRemove(&(pf->forwardRoot), num);
+    if (pf->jump)
+        jumpTableRefresh(pf->jump, pf->forwardRoot, num, trieMatch(&(pf->forwardRoot), num) + 1);
+}
+
+/** @brief Zapisuje zmianę w dzienniku.
+ * Dopisuje do dziennika struktury @p pf, jeśli jest dołączony, rekord
+ * wykonanej zmiany. Błąd zapisu jest zgłaszany przez @ref phfwdJournalSync.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num1   – wskaźnik na pierwszy numer operacji;
+ * @param[in] num2   – wskaźnik na drugi numer lub NULL dla usunięcia.
+ */
+static void journalChange(PhoneForward *pf, char const *num1, char const *num2) {
+    if (pf->journal)
+        journalAppend(pf->journal, num2 != NULL, num1, num2);
+}
+
+/** @brief Zapisuje wywołanie zmiany w śladzie.
+ * W strukturze z blokadami jest wywoływana pod blokadą pierwszego numeru,
+ * żeby kolejność zmian w śladzie była kolejnością ich wykonania.
+ * @param[in] pf   – wskaźnik na strukturę przechowującą przekierowania numerów
+ *                   lub NULL;
+ * @param[in] num1 – pierwszy numer operacji;
+ * @param[in] num2 – drugi numer lub NULL dla usunięcia.
+ */
+static void captureChange(PhoneForward const *pf, char const *num1, char const *num2) {
+    if (pf && pf->capture)
+        traceCaptureRecord(pf->capture, num2 ? PHFWD_OP_ADD : PHFWD_OP_REMOVE, false, num1, num2);
+}
+
+/** @brief Dodaje przekierowanie.
+ * Wykonuje @ref phfwdAdd bez pomiaru.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] num1   – wskaźnik na napis reprezentujący prefiks numerów
+ *                     przekierowywanych;
+ * @param[in] num2   – wskaźnik na napis reprezentujący prefiks numerów,
+ *                     na które jest wykonywane przekierowanie.
+ * @return Wynik @ref phfwdAdd.
+ */
+static bool addNumbers(PhoneForward *pf, char const *num1, char const *num2) {
+    if (pf && !pf->locks)
+        captureChange(pf, num1, num2);
+    if (pf && pf->persistent && isNumber(num1) && isNumber(num2) && strcmp(num1, num2) != 0) {
+        if (pf->readOnly || !persistentAdd(pf->persistent, num1, num2))
             return false;
-        }
+        journalChange(pf, num1, num2);
+        return true;
+    }
 
-        for (size_t i = 0; i <= size; ++i)
-            forwardPtr->data.forward[i] = num2[i];
+    if (pf && pf->shm && isNumber(num1) && isNumber(num2) && strcmp(num1, num2) != 0) {
+        if (pf->readOnly || !shmTrieAdd(pf->shm, num1, num2))
+            return false;
+        journalChange(pf, num1, num2);
         return true;
     }
 
+    if (pf && pf->reverseRoot && pf->forwardRoot && isNumber(num1) && isNumber(num2) && strcmp(num1, num2) != 0) {
+        if (!pf->locks) {
+            if (!insertForward(pf, num1, num2))
+                return false;
+            journalChange(pf, num1, num2);
+            return true;
+        }
+
+        int shard = trieIndex(num1[0]);
+        shardLockForward(pf->locks, shard, true);
+        captureChange(pf, num1, num2);
+        unsigned mask = 1u << trieIndex(num2[0]);
+        TrieNode *old = trieFind(&(pf->forwardRoot), num1);
+        if (old && old->forward)
+            mask |= 1u << trieIndex(old->forward[0]);
+
+        shardLockReverse(pf->locks, mask, true);
+        bool res = insertForward(pf, num1, num2);
+        shardUnlockReverse(pf->locks, mask);
+        if (res)
+            journalChange(pf, num1, num2);
+        shardUnlockForward(pf->locks, shard);
+        return res;
+    }
+
+    if (pf && pf->locks)
+        captureChange(pf, num1, num2);
     return false;
 }
 
+bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2) {
+    if (!traced(pf))
+        return addNumbers(pf, num1, num2);
+
+    uint64_t start = traceEnter(pf, PHFWD_OP_ADD, num1, num2);
+    bool res = addNumbers(pf, num1, num2);
+    traceExit(pf, PHFWD_OP_ADD, num1, traceLength(num1), start, res);
+    return res;
+}
+
+/** @brief Usuwa przekierowania.
+ * Wykonuje @ref phfwdRemove bez pomiaru.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] num    – wskaźnik na napis reprezentujący prefiks numerów.
+ */
+static void removeNumbers(PhoneForward *pf, char const *num) {
+    if (pf && !pf->locks)
+        captureChange(pf, num, NULL);
+    if (pf && pf->persistent && !pf->readOnly && isNumber(num)) {
+        if (persistentRemove(pf->persistent, num))
+            journalChange(pf, num, NULL);
+        return;
+    }
+    if (pf && pf->shm && !pf->readOnly && isNumber(num)) {
+        if (shmTrieRemove(pf->shm, num))
+            journalChange(pf, num, NULL);
+        return;
+    }
+    if (!pf || !pf->forwardRoot || !isNumber(num)) {
+        if (pf && pf->locks)
+            captureChange(pf, num, NULL);
+        return;
+    }
+    if (!pf->locks) {
+        bool changed = false;
+        if (pf->overlay && !overlayMask(pf->overlay, num, &changed))
+            return;
+        if (trieFind(&(pf->forwardRoot), num)) {
+            removeForward(pf, num);
+            changed = true;
+        }
+        if (changed)
+            journalChange(pf, num, NULL);
+        return;
+    }
+
+    int shard = trieIndex(num[0]);
+    shardLockForward(pf->locks, shard, true);
+    captureChange(pf, num, NULL);
+    TrieNode *node = trieFind(&(pf->forwardRoot), num);
+    if (node) {
+        unsigned mask = trieTargetShards(node);
+        shardLockReverse(pf->locks, mask, true);
+        removeForward(pf, num);
+        shardUnlockReverse(pf->locks, mask);
+        journalChange(pf, num, NULL);
+    }
+    shardUnlockForward(pf->locks, shard);
+}
+
 void phfwdRemove(PhoneForward *pf, char const *num) {
-    if (pf && pf->forwardRoot && isNumber(num))
-        trieRemove(&(pf->forwardRoot), num);
+    if (!traced(pf)) {
+        removeNumbers(pf, num);
+        return;
+    }
+
+    uint64_t start = traceEnter(pf, PHFWD_OP_REMOVE, num, NULL);
+    removeNumbers(pf, num);
+    traceExit(pf, PHFWD_OP_REMOVE, num, traceLength(num), start, 0);
 }
 
-PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num) {
+/** @brief Wykonuje odtwarzaną operację.
+ * Funkcja typu JournalApply wykonująca operację na strukturze @p ctx.
+ * @param[in,out] ctx – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] add     – @p true dla dodania przekierowania, @p false dla usunięcia;
+ * @param[in] num1    – wskaźnik na pierwszy numer operacji;
+ * @param[in] num2    – wskaźnik na drugi numer lub NULL dla usunięcia.
+ * @return Wartość @p false, jeśli nie udało się dodać przekierowania.
+ */
+static bool replayChange(void *ctx, bool add, char const *num1, char const *num2) {
+    if (add)
+        return phfwdAdd(ctx, num1, num2);
+    phfwdRemove(ctx, num1);
+    return true;
+}
+
+/**
+ * To jest struktura przechowująca rekordy dziennika wczytane do pamięci.
+ */
+typedef struct JournalRecords {
+    char **num1; /**< Pierwsze numery operacji. */
+    char **num2; /**< Drugie numery operacji lub NULL dla usunięć. */
+    size_t size; /**< Liczba rekordów. */
+    size_t capacity; /**< Rozmiar tablic. */
+} JournalRecords;
+
+/** @brief Zapamiętuje rekord dziennika.
+ * Funkcja typu JournalApply dopisująca kopię rekordu do struktury @p ctx.
+ * @param[in,out] ctx – wskaźnik na strukturę JournalRecords;
+ * @param[in] add     – @p true dla dodania przekierowania, @p false dla usunięcia;
+ * @param[in] num1    – wskaźnik na pierwszy numer operacji;
+ * @param[in] num2    – wskaźnik na drugi numer lub NULL dla usunięcia.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool collectChange(void *ctx, bool add, char const *num1, char const *num2) {
+    JournalRecords *records = ctx;
+    if (records->size == records->capacity) {
+        size_t capacity = records->capacity ? 2 * records->capacity : 1024;
+        char **temp1 = realloc(records->num1, capacity * sizeof(char *));
+        if (!temp1) return false;
+        records->num1 = temp1;
+        char **temp2 = realloc(records->num2, capacity * sizeof(char *));
+        if (!temp2) return false;
+        records->num2 = temp2;
+        records->capacity = capacity;
+    }
+
+    char *copy1 = malloc((strlen(num1) + 1) * sizeof(char));
+    char *copy2 = add ? malloc((strlen(num2) + 1) * sizeof(char)) : NULL;
+    if (!copy1 || (add && !copy2)) {
+        free(copy1);
+        free(copy2);
+        return false;
+    }
+    strcpy(copy1, num1);
+    if (add)
+        strcpy(copy2, num2);
+
+    records->num1[records->size] = copy1;
+    records->num2[records->size] = copy2;
+    ++records->size;
+    return true;
+}
+
+bool phfwdJournalAttach(PhoneForward *pf, char const *path, size_t batch) {
+    if (!pf || pf->readOnly)
+        return false;
+    Journal *journal = journalOpen(path, batch);
+    if (!journal)
+        return false;
+    journalClose(pf->journal);
+    pf->journal = journal;
+    return true;
+}
+
+bool phfwdJournalSync(PhoneForward *pf) {
+    return pf && pf->journal && journalSync(pf->journal);
+}
+
+/** @brief Dopisuje przekierowanie do przepisywanego dziennika.
+ * Funkcja typu TrieVisit.
+ * @param[in,out] ctx – wskaźnik na dziennik tymczasowy;
+ * @param[in] num1    – wskaźnik na numer przekierowywany;
+ * @param[in] num2    – wskaźnik na numer docelowy.
+ * @return Wartość @p false, jeśli wystąpił błąd zapisu.
+ */
+static bool compactForward(void *ctx, char const *num1, char const *num2) {
+    return journalAppend(ctx, true, num1, num2);
+}
+
+bool phfwdJournalCompact(PhoneForward *pf) {
+    if (!pf || !pf->journal || pf->overlay)
+        return false;
+    Journal *compacted = journalCompactBegin(pf->journal);
+    if (!compacted)
+        return false;
+
+    if (pf->locks) {
+        for (int i = 0; i < N; ++i)
+            shardLockForward(pf->locks, i, false);
+    }
+
+    bool res;
+    if (pf->persistent)
+        res = persistentForEach(pf->persistent, compactForward, compacted);
+    else if (pf->shm)
+        res = shmTrieForEach(pf->shm, compactForward, compacted);
+    else
+        res = trieForEach(pf->forwardRoot, compactForward, compacted);
+    res = journalCompactEnd(pf->journal, compacted, res);
+
+    if (pf->locks) {
+        for (int i = N - 1; i >= 0; --i)
+            shardUnlockForward(pf->locks, i);
+    }
+    return res;
+}
+
+bool phfwdCompact(PhoneForward *pf, size_t *reclaimed) {
+    if (!pf || !reclaimed || pf->persistent || pf->disk || pf->shm)
+        return false;
+
+    if (pf->locks) {
+        for (int i = 0; i < N; ++i)
+            shardLockForward(pf->locks, i, true);
+        shardLockReverse(pf->locks, (1u << N) - 1, true);
+    }
+
+    bool res = trieCompact(pf->forwardRoot, pf->reverseRoot, &(pf->arena), reclaimed);
+    if (res && pf->jump)
+        jumpTableRebuild(pf->jump, pf->forwardRoot);
+    if (res)
+        prefixHashInvalidate(pf->hash);
+
+    if (pf->locks) {
+        shardUnlockReverse(pf->locks, (1u << N) - 1);
+        for (int i = N - 1; i >= 0; --i)
+            shardUnlockForward(pf->locks, i);
+    }
+    return res;
+}
+
+bool phfwdEnableJumpTable(PhoneForward *pf, unsigned levels) {
+    if (!pf || pf->persistent || pf->disk || pf->shm || pf->overlay || levels > JUMP_TABLE_MAX_LEVELS)
+        return false;
+
+    JumpTable *table = NULL;
+    if (levels > 0) {
+        table = jumpTableNew(pf->forwardRoot, levels);
+        if (!table)
+            return false;
+    }
+    jumpTableDelete(pf->jump);
+    pf->jump = table;
+    return true;
+}
+
+bool phfwdEnablePrefixHash(PhoneForward *pf, bool enable) {
+    if (!pf || pf->persistent || pf->disk || pf->shm || pf->overlay || pf->locks)
+        return false;
+
+    PrefixHash *hash = NULL;
+    if (enable) {
+        hash = prefixHashNew();
+        if (!hash)
+            return false;
+    }
+    prefixHashDelete(pf->hash);
+    pf->hash = hash;
+    return true;
+}
+
+bool phfwdExportDisk(PhoneForward const *pf, char const *path) {
+    if (!pf || !path || pf->persistent || pf->disk || pf->shm || pf->overlay)
+        return false;
+
+    if (pf->locks) {
+        for (int i = 0; i < N; ++i)
+            shardLockForward(pf->locks, i, false);
+        shardLockReverse(pf->locks, (1u << N) - 1, false);
+    }
+
+    bool res = ensureReverse(pf) && diskTrieExport(pf->forwardRoot, pf->reverseRoot, path);
+
+    if (pf->locks) {
+        shardUnlockReverse(pf->locks, (1u << N) - 1);
+        for (int i = N - 1; i >= 0; --i)
+            shardUnlockForward(pf->locks, i);
+    }
+    return res;
+}
+
+PhoneForward *phfwdOpenDisk(char const *path, size_t cacheBytes, size_t pinnedBytes) {
+    if (!path)
+        return NULL;
+    PhoneForward *phoneForward = allocForward();
+
+    if (phoneForward) {
+        phoneForward->disk = diskTrieOpen(path, cacheBytes, pinnedBytes);
+        if (!phoneForward->disk) {
+            free(phoneForward);
+            return NULL;
+        }
+        phoneForward->readOnly = true;
+    }
+
+    return phoneForward;
+}
+
+bool phfwdDiskStats(PhoneForward const *pf, uint64_t *hits, uint64_t *misses) {
+    if (!pf || !pf->disk || !hits || !misses)
+        return false;
+    diskTrieStats(pf->disk, hits, misses);
+    return true;
+}
+
+/** @brief Tworzy strukturę korzystającą z segmentu współdzielonej pamięci.
+ * @param[in] shm – wskaźnik na odwzorowany segment lub NULL;
+ * @param[in] readOnly – flaga mówiąca czy struktura jest tylko do odczytu.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy @p shm ma wartość NULL
+ *         lub nie udało się alokować pamięci; segment jest wtedy zamykany.
+ */
+static PhoneForward *newShm(ShmTrie *shm, bool readOnly) {
+    PhoneForward *phoneForward = shm ? allocForward() : NULL;
+
+    if (!phoneForward) {
+        shmTrieClose(shm);
+        return NULL;
+    }
+    phoneForward->readOnly = readOnly;
+    phoneForward->shm = shm;
+    return phoneForward;
+}
+
+PhoneForward *phfwdShmCreate(char const *name, size_t bytes) {
+    return newShm(shmTrieCreate(name, bytes), false);
+}
+
+PhoneForward *phfwdShmOpen(char const *name) {
+    return newShm(shmTrieOpen(name), true);
+}
+
+bool phfwdShmUnlink(char const *name) {
+    return shmTrieUnlink(name);
+}
+
+bool phfwdShmUsage(PhoneForward const *pf, size_t *used, size_t *size) {
+    if (!pf || !pf->shm || !used || !size)
+        return false;
+    shmTrieUsage(pf->shm, used, size);
+    return true;
+}
+
+bool phfwdJournalReplay(PhoneForward *pf, char const *path) {
+    if (!pf || pf->readOnly)
+        return false;
+    return journalReplay(path, replayChange, pf);
+}
+
+PhoneForward *phfwdJournalLoad(char const *path, size_t threads) {
+    JournalRecords records = {NULL, NULL, 0, 0};
+    PhoneForward *pf = NULL;
+
+    if (journalReplay(path, collectChange, &records)) {
+        size_t adds = 0;
+        while (adds < records.size && records.num2[adds])
+            ++adds;
+
+        pf = phfwdNewBulk((char const *const *) records.num1, (char const *const *) records.num2,
+                          adds, threads);
+        for (size_t i = adds; pf && i < records.size; ++i) {
+            if (!replayChange(pf, records.num2[i] != NULL, records.num1[i], records.num2[i])) {
+                phfwdDelete(pf);
+                pf = NULL;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < records.size; ++i) {
+        free(records.num1[i]);
+        free(records.num2[i]);
+    }
+    free(records.num1);
+    free(records.num2);
+    return pf;
+}
+
+/** @brief Wyznacza przekierowania na dany numer.
+ * Wykonuje @ref phfwdReverse bez pomiaru.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wynik @ref phfwdReverse.
+ */
+static PhoneNumbers *reverseNumbers(PhoneForward const *pf, char const *num) {
     if (!pf) return NULL;
     PhoneNumbers *pnum = malloc(sizeof(struct PhoneNumbers));
     if (!pnum) return NULL;
@@ -186,7 +1153,7 @@ PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num) {
         return pnum;
 
     size_t size = 0;
-    char **res = findReverseForwards(&(pf->reverseRoot), num, &size);
+    char **res = reverseForwards(pf, num, &size);
     if (!res) {
         free(pnum);
         return NULL;
@@ -227,7 +1194,23 @@ PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num) {
     return pnum;
 }
 
-PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num) {
+PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num) {
+    if (!traced(pf))
+        return reverseNumbers(pf, num);
+
+    uint64_t start = traceEnter(pf, PHFWD_OP_REVERSE, num, NULL);
+    PhoneNumbers *pnum = reverseNumbers(pf, num);
+    traceExit(pf, PHFWD_OP_REVERSE, num, traceLength(num), start, pnum ? pnum->size : 0);
+    return pnum;
+}
+
+/** @brief Wyznacza przekierowania na dany numer.
+ * Wykonuje @ref phfwdGetReverse bez pomiaru.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wynik @ref phfwdGetReverse.
+ */
+static PhoneNumbers *getReverseNumbers(PhoneForward const *pf, char const *num) {
     if (!pf) return NULL;
     PhoneNumbers *pnum = malloc(sizeof(struct PhoneNumbers));
     if (!pnum) return NULL;
@@ -238,32 +1221,13 @@ PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num) {
         return pnum;
 
     size_t size = 0;
-    char **tempResult = findReverseForwards(&(pf->reverseRoot), num, &size);
+    char **tempResult = reverseForwards(pf, num, &size);
     if (!tempResult) {
         free(pnum);
         return NULL;
     }
 
-    char *temp;
-    size_t newSize = 0;
-    for (size_t i = 0; i < size; ++i) {
-        temp = trieFindForward(&(pf->forwardRoot), tempResult[i]);
-        if (!temp) {
-            for (size_t j = 0; j < size; ++j)
-                free(tempResult[j]);
-            free(tempResult);
-            free(pnum);
-
-            return NULL;
-        }
-        if (strcmp(temp, num) == 0)
-            ++newSize;
-        if (temp != tempResult[i])
-            free(temp);
-    }
-
-    pnum->size = 0;
-    pnum->data = malloc(newSize * sizeof(char *));
+    pnum->data = malloc(size * sizeof(char *));
     if (!pnum->data) {
         for (size_t j = 0; j < size; ++j)
             free(tempResult[j]);
@@ -274,39 +1238,421 @@ PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num) {
     }
 
     for (size_t i = 0; i < size; ++i) {
-        temp = trieFindForward(&(pf->forwardRoot), tempResult[i]);
+        char *temp = findForward(pf, tempResult[i]);
         if (!temp) {
             phnumDelete(pnum);
-            for (size_t j = 0; j < size; ++j)
+            for (size_t j = i; j < size; ++j)
                 free(tempResult[j]);
             free(tempResult);
 
             return NULL;
         }
-        if (strcmp(temp, num) == 0) {
-            size_t tempSize = strlen(tempResult[i]);
-            pnum->data[pnum->size] = malloc((tempSize + 1) * sizeof(char));
-            if (!pnum->data[pnum->size]) {
-                phnumDelete(pnum);
-                if (temp != tempResult[i])
-                    free(temp);
-
-                for (size_t j = 0; j < size; ++j)
-                    free(tempResult[j]);
-                free(tempResult);
-
-                return NULL;
-            }
-            for (size_t j = 0; j <= tempSize; ++j)
-                pnum->data[pnum->size][j] = tempResult[i][j];
-            ++pnum->size;
-        }
+        bool matches = strcmp(temp, num) == 0;
         if (temp != tempResult[i])
             free(temp);
+
+        if (matches)
+            pnum->data[pnum->size++] = tempResult[i];
+        else
+            free(tempResult[i]);
     }
-    for (size_t j = 0; j < size; ++j)
-        free(tempResult[j]);
     free(tempResult);
 
     return pnum;
-}
\ No newline at end of file
+}
+
+PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num) {
+    if (!traced(pf))
+        return getReverseNumbers(pf, num);
+
+    uint64_t start = traceEnter(pf, PHFWD_OP_GET_REVERSE, num, NULL);
+    PhoneNumbers *pnum = getReverseNumbers(pf, num);
+    traceExit(pf, PHFWD_OP_GET_REVERSE, num, traceLength(num), start, pnum ? pnum->size : 0);
+    return pnum;
+}
+
+/** @brief Zamienia numer podany z długością na napis.
+ * Kopiuje @p len znaków @p num do bufora @p buffer lub, gdy się w nim nie
+ * mieszczą, do nowo alokowanej pamięci i dopisuje znak '\0'. Fragment
+ * zawierający znak '\0' jest zamieniany na pusty napis, który nie
+ * reprezentuje numeru.
+ * @param[in] num     – wskaźnik na numer lub NULL;
+ * @param[in] len     – długość numeru;
+ * @param[out] buffer – bufor o rozmiarze @ref SHORT_NUMBER.
+ * @return Wskaźnik na napis lub NULL, gdy @p num ma wartość NULL lub nie
+ *         udało się alokować pamięci.
+ */
+static char *terminate(char const *num, size_t len, char *buffer) {
+    if (!num)
+        return NULL;
+    if (memchr(num, '\0', len))
+        len = 0;
+    char *res = len < SHORT_NUMBER ? buffer : malloc((len + 1) * sizeof(char));
+    if (res) {
+        memcpy(res, num, len);
+        res[len] = '\0';
+    }
+    return res;
+}
+
+/** @brief Zwalnia napis utworzony przez terminate.
+ * @param[in] str    – wskaźnik na napis lub NULL;
+ * @param[in] buffer – bufor przekazany do terminate.
+ */
+static void release(char *str, char const *buffer) {
+    if (str != buffer)
+        free(str);
+}
+
+bool phfwdAddLen(PhoneForward *pf, char const *num1, size_t len1, char const *num2, size_t len2) {
+    char buffer1[SHORT_NUMBER], buffer2[SHORT_NUMBER];
+    char *copy1 = terminate(num1, len1, buffer1), *copy2 = terminate(num2, len2, buffer2);
+    bool res = copy1 && copy2 && phfwdAdd(pf, copy1, copy2);
+    release(copy1, buffer1);
+    release(copy2, buffer2);
+    return res;
+}
+
+void phfwdRemoveLen(PhoneForward *pf, char const *num, size_t len) {
+    char buffer[SHORT_NUMBER];
+    char *copy = terminate(num, len, buffer);
+    if (copy)
+        phfwdRemove(pf, copy);
+    release(copy, buffer);
+}
+
+/** @brief Wykonuje zapytanie dla numeru podanego z długością.
+ * @param[in] query – funkcja zapytania;
+ * @param[in] pf    – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num   – wskaźnik na numer;
+ * @param[in] len   – długość numeru.
+ * @return Wynik funkcji @p query lub NULL, gdy nie udało się alokować pamięci.
+ */
+static PhoneNumbers *queryLen(PhoneNumbers *(*query)(PhoneForward const *, char const *),
+                              PhoneForward const *pf, char const *num, size_t len) {
+    char buffer[SHORT_NUMBER];
+    char *copy = terminate(num, len, buffer);
+    if (num && !copy)
+        return NULL;
+    PhoneNumbers *pnum = query(pf, copy);
+    release(copy, buffer);
+    return pnum;
+}
+
+PhoneNumbers *phfwdGetLen(PhoneForward const *pf, char const *num, size_t len) {
+    return queryLen(phfwdGet, pf, num, len);
+}
+
+PhoneNumbers *phfwdReverseLen(PhoneForward const *pf, char const *num, size_t len) {
+    return queryLen(phfwdReverse, pf, num, len);
+}
+
+PhoneNumbers *phfwdGetReverseLen(PhoneForward const *pf, char const *num, size_t len) {
+    return queryLen(phfwdGetReverse, pf, num, len);
+}
+
+/** @brief Tworzy pusty wynik zapytania wsadowego.
+ * @param[in] count – liczba zapytań.
+ * @return Wskaźnik na strukturę z @p count pustymi ciągami lub NULL, gdy nie
+ *         udało się alokować pamięci.
+ */
+static PhoneNumbersBatch *batchNew(size_t count) {
+    PhoneNumbersBatch *batch = malloc(sizeof(struct PhoneNumbersBatch));
+    if (!batch) return NULL;
+
+    numberPackInit(&(batch->pack));
+    batch->count = count;
+    batch->start = calloc(count ? count : 1, sizeof(size_t));
+    batch->size = calloc(count ? count : 1, sizeof(size_t));
+    if (!batch->start || !batch->size) {
+        phnumBatchDelete(batch);
+        return NULL;
+    }
+    return batch;
+}
+
+/** @brief Wyznacza przekierowania na wiele numerów.
+ * Wykonuje @ref phfwdReverseBatch bez pomiaru.
+ * @param[in] pf    – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] nums  – tablica wskaźników na napisy reprezentujące numery;
+ * @param[in] count – liczba numerów.
+ * @return Wynik @ref phfwdReverseBatch.
+ */
+static PhoneNumbersBatch *reverseBatchNumbers(PhoneForward const *pf, char const *const *nums, size_t count) {
+    if (!pf || (count > 0 && !nums)) return NULL;
+    PhoneNumbersBatch *batch = batchNew(count);
+    if (!batch) return NULL;
+
+    char const **valid = malloc((count ? count : 1) * sizeof(char const *));
+    size_t *positions = malloc((count ? count : 1) * sizeof(size_t));
+    size_t *start = malloc((count ? count : 1) * sizeof(size_t));
+    size_t *size = malloc((count ? count : 1) * sizeof(size_t));
+    bool res = valid && positions && start && size;
+
+    size_t validCount = 0;
+    unsigned mask = 0;
+    for (size_t i = 0; res && i < count; ++i) {
+        if (isNumber(nums[i])) {
+            valid[validCount] = nums[i];
+            positions[validCount++] = i;
+            mask |= 1u << trieIndex(nums[i][0]);
+        }
+    }
+
+    if (res && (pf->persistent || pf->disk || pf->shm || pf->overlay)) {
+        for (size_t k = 0; res && k < validCount; ++k) {
+            size_t numSize = 0;
+            char **arr = reverseForwards(pf, valid[k], &numSize);
+            res = arr != NULL;
+            start[k] = batch->pack.size;
+            for (size_t i = 0; res && i < numSize; ++i)
+                res = numberPackAppend(&(batch->pack), arr[i], 0, arr[i]);
+            size[k] = batch->pack.size - start[k];
+            for (size_t i = 0; arr && i < numSize; ++i)
+                free(arr[i]);
+            free(arr);
+        }
+    } else if (res && !ensureReverse(pf)) {
+        res = false;
+    } else if (res) {
+        if (pf->locks)
+            shardLockReverse(pf->locks, mask, false);
+        res = trieReverseBatch(&(pf->reverseRoot), valid, validCount, &(batch->pack), start, size);
+        if (pf->locks)
+            shardUnlockReverse(pf->locks, mask);
+    }
+
+    for (size_t k = 0; res && k < validCount; ++k) {
+        batch->start[positions[k]] = start[k];
+        batch->size[positions[k]] = size[k];
+    }
+    free(valid);
+    free(positions);
+    free(start);
+    free(size);
+    if (!res) {
+        phnumBatchDelete(batch);
+        return NULL;
+    }
+    return batch;
+}
+
+PhoneNumbersBatch *phfwdReverseBatch(PhoneForward const *pf, char const *const *nums, size_t count) {
+    if (!traced(pf))
+        return reverseBatchNumbers(pf, nums, count);
+
+    uint64_t start = traceEnter(pf, PHFWD_OP_REVERSE_BATCH, NULL, NULL);
+    PhoneNumbersBatch *batch = reverseBatchNumbers(pf, nums, count);
+    traceExit(pf, PHFWD_OP_REVERSE_BATCH, NULL, count, start, batch ? batch->pack.size : 0);
+    return batch;
+}
+
+/** @brief Wyznacza przekierowania numerów na wiele numerów.
+ * Wykonuje @ref phfwdGetReverseBatch bez pomiaru: wyznacza wyniki
+ * @ref phfwdReverseBatch, a następnie przekierowania wszystkich kandydatów
+ * jednym wywołaniem trieFindForwardBatch i zostawia tych, których
+ * przekierowaniem jest numer zapytania.
+ * @param[in] pf    – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] nums  – tablica wskaźników na napisy reprezentujące numery;
+ * @param[in] count – liczba numerów.
+ * @return Wynik @ref phfwdGetReverseBatch.
+ */
+static PhoneNumbersBatch *getReverseBatchNumbers(PhoneForward const *pf, char const *const *nums,
+                                                 size_t count) {
+    PhoneNumbersBatch *batch = reverseBatchNumbers(pf, nums, count);
+    if (!batch || batch->pack.size == 0)
+        return batch;
+
+    size_t total = batch->pack.size;
+    char const **candidates = malloc(total * sizeof(char const *));
+    char **forwards = calloc(total, sizeof(char *));
+    bool res = candidates && forwards;
+    for (size_t j = 0; res && j < total; ++j)
+        candidates[j] = numberPackGet(&(batch->pack), j);
+
+    if (res && !pf->persistent && !pf->locks && !pf->disk && !pf->shm && !pf->overlay && !pf->hash) {
+        res = trieFindForwardBatch(&(pf->forwardRoot), candidates, total, forwards);
+    } else {
+        for (size_t j = 0; res && j < total; ++j) {
+            forwards[j] = findForward(pf, candidates[j]);
+            res = forwards[j] != NULL;
+        }
+    }
+
+    for (size_t i = 0; res && i < count; ++i) {
+        size_t kept = 0, first = batch->start[i];
+        for (size_t j = first; j < first + batch->size[i]; ++j) {
+            if (strcmp(forwards[j], nums[i]) == 0)
+                batch->pack.offsets[first + kept++] = batch->pack.offsets[j];
+        }
+        batch->size[i] = kept;
+    }
+
+    for (size_t j = 0; forwards && j < total; ++j) {
+        if (forwards[j] != candidates[j])
+            free(forwards[j]);
+    }
+    free(forwards);
+    free(candidates);
+    if (!res) {
+        phnumBatchDelete(batch);
+        return NULL;
+    }
+    return batch;
+}
+
+PhoneNumbersBatch *phfwdGetReverseBatch(PhoneForward const *pf, char const *const *nums, size_t count) {
+    if (!traced(pf))
+        return getReverseBatchNumbers(pf, nums, count);
+
+    uint64_t start = traceEnter(pf, PHFWD_OP_GET_REVERSE_BATCH, NULL, NULL);
+    PhoneNumbersBatch *batch = getReverseBatchNumbers(pf, nums, count);
+    size_t results = 0;
+    for (size_t i = 0; batch && i < count; ++i)
+        results += batch->size[i];
+    traceExit(pf, PHFWD_OP_GET_REVERSE_BATCH, NULL, count, start, results);
+    return batch;
+}
+
+size_t phnumBatchSize(PhoneNumbersBatch const *batch, size_t idx) {
+    if (!batch || idx >= batch->count)
+        return 0;
+    return batch->size[idx];
+}
+
+char const *phnumBatchGet(PhoneNumbersBatch const *batch, size_t idx, size_t pos) {
+    if (!batch || idx >= batch->count || pos >= batch->size[idx])
+        return NULL;
+    return numberPackGet(&(batch->pack), batch->start[idx] + pos);
+}
+
+void phnumBatchDelete(PhoneNumbersBatch *batch) {
+    if (!batch) return;
+    numberPackFree(&(batch->pack));
+    free(batch->start);
+    free(batch->size);
+    free(batch);
+}
+
+PhoneForwardList *phfwdList(PhoneForward const *pf, char const *prefix) {
+    if (!pf || pf->disk || pf->shm || pf->overlay)
+        return NULL;
+
+    PhoneForwardList *list = malloc(sizeof(PhoneForwardList));
+    if (!list) return NULL;
+
+    bool valid = !prefix || prefix[0] == '\0' || isNumber(prefix);
+    char const *start = valid && prefix ? prefix : "";
+    bool res;
+    list->persistent = pf->persistent != NULL;
+    if (list->persistent) {
+        PersistentTries empty = {NULL, NULL};
+        res = persistentCursorInit(&(list->cursor.persistent), valid ? pf->persistent : &empty, start);
+    } else {
+        res = trieCursorInit(&(list->cursor.trie), valid ? pf->forwardRoot : NULL, start);
+    }
+
+    if (!res) {
+        free(list);
+        return NULL;
+    }
+    return list;
+}
+
+bool phfwdListNext(PhoneForwardList *list, char const **num1, char const **num2) {
+    if (!list)
+        return false;
+    if (list->persistent)
+        return persistentCursorNext(&(list->cursor.persistent), num1, num2);
+    return trieCursorNext(&(list->cursor.trie), num1, num2);
+}
+
+void phfwdListDelete(PhoneForwardList *list) {
+    if (!list)
+        return;
+    if (list->persistent)
+        persistentCursorFree(&(list->cursor.persistent));
+    else
+        trieCursorFree(&(list->cursor.trie));
+    free(list);
+}
+
+/** @brief Sprawdza, czy kursor przejrzał wszystkie przekierowania.
+ * Pozwala odróżnić koniec przekierowań od błędu alokacji pamięci, po którym
+ * @ref phfwdListNext także zwraca @p false.
+ * @param[in] list – wskaźnik na kursor.
+ * @return Wartość @p true, jeśli przekierowania się skończyły.
+ */
+static bool listFinished(PhoneForwardList const *list) {
+    if (list->persistent)
+        return list->cursor.persistent.next == N;
+    return list->cursor.trie.next == N;
+}
+
+bool phfwdCaptureStart(PhoneForward *pf, char const *path) {
+    if (!pf || !path || pf->disk || pf->shm || pf->overlay || pf->capture)
+        return false;
+    TraceCapture *capture = traceCaptureOpen(path);
+    PhoneForwardList *list = capture ? phfwdList(pf, NULL) : NULL;
+    if (!list) {
+        traceCaptureClose(capture);
+        return false;
+    }
+
+    char const *num1, *num2;
+    while (phfwdListNext(list, &num1, &num2))
+        traceCaptureRecord(capture, PHFWD_OP_ADD, true, num1, num2);
+    bool finished = listFinished(list);
+    phfwdListDelete(list);
+    if (!finished) {
+        traceCaptureClose(capture);
+        return false;
+    }
+    pf->capture = capture;
+    return true;
+}
+
+bool phfwdCaptureStop(PhoneForward *pf) {
+    if (!pf || !pf->capture)
+        return false;
+    bool res = traceCaptureClose(pf->capture);
+    pf->capture = NULL;
+    return res;
+}
+
+bool phfwdStatsEnable(PhoneForward *pf) {
+    if (!pf)
+        return false;
+    if (!pf->stats)
+        pf->stats = latencyStatsNew();
+    return pf->stats != NULL;
+}
+
+uint64_t phfwdStatsCount(PhoneForward const *pf, PhfwdOp op, int lengthClass, int countClass) {
+    if (!pf || !pf->stats || op >= PHFWD_OP_COUNT)
+        return 0;
+    return latencyCount(pf->stats, (int) op, lengthClass, countClass);
+}
+
+uint64_t phfwdStatsPercentile(PhoneForward const *pf, PhfwdOp op, int lengthClass,
+                              int countClass, double percentile) {
+    if (!pf || !pf->stats || op >= PHFWD_OP_COUNT)
+        return 0;
+    return latencyPercentile(pf->stats, (int) op, lengthClass, countClass, percentile);
+}
+
+void phfwdStatsPrint(PhoneForward const *pf, FILE *out) {
+    static char const *const names[PHFWD_OP_COUNT] = {
+            "add", "remove", "get", "getBatch", "reverse", "getReverse", "reverseBatch",
+            "getReverseBatch"
+    };
+    if (pf && pf->stats && out)
+        latencyPrint(pf->stats, names, out);
+}
+
+void phfwdSetTraceHook(PhoneForward *pf, PhfwdTraceHook hook, void *ctx) {
+    if (!pf)
+        return;
+    pf->traceHook = hook;
+    pf->traceCtx = ctx;
+}
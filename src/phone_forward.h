@@ -11,6 +11,12 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /**
  * To jest struktura przechowująca przekierowania numerów telefonów.
@@ -24,6 +30,47 @@ typedef struct PhoneForward PhoneForward;
 struct PhoneNumbers;
 typedef struct PhoneNumbers PhoneNumbers;
 
+/**
+ * To jest struktura przechowująca ciągi numerów telefonów wielu zapytań
+ * w jednym buforze.
+ */
+struct PhoneNumbersBatch;
+typedef struct PhoneNumbersBatch PhoneNumbersBatch;
+
+/**
+ * To jest struktura reprezentująca kursor przeglądający przekierowania.
+ */
+struct PhoneForwardList;
+typedef struct PhoneForwardList PhoneForwardList;
+
+/**
+ * To jest typ wyliczeniowy operacji mierzonych przez @ref phfwdStatsEnable
+ * i zgłaszanych funkcji ustawionej przez @ref phfwdSetTraceHook.
+ */
+typedef enum PhfwdOp {
+    PHFWD_OP_ADD, /**< Wywołanie @ref phfwdAdd. */
+    PHFWD_OP_REMOVE, /**< Wywołanie @ref phfwdRemove. */
+    PHFWD_OP_GET, /**< Wywołanie @ref phfwdGet. */
+    PHFWD_OP_GET_BATCH, /**< Wywołanie @ref phfwdGetBatch. */
+    PHFWD_OP_REVERSE, /**< Wywołanie @ref phfwdReverse. */
+    PHFWD_OP_GET_REVERSE, /**< Wywołanie @ref phfwdGetReverse. */
+    PHFWD_OP_REVERSE_BATCH, /**< Wywołanie @ref phfwdReverseBatch. */
+    PHFWD_OP_GET_REVERSE_BATCH, /**< Wywołanie @ref phfwdGetReverseBatch. */
+    PHFWD_OP_COUNT /**< Liczba operacji. */
+} PhfwdOp;
+
+/** @brief Funkcja wywoływana na początku i na końcu operacji.
+ * @param[in,out] ctx – wskaźnik przekazany do @ref phfwdSetTraceHook;
+ * @param[in] op      – operacja;
+ * @param[in] exit    – @p false na początku operacji, @p true na jej końcu;
+ * @param[in] num     – pierwszy numer przekazany do operacji lub NULL dla
+ *                      operacji wsadowych;
+ * @param[in] results – na końcu operacji liczba numerów w wyniku, dla
+ *                      @ref phfwdAdd 1, jeśli przekierowanie zostało dodane,
+ *                      a dla @ref phfwdRemove 0; na początku operacji 0.
+ */
+typedef void (*PhfwdTraceHook)(void *ctx, PhfwdOp op, bool exit, char const *num, size_t results);
+
 /** @brief Tworzy nową strukturę.
  * Tworzy nową strukturę niezawierającą żadnych przekierowań.
  * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
@@ -31,6 +78,67 @@ typedef struct PhoneNumbers PhoneNumbers;
  */
 PhoneForward * phfwdNew(void);
 
+/** @brief Tworzy nową strukturę współbieżną.
+ * Tworzy nową strukturę niezawierającą żadnych przekierowań, której drzewa są
+ * podzielone na fragmenty według pierwszej cyfry numeru, a każdy fragment ma
+ * własną blokadę. Funkcje @ref phfwdAdd, @ref phfwdRemove, @ref phfwdGet,
+ * @ref phfwdReverse i @ref phfwdGetReverse mogą być wtedy wywoływane
+ * jednocześnie z wielu wątków, a zmiany numerów o różnych pierwszych cyfrach
+ * wykonują się równolegle. Wynik @ref phfwdGetReverse jest wyznaczany w dwóch
+ * krokach i może nie uwzględniać zmian wykonanych w trakcie jego wyznaczania.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+PhoneForward * phfwdNewSharded(void);
+
+/** @brief Tworzy nową strukturę bez drzewa reverse.
+ * Tworzy nową strukturę niezawierającą żadnych przekierowań, która do
+ * pierwszego wywołania @ref phfwdReverse, @ref phfwdGetReverse, ich wersji
+ * wsadowych, @ref phfwdExportDisk lub @ref phfwdBuildReverse przechowuje
+ * przekierowania tylko w drzewie forward. Funkcje @ref phfwdAdd
+ * i @ref phfwdRemove nie zmieniają wtedy drzewa reverse, więc struktura
+ * używana tylko przez @ref phfwdGet zajmuje mniej pamięci, a dodawanie
+ * przekierowań jest szybsze. Pierwsze z tych wywołań buduje drzewo reverse
+ * z drzewa forward i od tej pory jest ono aktualizowane tak jak w strukturze
+ * utworzonej przez @ref phfwdNew. Wyniki wszystkich funkcji są takie same jak
+ * dla struktury utworzonej przez @ref phfwdNew.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+PhoneForward * phfwdNewLazyReverse(void);
+
+/** @brief Buduje drzewo reverse.
+ * Buduje drzewo reverse struktury utworzonej przez @ref phfwdNewLazyReverse,
+ * aby pierwsze wywołanie @ref phfwdReverse lub @ref phfwdGetReverse nie
+ * musiało tego robić. Dla pozostałych struktur nic nie robi.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ * @return Wartość @p true, jeśli drzewo reverse jest zbudowane. Wartość
+ *         @p false, jeśli wskaźnik @p pf ma wartość NULL lub nie udało się
+ *         alokować pamięci.
+ */
+bool phfwdBuildReverse(PhoneForward *pf);
+
+/** @brief Tworzy nakładkę na strukturę bazową.
+ * Tworzy strukturę, która widzi przekierowania struktury @p base, ale
+ * przechowuje tylko własne zmiany, więc zajmuje pamięć proporcjonalną do
+ * liczby zmian, a nie do rozmiaru @p base. Na jednej strukturze bazowej może
+ * być oparte wiele nakładek. Funkcja @ref phfwdAdd nakładki przesłania
+ * bazowe przekierowanie tego samego numeru, a @ref phfwdRemove usuwa jej
+ * przekierowania o danym prefiksie i ukrywa bazowe przekierowania numerów
+ * o tym prefiksie. Funkcje @ref phfwdGet, @ref phfwdReverse,
+ * @ref phfwdGetReverse i ich wersje wsadowe dają takie same wyniki jak dla
+ * kopii @p base, na której wykonano te same zmiany. Struktury @p base nie
+ * wolno zmieniać ani usuwać, dopóki istnieją oparte na niej nakładki.
+ * @param[in] base – wskaźnik na strukturę utworzoną przez @ref phfwdNew,
+ *                   @ref phfwdNewSharded, @ref phfwdNewLazyReverse lub
+ *                   @ref phfwdNewBulk.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy wskaźnik @p base ma
+ *         wartość NULL, struktura @p base jest innego rodzaju lub nie udało
+ *         się alokować pamięci.
+ */
+PhoneForward * phfwdNewOverlay(PhoneForward const *base);
+
 /** @brief Usuwa strukturę.
  * Usuwa strukturę wskazywaną przez @p pf. Nic nie robi, jeśli wskaźnik ten ma
  * wartość NULL.
@@ -38,6 +146,71 @@ PhoneForward * phfwdNew(void);
  */
 void phfwdDelete(PhoneForward *pf);
 
+/** @brief Tworzy nową strukturę z migawkami.
+ * Tworzy nową strukturę niezawierającą żadnych przekierowań, opartą na
+ * trwałych drzewach. Funkcje @ref phfwdAdd i @ref phfwdRemove kopiują tylko
+ * wierzchołki na zmienianych ścieżkach, a pozostałe są współdzielone
+ * z poprzednimi wersjami, dzięki czemu @ref phfwdSnapshot działa w czasie
+ * stałym. Jeśli @ref phfwdRemove nie uda się alokować pamięci, struktura
+ * pozostaje bez zmian.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+PhoneForward * phfwdNewPersistent(void);
+
+/** @brief Tworzy migawkę struktury.
+ * Tworzy w czasie stałym strukturę tylko do odczytu zawierającą te same
+ * przekierowania co @p pf w chwili wywołania. Późniejsze zmiany @p pf nie
+ * wpływają na migawkę. Migawkę można przekazywać do @ref phfwdGet,
+ * @ref phfwdReverse, @ref phfwdGetReverse, @ref phfwdSnapshot i @ref phfwdRestore,
+ * także z innych wątków niż ten, który zmienia @p pf; @ref phfwdAdd zwraca dla
+ * niej @p false, a @ref phfwdRemove nic nie robi. Migawkę należy usunąć funkcją
+ * @ref phfwdDelete.
+ * @param[in] pf – wskaźnik na strukturę utworzoną przez @ref phfwdNewPersistent
+ *                 lub na migawkę.
+ * @return Wskaźnik na migawkę lub NULL, gdy @p pf nie wspiera migawek lub nie
+ *         udało się alokować pamięci.
+ */
+PhoneForward * phfwdSnapshot(PhoneForward const *pf);
+
+/** @brief Przywraca stan z migawki.
+ * Zastępuje w czasie stałym wszystkie przekierowania struktury @p pf
+ * przekierowaniami zapisanymi w migawce @p snap. Migawka pozostaje ważna.
+ * @param[in,out] pf – wskaźnik na strukturę utworzoną przez
+ *                     @ref phfwdNewPersistent;
+ * @param[in] snap   – wskaźnik na migawkę.
+ * @return Wartość @p true, jeśli stan został przywrócony. Wartość @p false,
+ *         jeśli któraś ze struktur nie wspiera migawek lub @p pf jest migawką.
+ */
+bool phfwdRestore(PhoneForward *pf, PhoneForward const *snap);
+
+/** @brief Tworzy strukturę z wielu przekierowań.
+ * Tworzy nową strukturę zawierającą przekierowania @p num1[i] na @p num2[i]
+ * dla @p i od 0 do @p count - 1. Wynik jest taki sam, jak po kolejnych
+ * wywołaniach @ref phfwdAdd dla tych par: pary, dla których @ref phfwdAdd
+ * zwróciłoby @p false, są pomijane, a późniejsze przekierowanie z tym samym
+ * numerem @p num1 zastępuje wcześniejsze. Drzewa są budowane równolegle,
+ * z podziałem pracy według pierwszych cyfr numerów.
+ * @param[in] num1    – tablica napisów reprezentujących prefiksy numerów
+ *                      przekierowywanych;
+ * @param[in] num2    – tablica napisów reprezentujących prefiksy numerów,
+ *                      na które są wykonywane przekierowania;
+ * @param[in] count   – liczba przekierowań;
+ * @param[in] threads – liczba wątków lub 0, by użyć wszystkich procesorów.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+PhoneForward * phfwdNewBulk(char const *const *num1, char const *const *num2,
+                            size_t count, size_t threads);
+
+/** @brief Usuwa strukturę równolegle.
+ * Działa tak jak @ref phfwdDelete, ale usuwa poddrzewa obu drzew na wielu
+ * wątkach. Żaden inny wątek nie może w tym czasie używać struktury @p pf.
+ * @param[in] pf      – wskaźnik na usuwaną strukturę;
+ * @param[in] threads – liczba wątków lub 0, by użyć wszystkich procesorów.
+ */
+void phfwdDeleteParallel(PhoneForward *pf, size_t threads);
+
 /** @brief Dodaje przekierowanie.
  * Dodaje przekierowanie wszystkich numerów mających prefiks @p num1, na numery,
  * w których ten prefiks zamieniono odpowiednio na prefiks @p num2. Każdy numer
@@ -67,6 +240,209 @@ bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2);
  */
 void phfwdRemove(PhoneForward *pf, char const *num);
 
+/** @brief Dodaje przekierowanie numerów podanych z długościami.
+ * Działa tak jak @ref phfwdAdd dla pierwszych @p len1 znaków @p num1
+ * i pierwszych @p len2 znaków @p num2, które nie muszą kończyć się znakiem
+ * '\0'. Fragment zawierający znak '\0' nie reprezentuje numeru. Numery
+ * krótsze niż 64 znaki są kopiowane na stos, więc funkcja nie alokuje
+ * dodatkowej pamięci.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] num1   – wskaźnik na prefiks numerów przekierowywanych;
+ * @param[in] len1   – długość prefiksu @p num1;
+ * @param[in] num2   – wskaźnik na prefiks numerów, na które jest wykonywane
+ *                     przekierowanie;
+ * @param[in] len2   – długość prefiksu @p num2.
+ * @return Wynik taki jak dla @ref phfwdAdd.
+ */
+bool phfwdAddLen(PhoneForward *pf, char const *num1, size_t len1, char const *num2, size_t len2);
+
+/** @brief Usuwa przekierowania prefiksu podanego z długością.
+ * Działa tak jak @ref phfwdRemove dla pierwszych @p len znaków @p num.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] num    – wskaźnik na prefiks numerów;
+ * @param[in] len    – długość prefiksu.
+ */
+void phfwdRemoveLen(PhoneForward *pf, char const *num, size_t len);
+
+/** @brief Porządkuje pamięć struktury.
+ * Przenosi wszystkie wierzchołki drzew struktury @p pf, listy i numery do
+ * jednego nowego bloku pamięci w kolejności przechodzenia drzew w głąb, tak
+ * aby ścieżki od korzenia leżały obok siebie. Zwalnia pamięć rozproszoną po
+ * wielu dodaniach i usunięciach przekierowań. Struktura pozostaje w pełni
+ * modyfikowalna; pamięć wierzchołków usuniętych z bloku jest odzyskiwana przy
+ * następnym wywołaniu tej funkcji.
+ * @param[in,out] pf   – wskaźnik na strukturę przechowującą przekierowania
+ *                       numerów;
+ * @param[out] reclaimed – wskaźnik na liczbę bajtów wierzchołków, list
+ *                         i numerów, o którą zmniejszyło się zużycie pamięci,
+ *                         bez narzutu alokatora.
+ * @return Wartość @p true, jeśli struktura została uporządkowana. Wartość
+ *         @p false, jeśli któryś ze wskaźników ma wartość NULL, struktura
+ *         została utworzona przez @ref phfwdNewPersistent, @ref phfwdOpenDisk,
+ *         @ref phfwdShmCreate lub @ref phfwdShmOpen albo nie udało się
+ *         alokować pamięci; struktura nie jest wtedy
+ *         zmieniana.
+ */
+bool phfwdCompact(PhoneForward *pf, size_t *reclaimed);
+
+/** @brief Włącza tablicę skoków.
+ * Tworzy tablicę o 12^@p levels elementach, po jednym dla każdego możliwego
+ * początku numeru złożonego z @p levels znaków. Element wskazuje wierzchołek
+ * drzewa tego początku i najdłuższe przekierowanie na jego ścieżce, więc
+ * @ref phfwdGet i @ref phfwdGetReverse zaczynają przeszukiwanie drzewa
+ * @p levels poziomów pod korzeniem. Tablica jest aktualizowana przez
+ * @ref phfwdAdd, @ref phfwdRemove i @ref phfwdCompact. Wartość 0 usuwa
+ * tablicę. Funkcji nie wolno wywoływać jednocześnie z innymi operacjami na
+ * strukturze @p pf.
+ * @param[in,out] pf  – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[in] levels  – liczba poziomów od 0 do 5.
+ * @return Wartość @p true, jeśli tablica została utworzona lub usunięta.
+ *         Wartość @p false, jeśli wskaźnik @p pf ma wartość NULL, liczba
+ *         poziomów jest za duża, struktura została utworzona przez
+ *         @ref phfwdNewPersistent, @ref phfwdOpenDisk, @ref phfwdShmCreate,
+ *         @ref phfwdShmOpen lub @ref phfwdNewOverlay albo nie udało się
+ *         alokować pamięci.
+ */
+bool phfwdEnableJumpTable(PhoneForward *pf, unsigned levels);
+
+/** @brief Włącza wyszukiwanie przekierowań w tablicach haszujących.
+ * Zamiast schodzić drzewem forward znak po znaku, @ref phfwdGet
+ * i @ref phfwdGetReverse szukają najdłuższego prefiksu z przekierowaniem
+ * binarnie po długościach prefiksów, pod którymi są przekierowania, sprawdzając
+ * dla każdej długości jedną tablicę haszującą. Wyszukiwanie wykonuje więc
+ * około log2(k) odczytów tablic, gdzie k to liczba różnych długości. Indeks
+ * jest budowany przy pierwszym wyszukiwaniu. Późniejsze zmiany są nanoszone
+ * na tablice bez przebudowy, chyba że wymagają tablicy nowej długości. Wyniki są
+ * takie same jak bez indeksu. Wartość @p false usuwa indeks. Funkcji nie wolno
+ * wywoływać jednocześnie z innymi operacjami na strukturze @p pf.
+ * @param[in,out] pf  – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[in] enable  – flaga mówiąca czy indeks ma być używany.
+ * @return Wartość @p true, jeśli indeks został utworzony lub usunięty.
+ *         Wartość @p false, jeśli wskaźnik @p pf ma wartość NULL, struktura
+ *         została utworzona przez @ref phfwdNewPersistent,
+ *         @ref phfwdNewSharded, @ref phfwdOpenDisk, @ref phfwdShmCreate,
+ *         @ref phfwdShmOpen lub @ref phfwdNewOverlay albo nie udało się
+ *         alokować pamięci.
+ */
+bool phfwdEnablePrefixHash(PhoneForward *pf, bool enable);
+
+/** @brief Zapisuje przekierowania do pliku.
+ * Zapisuje drzewa struktury @p pf do pliku @p path podzielonego na bloki po
+ * 4096 bajtów, tak aby mogły być przeszukiwane funkcją @ref phfwdOpenDisk bez
+ * wczytywania całego pliku do pamięci. Wierzchołki są zapisane w kolejności
+ * przechodzenia drzew wszerz, więc górne poziomy drzew leżą w pierwszych
+ * blokach. Plik jest najpierw zapisywany pod nazwą @p path z przyrostkiem
+ * ".tmp", a po utrwaleniu zastępuje plik @p path, więc po błędzie lub
+ * awarii plik @p path zawiera poprzednią albo nową zawartość w całości.
+ * @param[in] pf   – wskaźnik na strukturę przechowującą przekierowania
+ *                   numerów;
+ * @param[in] path – ścieżka do pliku.
+ * @return Wartość @p true, jeśli plik został zapisany. Wartość @p false,
+ *         jeśli któryś ze wskaźników ma wartość NULL, struktura została
+ *         utworzona przez @ref phfwdNewPersistent, @ref phfwdOpenDisk,
+ *         @ref phfwdShmCreate, @ref phfwdShmOpen lub @ref phfwdNewOverlay,
+ *         wystąpił błąd zapisu lub nie udało się alokować pamięci.
+ */
+bool phfwdExportDisk(PhoneForward const *pf, char const *path);
+
+/** @brief Otwiera przekierowania zapisane w pliku.
+ * Tworzy strukturę tylko do odczytu, która przeszukuje plik zapisany przez
+ * @ref phfwdExportDisk. Pierwsze @p pinnedBytes bajtów pliku, czyli górne
+ * poziomy drzew, jest wczytywane do pamięci przy otwarciu. Pozostałe bloki są
+ * czytane z pliku przy pierwszym użyciu i trzymane w pamięci podręcznej
+ * o rozmiarze @p cacheBytes, z której bloki są usuwane algorytmem
+ * zegarowym: blok użyty od ostatniego przejścia wskazówki zegara zostaje
+ * w pamięci, a pierwszy nieużyty jest zastępowany.
+ * Funkcje @ref phfwdGet, @ref phfwdGetBatch, @ref phfwdReverse,
+ * @ref phfwdGetReverse i ich wersje wsadowe dają takie same wyniki jak dla
+ * struktury, z której plik został zapisany, i mogą być wywoływane
+ * jednocześnie z wielu wątków. Funkcja @ref phfwdAdd zwraca @p false,
+ * a @ref phfwdRemove nic nie robi. Plik nie może być zmieniany, dopóki
+ * struktura istnieje.
+ * @param[in] path        – ścieżka do pliku;
+ * @param[in] cacheBytes  – rozmiar pamięci podręcznej w bajtach, nie mniej niż
+ *                          jeden blok;
+ * @param[in] pinnedBytes – liczba bajtów z początku pliku trzymanych stale
+ *                          w pamięci.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy wskaźnik @p path ma
+ *         wartość NULL, pliku nie udało się odczytać, ma on niepoprawny format
+ *         lub nie udało się alokować pamięci.
+ */
+PhoneForward *phfwdOpenDisk(char const *path, size_t cacheBytes, size_t pinnedBytes);
+
+/** @brief Zwraca liczniki pamięci podręcznej pliku.
+ * Liczy odczyty bloków pliku wykonane przez strukturę utworzoną przez
+ * @ref phfwdOpenDisk. Odczyt bloku trzymanego stale w pamięci jest liczony
+ * jako trafienie.
+ * @param[in] pf      – wskaźnik na strukturę przechowującą przekierowania
+ *                      numerów;
+ * @param[out] hits   – wskaźnik na liczbę odczytów bloków z pamięci;
+ * @param[out] misses – wskaźnik na liczbę odczytów bloków z pliku.
+ * @return Wartość @p true, jeśli liczniki zostały zapisane. Wartość @p false,
+ *         jeśli któryś ze wskaźników ma wartość NULL lub struktura nie została
+ *         utworzona przez @ref phfwdOpenDisk.
+ */
+bool phfwdDiskStats(PhoneForward const *pf, uint64_t *hits, uint64_t *misses);
+
+/** @brief Tworzy strukturę we współdzielonej pamięci.
+ * Tworzy nazwany segment współdzielonej pamięci POSIX o stałym rozmiarze
+ * @p bytes z pustymi drzewami forward i reverse. Wierzchołki i numery leżą
+ * w segmencie i wskazują na siebie przesunięciami zamiast wskaźników, więc
+ * wiele procesów może odwzorować segment funkcją @ref phfwdShmOpen i czytać
+ * przekierowania bez własnej kopii drzew. Zwrócona struktura jest jedynym
+ * procesem piszącym: @ref phfwdAdd i @ref phfwdRemove zmieniają segment i nie
+ * wolno ich wywoływać jednocześnie z wielu wątków. Funkcja @ref phfwdAdd
+ * zwraca @p false także wtedy, gdy w segmencie zabrakło miejsca. Segment
+ * istnieje po usunięciu struktury, dopóki nie zostanie usunięty funkcją
+ * @ref phfwdShmUnlink.
+ * @param[in] name  – nazwa segmentu w postaci "/nazwa";
+ * @param[in] bytes – rozmiar segmentu w bajtach, co najwyżej 32 GiB.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy wskaźnik @p name ma
+ *         wartość NULL, segment o tej nazwie już istnieje, rozmiar jest za mały
+ *         lub za duży, nie udało się utworzyć segmentu lub alokować pamięci.
+ */
+PhoneForward *phfwdShmCreate(char const *name, size_t bytes);
+
+/** @brief Otwiera przekierowania ze współdzielonej pamięci.
+ * Odwzorowuje do odczytu segment utworzony przez @ref phfwdShmCreate.
+ * Funkcje @ref phfwdGet, @ref phfwdGetBatch, @ref phfwdReverse,
+ * @ref phfwdGetReverse i ich wersje wsadowe widzą zmiany procesu piszącego
+ * i mogą być wywoływane jednocześnie z wielu wątków i procesów. Każda zmiana
+ * jest dla nich niepodzielna: zapytanie, w trakcie którego proces piszący
+ * zmienił segment, jest powtarzane. Funkcja @ref phfwdAdd zwraca @p false,
+ * a @ref phfwdRemove nic nie robi.
+ * @param[in] name – nazwa segmentu.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy wskaźnik @p name ma
+ *         wartość NULL, segment nie istnieje, ma niepoprawny format lub nie
+ *         udało się alokować pamięci.
+ */
+PhoneForward *phfwdShmOpen(char const *name);
+
+/** @brief Usuwa nazwę segmentu współdzielonej pamięci.
+ * Struktury, które odwzorowały segment, mogą go dalej używać; pamięć jest
+ * zwalniana po usunięciu ostatniej z nich.
+ * @param[in] name – nazwa segmentu.
+ * @return Wartość @p true, jeśli nazwa została usunięta. Wartość @p false,
+ *         jeśli wskaźnik @p name ma wartość NULL lub segment nie istnieje.
+ */
+bool phfwdShmUnlink(char const *name);
+
+/** @brief Zwraca zajętość segmentu współdzielonej pamięci.
+ * @param[in] pf    – wskaźnik na strukturę przechowującą przekierowania
+ *                    numerów;
+ * @param[out] used – wskaźnik na liczbę bajtów zajętych przez wierzchołki
+ *                    i numery;
+ * @param[out] size – wskaźnik na rozmiar segmentu w bajtach.
+ * @return Wartość @p true, jeśli wartości zostały zapisane. Wartość @p false,
+ *         jeśli któryś ze wskaźników ma wartość NULL lub struktura nie została
+ *         utworzona przez @ref phfwdShmCreate lub @ref phfwdShmOpen.
+ */
+bool phfwdShmUsage(PhoneForward const *pf, size_t *used, size_t *size);
+
 /** @brief Wyznacza przekierowanie numeru.
  * Wyznacza przekierowanie podanego numeru. Szuka najdłuższego pasującego
  * prefiksu. Wynikiem jest ciąg zawierający co najwyżej jeden numer. Jeśli dany
@@ -81,6 +457,30 @@ void phfwdRemove(PhoneForward *pf, char const *num);
  */
 PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num);
 
+/** @brief Wyznacza przekierowanie numeru podanego z długością.
+ * Działa tak jak @ref phfwdGet dla pierwszych @p len znaków @p num.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na numer;
+ * @param[in] len – długość numeru.
+ * @return Wynik taki jak dla @ref phfwdGet.
+ */
+PhoneNumbers *phfwdGetLen(PhoneForward const *pf, char const *num, size_t len);
+
+/** @brief Wyznacza przekierowania wielu numerów.
+ * Wyznacza przekierowania numerów @p nums[0], ..., @p nums[count - 1] tak jak
+ * @ref phfwdGet, przechodząc drzewo raz dla numerów o wspólnych prefiksach.
+ * Wynikiem jest ciąg @p count numerów, w którym numer o indeksie @p i jest
+ * przekierowaniem @p nums[i]; jeśli @p nums[i] nie reprezentuje numeru,
+ * @ref phnumGet zwraca dla tego indeksu NULL. Alokuje strukturę
+ * @p PhoneNumbers, która musi być zwolniona za pomocą funkcji @ref phnumDelete.
+ * @param[in] pf    – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] nums  – tablica wskaźników na napisy reprezentujące numery;
+ * @param[in] count – liczba numerów.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ *         udało się alokować pamięci.
+ */
+PhoneNumbers *phfwdGetBatch(PhoneForward const *pf, char const *const *nums, size_t count);
+
 /** @brief Wyznacza przekierowania na dany numer.
  * Wyznacza następujący ciąg numerów: jeśli istnieje numer @p x, taki że zastępując
  * jego prefiks przekierowaniem tego prefiksu da numer @p num, to numer @p x
@@ -97,6 +497,15 @@ PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num);
  */
 PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num);
 
+/** @brief Wyznacza przekierowania na numer podany z długością.
+ * Działa tak jak @ref phfwdReverse dla pierwszych @p len znaków @p num.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na numer;
+ * @param[in] len – długość numeru.
+ * @return Wynik taki jak dla @ref phfwdReverse.
+ */
+PhoneNumbers *phfwdReverseLen(PhoneForward const *pf, char const *num, size_t len);
+
 /** @brief Usuwa strukturę.
  * Usuwa strukturę wskazywaną przez @p pnum. Nic nie robi, jeśli wskaźnik ten ma
  * wartość NULL.
@@ -114,6 +523,13 @@ void phnumDelete(PhoneNumbers *pnum);
  */
 char const *phnumGet(PhoneNumbers const *pnum, size_t idx);
 
+/** @brief Zwraca liczbę numerów ciągu.
+ * @param[in] pnum – wskaźnik na strukturę przechowującą ciąg numerów telefonów.
+ * @return Liczba numerów, łącznie z pozycjami bez numeru w wyniku
+ *         @ref phfwdGetBatch. Wartość 0, jeśli wskaźnik @p pnum ma wartość NULL.
+ */
+size_t phnumSize(PhoneNumbers const *pnum);
+
 /** @brief Wyznacza przekierowania na dany numer.
  * Wyznacza posortowaną leksykograficznie listę wszystkich takich numerów telefonów
  * i tylko takich numerów telefonów @p x, że phfwdGet(x) = @p num.
@@ -125,4 +541,271 @@ char const *phnumGet(PhoneNumbers const *pnum, size_t idx);
  */
 PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num);
 
+/** @brief Wyznacza numery przekierowywane na numer podany z długością.
+ * Działa tak jak @ref phfwdGetReverse dla pierwszych @p len znaków @p num.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na numer;
+ * @param[in] len – długość numeru.
+ * @return Wynik taki jak dla @ref phfwdGetReverse.
+ */
+PhoneNumbers *phfwdGetReverseLen(PhoneForward const *pf, char const *num, size_t len);
+
+/** @brief Wyznacza przekierowania na wiele numerów.
+ * Dla każdego numeru @p nums[i] wyznacza ten sam ciąg co @ref phfwdReverse.
+ * Numery są przetwarzane w kolejności leksykograficznej, a drzewo jest
+ * przechodzone od końca wspólnego prefiksu z poprzednim numerem, więc numery
+ * o wspólnych prefiksach korzystają z raz zebranych przekierowań. Wszystkie
+ * ciągi są zapisane w jednym buforze. Wynik musi być zwolniony za pomocą
+ * funkcji @ref phnumBatchDelete.
+ * @param[in] pf    – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] nums  – tablica wskaźników na napisy reprezentujące numery;
+ * @param[in] count – liczba numerów.
+ * @return Wskaźnik na strukturę przechowującą @p count ciągów numerów lub NULL,
+ *         gdy nie udało się alokować pamięci.
+ */
+PhoneNumbersBatch *phfwdReverseBatch(PhoneForward const *pf, char const *const *nums, size_t count);
+
+/** @brief Wyznacza przekierowania numerów na wiele numerów.
+ * Dla każdego numeru @p nums[i] wyznacza ten sam ciąg co @ref phfwdGetReverse,
+ * przechodząc drzewa tak jak @ref phfwdReverseBatch i @ref phfwdGetBatch.
+ * Wynik musi być zwolniony za pomocą funkcji @ref phnumBatchDelete.
+ * @param[in] pf    – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] nums  – tablica wskaźników na napisy reprezentujące numery;
+ * @param[in] count – liczba numerów.
+ * @return Wskaźnik na strukturę przechowującą @p count ciągów numerów lub NULL,
+ *         gdy nie udało się alokować pamięci.
+ */
+PhoneNumbersBatch *phfwdGetReverseBatch(PhoneForward const *pf, char const *const *nums, size_t count);
+
+/** @brief Zwraca długość ciągu zapytania.
+ * @param[in] batch – wskaźnik na strukturę przechowującą ciągi numerów;
+ * @param[in] idx   – indeks zapytania.
+ * @return Liczba numerów w ciągu zapytania @p idx lub 0, gdy wskaźnik
+ *         @p batch ma wartość NULL lub indeks ma za dużą wartość.
+ */
+size_t phnumBatchSize(PhoneNumbersBatch const *batch, size_t idx);
+
+/** @brief Udostępnia numer z ciągu zapytania.
+ * @param[in] batch – wskaźnik na strukturę przechowującą ciągi numerów;
+ * @param[in] idx   – indeks zapytania;
+ * @param[in] pos   – indeks numeru w ciągu zapytania.
+ * @return Wskaźnik na napis reprezentujący numer telefonu. Wartość NULL, jeśli
+ *         wskaźnik @p batch ma wartość NULL lub któryś z indeksów ma za dużą
+ *         wartość.
+ */
+char const *phnumBatchGet(PhoneNumbersBatch const *batch, size_t idx, size_t pos);
+
+/** @brief Usuwa strukturę.
+ * Usuwa strukturę wskazywaną przez @p batch. Nic nie robi, jeśli wskaźnik ten
+ * ma wartość NULL.
+ * @param[in] batch – wskaźnik na usuwaną strukturę.
+ */
+void phnumBatchDelete(PhoneNumbersBatch *batch);
+
+/** @brief Tworzy kursor przeglądający przekierowania.
+ * Tworzy kursor, który zwraca przekierowania wszystkich numerów zaczynających
+ * się od @p prefix w kolejności leksykograficznej wyznaczonej przez kolejność
+ * znaków 0, 1, ..., 9, *, #. Pusty napis lub NULL oznacza wszystkie
+ * przekierowania. Jeśli @p prefix nie reprezentuje numeru, kursor jest pusty.
+ * Kursor struktury utworzonej przez @ref phfwdNewPersistent widzi
+ * przekierowania z chwili utworzenia kursora. Pozostałych struktur nie wolno
+ * zmieniać, dopóki kursor jest używany. Kursor musi być zwolniony za pomocą
+ * funkcji @ref phfwdListDelete.
+ * @param[in] pf     – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] prefix – wskaźnik na napis reprezentujący prefiks numerów.
+ * @return Wskaźnik na kursor lub NULL, gdy wskaźnik @p pf ma wartość NULL,
+ *         struktura została utworzona przez @ref phfwdOpenDisk,
+ *         @ref phfwdShmCreate, @ref phfwdShmOpen lub @ref phfwdNewOverlay
+ *         albo nie udało się alokować pamięci.
+ */
+PhoneForwardList *phfwdList(PhoneForward const *pf, char const *prefix);
+
+/** @brief Przesuwa kursor na następne przekierowanie.
+ * Ustawia @p num1 na numer przekierowywany, a @p num2 na numer, na który jest
+ * on przekierowany. Napisy należą do kursora i są ważne do następnego wywołania
+ * tej funkcji; kolejne przekierowania nie wymagają alokowania pamięci.
+ * @param[in,out] list – wskaźnik na kursor;
+ * @param[out] num1    – wskaźnik na numer przekierowywany;
+ * @param[out] num2    – wskaźnik na numer, na który jest wykonywane
+ *                       przekierowanie.
+ * @return Wartość @p true, jeśli zwrócono przekierowanie. Wartość @p false,
+ *         jeśli przekierowania się skończyły, wskaźnik @p list ma wartość NULL
+ *         lub nie udało się alokować pamięci; w ostatnim przypadku można
+ *         ponowić wywołanie.
+ */
+bool phfwdListNext(PhoneForwardList *list, char const **num1, char const **num2);
+
+/** @brief Usuwa kursor.
+ * Usuwa kursor wskazywany przez @p list. Nic nie robi, jeśli wskaźnik ten ma
+ * wartość NULL.
+ * @param[in] list – wskaźnik na usuwany kursor.
+ */
+void phfwdListDelete(PhoneForwardList *list);
+
+/** @brief Włącza pomiar opóźnień.
+ * Od tej chwili czas każdego wywołania operacji z @ref PhfwdOp na strukturze
+ * @p pf jest zapisywany w histogramie tej operacji, osobnym dla każdej klasy
+ * długości numeru (0–3, 4–7, 8–15, 16–31, 32 i więcej znaków) i klasy liczby
+ * wyników (0, 1, 2–3, 4–15, 16–63, 64 i więcej). Dla operacji wsadowych
+ * długością jest liczba numerów zapytania. Histogramy mają względną dokładność 12,5%.
+ * Bez włączonego pomiaru i funkcji śledzącej operacje nie są mierzone.
+ * Funkcję należy wywołać, zanim struktura zostanie udostępniona innym wątkom.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ * @return Wartość @p true, jeśli pomiar jest włączony. Wartość @p false, jeśli
+ *         wskaźnik @p pf ma wartość NULL lub nie udało się alokować pamięci.
+ */
+bool phfwdStatsEnable(PhoneForward *pf);
+
+/** @brief Zwraca liczbę zmierzonych wywołań.
+ * @param[in] pf          – wskaźnik na strukturę przechowującą przekierowania
+ *                          numerów;
+ * @param[in] op          – operacja;
+ * @param[in] lengthClass – klasa długości numeru od 0 do 4 lub -1 dla wszystkich;
+ * @param[in] countClass  – klasa liczby wyników od 0 do 5 lub -1 dla wszystkich.
+ * @return Liczba wywołań lub 0, gdy pomiar nie jest włączony.
+ */
+uint64_t phfwdStatsCount(PhoneForward const *pf, PhfwdOp op, int lengthClass, int countClass);
+
+/** @brief Zwraca percentyl opóźnień.
+ * @param[in] pf          – wskaźnik na strukturę przechowującą przekierowania
+ *                          numerów;
+ * @param[in] op          – operacja;
+ * @param[in] lengthClass – klasa długości numeru od 0 do 4 lub -1 dla wszystkich;
+ * @param[in] countClass  – klasa liczby wyników od 0 do 5 lub -1 dla wszystkich;
+ * @param[in] percentile  – percentyl z przedziału od 0 do 100.
+ * @return Opóźnienie w nanosekundach, którego nie przekroczył dany odsetek
+ *         wywołań, lub 0, gdy pomiar nie jest włączony lub nie ma wywołań.
+ */
+uint64_t phfwdStatsPercentile(PhoneForward const *pf, PhfwdOp op, int lengthClass,
+                              int countClass, double percentile);
+
+/** @brief Wypisuje histogramy opóźnień.
+ * Wypisuje do @p out po jednym wierszu dla każdej operacji i pary klas,
+ * w których zmierzono wywołania: liczbę wywołań i percentyle 50, 90, 99
+ * i 99,9 w mikrosekundach. Nic nie robi, jeśli pomiar nie jest włączony.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] out – strumień wyjściowy.
+ */
+void phfwdStatsPrint(PhoneForward const *pf, FILE *out);
+
+/** @brief Rozpoczyna zapis śladu wywołań.
+ * Tworzy lub nadpisuje plik @p path i zapisuje w nim najpierw wszystkie
+ * przekierowania struktury @p pf, a potem każde wywołanie @ref phfwdAdd,
+ * @ref phfwdRemove, @ref phfwdGet, @ref phfwdReverse i @ref phfwdGetReverse
+ * na tej strukturze z argumentami i czasem wywołania. Rekord zajmuje bajt
+ * operacji, czas od poprzedniego rekordu i numery z ich długościami; liczby są
+ * zapisane w kodowaniu LEB128. Operacje wsadowe nie są zapisywane. Zmiany
+ * struktury z @ref phfwdNewSharded są zapisywane pod blokadą, więc ich
+ * kolejność w śladzie jest kolejnością wykonania. Ślad można odtworzyć
+ * programem phone_forward_replay. Funkcji nie wolno wywoływać
+ * jednocześnie z innymi operacjami na strukturze @p pf.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] path   – ścieżka do pliku śladu.
+ * @return Wartość @p true, jeśli zapis się rozpoczął. Wartość @p false, jeśli
+ *         któryś ze wskaźników ma wartość NULL, zapis już trwa, struktura
+ *         została utworzona przez @ref phfwdOpenDisk, @ref phfwdShmCreate,
+ *         @ref phfwdShmOpen lub @ref phfwdNewOverlay, nie udało się utworzyć
+ *         pliku lub alokować pamięci.
+ */
+bool phfwdCaptureStart(PhoneForward *pf, char const *path);
+
+/** @brief Kończy zapis śladu wywołań.
+ * Zapisuje rekordy z bufora i zamyka plik śladu. Funkcji nie wolno wywoływać
+ * jednocześnie z innymi operacjami na strukturze @p pf. Zapis jest też
+ * kończony przez @ref phfwdDelete.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ * @return Wartość @p true, jeśli cały ślad został zapisany. Wartość @p false,
+ *         jeśli wskaźnik @p pf ma wartość NULL, zapis nie trwa lub wystąpił
+ *         błąd zapisu albo alokacji.
+ */
+bool phfwdCaptureStop(PhoneForward *pf);
+
+/** @brief Ustawia funkcję śledzącą.
+ * Ustawia funkcję @p hook wywoływaną na początku i na końcu każdej operacji
+ * z @ref PhfwdOp na strukturze @p pf, w wątku wykonującym operację. Wartość
+ * NULL wyłącza śledzenie. Funkcję należy wywołać, zanim struktura zostanie
+ * udostępniona innym wątkom.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] hook   – funkcja śledząca lub NULL;
+ * @param[in] ctx    – wskaźnik przekazywany do @p hook.
+ */
+void phfwdSetTraceHook(PhoneForward *pf, PhfwdTraceHook hook, void *ctx);
+
+/** @brief Dołącza dziennik zmian.
+ * Od tej chwili każde udane wywołanie @ref phfwdAdd i każde wywołanie
+ * @ref phfwdRemove, które coś usunęło, jest dopisywane do dziennika w pliku
+ * @p path. Rekordy są zapisywane na dysk grupami po @p batch, a ostatnią,
+ * niepełną grupę zapisuje @ref phfwdJournalSync lub @ref phfwdDelete.
+ * Wcześniej dołączony dziennik jest zamykany. Istniejący plik nie jest
+ * odtwarzany; służy do tego @ref phfwdJournalReplay lub @ref phfwdJournalLoad.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] path   – wskaźnik na ścieżkę pliku dziennika;
+ * @param[in] batch  – liczba rekordów w grupie lub 0, jeśli grupy mają być
+ *                     zapisywane tylko przez @ref phfwdJournalSync i przy
+ *                     zapełnieniu bufora.
+ * @return Wartość @p true, jeśli dziennik został dołączony. Wartość @p false,
+ *         jeśli @p pf jest migawką, nie udało się otworzyć pliku, plik nie jest
+ *         dziennikiem lub nie udało się alokować pamięci.
+ */
+bool phfwdJournalAttach(PhoneForward *pf, char const *path, size_t batch);
+
+/** @brief Zapisuje dziennik na dysk.
+ * Zapisuje buforowane rekordy dziennika struktury @p pf i czeka, aż trafią na dysk.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ * @return Wartość @p true, jeśli wszystkie dotychczasowe rekordy są zapisane.
+ *         Wartość @p false, jeśli struktura nie ma dziennika lub wystąpił błąd
+ *         zapisu, także przy którejś z wcześniejszych zmian.
+ */
+bool phfwdJournalSync(PhoneForward *pf);
+
+/** @brief Przepisuje dziennik.
+ * Zastępuje dziennik struktury @p pf dziennikiem zawierającym tylko
+ * obecne przekierowania, po jednym rekordzie dodania na przekierowanie.
+ * Nowy plik jest zapisywany obok i podmieniany dopiero, gdy trafi na dysk.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ * @return Wartość @p true, jeśli dziennik został przepisany. Wartość @p false,
+ *         jeśli struktura nie ma dziennika, została utworzona przez
+ *         @ref phfwdNewOverlay lub wystąpił błąd; dotychczasowy dziennik
+ *         pozostaje wtedy ważny.
+ */
+bool phfwdJournalCompact(PhoneForward *pf);
+
+/** @brief Odtwarza dziennik.
+ * Wykonuje na strukturze @p pf kolejne operacje zapisane w dzienniku @p path.
+ * Niekompletna ostatnia grupa rekordów jest pomijana. Jeśli do @p pf jest
+ * dołączony dziennik, odtwarzane operacje są do niego dopisywane.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] path   – wskaźnik na ścieżkę pliku dziennika.
+ * @return Wartość @p true, jeśli dziennik został odtworzony. Wartość @p false,
+ *         jeśli nie udało się odczytać pliku, plik nie jest dziennikiem lub nie
+ *         udało się alokować pamięci.
+ */
+bool phfwdJournalReplay(PhoneForward *pf, char const *path);
+
+/** @brief Tworzy strukturę z dziennika.
+ * Tworzy nową strukturę zawierającą przekierowania zapisane w dzienniku
+ * @p path. Początkowe rekordy dodania, czyli cały przepisany dziennik, są
+ * wczytywane równolegle przez @ref phfwdNewBulk, a pozostałe odtwarzane
+ * kolejno.
+ * @param[in] path    – wskaźnik na ścieżkę pliku dziennika;
+ * @param[in] threads – liczba wątków lub 0, by użyć wszystkich procesorów.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         odczytać pliku, plik nie jest dziennikiem lub nie udało się
+ *         alokować pamięci.
+ */
+PhoneForward * phfwdJournalLoad(char const *path, size_t threads);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* __PHONE_FORWARD_H__ */
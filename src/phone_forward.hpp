@@ -0,0 +1,273 @@
+/** @file
+ * Interfejs C++ klasy przechowującej przekierowania numerów telefonicznych
+ *
+ * Klasy są cienką warstwą nad funkcjami z phone_forward.h: przejmują
+ * własność struktur biblioteki, zwalniają je w destruktorach i udostępniają
+ * numery wyników jako @p std::string_view wskazujące na pamięć biblioteki.
+ * Numery zapytań są przekazywane z długościami, więc nie muszą kończyć się
+ * znakiem '\0'. Niepowodzenie alokacji pamięci jest zgłaszane wyjątkiem
+ * @p std::bad_alloc.
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __PHONE_FORWARD_HPP__
+#define __PHONE_FORWARD_HPP__
+
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <string_view>
+#include <utility>
+#include "phone_forward.h"
+
+namespace phfwd {
+
+/**
+ * To jest klasa przechowująca ciąg numerów telefonów, wynik zapytania.
+ * Obiekt jest jedynym właścicielem struktury @p PhoneNumbers i można go
+ * tylko przenosić. Widoki numerów są ważne, dopóki obiekt istnieje.
+ */
+class Numbers {
+public:
+    /**
+     * To jest iterator po numerach ciągu.
+     */
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag; /**< Rodzaj iteratora. */
+        using value_type = std::string_view; /**< Typ elementu. */
+        using difference_type = std::ptrdiff_t; /**< Typ różnicy iteratorów. */
+        using pointer = void; /**< Elementy są zwracane przez wartość. */
+        using reference = std::string_view; /**< Typ zwracany przez operator*. */
+
+        /** @brief Tworzy iterator.
+         * @param[in] pnum – wskaźnik na ciąg numerów;
+         * @param[in] idx  – indeks numeru.
+         */
+        iterator(PhoneNumbers const *pnum, std::size_t idx) noexcept : pnum(pnum), idx(idx) {}
+
+        /** @brief Zwraca bieżący numer.
+         * @return Widok numeru lub pusty widok, jeśli pozycja nie zawiera numeru.
+         */
+        std::string_view operator*() const noexcept {
+            char const *num = phnumGet(pnum, idx);
+            return num ? std::string_view(num) : std::string_view();
+        }
+
+        /** @brief Przechodzi do następnego numeru.
+         * @return Referencja na iterator.
+         */
+        iterator &operator++() noexcept {
+            ++idx;
+            return *this;
+        }
+
+        /** @brief Przechodzi do następnego numeru.
+         * @return Iterator przed przesunięciem.
+         */
+        iterator operator++(int) noexcept {
+            iterator res = *this;
+            ++idx;
+            return res;
+        }
+
+        /** @brief Porównuje iteratory.
+         * @param[in] other – drugi iterator.
+         * @return Wartość @p true, jeśli iteratory wskazują ten sam numer.
+         */
+        bool operator==(iterator const &other) const noexcept {
+            return pnum == other.pnum && idx == other.idx;
+        }
+
+        /** @brief Porównuje iteratory.
+         * @param[in] other – drugi iterator.
+         * @return Wartość @p true, jeśli iteratory wskazują różne numery.
+         */
+        bool operator!=(iterator const &other) const noexcept { return !(*this == other); }
+
+    private:
+        PhoneNumbers const *pnum; /**< Ciąg numerów. */
+        std::size_t idx; /**< Indeks bieżącego numeru. */
+    };
+
+    /** @brief Przejmuje ciąg numerów.
+     * @param[in] pnum – wskaźnik na ciąg numerów lub NULL.
+     */
+    explicit Numbers(PhoneNumbers *pnum = nullptr) noexcept : pnum(pnum) {}
+
+    /** @brief Przenosi ciąg numerów.
+     * @param[in,out] other – obiekt, który przestaje być właścicielem ciągu.
+     */
+    Numbers(Numbers &&other) noexcept : pnum(std::exchange(other.pnum, nullptr)) {}
+
+    /** @brief Przenosi ciąg numerów, zwalniając poprzedni.
+     * @param[in,out] other – obiekt, który przestaje być właścicielem ciągu.
+     * @return Referencja na obiekt.
+     */
+    Numbers &operator=(Numbers &&other) noexcept {
+        if (this != &other)
+            phnumDelete(std::exchange(pnum, std::exchange(other.pnum, nullptr)));
+        return *this;
+    }
+
+    Numbers(Numbers const &) = delete;
+    Numbers &operator=(Numbers const &) = delete;
+
+    /** @brief Zwalnia ciąg numerów. */
+    ~Numbers() { phnumDelete(pnum); }
+
+    /** @brief Zwraca liczbę numerów.
+     * @return Liczba numerów ciągu.
+     */
+    std::size_t size() const noexcept { return phnumSize(pnum); }
+
+    /** @brief Sprawdza czy ciąg jest pusty.
+     * @return Wartość @p true, jeśli ciąg nie zawiera numerów.
+     */
+    bool empty() const noexcept { return phnumSize(pnum) == 0; }
+
+    /** @brief Zwraca numer.
+     * @param[in] idx – indeks numeru.
+     * @return Widok numeru lub pusty widok, jeśli indeks ma za dużą wartość
+     *         lub pozycja nie zawiera numeru.
+     */
+    std::string_view operator[](std::size_t idx) const noexcept {
+        char const *num = phnumGet(pnum, idx);
+        return num ? std::string_view(num) : std::string_view();
+    }
+
+    /** @brief Zwraca iterator na pierwszy numer.
+     * @return Iterator.
+     */
+    iterator begin() const noexcept { return iterator(pnum, 0); }
+
+    /** @brief Zwraca iterator za ostatnim numerem.
+     * @return Iterator.
+     */
+    iterator end() const noexcept { return iterator(pnum, size()); }
+
+    /** @brief Udostępnia strukturę biblioteki.
+     * @return Wskaźnik na ciąg numerów lub NULL.
+     */
+    PhoneNumbers const *get() const noexcept { return pnum; }
+
+private:
+    PhoneNumbers *pnum; /**< Ciąg numerów, którego właścicielem jest obiekt. */
+};
+
+/**
+ * To jest klasa przechowująca przekierowania numerów telefonów.
+ * Obiekt jest jedynym właścicielem struktury @p PhoneForward i można go
+ * tylko przenosić. Obiekt, z którego przeniesiono strukturę, można jedynie
+ * usunąć lub przypisać mu inny obiekt: @ref add zwraca dla niego @p false,
+ * @ref remove nic nie robi, a zapytania zgłaszają wyjątek @p std::bad_alloc.
+ */
+class Forward {
+public:
+    /** @brief Tworzy pustą strukturę, tak jak @ref phfwdNew. */
+    Forward() : Forward(phfwdNew()) {}
+
+    /** @brief Przejmuje strukturę.
+     * Pozwala korzystać z innych konstruktorów biblioteki, np.
+     * Forward(phfwdNewSharded()).
+     * @param[in] pf – wskaźnik na strukturę.
+     * @throw std::bad_alloc, gdy @p pf ma wartość NULL.
+     */
+    explicit Forward(PhoneForward *pf) : pf(pf) {
+        if (!pf)
+            throw std::bad_alloc();
+    }
+
+    /** @brief Przenosi strukturę.
+     * @param[in,out] other – obiekt, który przestaje być właścicielem struktury.
+     */
+    Forward(Forward &&other) noexcept : pf(std::exchange(other.pf, nullptr)) {}
+
+    /** @brief Przenosi strukturę, usuwając poprzednią.
+     * @param[in,out] other – obiekt, który przestaje być właścicielem struktury.
+     * @return Referencja na obiekt.
+     */
+    Forward &operator=(Forward &&other) noexcept {
+        if (this != &other)
+            phfwdDelete(std::exchange(pf, std::exchange(other.pf, nullptr)));
+        return *this;
+    }
+
+    Forward(Forward const &) = delete;
+    Forward &operator=(Forward const &) = delete;
+
+    /** @brief Usuwa strukturę. */
+    ~Forward() { phfwdDelete(pf); }
+
+    /** @brief Dodaje przekierowanie, tak jak @ref phfwdAdd.
+     * @param[in] num1 – prefiks numerów przekierowywanych;
+     * @param[in] num2 – prefiks numerów, na które jest wykonywane przekierowanie.
+     * @return Wartość @p true, jeśli przekierowanie zostało dodane. Wartość
+     *         @p false, jeśli któryś napis nie reprezentuje numeru, numery są
+     *         identyczne lub nie udało się alokować pamięci.
+     */
+    bool add(std::string_view num1, std::string_view num2) noexcept {
+        return phfwdAddLen(pf, num1.data(), num1.size(), num2.data(), num2.size());
+    }
+
+    /** @brief Usuwa przekierowania, tak jak @ref phfwdRemove.
+     * @param[in] num – prefiks numerów.
+     */
+    void remove(std::string_view num) noexcept { phfwdRemoveLen(pf, num.data(), num.size()); }
+
+    /** @brief Wyznacza przekierowanie numeru, tak jak @ref phfwdGet.
+     * @param[in] num – numer.
+     * @return Ciąg numerów.
+     * @throw std::bad_alloc, gdy nie udało się alokować pamięci lub struktura
+     *        została przeniesiona.
+     */
+    Numbers get(std::string_view num) const { return result(phfwdGetLen(pf, num.data(), num.size())); }
+
+    /** @brief Wyznacza przekierowania na numer, tak jak @ref phfwdReverse.
+     * @param[in] num – numer.
+     * @return Ciąg numerów.
+     * @throw std::bad_alloc, gdy nie udało się alokować pamięci lub struktura
+     *        została przeniesiona.
+     */
+    Numbers reverse(std::string_view num) const {
+        return result(phfwdReverseLen(pf, num.data(), num.size()));
+    }
+
+    /** @brief Wyznacza numery przekierowywane na numer, tak jak @ref phfwdGetReverse.
+     * @param[in] num – numer.
+     * @return Ciąg numerów.
+     * @throw std::bad_alloc, gdy nie udało się alokować pamięci lub struktura
+     *        została przeniesiona.
+     */
+    Numbers getReverse(std::string_view num) const {
+        return result(phfwdGetReverseLen(pf, num.data(), num.size()));
+    }
+
+    /** @brief Udostępnia strukturę biblioteki.
+     * Pozwala wywoływać pozostałe funkcje z phone_forward.h.
+     * @return Wskaźnik na strukturę lub NULL, jeśli struktura została
+     *         przeniesiona.
+     */
+    PhoneForward *get() const noexcept { return pf; }
+
+private:
+    /** @brief Przejmuje wynik zapytania.
+     * @param[in] pnum – wskaźnik na ciąg numerów lub NULL.
+     * @return Ciąg numerów.
+     * @throw std::bad_alloc, gdy @p pnum ma wartość NULL.
+     */
+    static Numbers result(PhoneNumbers *pnum) {
+        if (!pnum)
+            throw std::bad_alloc();
+        return Numbers(pnum);
+    }
+
+    PhoneForward *pf; /**< Struktura, której właścicielem jest obiekt. */
+};
+
+} // namespace phfwd
+
+#endif /* __PHONE_FORWARD_HPP__ */
@@ -0,0 +1,214 @@
+/** @file
+ * Porównanie sposobów wyszukiwania przekierowań
+ *
+ * Dodaje losowe przekierowania z prefiksami kilku różnych długości,
+ * a następnie mierzy czas phfwdGet i phfwdGetBatch dla tych samych numerów
+ * przy wyszukiwaniu w drzewie, z tablicą skoków i w tablicach haszujących
+ * prefiksów. Sprawdza, że wszystkie sposoby dają takie same wyniki.
+ * Użycie: phone_forward_bench [PRZEKIEROWANIA] [ZAPYTANIA] [DŁUGOŚCI].
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+#define _POSIX_C_SOURCE 200809L /**< Udostępnia clock_gettime i rand_r. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include "phone_forward.h"
+
+#define QUERY_LENGTH 16 /**< Długość numerów zapytań. */
+#define MAX_LENGTHS 6 /**< Największa liczba różnych długości prefiksów. */
+#define BATCH 64 /**< Liczba numerów w jednym wywołaniu phfwdGetBatch. */
+#define JUMP_LEVELS 3 /**< Liczba poziomów tablicy skoków. */
+
+/**
+ * To są sposoby wyszukiwania przekierowań.
+ */
+typedef enum Engine {
+    ENGINE_TRIE, /**< Wyszukiwanie w drzewie. */
+    ENGINE_JUMP, /**< Wyszukiwanie z tablicą skoków. */
+    ENGINE_HASH, /**< Wyszukiwanie w tablicach haszujących prefiksów. */
+    ENGINE_COUNT /**< Liczba sposobów. */
+} Engine;
+
+/** Nazwy sposobów wyszukiwania. */
+static char const *const engineName[ENGINE_COUNT] = {"trie", "jump table", "prefix hash"};
+
+/** @brief Zwraca bieżący czas.
+ * @return Czas monotoniczny w nanosekundach.
+ */
+static uint64_t now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+/** @brief Losuje cyfry.
+ * @param[out] num - wskaźnik na bufor o długości co najmniej @p length + 1;
+ * @param[in] length - liczba cyfr;
+ * @param[in,out] seed - wskaźnik na ziarno.
+ */
+static void randomDigits(char *num, size_t length, unsigned *seed) {
+    for (size_t i = 0; i < length; ++i)
+        num[i] = (char) ('0' + rand_r(seed) % 10);
+    num[length] = '\0';
+}
+
+/** @brief Liczy sumę kontrolną wyniku.
+ * @param[in] num - wskaźnik na numer lub NULL.
+ * @return Skrót FNV-1a numeru.
+ */
+static uint64_t checksum(char const *num) {
+    uint64_t hash = 14695981039346656037u;
+    for (size_t i = 0; num && num[i] != '\0'; ++i) {
+        hash ^= (unsigned char) num[i];
+        hash *= 1099511628211u;
+    }
+    return hash;
+}
+
+/** @brief Odczytuje argument liczbowy.
+ * @param[in] argc - liczba argumentów;
+ * @param[in] argv - argumenty;
+ * @param[in] idx - indeks argumentu;
+ * @param[in] def - wartość domyślna.
+ * @return Wartość argumentu lub @p def, jeśli go nie podano.
+ */
+static size_t argument(int argc, char *argv[], int idx, size_t def) {
+    return argc > idx ? strtoull(argv[idx], NULL, 10) : def;
+}
+
+/** @brief Mierzy jeden sposób wyszukiwania.
+ * @param[in] engine - sposób wyszukiwania;
+ * @param[in] num1 - numery przekierowywane;
+ * @param[in] num2 - numery docelowe;
+ * @param[in] forwards - liczba przekierowań;
+ * @param[in] queries - numery zapytań;
+ * @param[in] lookups - liczba zapytań;
+ * @param[out] sum - wskaźnik na sumę kontrolną wyników.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool measure(Engine engine, char const *const *num1, char const *const *num2, size_t forwards,
+                    char const *const *queries, size_t lookups, uint64_t *sum) {
+    PhoneForward *pf = phfwdNew();
+    bool res = pf != NULL;
+    for (size_t i = 0; res && i < forwards; ++i)
+        res = strcmp(num1[i], num2[i]) == 0 || phfwdAdd(pf, num1[i], num2[i]);
+    if (res && engine == ENGINE_JUMP)
+        res = phfwdEnableJumpTable(pf, JUMP_LEVELS);
+    if (res && engine == ENGINE_HASH)
+        res = phfwdEnablePrefixHash(pf, true);
+    if (!res) {
+        phfwdDelete(pf);
+        return false;
+    }
+
+    uint64_t start = now();
+    PhoneNumbers *first = phfwdGet(pf, queries[0]);
+    uint64_t warm = now() - start;
+    phnumDelete(first);
+
+    uint64_t singleSum = 0, batchSum = 0;
+    start = now();
+    for (size_t i = 0; res && i < lookups; ++i) {
+        PhoneNumbers *pnum = phfwdGet(pf, queries[i]);
+        res = pnum != NULL;
+        singleSum += checksum(phnumGet(pnum, 0));
+        phnumDelete(pnum);
+    }
+    uint64_t single = now() - start;
+
+    start = now();
+    for (size_t i = 0; res && i < lookups; i += BATCH) {
+        size_t count = lookups - i < BATCH ? lookups - i : BATCH;
+        PhoneNumbers *pnum = phfwdGetBatch(pf, queries + i, count);
+        res = pnum != NULL;
+        for (size_t j = 0; res && j < count; ++j)
+            batchSum += checksum(phnumGet(pnum, j));
+        phnumDelete(pnum);
+    }
+    uint64_t batch = now() - start;
+    phfwdDelete(pf);
+    if (!res)
+        return false;
+
+    printf("%-12s first %8.1f us, phfwdGet %7.1f ns/number, phfwdGetBatch %7.1f ns/number%s\n",
+           engineName[engine], (double) warm / 1e3, (double) single / (double) lookups,
+           (double) batch / (double) lookups, singleSum == batchSum ? "" : " (batch mismatch)");
+    *sum = singleSum;
+    return singleSum == batchSum;
+}
+
+/** @brief Uruchamia porównanie.
+ * @param[in] argc - liczba argumentów;
+ * @param[in] argv - opcjonalnie liczba przekierowań, liczba zapytań i liczba
+ *                   różnych długości prefiksów przekierowań.
+ * @return Kod zakończenia programu.
+ */
+int main(int argc, char *argv[]) {
+    if (argc > 4) {
+        fprintf(stderr, "Usage: %s [FORWARDS] [LOOKUPS] [LENGTHS]\n", argv[0]);
+        return 1;
+    }
+    size_t forwards = argument(argc, argv, 1, 100000), lookups = argument(argc, argv, 2, 1000000);
+    size_t lengths = argument(argc, argv, 3, 3);
+    if (forwards == 0 || lookups == 0 || lengths == 0 || lengths > MAX_LENGTHS) {
+        fprintf(stderr, "FORWARDS and LOOKUPS must be positive, LENGTHS from 1 to %d\n", MAX_LENGTHS);
+        return 1;
+    }
+
+    char *chars = malloc((forwards * 2 + lookups) * (QUERY_LENGTH + 1));
+    char const **num1 = malloc(forwards * sizeof(char const *));
+    char const **num2 = malloc(forwards * sizeof(char const *));
+    char const **queries = malloc(lookups * sizeof(char const *));
+    if (!chars || !num1 || !num2 || !queries) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    unsigned seed = 1;
+    char *ptr = chars;
+    for (size_t i = 0; i < forwards; ++i, ptr += 2 * (QUERY_LENGTH + 1)) {
+        randomDigits(ptr, 4 + 2 * ((size_t) rand_r(&seed) % lengths), &seed);
+        randomDigits(ptr + QUERY_LENGTH + 1, 3 + (size_t) rand_r(&seed) % 6, &seed);
+        num1[i] = ptr;
+        num2[i] = ptr + QUERY_LENGTH + 1;
+    }
+    for (size_t i = 0; i < lookups; ++i, ptr += QUERY_LENGTH + 1) {
+        size_t prefix = 0;
+        if (rand_r(&seed) % 2) {
+            char const *source = num1[(size_t) rand_r(&seed) % forwards];
+            prefix = strlen(source);
+            memcpy(ptr, source, prefix);
+        }
+        randomDigits(ptr + prefix, QUERY_LENGTH - prefix, &seed);
+        queries[i] = ptr;
+    }
+
+    printf("%zu forwards with %zu prefix lengths, %zu lookups\n", forwards, lengths, lookups);
+    uint64_t expected = 0;
+    bool res = true;
+    for (Engine engine = 0; res && engine < ENGINE_COUNT; ++engine) {
+        uint64_t sum = 0;
+        res = measure(engine, num1, num2, forwards, queries, lookups, &sum);
+        if (engine == ENGINE_TRIE)
+            expected = sum;
+        else if (res && sum != expected)
+            res = false;
+    }
+
+    free(chars);
+    free(num1);
+    free(num2);
+    free(queries);
+    if (!res) {
+        fprintf(stderr, "Results differ or out of memory\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,57 @@
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include "phone_forward.hpp"
+#include <cassert>
+#include <string>
+#include <string_view>
+#include <utility>
+
+int main() {
+  phfwd::Forward pf;
+
+  std::string buffer = "123|9";
+  std::string_view view = buffer;
+  assert(pf.add(view.substr(0, 3), view.substr(4)));
+
+  phfwd::Numbers pnum = pf.get("1234");
+  assert(pnum.size() == 1);
+  assert(pnum[0] == "94");
+  assert(pnum[1].empty());
+
+  pnum = pf.get(view.substr(0, 2));
+  assert(pnum[0] == "12");
+
+  assert(pf.add("123456", "777777"));
+  assert(pf.get("12345")[0] == "945");
+  assert(pf.get("123456")[0] == "777777");
+  assert(pf.get("997")[0] == "997");
+  assert(pf.get("12a").empty());
+  assert(pf.get(std::string_view("12\0" "3", 4)).empty());
+
+  assert(pf.add("431", "432"));
+  assert(pf.add("432", "433"));
+  assert(pf.get("431")[0] == "432");
+  assert(pf.get("432")[0] == "433");
+
+  assert(pf.add("5", "9"));
+  size_t count = 0;
+  for (std::string_view num : pf.reverse("945")) {
+    assert(num == "12345" || num == "545" || num == "945");
+    ++count;
+  }
+  assert(count == 3);
+  pnum = pf.getReverse("945");
+  assert(pnum.size() == 3 && pnum[0] == "12345" && pnum[1] == "545" && pnum[2] == "945");
+
+  pf.remove("12");
+  assert(pf.get("1234")[0] == "1234");
+
+  phfwd::Forward sharded(phfwdNewSharded());
+  assert(sharded.add(std::string(40, '1'), "2"));
+  assert(sharded.get(std::string(100, '1')).size() == 1);
+  assert(sharded.get(std::string(100, '1'))[0] == "2" + std::string(60, '1'));
+  pf = std::move(sharded);
+  assert(pf.get("1")[0] == "1");
+}
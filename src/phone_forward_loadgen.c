@@ -0,0 +1,326 @@
+/** @file
+ * Generator obciążenia serwera przekierowań numerów telefonicznych
+ *
+ * Dodaje do serwera losowe przekierowania, a następnie z kilku połączeń
+ * naraz wysyła serie żądań phfwdGet, phfwdReverse i phfwdGetReverse bez
+ * czekania na odpowiedzi. Wypisuje czas dodawania przekierowań oraz
+ * przepustowość i percentyle opóźnień samych zapytań, mierzonych od chwili,
+ * w której wszystkie połączenia skończyły dodawanie.
+ * Użycie: phone_forward_loadgen GNIAZDO [POŁĄCZENIA] [ŻĄDANIA] [SERIA] [PRZEKIEROWANIA].
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+#define _POSIX_C_SOURCE 200809L /**< Udostępnia clock_gettime, rand_r i gniazda. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "phone_forward_protocol.h"
+
+#define MAX_NUMBER 16 /**< Maksymalna długość losowanego numeru. */
+
+/**
+ * To jest struktura opisująca pracę jednego połączenia.
+ */
+typedef struct Client {
+    char const *path; /**< Ścieżka gniazda serwera. */
+    unsigned seed; /**< Ziarno generatora liczb losowych. */
+    size_t requests; /**< Liczba żądań do wysłania. */
+    size_t depth; /**< Liczba żądań wysyłanych bez czekania na odpowiedzi. */
+    size_t forwards; /**< Liczba przekierowań dodawanych przed pomiarem. */
+    uint64_t *latencies; /**< Opóźnienia kolejnych żądań w nanosekundach. */
+    pthread_barrier_t *preloaded; /**< Bariera oddzielająca dodawanie od zapytań. */
+    bool failed; /**< Flaga mówiąca czy wystąpił błąd połączenia. */
+} Client;
+
+/** @brief Zwraca bieżący czas.
+ * @return Czas monotoniczny w nanosekundach.
+ */
+static uint64_t now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+/** @brief Losuje numer.
+ * Numery mają od 1 do 4 cyfr prefiksu i łącznie od 6 do @ref MAX_NUMBER cyfr,
+ * więc wiele z nich ma wspólne prefiksy.
+ * @param[out] num - wskaźnik na bufor numeru;
+ * @param[in,out] seed - wskaźnik na ziarno.
+ * @return Długość numeru.
+ */
+static size_t randomNumber(char *num, unsigned *seed) {
+    size_t len = 6 + (size_t) rand_r(seed) % (MAX_NUMBER - 5);
+    for (size_t i = 0; i < len; ++i)
+        num[i] = (char) ('0' + rand_r(seed) % (i < 4 ? 3 : 10));
+    num[len] = '\0';
+    return len;
+}
+
+/** @brief Łączy się z serwerem.
+ * @param[in] path - wskaźnik na ścieżkę gniazda.
+ * @return Deskryptor gniazda lub -1 w przypadku błędu.
+ */
+static int connectTo(char const *path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/** @brief Wysyła cały bufor.
+ * @param[in] fd - deskryptor gniazda;
+ * @param[in] data - wskaźnik na dane;
+ * @param[in] size - liczba bajtów.
+ * @return Wartość @p false, jeśli wystąpił błąd.
+ */
+static bool sendAll(int fd, unsigned char const *data, size_t size) {
+    while (size > 0) {
+        ssize_t written = send(fd, data, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        data += written;
+        size -= (size_t) written;
+    }
+    return true;
+}
+
+/** @brief Odbiera dokładnie zadaną liczbę bajtów.
+ * @param[in] fd - deskryptor gniazda;
+ * @param[out] data - wskaźnik na bufor;
+ * @param[in] size - liczba bajtów.
+ * @return Wartość @p false, jeśli wystąpił błąd lub połączenie zostało zamknięte.
+ */
+static bool recvAll(int fd, unsigned char *data, size_t size) {
+    while (size > 0) {
+        ssize_t got = recv(fd, data, size, 0);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return false;
+        data += got;
+        size -= (size_t) got;
+    }
+    return true;
+}
+
+/** @brief Odbiera i pomija odpowiedź.
+ * @param[in] fd - deskryptor gniazda.
+ * @return Wartość @p false, jeśli wystąpił błąd.
+ */
+static bool skipResponse(int fd) {
+    unsigned char header[PROTO_RESPONSE_HEADER], num[UINT16_MAX];
+    if (!recvAll(fd, header, PROTO_RESPONSE_HEADER))
+        return false;
+    for (uint32_t i = protoLoad32(header + 5); i > 0; --i) {
+        unsigned char len[4];
+        if (!recvAll(fd, len, 4))
+            return false;
+        for (uint32_t left = protoLoad32(len); left > 0; ) {
+            uint32_t part = left < sizeof(num) ? left : (uint32_t) sizeof(num);
+            if (!recvAll(fd, num, part))
+                return false;
+            left -= part;
+        }
+    }
+    return true;
+}
+
+/** @brief Dopisuje żądanie do bufora.
+ * @param[out] dst - wskaźnik na bufor;
+ * @param[in] op - kod operacji;
+ * @param[in] id - identyfikator żądania;
+ * @param[in] num1 - wskaźnik na pierwszy numer;
+ * @param[in] num2 - wskaźnik na drugi numer.
+ * @return Liczba zapisanych bajtów.
+ */
+static size_t encodeRequest(unsigned char *dst, unsigned char op, uint32_t id,
+                            char const *num1, char const *num2) {
+    size_t len1 = strlen(num1), len2 = strlen(num2);
+    dst[0] = op;
+    protoStore32(dst + 1, id);
+    protoStore16(dst + 5, (uint16_t) len1);
+    protoStore16(dst + 7, (uint16_t) len2);
+    memcpy(dst + PROTO_REQUEST_HEADER, num1, len1);
+    memcpy(dst + PROTO_REQUEST_HEADER + len1, num2, len2);
+    return PROTO_REQUEST_HEADER + len1 + len2;
+}
+
+/** @brief Wysyła serię żądań i mierzy ich opóźnienia.
+ * Wysyła @p client->depth żądań jednym wywołaniem, a następnie odbiera
+ * odpowiedzi, zapisując dla każdej czas od wysłania serii.
+ * @param[in,out] client - wskaźnik na opis połączenia;
+ * @param[in] fd - deskryptor gniazda;
+ * @param[in] add - flaga mówiąca czy wysyłać żądania dodania przekierowań;
+ * @param[in] total - łączna liczba żądań.
+ * @return Wartość @p false, jeśli wystąpił błąd.
+ */
+static bool runPipeline(Client *client, int fd, bool add, size_t total) {
+    size_t depth = client->depth ? client->depth : 1;
+    unsigned char *buffer = malloc(depth * (PROTO_REQUEST_HEADER + 2 * MAX_NUMBER));
+    if (!buffer)
+        return false;
+
+    char num1[MAX_NUMBER + 1], num2[MAX_NUMBER + 1];
+    for (size_t done = 0; done < total; ) {
+        size_t batch = total - done < depth ? total - done : depth, size = 0;
+        for (size_t i = 0; i < batch; ++i) {
+            randomNumber(num1, &(client->seed));
+            unsigned char op = PROTO_ADD;
+            if (add) {
+                num1[4 + rand_r(&(client->seed)) % 3] = '\0';
+                randomNumber(num2, &(client->seed));
+                num2[4 + rand_r(&(client->seed)) % 3] = '\0';
+            } else {
+                int kind = rand_r(&(client->seed)) % 10;
+                op = kind < 8 ? PROTO_GET : kind < 9 ? PROTO_REVERSE : PROTO_GET_REVERSE;
+                num2[0] = '\0';
+            }
+            size += encodeRequest(buffer + size, op, (uint32_t) (done + i), num1, num2);
+        }
+
+        uint64_t start = now();
+        if (!sendAll(fd, buffer, size)) {
+            free(buffer);
+            return false;
+        }
+        for (size_t i = 0; i < batch; ++i) {
+            if (!skipResponse(fd)) {
+                free(buffer);
+                return false;
+            }
+            if (!add)
+                client->latencies[done + i] = now() - start;
+        }
+        done += batch;
+    }
+
+    free(buffer);
+    return true;
+}
+
+/** @brief Funkcja wątku połączenia.
+ * @param[in,out] arg - wskaźnik na opis połączenia.
+ * @return NULL.
+ */
+static void *clientWorker(void *arg) {
+    Client *client = arg;
+    int fd = connectTo(client->path);
+    bool preloaded = fd >= 0 && runPipeline(client, fd, true, client->forwards);
+    pthread_barrier_wait(client->preloaded);
+    client->failed = !preloaded || !runPipeline(client, fd, false, client->requests);
+    if (fd >= 0)
+        close(fd);
+    return NULL;
+}
+
+/** @brief Porównuje opóźnienia.
+ * @param[in] a - wskaźnik na pierwsze opóźnienie;
+ * @param[in] b - wskaźnik na drugie opóźnienie.
+ * @return Wynik porównania dla qsort.
+ */
+static int compareLatency(void const *a, void const *b) {
+    uint64_t x = *(uint64_t const *) a, y = *(uint64_t const *) b;
+    return x < y ? -1 : x > y;
+}
+
+/** @brief Odczytuje argument liczbowy.
+ * @param[in] argc - liczba argumentów;
+ * @param[in] argv - argumenty;
+ * @param[in] idx - indeks argumentu;
+ * @param[in] def - wartość domyślna.
+ * @return Wartość argumentu lub @p def, jeśli go nie podano.
+ */
+static size_t argument(int argc, char *argv[], int idx, size_t def) {
+    return argc > idx ? strtoull(argv[idx], NULL, 10) : def;
+}
+
+/** @brief Uruchamia generator obciążenia.
+ * @param[in] argc - liczba argumentów;
+ * @param[in] argv - ścieżka gniazda oraz opcjonalnie liczba połączeń, liczba
+ *                   żądań na połączenie, długość serii i liczba przekierowań.
+ * @return Kod zakończenia programu.
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 6) {
+        fprintf(stderr, "Usage: %s SOCKET [CONNECTIONS] [REQUESTS] [DEPTH] [FORWARDS]\n", argv[0]);
+        return 1;
+    }
+    size_t connections = argument(argc, argv, 2, 4), requests = argument(argc, argv, 3, 100000);
+    size_t depth = argument(argc, argv, 4, 32), forwards = argument(argc, argv, 5, 10000);
+    if (connections == 0)
+        connections = 1;
+
+    Client *clients = calloc(connections, sizeof(Client));
+    pthread_t *threads = malloc(connections * sizeof(pthread_t));
+    uint64_t *latencies = malloc((connections * requests + 1) * sizeof(uint64_t));
+    if (!clients || !threads || !latencies) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    pthread_barrier_t preloaded;
+    if (pthread_barrier_init(&preloaded, NULL, (unsigned) connections + 1) != 0) {
+        fprintf(stderr, "Cannot create barrier\n");
+        return 1;
+    }
+
+    uint64_t begin = now();
+    for (size_t i = 0; i < connections; ++i) {
+        clients[i] = (Client) {argv[1], (unsigned) i + 1, requests, depth,
+                               forwards / connections, latencies + i * requests, &preloaded, false};
+        if (pthread_create(&threads[i], NULL, clientWorker, &clients[i]) != 0) {
+            fprintf(stderr, "Cannot create thread\n");
+            return 1;
+        }
+    }
+    pthread_barrier_wait(&preloaded);
+    uint64_t start = now();
+    bool failed = false;
+    for (size_t i = 0; i < connections; ++i) {
+        pthread_join(threads[i], NULL);
+        failed = failed || clients[i].failed;
+    }
+    double seconds = (double) (now() - start) / 1e9;
+    pthread_barrier_destroy(&preloaded);
+    if (failed) {
+        fprintf(stderr, "Connection to %s failed\n", argv[1]);
+        return 1;
+    }
+
+    size_t total = connections * requests;
+    qsort(latencies, total, sizeof(uint64_t), compareLatency);
+    printf("preload: %zu forwards in %.3f s\n", forwards / connections * connections,
+           (double) (start - begin) / 1e9);
+    printf("requests: %zu in %.3f s, %.0f req/s\n", total, seconds, (double) total / seconds);
+    double const percentiles[] = {50, 90, 99, 99.9};
+    for (size_t i = 0; total > 0 && i < sizeof(percentiles) / sizeof(percentiles[0]); ++i) {
+        size_t idx = (size_t) (percentiles[i] / 100 * (double) (total - 1));
+        printf("p%g: %.1f us\n", percentiles[i], (double) latencies[idx] / 1e3);
+    }
+
+    free(clients);
+    free(threads);
+    free(latencies);
+    return 0;
+}
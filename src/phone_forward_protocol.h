@@ -0,0 +1,73 @@
+/** @file
+ * Binarny protokół serwera przekierowań numerów telefonicznych
+ *
+ * Żądanie składa się z nagłówka: kodu operacji (1 bajt), identyfikatora
+ * (4 bajty), długości pierwszego i drugiego numeru (po 2 bajty), po którym
+ * następują numery bez znaków końca napisu. Odpowiedź składa się z
+ * identyfikatora żądania (4 bajty), statusu (1 bajt) i liczby numerów
+ * (4 bajty), po którym następują numery poprzedzone długościami (po 4 bajty,
+ * bo wynik może być dłuższy niż numery żądania).
+ * Liczby są zapisywane od najmłodszego bajtu. Odpowiedzi są wysyłane
+ * w kolejności żądań, więc klient może wysyłać kolejne żądania bez czekania.
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __PHONE_FORWARD_PROTOCOL_H__
+#define __PHONE_FORWARD_PROTOCOL_H__
+
+#include <stdint.h>
+
+#define PROTO_GET 1 /**< Kod operacji phfwdGet. */
+#define PROTO_REVERSE 2 /**< Kod operacji phfwdReverse. */
+#define PROTO_GET_REVERSE 3 /**< Kod operacji phfwdGetReverse. */
+#define PROTO_ADD 4 /**< Kod operacji phfwdAdd. */
+#define PROTO_REMOVE 5 /**< Kod operacji phfwdRemove. */
+
+#define PROTO_OK 0 /**< Status wykonanej operacji. */
+#define PROTO_FAILED 1 /**< Status operacji, która zwróciła @p false lub NULL. */
+#define PROTO_INVALID 2 /**< Status żądania o nieznanym kodzie operacji lub znaku numeru spoza 0-9, * i #. */
+
+#define PROTO_REQUEST_HEADER 9 /**< Rozmiar nagłówka żądania. */
+#define PROTO_RESPONSE_HEADER 9 /**< Rozmiar nagłówka odpowiedzi. */
+
+/** @brief Zapisuje liczbę 16-bitową.
+ * @param[out] dst - wskaźnik na 2 bajty;
+ * @param[in] value - zapisywana liczba.
+ */
+static inline void protoStore16(unsigned char *dst, uint16_t value) {
+    dst[0] = (unsigned char) value;
+    dst[1] = (unsigned char) (value >> 8);
+}
+
+/** @brief Zapisuje liczbę 32-bitową.
+ * @param[out] dst - wskaźnik na 4 bajty;
+ * @param[in] value - zapisywana liczba.
+ */
+static inline void protoStore32(unsigned char *dst, uint32_t value) {
+    for (int i = 0; i < 4; ++i)
+        dst[i] = (unsigned char) (value >> (8 * i));
+}
+
+/** @brief Odczytuje liczbę 16-bitową.
+ * @param[in] src - wskaźnik na 2 bajty.
+ * @return Odczytana liczba.
+ */
+static inline uint16_t protoLoad16(unsigned char const *src) {
+    return (uint16_t) (src[0] | (src[1] << 8));
+}
+
+/** @brief Odczytuje liczbę 32-bitową.
+ * @param[in] src - wskaźnik na 4 bajty.
+ * @return Odczytana liczba.
+ */
+static inline uint32_t protoLoad32(unsigned char const *src) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i)
+        value |= (uint32_t) src[i] << (8 * i);
+    return value;
+}
+
+#endif /* __PHONE_FORWARD_PROTOCOL_H__ */
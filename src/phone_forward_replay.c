@@ -0,0 +1,240 @@
+/** @file
+ * Odtwarzanie śladu wywołań zapisanego przez phfwdCaptureStart
+ *
+ * Tworzy strukturę wybranego rodzaju, dodaje do niej przekierowania
+ * istniejące przed rozpoczęciem zapisu, a następnie jak najszybciej wykonuje
+ * pozostałe rekordy śladu i wypisuje przepustowość oraz percentyle opóźnień.
+ * Przy kilku wątkach rekordy są rozdzielane według pierwszego znaku
+ * pierwszego numeru, więc kolejność jest zachowana w obrębie każdej grupy.
+ * Użycie: phone_forward_replay ŚLAD [WĄTKI] [STRUKTURA].
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+#define _POSIX_C_SOURCE 200809L /**< Udostępnia clock_gettime. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <pthread.h>
+#include "phone_forward.h"
+#include "trace_capture.h"
+
+#define MAX_THREADS 64 /**< Największa liczba wątków. */
+#define JUMP_LEVELS 3 /**< Liczba poziomów tablicy skoków. */
+#define GROUPS 12 /**< Liczba grup rekordów, czyli możliwych pierwszych znaków. */
+
+/** Nazwy rodzajów struktury. */
+static char const *const structureName[] = {"trie", "sharded", "persistent", "lazy", "hash", "jump"};
+
+/** Nazwy operacji zapisywanych w śladzie. */
+static char const *const opName[PHFWD_OP_COUNT] = {
+        [PHFWD_OP_ADD] = "add", [PHFWD_OP_REMOVE] = "remove", [PHFWD_OP_GET] = "get",
+        [PHFWD_OP_REVERSE] = "reverse", [PHFWD_OP_GET_REVERSE] = "getReverse"};
+
+/**
+ * To jest struktura opisująca zadanie jednego wątku.
+ */
+typedef struct Worker {
+    PhoneForward *pf; /**< Struktura, na której są wykonywane rekordy. */
+    TraceRecords const *records; /**< Odczytany ślad. */
+    size_t idx; /**< Numer wątku. */
+    size_t threads; /**< Liczba wątków. */
+    bool res; /**< Flaga mówiąca czy wszystkie operacje się powiodły. */
+} Worker;
+
+/** @brief Zwraca bieżący czas.
+ * @return Czas monotoniczny w nanosekundach.
+ */
+static uint64_t now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+/** @brief Zwraca grupę rekordu.
+ * @param[in] record - wskaźnik na rekord.
+ * @return Indeks pierwszego znaku pierwszego numeru albo 0, jeśli numer nie
+ *         zaczyna się od znaku numeru.
+ */
+static size_t group(TraceRecord const *record) {
+    char c = record->num1 ? record->num1[0] : '\0';
+    if (c >= '0' && c <= '9')
+        return (size_t) (c - '0');
+    return c == '*' ? 10 : c == '#' ? 11 : 0;
+}
+
+/** @brief Wykonuje rekord śladu.
+ * Wynik phfwdAdd nie jest sprawdzany, bo w śladzie są też wywołania, które się
+ * nie powiodły.
+ * @param[in,out] pf - wskaźnik na strukturę;
+ * @param[in] record - wskaźnik na rekord.
+ * @return Wartość @p false, jeśli zapytanie nie zwróciło wyniku.
+ */
+static bool execute(PhoneForward *pf, TraceRecord const *record) {
+    PhoneNumbers *pnum = NULL;
+    switch (record->op) {
+        case PHFWD_OP_ADD:
+            phfwdAdd(pf, record->num1, record->num2);
+            return true;
+        case PHFWD_OP_REMOVE:
+            phfwdRemove(pf, record->num1);
+            return true;
+        case PHFWD_OP_GET:
+            pnum = phfwdGet(pf, record->num1);
+            break;
+        case PHFWD_OP_REVERSE:
+            pnum = phfwdReverse(pf, record->num1);
+            break;
+        case PHFWD_OP_GET_REVERSE:
+            pnum = phfwdGetReverse(pf, record->num1);
+            break;
+        default:
+            return true;
+    }
+    phnumDelete(pnum);
+    return pnum != NULL || record->num1 == NULL;
+}
+
+/** @brief Wykonuje rekordy jednego wątku.
+ * @param[in,out] arg - wskaźnik na zadanie.
+ * @return NULL.
+ */
+static void *work(void *arg) {
+    Worker *worker = arg;
+    worker->res = true;
+    for (size_t i = 0; i < worker->records->count; ++i) {
+        TraceRecord const *record = &(worker->records->record[i]);
+        if (!record->preload && group(record) % worker->threads == worker->idx &&
+            !execute(worker->pf, record))
+            worker->res = false;
+    }
+    return NULL;
+}
+
+/** @brief Tworzy strukturę wybranego rodzaju.
+ * @param[in] name - nazwa rodzaju struktury.
+ * @return Wskaźnik na strukturę lub NULL, gdy nazwa jest niepoprawna lub nie
+ *         udało się alokować pamięci.
+ */
+static PhoneForward *create(char const *name) {
+    PhoneForward *pf = NULL;
+    if (strcmp(name, "trie") == 0 || strcmp(name, "hash") == 0 || strcmp(name, "jump") == 0)
+        pf = phfwdNew();
+    else if (strcmp(name, "sharded") == 0)
+        pf = phfwdNewSharded();
+    else if (strcmp(name, "persistent") == 0)
+        pf = phfwdNewPersistent();
+    else if (strcmp(name, "lazy") == 0)
+        pf = phfwdNewLazyReverse();
+
+    if (pf && ((strcmp(name, "hash") == 0 && !phfwdEnablePrefixHash(pf, true)) ||
+               (strcmp(name, "jump") == 0 && !phfwdEnableJumpTable(pf, JUMP_LEVELS)))) {
+        phfwdDelete(pf);
+        pf = NULL;
+    }
+    return pf;
+}
+
+/** @brief Wypisuje podsumowanie odtworzenia.
+ * @param[in] pf - wskaźnik na strukturę z włączonym pomiarem;
+ * @param[in] count - liczba wykonanych rekordów;
+ * @param[in] elapsed - czas wykonania w nanosekundach.
+ */
+static void report(PhoneForward const *pf, size_t count, uint64_t elapsed) {
+    printf("%zu records in %.3f s, %.0f ops/s\n", count, (double) elapsed / 1e9,
+           elapsed ? (double) count * 1e9 / (double) elapsed : 0.0);
+    printf("%-12s %10s %10s %10s %10s %10s\n", "op", "count", "p50 us", "p90 us", "p99 us",
+           "p99.9 us");
+    for (PhfwdOp op = 0; op < PHFWD_OP_COUNT; ++op) {
+        uint64_t calls = phfwdStatsCount(pf, op, -1, -1);
+        if (calls == 0 || !opName[op])
+            continue;
+        printf("%-12s %10" PRIu64 " %10.2f %10.2f %10.2f %10.2f\n", opName[op], calls,
+               (double) phfwdStatsPercentile(pf, op, -1, -1, 50) / 1e3,
+               (double) phfwdStatsPercentile(pf, op, -1, -1, 90) / 1e3,
+               (double) phfwdStatsPercentile(pf, op, -1, -1, 99) / 1e3,
+               (double) phfwdStatsPercentile(pf, op, -1, -1, 99.9) / 1e3);
+    }
+}
+
+/** @brief Uruchamia odtwarzanie.
+ * @param[in] argc - liczba argumentów;
+ * @param[in] argv - ścieżka do śladu, opcjonalnie liczba wątków i rodzaj
+ *                   struktury.
+ * @return Kod zakończenia programu.
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 4) {
+        fprintf(stderr, "Usage: %s TRACE [THREADS] [trie|sharded|persistent|lazy|hash|jump]\n",
+                argv[0]);
+        return 1;
+    }
+    size_t threads = argc > 2 ? strtoull(argv[2], NULL, 10) : 1;
+    char const *name = argc > 3 ? argv[3] : threads > 1 ? "sharded" : "trie";
+    bool known = false;
+    for (size_t i = 0; i < sizeof(structureName) / sizeof(structureName[0]); ++i)
+        known = known || strcmp(name, structureName[i]) == 0;
+    if (threads == 0 || threads > MAX_THREADS || !known ||
+        (threads > 1 && strcmp(name, "sharded") != 0)) {
+        fprintf(stderr, "THREADS must be from 1 to %d, more than one only with sharded\n",
+                MAX_THREADS);
+        return 1;
+    }
+    if (threads > GROUPS)
+        threads = GROUPS;
+
+    TraceRecords records;
+    if (!traceLoad(argv[1], &records)) {
+        fprintf(stderr, "Cannot read trace %s\n", argv[1]);
+        return 1;
+    }
+    PhoneForward *pf = create(name);
+    bool res = pf != NULL;
+    size_t preload = 0;
+    for (size_t i = 0; res && i < records.count; ++i) {
+        if (records.record[i].preload) {
+            res = phfwdAdd(pf, records.record[i].num1, records.record[i].num2);
+            ++preload;
+        }
+    }
+    res = res && phfwdStatsEnable(pf);
+    if (!res) {
+        fprintf(stderr, "Cannot prepare the structure\n");
+        phfwdDelete(pf);
+        traceRecordsFree(&records);
+        return 1;
+    }
+
+    Worker worker[MAX_THREADS];
+    pthread_t thread[MAX_THREADS];
+    bool started[MAX_THREADS];
+    uint64_t start = now();
+    for (size_t i = 0; i < threads; ++i) {
+        worker[i] = (Worker) {.pf = pf, .records = &records, .idx = i, .threads = threads};
+        started[i] = i < threads - 1 && pthread_create(&thread[i], NULL, work, &worker[i]) == 0;
+        if (!started[i])
+            work(&worker[i]);
+    }
+    for (size_t i = 0; i < threads; ++i)
+        if (started[i])
+            pthread_join(thread[i], NULL);
+    uint64_t elapsed = now() - start;
+
+    for (size_t i = 0; i < threads; ++i)
+        res = res && worker[i].res;
+    printf("%s, %zu threads, %zu preloaded forwards\n", name, threads, preload);
+    report(pf, records.count - preload, elapsed);
+    phfwdDelete(pf);
+    traceRecordsFree(&records);
+    if (!res) {
+        fprintf(stderr, "Some queries failed\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,544 @@
+/** @file
+ * Serwer przekierowań numerów telefonicznych
+ *
+ * Serwer przechowuje jedną strukturę PhoneForward i obsługuje żądania
+ * protokołu z pliku phone_forward_protocol.h przez gniazdo domeny Unix.
+ * Wszystkie połączenia są obsługiwane przez jeden wątek z pomocą epoll.
+ * Kolejne żądania phfwdGet, phfwdReverse lub phfwdGetReverse, które już
+ * nadeszły, są wykonywane razem przez phfwdGetBatch, phfwdReverseBatch lub
+ * phfwdGetReverseBatch. Żądania z numerem zawierającym znak spoza 0-9, *
+ * i # dostają status PROTO_INVALID bez wykonywania operacji. Połączenie, któremu uzbierało się OUTPUT_LIMIT bajtów
+ * niewysłanych odpowiedzi, nie jest czytane, dopóki klient ich nie odbierze.
+ * Z dziennikiem odpowiedzi są wysyłane dopiero po zapisaniu na dysk zmian
+ * wykonanych w danym obrocie pętli, więc potwierdzone zmiany są trwałe.
+ * Użycie: phone_forward_server GNIAZDO [DZIENNIK].
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+#define _GNU_SOURCE /**< Udostępnia accept4 i flagi gniazd. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "phone_forward.h"
+#include "phone_forward_protocol.h"
+
+#define MAX_EVENTS 64 /**< Liczba zdarzeń pobieranych jednym wywołaniem epoll_wait. */
+#define READ_SIZE (1 << 16) /**< Liczba bajtów odczytywanych jednym wywołaniem read. */
+#define READS_PER_EVENT 4 /**< Największa liczba wywołań read dla jednego zdarzenia. */
+#define OUTPUT_LIMIT (1 << 20) /**< Liczba niewysłanych bajtów wstrzymująca odczyt. */
+#define JOURNAL_BATCH 64 /**< Liczba rekordów w grupie dziennika. */
+
+/**
+ * To jest struktura reprezentująca bufor bajtów.
+ */
+typedef struct Buffer {
+    unsigned char *data; /**< Zawartość bufora. */
+    size_t size; /**< Liczba zajętych bajtów. */
+    size_t capacity; /**< Rozmiar bufora. */
+} Buffer;
+
+/**
+ * To jest struktura reprezentująca połączenie z klientem.
+ */
+typedef struct Connection {
+    int fd; /**< Deskryptor gniazda. */
+    Buffer in; /**< Odebrane, jeszcze nieobsłużone bajty. */
+    Buffer out; /**< Odpowiedzi czekające na wysłanie. */
+    size_t sent; /**< Liczba wysłanych bajtów bufora out. */
+    uint32_t events; /**< Zdarzenia, na które czeka epoll. */
+} Connection;
+
+static volatile sig_atomic_t stopped = 0; /**< Flaga ustawiana przez sygnał zakończenia. */
+
+/** @brief Obsługuje sygnał zakończenia.
+ * @param[in] signal - numer sygnału.
+ */
+static void onSignal(int signal) {
+    (void) signal;
+    stopped = 1;
+}
+
+/** @brief Zapewnia miejsce w buforze.
+ * @param[in,out] buffer - wskaźnik na bufor;
+ * @param[in] extra - liczba bajtów, które mają zmieścić się za zajętą częścią.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool reserve(Buffer *buffer, size_t extra) {
+    if (buffer->size + extra <= buffer->capacity)
+        return true;
+    size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+    while (capacity < buffer->size + extra)
+        capacity *= 2;
+    unsigned char *temp = realloc(buffer->data, capacity);
+    if (!temp)
+        return false;
+    buffer->data = temp;
+    buffer->capacity = capacity;
+    return true;
+}
+
+/** @brief Dopisuje odpowiedź.
+ * @param[in,out] out - wskaźnik na bufor odpowiedzi;
+ * @param[in] id - identyfikator żądania;
+ * @param[in] status - status operacji;
+ * @param[in] pnum - wskaźnik na wynik operacji lub NULL;
+ * @param[in] first - indeks pierwszego numeru wyniku;
+ * @param[in] count - liczba numerów wyniku.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool appendResponse(Buffer *out, uint32_t id, unsigned char status,
+                           PhoneNumbers const *pnum, size_t first, size_t count) {
+    size_t size = PROTO_RESPONSE_HEADER;
+    for (size_t i = first; i < first + count; ++i)
+        size += 4 + strlen(phnumGet(pnum, i));
+    if (!reserve(out, size))
+        return false;
+
+    unsigned char *dst = out->data + out->size;
+    protoStore32(dst, id);
+    dst[4] = status;
+    protoStore32(dst + 5, (uint32_t) count);
+    dst += PROTO_RESPONSE_HEADER;
+    for (size_t i = first; i < first + count; ++i) {
+        char const *num = phnumGet(pnum, i);
+        size_t len = strlen(num);
+        protoStore32(dst, (uint32_t) len);
+        memcpy(dst + 4, num, len);
+        dst += 4 + len;
+    }
+    out->size += size;
+    return true;
+}
+
+/** @brief Dopisuje odpowiedź z wynikiem zapytania wsadowego.
+ * @param[in,out] out - wskaźnik na bufor odpowiedzi;
+ * @param[in] id - identyfikator żądania;
+ * @param[in] batch - wskaźnik na wynik zapytania wsadowego;
+ * @param[in] idx - indeks zapytania w wyniku.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool appendBatchResponse(Buffer *out, uint32_t id, PhoneNumbersBatch const *batch, size_t idx) {
+    size_t count = phnumBatchSize(batch, idx), size = PROTO_RESPONSE_HEADER;
+    for (size_t i = 0; i < count; ++i)
+        size += 4 + strlen(phnumBatchGet(batch, idx, i));
+    if (!reserve(out, size))
+        return false;
+
+    unsigned char *dst = out->data + out->size;
+    protoStore32(dst, id);
+    dst[4] = PROTO_OK;
+    protoStore32(dst + 5, (uint32_t) count);
+    dst += PROTO_RESPONSE_HEADER;
+    for (size_t i = 0; i < count; ++i) {
+        char const *num = phnumBatchGet(batch, idx, i);
+        size_t len = strlen(num);
+        protoStore32(dst, (uint32_t) len);
+        memcpy(dst + 4, num, len);
+        dst += 4 + len;
+    }
+    out->size += size;
+    return true;
+}
+
+/** @brief Zwraca rozmiar kompletnego żądania.
+ * @param[in] src - wskaźnik na początek żądania;
+ * @param[in] available - liczba dostępnych bajtów.
+ * @return Rozmiar żądania lub 0, jeśli nie nadeszło w całości.
+ */
+static size_t requestSize(unsigned char const *src, size_t available) {
+    if (available < PROTO_REQUEST_HEADER)
+        return 0;
+    size_t size = PROTO_REQUEST_HEADER + protoLoad16(src + 5) + protoLoad16(src + 7);
+    return size <= available ? size : 0;
+}
+
+/** @brief Sprawdza znaki numerów żądania.
+ * @param[in] src - wskaźnik na kompletne żądanie.
+ * @return Wartość @p true, jeśli numery składają się tylko ze znaków 0-9, *
+ *         i #.
+ */
+static bool validNumbers(unsigned char const *src) {
+    size_t len = (size_t) protoLoad16(src + 5) + protoLoad16(src + 7);
+    for (size_t i = 0; i < len; ++i) {
+        unsigned char c = src[PROTO_REQUEST_HEADER + i];
+        if ((c < '0' || c > '9') && c != '*' && c != '#')
+            return false;
+    }
+    return true;
+}
+
+/** @brief Sprawdza, czy żądania operacji są wykonywane seriami.
+ * @param[in] op - kod operacji.
+ * @return Wartość @p true dla zapytań, które mają wersje wsadowe.
+ */
+static bool batchedOp(unsigned char op) {
+    return op == PROTO_GET || op == PROTO_REVERSE || op == PROTO_GET_REVERSE;
+}
+
+/** @brief Kopiuje numer z żądania.
+ * @param[in,out] scratch - wskaźnik na bufor, na którego koniec trafia napis;
+ * @param[in] src - wskaźnik na cyfry numeru;
+ * @param[in] len - liczba cyfr.
+ * @return Przesunięcie napisu w buforze lub (size_t) -1, gdy nie udało się
+ *         alokować pamięci.
+ */
+static size_t copyNumber(Buffer *scratch, unsigned char const *src, size_t len) {
+    if (!reserve(scratch, len + 1))
+        return (size_t) -1;
+    size_t offset = scratch->size;
+    memcpy(scratch->data + offset, src, len);
+    scratch->data[offset + len] = '\0';
+    scratch->size += len + 1;
+    return offset;
+}
+
+/** @brief Wykonuje serię zapytań tej samej operacji.
+ * @param[in] pf - wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] src - wskaźnik na pierwsze żądanie serii;
+ * @param[in] count - liczba żądań;
+ * @param[in,out] out - wskaźnik na bufor odpowiedzi;
+ * @param[in,out] scratch - wskaźnik na bufor pomocniczy.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool handleQueries(PhoneForward *pf, unsigned char const *src, size_t count,
+                          Buffer *out, Buffer *scratch) {
+    size_t bytes = 0;
+    unsigned char const *ptr = src;
+    for (size_t i = 0; i < count; ++i) {
+        bytes += protoLoad16(ptr + 5) + 1;
+        ptr += PROTO_REQUEST_HEADER + protoLoad16(ptr + 5) + protoLoad16(ptr + 7);
+    }
+
+    scratch->size = 0;
+    char const **nums = malloc(count * sizeof(char const *));
+    if (!nums || !reserve(scratch, bytes)) {
+        free(nums);
+        return false;
+    }
+    ptr = src;
+    for (size_t i = 0; i < count; ++i) {
+        size_t len = protoLoad16(ptr + 5);
+        nums[i] = (char const *) scratch->data + copyNumber(scratch, ptr + PROTO_REQUEST_HEADER, len);
+        ptr += PROTO_REQUEST_HEADER + len + protoLoad16(ptr + 7);
+    }
+
+    PhoneNumbers *pnum = NULL;
+    PhoneNumbersBatch *batch = NULL;
+    if (src[0] == PROTO_GET)
+        pnum = phfwdGetBatch(pf, nums, count);
+    else if (src[0] == PROTO_REVERSE)
+        batch = phfwdReverseBatch(pf, nums, count);
+    else
+        batch = phfwdGetReverseBatch(pf, nums, count);
+    free(nums);
+
+    bool res = true;
+    ptr = src;
+    for (size_t i = 0; res && i < count; ++i) {
+        uint32_t id = protoLoad32(ptr + 1);
+        if (batch)
+            res = appendBatchResponse(out, id, batch, i);
+        else if (pnum)
+            res = appendResponse(out, id, PROTO_OK, pnum, i, phnumGet(pnum, i) ? 1 : 0);
+        else
+            res = appendResponse(out, id, PROTO_FAILED, NULL, 0, 0);
+        ptr += PROTO_REQUEST_HEADER + protoLoad16(ptr + 5) + protoLoad16(ptr + 7);
+    }
+    phnumDelete(pnum);
+    phnumBatchDelete(batch);
+    return res;
+}
+
+/** @brief Wykonuje żądanie zmiany przekierowań.
+ * @param[in] pf - wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] src - wskaźnik na żądanie;
+ * @param[in,out] out - wskaźnik na bufor odpowiedzi;
+ * @param[in,out] scratch - wskaźnik na bufor pomocniczy.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool handleChange(PhoneForward *pf, unsigned char const *src, Buffer *out, Buffer *scratch) {
+    unsigned char op = src[0];
+    uint32_t id = protoLoad32(src + 1);
+    size_t len1 = protoLoad16(src + 5), len2 = protoLoad16(src + 7);
+
+    scratch->size = 0;
+    size_t offset1 = copyNumber(scratch, src + PROTO_REQUEST_HEADER, len1);
+    size_t offset2 = copyNumber(scratch, src + PROTO_REQUEST_HEADER + len1, len2);
+    if (offset1 == (size_t) -1 || offset2 == (size_t) -1)
+        return false;
+    char const *num1 = (char const *) scratch->data + offset1;
+    char const *num2 = (char const *) scratch->data + offset2;
+
+    switch (op) {
+        case PROTO_ADD:
+            return appendResponse(out, id, phfwdAdd(pf, num1, num2) ? PROTO_OK : PROTO_FAILED, NULL, 0, 0);
+        case PROTO_REMOVE:
+            phfwdRemove(pf, num1);
+            return appendResponse(out, id, PROTO_OK, NULL, 0, 0);
+        default:
+            return appendResponse(out, id, PROTO_INVALID, NULL, 0, 0);
+    }
+}
+
+/** @brief Wykonuje wszystkie kompletne żądania połączenia.
+ * @param[in] pf - wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in,out] conn - wskaźnik na połączenie;
+ * @param[in,out] scratch - wskaźnik na bufor pomocniczy.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool handleRequests(PhoneForward *pf, Connection *conn, Buffer *scratch) {
+    size_t pos = 0, size;
+    bool res = true;
+    while (res && (size = requestSize(conn->in.data + pos, conn->in.size - pos)) > 0) {
+        unsigned char const *src = conn->in.data + pos;
+        if (!validNumbers(src)) {
+            res = appendResponse(&(conn->out), protoLoad32(src + 1), PROTO_INVALID, NULL, 0, 0);
+            pos += size;
+            continue;
+        }
+        if (!batchedOp(src[0])) {
+            res = handleChange(pf, src, &(conn->out), scratch);
+            pos += size;
+            continue;
+        }
+
+        size_t count = 0, end = pos;
+        while ((size = requestSize(conn->in.data + end, conn->in.size - end)) > 0
+               && conn->in.data[end] == src[0] && validNumbers(conn->in.data + end)) {
+            end += size;
+            ++count;
+        }
+        res = handleQueries(pf, src, count, &(conn->out), scratch);
+        pos = end;
+    }
+
+    memmove(conn->in.data, conn->in.data + pos, conn->in.size - pos);
+    conn->in.size -= pos;
+    return res;
+}
+
+/** @brief Wysyła oczekujące odpowiedzi.
+ * @param[in] epoll - deskryptor epoll;
+ * @param[in,out] conn - wskaźnik na połączenie.
+ * @return Wartość @p false, jeśli połączenie zostało zerwane.
+ */
+static bool flushOutput(int epoll, Connection *conn) {
+    while (conn->sent < conn->out.size) {
+        ssize_t written = send(conn->fd, conn->out.data + conn->sent, conn->out.size - conn->sent, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return false;
+        }
+        conn->sent += (size_t) written;
+    }
+    if (conn->sent == conn->out.size) {
+        conn->sent = 0;
+        conn->out.size = 0;
+    }
+
+    uint32_t events = (conn->out.size - conn->sent < OUTPUT_LIMIT ? EPOLLIN : 0)
+                      | (conn->out.size > 0 ? EPOLLOUT : 0);
+    if (events != conn->events) {
+        struct epoll_event event = {.events = events, .data.ptr = conn};
+        if (epoll_ctl(epoll, EPOLL_CTL_MOD, conn->fd, &event) != 0)
+            return false;
+        conn->events = events;
+    }
+    return true;
+}
+
+/** @brief Zamyka połączenie.
+ * @param[in,out] conn - wskaźnik na połączenie.
+ */
+static void closeConnection(Connection *conn) {
+    close(conn->fd);
+    free(conn->in.data);
+    free(conn->out.data);
+    free(conn);
+}
+
+/** @brief Odczytuje i obsługuje żądania połączenia.
+ * Wykonuje co najwyżej READS_PER_EVENT odczytów i przestaje czytać, gdy
+ * niewysłane odpowiedzi przekroczą OUTPUT_LIMIT bajtów, żeby jeden klient nie
+ * zagłodził pozostałych. Resztę danych zgłosi kolejne wywołanie epoll_wait.
+ * @param[in] pf - wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in,out] conn - wskaźnik na połączenie;
+ * @param[in,out] scratch - wskaźnik na bufor pomocniczy.
+ * @return Wartość @p false, jeśli połączenie należy zamknąć.
+ */
+static bool readRequests(PhoneForward *pf, Connection *conn, Buffer *scratch) {
+    for (int reads = 0; reads < READS_PER_EVENT && conn->out.size - conn->sent < OUTPUT_LIMIT; ++reads) {
+        if (!reserve(&(conn->in), READ_SIZE))
+            return false;
+        ssize_t got = read(conn->fd, conn->in.data + conn->in.size, READ_SIZE);
+        if (got < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+            return false;
+        }
+        if (got == 0)
+            return false;
+        conn->in.size += (size_t) got;
+        if (!handleRequests(pf, conn, scratch))
+            return false;
+    }
+    return true;
+}
+
+/** @brief Tworzy gniazdo nasłuchujące.
+ * @param[in] path - wskaźnik na ścieżkę gniazda.
+ * @return Deskryptor gniazda lub -1 w przypadku błędu.
+ */
+static int listenOn(char const *path) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path))
+        return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    unlink(path);
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/** @brief Obsługuje połączenia aż do otrzymania sygnału zakończenia.
+ * Najpierw wykonuje żądania wszystkich gotowych połączeń, potem zapisuje
+ * dziennik na dysk, a dopiero potem wysyła odpowiedzi.
+ * @param[in] pf - wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] listener - deskryptor gniazda nasłuchującego;
+ * @param[in] durable - flaga mówiąca czy struktura ma dołączony dziennik.
+ * @return Wartość @p false, jeśli wystąpił błąd epoll lub zapisu dziennika.
+ */
+static bool serve(PhoneForward *pf, int listener, bool durable) {
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll < 0)
+        return false;
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = NULL};
+    if (epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event) != 0) {
+        close(epoll);
+        return false;
+    }
+
+    Buffer scratch = {NULL, 0, 0};
+    struct epoll_event events[MAX_EVENTS];
+    Connection *active[MAX_EVENTS];
+    bool res = true;
+    while (!stopped) {
+        int ready = epoll_wait(epoll, events, MAX_EVENTS, -1);
+        if (ready < 0) {
+            if (errno == EINTR)
+                continue;
+            res = false;
+            break;
+        }
+
+        int count = 0;
+        for (int i = 0; i < ready; ++i) {
+            Connection *conn = events[i].data.ptr;
+            if (!conn) {
+                int fd;
+                while ((fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    conn = calloc(1, sizeof(Connection));
+                    struct epoll_event added = {.events = EPOLLIN, .data.ptr = conn};
+                    if (!conn || epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &added) != 0) {
+                        close(fd);
+                        free(conn);
+                        continue;
+                    }
+                    conn->fd = fd;
+                    conn->events = EPOLLIN;
+                }
+                continue;
+            }
+
+            if (!(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) || readRequests(pf, conn, &scratch)) {
+                active[count++] = conn;
+            } else {
+                epoll_ctl(epoll, EPOLL_CTL_DEL, conn->fd, NULL);
+                closeConnection(conn);
+            }
+        }
+
+        if (durable && !phfwdJournalSync(pf)) {
+            res = false;
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            if (!flushOutput(epoll, active[i])) {
+                epoll_ctl(epoll, EPOLL_CTL_DEL, active[i]->fd, NULL);
+                closeConnection(active[i]);
+            }
+        }
+    }
+
+    free(scratch.data);
+    close(epoll);
+    return res;
+}
+
+/** @brief Uruchamia serwer.
+ * @param[in] argc - liczba argumentów;
+ * @param[in] argv - ścieżka gniazda i opcjonalnie ścieżka dziennika.
+ * @return Kod zakończenia programu.
+ */
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s SOCKET [JOURNAL]\n", argv[0]);
+        return 1;
+    }
+
+    PhoneForward *pf = NULL;
+    if (argc == 3 && access(argv[2], F_OK) == 0)
+        pf = phfwdJournalLoad(argv[2], 0);
+    else
+        pf = phfwdNew();
+    if (!pf || (argc == 3 && !phfwdJournalAttach(pf, argv[2], JOURNAL_BATCH))) {
+        fprintf(stderr, "Cannot initialize forwarding table\n");
+        phfwdDelete(pf);
+        return 1;
+    }
+
+    int listener = listenOn(argv[1]);
+    if (listener < 0) {
+        fprintf(stderr, "Cannot listen on %s\n", argv[1]);
+        phfwdDelete(pf);
+        return 1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onSignal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    bool res = serve(pf, listener, argc == 3);
+    close(listener);
+    unlink(argv[1]);
+    if (argc == 3)
+        res = phfwdJournalSync(pf) && res;
+    phfwdDelete(pf);
+    return res ? 0 : 1;
+}
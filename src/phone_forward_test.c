@@ -0,0 +1,1076 @@
+/** @file
+ * Testy wariantów struktury przechowującej przekierowania numerów
+ *
+ * Każdy test wykonuje te same operacje na badanym wariancie i na strukturze
+ * z @ref phfwdNew, a potem porównuje wyniki @ref phfwdGet i @ref phfwdReverse
+ * dla wszystkich krótkich numerów. Użycie: phone_forward_test [TEST].
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+#define _POSIX_C_SOURCE 200809L /**< Udostępnia wątki POSIX. */
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "phone_forward.h"
+
+#define ALPHABET "0123" /**< Symbole numerów używanych w testach. */
+#define SYMBOLS 4 /**< Liczba symboli w ALPHABET. */
+#define MAX_LEN 4 /**< Maksymalna długość porównywanego numeru. */
+#define THREADS 4 /**< Liczba wątków zmieniających strukturę współbieżną. */
+#define OPERATIONS 20000 /**< Liczba operacji wykonywanych przez wątek. */
+#define CHANGES 500 /**< Liczba zmian jednej serii w testach jednowątkowych. */
+#define JOURNAL_PATH "phone_forward_test.journal" /**< Plik dziennika w katalogu roboczym. */
+#define SHM_BYTES (1 << 20) /**< Rozmiar segmentu współdzielonej pamięci. */
+#define DISK_PATH "phone_forward_test.disk" /**< Plik drzew w katalogu roboczym. */
+#define DISK_BLOCK 4096 /**< Rozmiar bloku pliku drzew w bajtach. */
+#define LIST_SYMBOLS "0123456789*#" /**< Symbole numerów w teście kursora, w kolejności kursora. */
+#define LIST_LEN 3 /**< Maksymalna długość numeru w teście kursora. */
+#define LIST_NUMBERS (12 + 12 * 12 + 12 * 12 * 12) /**< Liczba numerów w teście kursora. */
+#define TRACE_EVENTS 8 /**< Liczba wywołań zapamiętywanych przez funkcję śledzącą. */
+
+/** @brief Losuje liczbę.
+ * @param[in,out] seed - wskaźnik na stan generatora.
+ * @return Liczba z przedziału [0, 32767].
+ */
+static unsigned nextRandom(unsigned *seed) {
+    *seed = *seed * 1103515245u + 12345u;
+    return (*seed >> 16) & 0x7FFF;
+}
+
+/** @brief Losuje numer złożony z symboli ALPHABET.
+ * @param[out] num - bufor na co najmniej MAX_LEN + 1 znaków;
+ * @param[in] first - pierwszy symbol numeru lub '\0', jeśli ma być losowy;
+ * @param[in,out] seed - wskaźnik na stan generatora.
+ */
+static void randomNumber(char *num, char first, unsigned *seed) {
+    size_t length = 1 + nextRandom(seed) % (MAX_LEN - 1);
+    for (size_t i = 0; i < length; ++i)
+        num[i] = ALPHABET[nextRandom(seed) % SYMBOLS];
+    if (first != '\0')
+        num[0] = first;
+    num[length] = '\0';
+}
+
+/** @brief Sprawdza, czy wyniki są równe.
+ * @param[in] pnum - wskaźnik na wynik badanej struktury;
+ * @param[in] ref - wskaźnik na wynik struktury wzorcowej.
+ */
+static void checkNumbers(PhoneNumbers *pnum, PhoneNumbers *ref) {
+    assert(pnum != NULL && ref != NULL);
+    size_t i = 0;
+    for (; phnumGet(ref, i); ++i)
+        assert(phnumGet(pnum, i) && strcmp(phnumGet(pnum, i), phnumGet(ref, i)) == 0);
+    assert(phnumGet(pnum, i) == NULL);
+    phnumDelete(pnum);
+    phnumDelete(ref);
+}
+
+/** @brief Porównuje strukturę ze wzorcem.
+ * Porównuje wyniki @ref phfwdGet, @ref phfwdReverse i @ref phfwdGetReverse
+ * dla wszystkich numerów złożonych z symboli ALPHABET o długości od 1
+ * do MAX_LEN.
+ * @param[in] pf - wskaźnik na badaną strukturę;
+ * @param[in] ref - wskaźnik na strukturę wzorcową.
+ */
+static void checkSame(PhoneForward const *pf, PhoneForward const *ref) {
+    char num[MAX_LEN + 1];
+    for (size_t length = 1; length <= MAX_LEN; ++length) {
+        size_t count = 1;
+        for (size_t i = 0; i < length; ++i)
+            count *= SYMBOLS;
+        for (size_t code = 0; code < count; ++code) {
+            for (size_t i = 0, rest = code; i < length; ++i, rest /= SYMBOLS)
+                num[i] = ALPHABET[rest % SYMBOLS];
+            num[length] = '\0';
+            checkNumbers(phfwdGet(pf, num), phfwdGet(ref, num));
+            checkNumbers(phfwdReverse(pf, num), phfwdReverse(ref, num));
+            checkNumbers(phfwdGetReverse(pf, num), phfwdGetReverse(ref, num));
+        }
+    }
+}
+
+/** @brief Wykonuje serię losowych zmian na dwóch strukturach.
+ * @param[in,out] pf - wskaźnik na badaną strukturę;
+ * @param[in,out] ref - wskaźnik na strukturę wzorcową lub NULL;
+ * @param[in] seed - ziarno serii.
+ */
+static void randomChanges(PhoneForward *pf, PhoneForward *ref, unsigned seed) {
+    char num1[MAX_LEN + 1], num2[MAX_LEN + 1];
+    for (size_t i = 0; i < CHANGES; ++i) {
+        randomNumber(num1, '\0', &seed);
+        randomNumber(num2, '\0', &seed);
+        if (nextRandom(&seed) % 4 != 0) {
+            bool res = phfwdAdd(pf, num1, num2);
+            assert(!ref || res == phfwdAdd(ref, num1, num2));
+        } else {
+            phfwdRemove(pf, num1);
+            if (ref)
+                phfwdRemove(ref, num1);
+        }
+    }
+}
+
+/**
+ * To jest struktura opisująca wątek testu struktury współbieżnej.
+ */
+typedef struct ShardedWorker {
+    PhoneForward *pf; /**< Wskaźnik na zmienianą strukturę. */
+    unsigned thread; /**< Numer wątku, wyznaczający pierwszy symbol jego numerów. */
+} ShardedWorker;
+
+/** @brief Wykonuje operacje jednego wątku.
+ * Zmienia tylko przekierowania numerów zaczynających się od symbolu
+ * ALPHABET[@p thread], więc wynik nie zależy od przeplotu wątków. Numery
+ * docelowe i zapytania dotyczą dowolnych numerów.
+ * @param[in,out] pf - wskaźnik na strukturę;
+ * @param[in] thread - numer wątku;
+ * @param[in] query - flaga mówiąca czy wykonywać też zapytania.
+ */
+static void shardedOperations(PhoneForward *pf, unsigned thread, bool query) {
+    unsigned seed = thread + 1;
+    char num1[MAX_LEN + 1], num2[MAX_LEN + 1];
+    for (size_t i = 0; i < OPERATIONS; ++i) {
+        randomNumber(num1, ALPHABET[thread], &seed);
+        randomNumber(num2, '\0', &seed);
+        unsigned kind = nextRandom(&seed) % 8;
+        if (kind < 5)
+            phfwdAdd(pf, num1, num2);
+        else if (kind < 6)
+            phfwdRemove(pf, num1);
+        else if (query && kind < 7)
+            phnumDelete(phfwdGet(pf, num2));
+        else if (query)
+            phnumDelete(phfwdReverse(pf, num2));
+    }
+}
+
+/** @brief Funkcja wątku testu struktury współbieżnej.
+ * @param[in] arg - wskaźnik na opis wątku.
+ * @return NULL.
+ */
+static void *shardedWorker(void *arg) {
+    ShardedWorker *worker = arg;
+    shardedOperations(worker->pf, worker->thread, true);
+    return NULL;
+}
+
+/** @brief Testuje strukturę z @ref phfwdNewSharded.
+ * Kilka wątków naraz dodaje i usuwa przekierowania oraz wykonuje zapytania,
+ * a wynik jest porównywany ze strukturą, na której te same zmiany wykonano
+ * kolejno.
+ */
+static void testSharded(void) {
+    PhoneForward *pf = phfwdNewSharded(), *ref = phfwdNew();
+    assert(pf != NULL && ref != NULL);
+
+    pthread_t threads[THREADS];
+    ShardedWorker workers[THREADS];
+    for (unsigned i = 0; i < THREADS; ++i) {
+        workers[i] = (ShardedWorker) {pf, i};
+        assert(pthread_create(&threads[i], NULL, shardedWorker, &workers[i]) == 0);
+    }
+    for (unsigned i = 0; i < THREADS; ++i) {
+        pthread_join(threads[i], NULL);
+        shardedOperations(ref, i, false);
+    }
+    checkSame(pf, ref);
+
+    phfwdDelete(pf);
+    phfwdDelete(ref);
+}
+
+/** @brief Testuje migawki z @ref phfwdSnapshot.
+ * Sprawdza, że migawka nie zmienia się po późniejszych zmianach struktury,
+ * że @ref phfwdRestore przywraca dokładnie stan z migawki i że migawka
+ * działa po usunięciu struktury, z której powstała.
+ */
+static void testSnapshot(void) {
+    PhoneForward *pf = phfwdNewPersistent(), *ref = phfwdNew(), *saved = phfwdNew();
+    assert(pf != NULL && ref != NULL && saved != NULL);
+    randomChanges(pf, ref, 1);
+    randomChanges(saved, NULL, 1);
+
+    PhoneForward *snap = phfwdSnapshot(pf);
+    assert(snap != NULL);
+    assert(phfwdAdd(snap, "1", "2") == false);
+    randomChanges(pf, ref, 2);
+    checkSame(snap, saved);
+    checkSame(pf, ref);
+
+    assert(phfwdRestore(pf, snap));
+    checkSame(pf, saved);
+    randomChanges(pf, NULL, 3);
+    checkSame(snap, saved);
+
+    phfwdDelete(pf);
+    checkSame(snap, saved);
+
+    phfwdDelete(snap);
+    phfwdDelete(saved);
+    phfwdDelete(ref);
+}
+
+/** @brief Zwraca rozmiar pliku.
+ * @param[in] path - ścieżka do pliku.
+ * @return Rozmiar pliku w bajtach.
+ */
+static off_t fileSize(char const *path) {
+    struct stat info;
+    assert(stat(path, &info) == 0);
+    return info.st_size;
+}
+
+/** @brief Sprawdza, że dziennik odtwarza strukturę.
+ * Porównuje ze wzorcem strukturę z @ref phfwdJournalLoad i pustą strukturę
+ * po @ref phfwdJournalReplay.
+ * @param[in] ref - wskaźnik na strukturę wzorcową.
+ */
+static void checkJournal(PhoneForward const *ref) {
+    PhoneForward *loaded = phfwdJournalLoad(JOURNAL_PATH, 2), *replayed = phfwdNew();
+    assert(loaded != NULL && replayed != NULL);
+    assert(phfwdJournalReplay(replayed, JOURNAL_PATH));
+    checkSame(loaded, ref);
+    checkSame(replayed, ref);
+    phfwdDelete(loaded);
+    phfwdDelete(replayed);
+}
+
+/** @brief Testuje dziennik zmian.
+ * Zapisuje zmiany w dzienniku, przepisuje go przez @ref phfwdJournalCompact
+ * i dopisuje kolejne zmiany, sprawdzając po każdym kroku, że dziennik
+ * odtwarza strukturę. Na końcu ucina plik w środku ostatniej grupy, która
+ * powinna zostać pominięta.
+ */
+static void testJournal(void) {
+    remove(JOURNAL_PATH);
+    PhoneForward *pf = phfwdNew(), *ref = phfwdNew();
+    assert(pf != NULL && ref != NULL);
+    assert(phfwdJournalAttach(pf, JOURNAL_PATH, 0));
+
+    randomChanges(pf, ref, 1);
+    assert(phfwdJournalSync(pf));
+    randomChanges(pf, ref, 2);
+    assert(phfwdJournalSync(pf));
+    checkJournal(ref);
+
+    off_t before = fileSize(JOURNAL_PATH);
+    assert(phfwdJournalCompact(pf));
+    assert(fileSize(JOURNAL_PATH) < before);
+    checkJournal(ref);
+
+    randomChanges(pf, ref, 3);
+    assert(phfwdJournalSync(pf));
+    checkJournal(ref);
+
+    off_t complete = fileSize(JOURNAL_PATH);
+    randomChanges(pf, NULL, 4);
+    assert(phfwdJournalSync(pf));
+    off_t size = fileSize(JOURNAL_PATH);
+    assert(size > complete);
+    assert(truncate(JOURNAL_PATH, complete + (size - complete) / 2) == 0);
+    checkJournal(ref);
+
+    phfwdDelete(pf);
+    phfwdDelete(ref);
+    remove(JOURNAL_PATH);
+}
+
+/** @brief Testuje nakładkę z @ref phfwdNewOverlay.
+ * Wykonuje te same zmiany na nakładce i na kopii struktury bazowej
+ * z @ref phfwdNew: usunięcie ukrywające bazowe przekierowania o danym
+ * prefiksie, zastąpienie dłuższej maski krótszą i lokalne przekierowanie
+ * numeru, który w bazie jest przekierowany gdzie indziej, co musi go ukryć
+ * w wynikach @ref phfwdReverse. Sprawdza też, że baza się nie zmienia.
+ */
+static void testOverlay(void) {
+    char const *const pairs[][2] = {
+        {"1", "2"}, {"12", "30"}, {"123", "0"}, {"201", "3"},
+        {"2013", "1"}, {"20", "33"}, {"30", "0"}, {"31", "0"},
+    };
+    PhoneForward *base = phfwdNew(), *saved = phfwdNew(), *ref = phfwdNew();
+    assert(base != NULL && saved != NULL && ref != NULL);
+    randomChanges(base, saved, 5);
+    randomChanges(ref, NULL, 5);
+    for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); ++i) {
+        assert(phfwdAdd(base, pairs[i][0], pairs[i][1]));
+        assert(phfwdAdd(saved, pairs[i][0], pairs[i][1]));
+        assert(phfwdAdd(ref, pairs[i][0], pairs[i][1]));
+    }
+
+    PhoneForward *pf = phfwdNewOverlay(base);
+    assert(pf != NULL);
+    checkSame(pf, ref);
+
+    char const *const removed[] = {"12", "201", "20"};
+    for (size_t i = 0; i < sizeof(removed) / sizeof(removed[0]); ++i) {
+        phfwdRemove(pf, removed[i]);
+        phfwdRemove(ref, removed[i]);
+        checkSame(pf, ref);
+    }
+
+    assert(phfwdAdd(pf, "30", "11"));
+    assert(phfwdAdd(ref, "30", "11"));
+    checkSame(pf, ref);
+
+    randomChanges(pf, ref, 6);
+    checkSame(pf, ref);
+    checkSame(base, saved);
+
+    phfwdDelete(pf);
+    phfwdDelete(ref);
+    phfwdDelete(saved);
+    phfwdDelete(base);
+}
+
+/** @brief Testuje zmiany struktury po @ref phfwdCompact.
+ * Po kompaktowaniu usuwa i nadpisuje przekierowania, zwalniając wierzchołki,
+ * elementy list i numery leżące w bloku, a potem kompaktuje strukturę
+ * ponownie. Sprawdza strukturę z @ref phfwdNew i z @ref phfwdNewSharded.
+ */
+static void testCompact(void) {
+    PhoneForward *(*const constructors[])(void) = {phfwdNew, phfwdNewSharded};
+    for (size_t i = 0; i < sizeof(constructors) / sizeof(constructors[0]); ++i) {
+        PhoneForward *pf = constructors[i](), *ref = phfwdNew();
+        assert(pf != NULL && ref != NULL);
+        randomChanges(pf, ref, 7);
+
+        size_t reclaimed = 0;
+        assert(phfwdCompact(pf, &reclaimed));
+        checkSame(pf, ref);
+
+        char const *const removed[] = {"1", "23", "302"};
+        for (size_t j = 0; j < sizeof(removed) / sizeof(removed[0]); ++j) {
+            phfwdRemove(pf, removed[j]);
+            phfwdRemove(ref, removed[j]);
+        }
+        checkSame(pf, ref);
+        randomChanges(pf, ref, 8);
+        checkSame(pf, ref);
+
+        assert(phfwdCompact(pf, &reclaimed));
+        assert(reclaimed > 0);
+        checkSame(pf, ref);
+        randomChanges(pf, ref, 9);
+        checkSame(pf, ref);
+
+        phfwdDelete(pf);
+        phfwdDelete(ref);
+    }
+}
+
+/** @brief Testuje przekierowania we współdzielonej pamięci.
+ * Zmienia segment przez strukturę z @ref phfwdShmCreate i porównuje ze
+ * wzorcem ją oraz czytelnika z @ref phfwdShmOpen w tym samym procesie.
+ * Sprawdza, że @ref phfwdShmUnlink usuwa nazwę segmentu, a odwzorowany
+ * segment działa dalej.
+ */
+static void testShm(void) {
+    char name[64];
+    snprintf(name, sizeof(name), "/phone_forward_test_%ld", (long) getpid());
+    phfwdShmUnlink(name);
+
+    PhoneForward *pf = phfwdShmCreate(name, SHM_BYTES), *ref = phfwdNew();
+    assert(pf != NULL && ref != NULL);
+    PhoneForward *reader = phfwdShmOpen(name);
+    assert(reader != NULL);
+    assert(phfwdShmCreate(name, SHM_BYTES) == NULL);
+    assert(phfwdAdd(reader, "1", "2") == false);
+
+    randomChanges(pf, ref, 10);
+    checkSame(pf, ref);
+    checkSame(reader, ref);
+    phfwdRemove(reader, "1");
+    phfwdRemove(pf, "2");
+    phfwdRemove(ref, "2");
+    checkSame(reader, ref);
+
+    assert(phfwdShmUnlink(name));
+    assert(phfwdShmOpen(name) == NULL);
+    assert(phfwdShmUnlink(name) == false);
+    randomChanges(pf, ref, 11);
+    checkSame(reader, ref);
+
+    phfwdDelete(reader);
+    phfwdDelete(pf);
+    phfwdDelete(ref);
+}
+
+/** @brief Testuje tablicę skoków z @ref phfwdEnableJumpTable.
+ * Dla każdej liczby poziomów włącza tablicę przed zmianami albo po nich,
+ * a następnie przeplata losowe zmiany, usunięcia całych prefiksów
+ * i kompaktowanie, które zwalnia i przenosi wierzchołki wskazywane przez
+ * tablicę.
+ */
+static void testJump(void) {
+    for (unsigned levels = 1; levels <= 5; ++levels) {
+        PhoneForward *pf = phfwdNew(), *ref = phfwdNew();
+        assert(pf != NULL && ref != NULL);
+        if (levels % 2 == 1)
+            assert(phfwdEnableJumpTable(pf, levels));
+        randomChanges(pf, ref, 20 + levels);
+        if (levels % 2 == 0)
+            assert(phfwdEnableJumpTable(pf, levels));
+        checkSame(pf, ref);
+
+        size_t reclaimed;
+        assert(phfwdCompact(pf, &reclaimed));
+        checkSame(pf, ref);
+        char const *const removed[] = {"0", "12", "213"};
+        for (size_t i = 0; i < sizeof(removed) / sizeof(removed[0]); ++i) {
+            phfwdRemove(pf, removed[i]);
+            phfwdRemove(ref, removed[i]);
+            checkSame(pf, ref);
+        }
+        randomChanges(pf, ref, 30 + levels);
+        checkSame(pf, ref);
+        assert(phfwdCompact(pf, &reclaimed));
+        randomChanges(pf, ref, 40 + levels);
+        checkSame(pf, ref);
+
+        assert(phfwdEnableJumpTable(pf, 0));
+        checkSame(pf, ref);
+        phfwdDelete(pf);
+        phfwdDelete(ref);
+    }
+    assert(phfwdEnableJumpTable(NULL, 1) == false);
+}
+
+/** @brief Sprawdza, czy ciąg zapytania wsadowego jest równy wynikowi.
+ * @param[in] batch - wskaźnik na wynik zapytania wsadowego;
+ * @param[in] idx - indeks zapytania;
+ * @param[in] ref - wskaźnik na wynik pojedynczego zapytania.
+ */
+static void checkBatch(PhoneNumbersBatch const *batch, size_t idx, PhoneNumbers *ref) {
+    assert(ref != NULL);
+    size_t i = 0;
+    for (; phnumGet(ref, i); ++i)
+        assert(phnumBatchGet(batch, idx, i) && strcmp(phnumBatchGet(batch, idx, i), phnumGet(ref, i)) == 0);
+    assert(phnumBatchSize(batch, idx) == i && phnumBatchGet(batch, idx, i) == NULL);
+    phnumDelete(ref);
+}
+
+/** @brief Porównuje zapytania wsadowe z pojedynczymi zapytaniami wzorca.
+ * @param[in] pf - wskaźnik na badaną strukturę;
+ * @param[in] ref - wskaźnik na strukturę wzorcową;
+ * @param[in] nums - tablica numerów;
+ * @param[in] count - liczba numerów.
+ */
+static void checkBatches(PhoneForward const *pf, PhoneForward const *ref,
+                         char const *const *nums, size_t count) {
+    PhoneNumbers *get = phfwdGetBatch(pf, nums, count);
+    PhoneNumbersBatch *reverse = phfwdReverseBatch(pf, nums, count);
+    PhoneNumbersBatch *getReverse = phfwdGetReverseBatch(pf, nums, count);
+    assert(get != NULL && reverse != NULL && getReverse != NULL);
+    for (size_t i = 0; i < count; ++i) {
+        PhoneNumbers *single = phfwdGet(ref, nums[i]);
+        assert(single != NULL);
+        char const *expected = phnumGet(single, 0);
+        assert(expected ? phnumGet(get, i) && strcmp(phnumGet(get, i), expected) == 0
+                        : phnumGet(get, i) == NULL);
+        phnumDelete(single);
+        checkBatch(reverse, i, phfwdReverse(ref, nums[i]));
+        checkBatch(getReverse, i, phfwdGetReverse(ref, nums[i]));
+    }
+    phnumDelete(get);
+    phnumBatchDelete(reverse);
+    phnumBatchDelete(getReverse);
+}
+
+/** @brief Testuje zapytania wsadowe.
+ * Porównuje @ref phfwdGetBatch, @ref phfwdReverseBatch
+ * i @ref phfwdGetReverseBatch z pojedynczymi zapytaniami dla wszystkich
+ * numerów do długości MAX_LEN, które mają wspólne prefiksy, w kolejności
+ * malejącej i z powtórzeniami, a także dla numerów niepoprawnych, w tym
+ * zapytania złożonego wyłącznie z nich, i pustego zapytania.
+ */
+static void testBatch(void) {
+    size_t total = 0, count = 1;
+    for (size_t length = 1; length <= MAX_LEN; ++length) {
+        count *= SYMBOLS;
+        total += count;
+    }
+    size_t size = 2 * total + 3;
+    char (*numbers)[MAX_LEN + 1] = malloc(total * sizeof(*numbers));
+    char const **nums = malloc(size * sizeof(char const *));
+    assert(numbers != NULL && nums != NULL);
+    size_t k = 0;
+    for (size_t length = 1, codes = SYMBOLS; length <= MAX_LEN; ++length, codes *= SYMBOLS) {
+        for (size_t code = 0; code < codes; ++code, ++k) {
+            for (size_t i = 0, rest = code; i < length; ++i, rest /= SYMBOLS)
+                numbers[k][i] = ALPHABET[rest % SYMBOLS];
+            numbers[k][length] = '\0';
+        }
+    }
+    for (size_t i = 0; i < total; ++i) {
+        nums[i] = numbers[total - 1 - i];
+        nums[total + i] = numbers[i];
+    }
+    char const *const invalid[] = {"", "12a", NULL};
+    for (size_t i = 0; i < 3; ++i)
+        nums[2 * total + i] = invalid[i];
+
+    PhoneForward *(*const constructors[])(void) = {phfwdNew, phfwdNewSharded, phfwdNewPersistent};
+    for (size_t i = 0; i < sizeof(constructors) / sizeof(constructors[0]); ++i) {
+        PhoneForward *pf = constructors[i](), *ref = phfwdNew();
+        assert(pf != NULL && ref != NULL);
+        randomChanges(pf, ref, 50);
+        checkBatches(pf, ref, nums, size);
+        checkBatches(pf, ref, invalid, 3);
+        checkBatches(pf, ref, nums, 0);
+        phfwdDelete(pf);
+        phfwdDelete(ref);
+    }
+    free(numbers);
+    free(nums);
+}
+
+/** @brief Wykonuje losowe zmiany, sprawdzając wyszukiwanie po każdej z nich.
+ * Po każdej zmianie porównuje wynik @ref phfwdGet dla zmienionego numeru
+ * i jednego losowego numeru, a co CHANGES / 10 zmian całe struktury.
+ * @param[in,out] pf - wskaźnik na badaną strukturę;
+ * @param[in,out] ref - wskaźnik na strukturę wzorcową;
+ * @param[in] seed - ziarno serii.
+ */
+static void checkedChanges(PhoneForward *pf, PhoneForward *ref, unsigned seed) {
+    char num1[MAX_LEN + 1], num2[MAX_LEN + 1];
+    for (size_t i = 0; i < CHANGES; ++i) {
+        randomNumber(num1, '\0', &seed);
+        randomNumber(num2, '\0', &seed);
+        if (nextRandom(&seed) % 3 != 0) {
+            assert(phfwdAdd(pf, num1, num2) == phfwdAdd(ref, num1, num2));
+        } else {
+            phfwdRemove(pf, num1);
+            phfwdRemove(ref, num1);
+        }
+        checkNumbers(phfwdGet(pf, num1), phfwdGet(ref, num1));
+        checkNumbers(phfwdGet(pf, num2), phfwdGet(ref, num2));
+        if (i % (CHANGES / 10) == 0)
+            checkSame(pf, ref);
+    }
+    checkSame(pf, ref);
+}
+
+/** @brief Testuje wyszukiwanie w tablicach haszujących.
+ * Zmiany są wykonywane po zbudowaniu indeksu, więc są nanoszone na jego
+ * tablice. Przekierowania dłuższych numerów wymagają nowych tablic,
+ * a usunięcie przekierowań krótkich prefiksów usuwa całe poddrzewa.
+ */
+static void testHash(void) {
+    PhoneForward *pf = phfwdNew(), *ref = phfwdNew();
+    assert(pf != NULL && ref != NULL);
+    assert(phfwdEnablePrefixHash(pf, true));
+    checkSame(pf, ref);
+    checkedChanges(pf, ref, 50);
+
+    char const *const added[][2] = {{"0123", "3"}, {"01", "0123"}, {"0", "2"}, {"0123", "1"}};
+    for (size_t i = 0; i < sizeof(added) / sizeof(added[0]); ++i) {
+        assert(phfwdAdd(pf, added[i][0], added[i][1]));
+        assert(phfwdAdd(ref, added[i][0], added[i][1]));
+        checkSame(pf, ref);
+    }
+    char const *const removed[] = {"012", "01", "3", "0"};
+    for (size_t i = 0; i < sizeof(removed) / sizeof(removed[0]); ++i) {
+        phfwdRemove(pf, removed[i]);
+        phfwdRemove(ref, removed[i]);
+        checkSame(pf, ref);
+    }
+    checkedChanges(pf, ref, 51);
+
+    size_t reclaimed;
+    assert(phfwdCompact(pf, &reclaimed));
+    checkedChanges(pf, ref, 52);
+    assert(phfwdEnablePrefixHash(pf, false));
+    checkSame(pf, ref);
+    assert(phfwdEnablePrefixHash(pf, true));
+    checkedChanges(pf, ref, 53);
+    phfwdDelete(pf);
+    phfwdDelete(ref);
+}
+
+/** @brief Testuje strukturę z drzewem reverse budowanym przy pierwszym użyciu.
+ * Drzewo reverse jest budowane kolejno przez @ref phfwdReverse,
+ * @ref phfwdGetReverse i @ref phfwdBuildReverse, po zmianach wykonanych bez
+ * niego. Te same zmiany po zbudowaniu drzewa sprawdzają jego aktualizację.
+ */
+static void testLazy(void) {
+    for (unsigned trigger = 0; trigger < 3; ++trigger) {
+        PhoneForward *pf = phfwdNewLazyReverse(), *ref = phfwdNew();
+        assert(pf != NULL && ref != NULL);
+        randomChanges(pf, ref, 60 + trigger);
+        char const *const nums[] = {"0", "12", "3012"};
+        for (size_t i = 0; i < sizeof(nums) / sizeof(nums[0]); ++i)
+            checkNumbers(phfwdGet(pf, nums[i]), phfwdGet(ref, nums[i]));
+
+        if (trigger == 0)
+            checkNumbers(phfwdReverse(pf, "1"), phfwdReverse(ref, "1"));
+        else if (trigger == 1)
+            checkNumbers(phfwdGetReverse(pf, "1"), phfwdGetReverse(ref, "1"));
+        else
+            assert(phfwdBuildReverse(pf) && phfwdBuildReverse(pf) && phfwdBuildReverse(ref));
+        checkSame(pf, ref);
+
+        randomChanges(pf, ref, 60 + trigger);
+        checkSame(pf, ref);
+        randomChanges(pf, ref, 70 + trigger);
+        checkSame(pf, ref);
+        phfwdDelete(pf);
+        phfwdDelete(ref);
+    }
+    assert(phfwdBuildReverse(NULL) == false);
+}
+
+/** @brief Porównuje strukturę otwartą z pliku ze wzorcem.
+ * @param[in] ref - wskaźnik na strukturę wzorcową zapisaną do pliku DISK_PATH;
+ * @param[in] cacheBytes - rozmiar pamięci podręcznej;
+ * @param[in] pinnedBytes - liczba bajtów trzymanych stale w pamięci;
+ * @param[out] hits - wskaźnik na liczbę odczytów bloków z pamięci;
+ * @param[out] misses - wskaźnik na liczbę odczytów bloków z pliku.
+ */
+static void checkDisk(PhoneForward const *ref, size_t cacheBytes, size_t pinnedBytes,
+                      uint64_t *hits, uint64_t *misses) {
+    PhoneForward *pf = phfwdOpenDisk(DISK_PATH, cacheBytes, pinnedBytes);
+    assert(pf != NULL);
+    assert(phfwdDiskStats(pf, hits, misses) && *hits == 0 && *misses == 0);
+    checkSame(pf, ref);
+    assert(phfwdAdd(pf, "1", "2") == false);
+    phfwdRemove(pf, "1");
+    checkSame(pf, ref);
+    assert(phfwdDiskStats(pf, hits, misses));
+    phfwdDelete(pf);
+}
+
+/** @brief Testuje przekierowania zapisane w pliku.
+ * Porównuje ze wzorcem struktury otwarte z pamięcią podręczną jednego bloku,
+ * całego pliku i z całym plikiem trzymanym stale w pamięci. Drugi zapis
+ * zastępuje plik i nie zostawia pliku tymczasowego.
+ */
+static void testDisk(void) {
+    PhoneForward *ref = phfwdNew();
+    assert(ref != NULL);
+    uint64_t hits, misses;
+    for (unsigned round = 0; round < 2; ++round) {
+        randomChanges(ref, NULL, 80 + round);
+        assert(phfwdExportDisk(ref, DISK_PATH));
+        assert(access(DISK_PATH ".tmp", F_OK) != 0);
+        off_t size = fileSize(DISK_PATH);
+        assert(size > 2 * DISK_BLOCK);
+        uint64_t blocks = ((uint64_t) size + DISK_BLOCK - 1) / DISK_BLOCK;
+
+        checkDisk(ref, DISK_BLOCK, 0, &hits, &misses);
+        assert(hits > 0 && misses > blocks);
+        checkDisk(ref, (size_t) blocks * DISK_BLOCK, 0, &hits, &misses);
+        assert(hits > 0 && misses > 0 && misses <= blocks);
+        checkDisk(ref, DISK_BLOCK, (size_t) blocks * DISK_BLOCK, &hits, &misses);
+        assert(hits > 0 && misses == 0);
+    }
+
+    PhoneForward *pf = phfwdNew();
+    assert(pf != NULL);
+    assert(phfwdDiskStats(pf, &hits, &misses) == false);
+    assert(phfwdDiskStats(NULL, &hits, &misses) == false);
+    assert(phfwdExportDisk(pf, "/nonexistent/" DISK_PATH) == false);
+    assert(phfwdOpenDisk(DISK_PATH ".tmp", DISK_BLOCK, 0) == NULL);
+    phfwdDelete(pf);
+    phfwdDelete(ref);
+    assert(unlink(DISK_PATH) == 0);
+}
+
+/** @brief Porównuje wyniki dla numerów par ze wzorcem.
+ * @param[in] pf - wskaźnik na badaną strukturę;
+ * @param[in] ref - wskaźnik na strukturę wzorcową;
+ * @param[in] nums - tablica numerów;
+ * @param[in] count - liczba numerów.
+ */
+static void checkPairs(PhoneForward const *pf, PhoneForward const *ref, char const *const *nums, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        checkNumbers(phfwdGet(pf, nums[i]), phfwdGet(ref, nums[i]));
+        checkNumbers(phfwdReverse(pf, nums[i]), phfwdReverse(ref, nums[i]));
+        checkNumbers(phfwdGetReverse(pf, nums[i]), phfwdGetReverse(ref, nums[i]));
+    }
+}
+
+/** @brief Testuje budowanie struktury z wielu przekierowań.
+ * Pary zawierają powtórzone numery przekierowywane, pary niepoprawne i równe
+ * oraz wiele numerów o wspólnym prefiksie dłuższym niż 8 symboli, który
+ * zmusza podział do zejścia na największą głębokość. Struktura z
+ * @ref phfwdNewBulk jest porównywana ze strukturą budowaną kolejnymi
+ * wywołaniami @ref phfwdAdd i usuwana przez @ref phfwdDeleteParallel.
+ */
+static void testBulk(void) {
+    enum { PAIRS = 3000, LENGTH = 16 };
+    char (*buffer)[2][LENGTH] = malloc(PAIRS * sizeof(*buffer));
+    char const **num1 = malloc(PAIRS * sizeof(char const *));
+    char const **num2 = malloc(PAIRS * sizeof(char const *));
+    assert(buffer != NULL && num1 != NULL && num2 != NULL);
+
+    char const *const skewed = "0123012301";
+    char const *const invalid[][2] = {{"12a", "1"}, {"1", ""}, {"", "2"}, {"3", "3"}, {"0123012301", "0123012301"}};
+    unsigned seed = 90;
+    for (size_t i = 0; i < PAIRS; ++i) {
+        unsigned kind = nextRandom(&seed) % 10;
+        if (kind == 9) {
+            unsigned row = nextRandom(&seed) % (sizeof(invalid) / sizeof(invalid[0]));
+            strcpy(buffer[i][0], invalid[row][0]);
+            strcpy(buffer[i][1], invalid[row][1]);
+        } else {
+            for (int j = 0; j < 2; ++j) {
+                bool deep = j == 0 ? kind < 5 : kind % 2 == 0;
+                strcpy(buffer[i][j], deep ? skewed : "");
+                randomNumber(buffer[i][j] + strlen(buffer[i][j]), '\0', &seed);
+            }
+        }
+        num1[i] = buffer[i][0];
+        num2[i] = buffer[i][1];
+    }
+
+    PhoneForward *ref = phfwdNew();
+    assert(ref != NULL);
+    for (size_t i = 0; i < PAIRS; ++i)
+        phfwdAdd(ref, num1[i], num2[i]);
+
+    size_t const threads[] = {1, 4, 16};
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t) {
+        PhoneForward *pf = phfwdNewBulk(num1, num2, PAIRS, threads[t]);
+        assert(pf != NULL);
+        checkSame(pf, ref);
+        checkPairs(pf, ref, num1, PAIRS);
+        checkPairs(pf, ref, num2, PAIRS);
+        phfwdDeleteParallel(pf, threads[t]);
+    }
+
+    PhoneForward *empty = phfwdNewBulk(NULL, NULL, 0, 16), *none = phfwdNew();
+    assert(empty != NULL && none != NULL);
+    checkSame(empty, none);
+    phfwdDeleteParallel(empty, 16);
+    phfwdDelete(none);
+    assert(phfwdNewBulk(NULL, num2, 1, 1) == NULL);
+    phfwdDelete(ref);
+    free(buffer);
+    free(num1);
+    free(num2);
+}
+
+/**
+ * To jest struktura przechowująca wzorcowe przekierowania dla testu kursora.
+ * Numery złożone z symboli LIST_SYMBOLS o długości od 1 do LIST_LEN leżą
+ * w tablicy name w kolejności leksykograficznej.
+ */
+typedef struct ListModel {
+    char name[LIST_NUMBERS][LIST_LEN + 1]; /**< Numery w kolejności leksykograficznej. */
+    char forward[LIST_NUMBERS][LIST_LEN + 1]; /**< Przekierowania numerów lub puste napisy. */
+} ListModel;
+
+/** @brief Wypełnia numery modelu w kolejności leksykograficznej.
+ * @param[in,out] model - wskaźnik na model;
+ * @param[in,out] count - wskaźnik na liczbę wypełnionych numerów;
+ * @param[in] prefix - wskaźnik na numer, którego przedłużenia są dopisywane;
+ * @param[in] length - długość numeru @p prefix.
+ */
+static void listNames(ListModel *model, size_t *count, char const *prefix, size_t length) {
+    for (size_t c = 0; length < LIST_LEN && c < strlen(LIST_SYMBOLS); ++c) {
+        char *name = model->name[(*count)++];
+        memcpy(name, prefix, length);
+        name[length] = LIST_SYMBOLS[c];
+        name[length + 1] = '\0';
+        model->forward[*count - 1][0] = '\0';
+        listNames(model, count, name, length + 1);
+    }
+}
+
+/** @brief Losuje numer złożony z symboli LIST_SYMBOLS.
+ * @param[out] num - bufor na co najmniej LIST_LEN + 1 znaków;
+ * @param[in,out] seed - wskaźnik na stan generatora.
+ */
+static void listNumber(char *num, unsigned *seed) {
+    size_t length = 1 + nextRandom(seed) % LIST_LEN;
+    for (size_t i = 0; i < length; ++i)
+        num[i] = LIST_SYMBOLS[nextRandom(seed) % strlen(LIST_SYMBOLS)];
+    num[length] = '\0';
+}
+
+/** @brief Wykonuje losową zmianę na strukturze i modelu.
+ * @param[in,out] pf - wskaźnik na strukturę;
+ * @param[in,out] model - wskaźnik na model;
+ * @param[in,out] seed - wskaźnik na stan generatora.
+ */
+static void listChange(PhoneForward *pf, ListModel *model, unsigned *seed) {
+    char num1[LIST_LEN + 1], num2[LIST_LEN + 1];
+    listNumber(num1, seed);
+    listNumber(num2, seed);
+    bool add = nextRandom(seed) % 4 != 0;
+    if (add)
+        assert(phfwdAdd(pf, num1, num2) == (strcmp(num1, num2) != 0));
+    else
+        phfwdRemove(pf, num1);
+
+    size_t length = strlen(num1);
+    for (size_t i = 0; i < LIST_NUMBERS; ++i) {
+        if (!add && strncmp(model->name[i], num1, length) == 0)
+            model->forward[i][0] = '\0';
+        else if (add && strcmp(num1, num2) != 0 && strcmp(model->name[i], num1) == 0)
+            strcpy(model->forward[i], num2);
+    }
+}
+
+/** @brief Sprawdza kolejne przekierowania kursora.
+ * Kursor ma zwrócić przekierowania modelu z prefiksem @p prefix w kolejności
+ * numerów modelu. Jeśli @p pf nie jest NULL, każde zwrócone przekierowanie
+ * jest porównywane z wynikiem @ref phfwdGet, a po każdym kroku na @p pf
+ * wykonywana jest losowa zmiana.
+ * @param[in,out] list - wskaźnik na kursor, który jest usuwany;
+ * @param[in] model - wskaźnik na model z chwili utworzenia kursora;
+ * @param[in] prefix - wskaźnik na prefiks numerów;
+ * @param[in,out] pf - wskaźnik na zmienianą strukturę lub NULL;
+ * @param[in,out] changed - wskaźnik na model zmienianej struktury lub NULL;
+ * @param[in,out] seed - wskaźnik na stan generatora.
+ */
+static void checkList(PhoneForwardList *list, ListModel const *model, char const *prefix,
+                      PhoneForward *pf, ListModel *changed, unsigned *seed) {
+    assert(list != NULL);
+    size_t length = strlen(prefix);
+    char const *num1, *num2;
+    for (size_t i = 0; i < LIST_NUMBERS; ++i) {
+        if (model->forward[i][0] == '\0' || strncmp(model->name[i], prefix, length) != 0)
+            continue;
+        assert(phfwdListNext(list, &num1, &num2));
+        assert(strcmp(num1, model->name[i]) == 0 && strcmp(num2, model->forward[i]) == 0);
+        if (!pf)
+            continue;
+        listChange(pf, changed, seed);
+        PhoneNumbers *pnum = phfwdGet(pf, num1);
+        assert(pnum != NULL && phnumGet(pnum, 0) != NULL);
+        char const *expected = NULL;
+        for (size_t j = 0; j < LIST_NUMBERS && !expected; ++j) {
+            if (strcmp(changed->name[j], num1) == 0)
+                expected = changed->forward[j][0] != '\0' ? changed->forward[j] : NULL;
+        }
+        assert(!expected || strcmp(phnumGet(pnum, 0), expected) == 0);
+        phnumDelete(pnum);
+    }
+    assert(!phfwdListNext(list, &num1, &num2));
+    assert(!phfwdListNext(list, &num1, &num2));
+    phfwdListDelete(list);
+}
+
+/** @brief Testuje kursory przeglądające przekierowania.
+ * Porównuje kursory ze wzorcem dla pustego prefiksu, prefiksów
+ * przekierowanych numerów, wszystkich numerów długości 1 i napisów niebędących
+ * numerami, a kursor struktury trwałej także podczas jej zmieniania.
+ */
+static void testList(void) {
+    ListModel *model = malloc(sizeof(ListModel)), *changed = malloc(sizeof(ListModel));
+    assert(model != NULL && changed != NULL);
+    PhoneForward *(*const constructors[])(void) = {phfwdNew, phfwdNewSharded, phfwdNewPersistent};
+    for (size_t k = 0; k < sizeof(constructors) / sizeof(constructors[0]); ++k) {
+        size_t count = 0;
+        listNames(model, &count, "", 0);
+        assert(count == LIST_NUMBERS);
+        PhoneForward *pf = constructors[k]();
+        assert(pf != NULL);
+        unsigned seed = 100 + (unsigned) k;
+        for (size_t i = 0; i < CHANGES; ++i)
+            listChange(pf, model, &seed);
+
+        checkList(phfwdList(pf, NULL), model, "", NULL, NULL, NULL);
+        checkList(phfwdList(pf, ""), model, "", NULL, NULL, NULL);
+        for (size_t i = 0; i < LIST_NUMBERS; ++i) {
+            if (strlen(model->name[i]) == 1 || model->forward[i][0] != '\0')
+                checkList(phfwdList(pf, model->name[i]), model, model->name[i], NULL, NULL, NULL);
+        }
+        char const *const invalid[] = {"1a", "a", "12 ", "*x#"};
+        for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i)
+            checkList(phfwdList(pf, invalid[i]), model, "-", NULL, NULL, NULL);
+
+        if (constructors[k] == phfwdNewPersistent) {
+            char const *const prefixes[] = {"", "1", "#"};
+            for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); ++i) {
+                memcpy(changed, model, sizeof(ListModel));
+                checkList(phfwdList(pf, prefixes[i]), model, prefixes[i], pf, changed, &seed);
+                memcpy(model, changed, sizeof(ListModel));
+                checkList(phfwdList(pf, ""), model, "", NULL, NULL, NULL);
+            }
+        }
+        phfwdDelete(pf);
+    }
+
+    char const *num1, *num2;
+    assert(phfwdList(NULL, "") == NULL);
+    assert(!phfwdListNext(NULL, &num1, &num2));
+    phfwdListDelete(NULL);
+    free(model);
+    free(changed);
+}
+
+/**
+ * To jest struktura zapisująca wywołania funkcji śledzącej.
+ */
+typedef struct TraceLog {
+    PhfwdOp op[TRACE_EVENTS]; /**< Operacje kolejnych wywołań. */
+    bool exit[TRACE_EVENTS]; /**< Flagi końca operacji kolejnych wywołań. */
+    char const *num[TRACE_EVENTS]; /**< Numery przekazane kolejnym wywołaniom. */
+    size_t results[TRACE_EVENTS]; /**< Liczby wyników przekazane kolejnym wywołaniom. */
+    size_t count; /**< Liczba wywołań. */
+} TraceLog;
+
+/** @brief Zapisuje wywołanie funkcji śledzącej.
+ * Funkcja typu PhfwdTraceHook.
+ * @param[in,out] ctx - wskaźnik na zapis wywołań;
+ * @param[in] op - operacja;
+ * @param[in] exit - flaga końca operacji;
+ * @param[in] num - pierwszy numer operacji lub NULL;
+ * @param[in] results - liczba wyników operacji.
+ */
+static void traceLogHook(void *ctx, PhfwdOp op, bool exit, char const *num, size_t results) {
+    TraceLog *log = ctx;
+    assert(log->count < TRACE_EVENTS);
+    log->op[log->count] = op;
+    log->exit[log->count] = exit;
+    log->num[log->count] = num;
+    log->results[log->count] = results;
+    ++log->count;
+}
+
+/** @brief Sprawdza, że ostatnia operacja wywołała funkcję śledzącą dwa razy.
+ * @param[in,out] log - wskaźnik na zapis wywołań, który jest czyszczony;
+ * @param[in] op - oczekiwana operacja;
+ * @param[in] num - oczekiwany numer;
+ * @param[in] results - oczekiwana liczba wyników.
+ */
+static void checkTrace(TraceLog *log, PhfwdOp op, char const *num, size_t results) {
+    assert(log->count == 2);
+    assert(log->op[0] == op && !log->exit[0] && log->num[0] == num && log->results[0] == 0);
+    assert(log->op[1] == op && log->exit[1] && log->num[1] == num && log->results[1] == results);
+    log->count = 0;
+}
+
+/** @brief Testuje liczniki pomiaru opóźnień i funkcję śledzącą.
+ * Każde wywołanie ma trafić do klasy długości numeru i klasy liczby wyników
+ * opisanych przy @ref phfwdStatsEnable i wywołać funkcję śledzącą raz na
+ * początku i raz na końcu.
+ */
+static void testStats(void) {
+    PhoneForward *pf = phfwdNew();
+    assert(pf != NULL);
+    assert(phfwdStatsCount(pf, PHFWD_OP_GET, -1, -1) == 0);
+    assert(phfwdStatsEnable(pf));
+    TraceLog *log = calloc(1, sizeof(TraceLog));
+    assert(log != NULL);
+    phfwdSetTraceHook(pf, traceLogHook, log);
+
+    char const *short1 = "12", *short2 = "34", *one = "1", *five = "5";
+    char const *long1 = "1234567890", *long2 = "12345678901234567890123456789012";
+    assert(phfwdAdd(pf, short1, short2));
+    checkTrace(log, PHFWD_OP_ADD, short1, 1);
+    assert(phfwdAdd(pf, long1, five));
+    checkTrace(log, PHFWD_OP_ADD, long1, 1);
+    assert(!phfwdAdd(pf, one, one));
+    checkTrace(log, PHFWD_OP_ADD, one, 0);
+    assert(phfwdStatsCount(pf, PHFWD_OP_ADD, 0, 1) == 1);
+    assert(phfwdStatsCount(pf, PHFWD_OP_ADD, 2, 1) == 1);
+    assert(phfwdStatsCount(pf, PHFWD_OP_ADD, 0, 0) == 1);
+    assert(phfwdStatsCount(pf, PHFWD_OP_ADD, -1, 1) == 2);
+    assert(phfwdStatsCount(pf, PHFWD_OP_ADD, -1, -1) == 3);
+
+    char const *const gets[] = {"7", "123", "1234", long1, "12345678901234567", long2, "1a"};
+    int const getClasses[][2] = {{0, 1}, {0, 1}, {1, 1}, {2, 1}, {3, 1}, {4, 1}, {0, 0}};
+    for (size_t i = 0; i < sizeof(gets) / sizeof(gets[0]); ++i) {
+        phnumDelete(phfwdGet(pf, gets[i]));
+        checkTrace(log, PHFWD_OP_GET, gets[i], (size_t) getClasses[i][1]);
+        assert(phfwdStatsCount(pf, PHFWD_OP_GET, getClasses[i][0], getClasses[i][1]) >= 1);
+    }
+    assert(phfwdStatsCount(pf, PHFWD_OP_GET, 0, 1) == 2);
+    assert(phfwdStatsCount(pf, PHFWD_OP_GET, -1, 0) == 1);
+    assert(phfwdStatsCount(pf, PHFWD_OP_GET, -1, -1) == 7);
+
+    char num[3] = "20";
+    for (num[0] = '2'; num[0] <= '3'; ++num[0]) {
+        for (num[1] = '0'; num[1] <= '9'; ++num[1]) {
+            assert(phfwdAdd(pf, num, short2) == (strcmp(num, short2) != 0));
+            checkTrace(log, PHFWD_OP_ADD, num, strcmp(num, short2) != 0);
+        }
+    }
+    phnumDelete(phfwdReverse(pf, short2));
+    checkTrace(log, PHFWD_OP_REVERSE, short2, 21);
+    assert(phfwdStatsCount(pf, PHFWD_OP_REVERSE, 0, 4) == 1);
+    phnumDelete(phfwdGetReverse(pf, five));
+    checkTrace(log, PHFWD_OP_GET_REVERSE, five, 2);
+    assert(phfwdStatsCount(pf, PHFWD_OP_GET_REVERSE, 0, 2) == 1);
+
+    char const *const batch[] = {"1", "12", "123", "9"};
+    phnumDelete(phfwdGetBatch(pf, batch, 4));
+    checkTrace(log, PHFWD_OP_GET_BATCH, NULL, 4);
+    assert(phfwdStatsCount(pf, PHFWD_OP_GET_BATCH, 1, 3) == 1);
+    phnumBatchDelete(phfwdReverseBatch(pf, batch, 4));
+    checkTrace(log, PHFWD_OP_REVERSE_BATCH, NULL, 4);
+    assert(phfwdStatsCount(pf, PHFWD_OP_REVERSE_BATCH, 1, 3) == 1);
+
+    char const *two = "2";
+    phfwdRemove(pf, two);
+    checkTrace(log, PHFWD_OP_REMOVE, two, 0);
+    assert(phfwdStatsCount(pf, PHFWD_OP_REMOVE, 0, 0) == 1);
+    assert(phfwdStatsPercentile(pf, PHFWD_OP_GET, -1, -1, 100) > 0);
+
+    phfwdSetTraceHook(pf, NULL, NULL);
+    phnumDelete(phfwdGet(pf, one));
+    assert(log->count == 0);
+    assert(phfwdStatsCount(pf, PHFWD_OP_GET, -1, -1) == 8);
+    assert(phfwdStatsCount(NULL, PHFWD_OP_GET, -1, -1) == 0);
+    phfwdDelete(pf);
+    free(log);
+}
+
+/**
+ * To jest struktura opisująca test.
+ */
+typedef struct Test {
+    char const *name; /**< Nazwa testu. */
+    void (*run)(void); /**< Funkcja testu. */
+} Test;
+
+/** @brief Uruchamia testy.
+ * @param[in] argc - liczba argumentów;
+ * @param[in] argv - opcjonalnie nazwa testu do uruchomienia.
+ * @return Kod zakończenia programu.
+ */
+int main(int argc, char *argv[]) {
+    Test const tests[] = {
+        {"sharded", testSharded},
+        {"snapshot", testSnapshot},
+        {"journal", testJournal},
+        {"overlay", testOverlay},
+        {"compact", testCompact},
+        {"shm", testShm},
+        {"jump", testJump},
+        {"batch", testBatch},
+        {"hash", testHash},
+        {"lazy", testLazy},
+        {"disk", testDisk},
+        {"bulk", testBulk},
+        {"list", testList},
+        {"stats", testStats},
+    };
+
+    bool found = false;
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); ++i) {
+        if (argc < 2 || strcmp(argv[1], tests[i].name) == 0) {
+            tests[i].run();
+            found = true;
+        }
+    }
+    if (!found) {
+        fprintf(stderr, "Unknown test %s\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+/** @file
+ * Testy interfejsu C++ struktury przechowującej przekierowania numerów
+ *
+ * Sprawdzają przenoszenie obiektów, iterowanie po wynikach, numery zapytań
+ * niezakończone znakiem '\0' i zgłaszanie wyjątku @p std::bad_alloc.
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include "phone_forward.hpp"
+#include <cassert>
+#include <new>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/** @brief Sprawdza, czy wywołanie zgłasza wyjątek std::bad_alloc.
+ * @param[in] call – wywoływana funkcja.
+ * @return Wartość @p true, jeśli wyjątek został zgłoszony.
+ */
+template <typename Call>
+static bool throwsBadAlloc(Call call) {
+    try {
+        call();
+    } catch (std::bad_alloc const &) {
+        return true;
+    }
+    return false;
+}
+
+/** @brief Testuje przenoszenie struktur i wyników.
+ * Obiekt przeniesiony nie ma struktury: nie zmienia przekierowań, a zapytania
+ * zgłaszają std::bad_alloc.
+ */
+static void testMove() {
+    phfwd::Forward pf;
+    assert(pf.add("12", "34"));
+    phfwd::Forward moved(std::move(pf));
+    assert(pf.get() == nullptr && moved.get() != nullptr);
+    assert(moved.get("123")[0] == "343");
+
+    assert(!pf.add("5", "6"));
+    pf.remove("12");
+    assert(throwsBadAlloc([&] { pf.get("1"); }));
+    assert(throwsBadAlloc([&] { pf.reverse("1"); }));
+    assert(throwsBadAlloc([&] { pf.getReverse("1"); }));
+
+    pf = std::move(moved);
+    assert(moved.get() == nullptr && pf.get("123")[0] == "343");
+    pf = std::move(pf);
+    assert(pf.get("123")[0] == "343");
+
+    phfwd::Numbers pnum = pf.get("12");
+    phfwd::Numbers taken(std::move(pnum));
+    assert(pnum.get() == nullptr && pnum.empty() && pnum.size() == 0);
+    assert(pnum.begin() == pnum.end() && pnum[0].empty());
+    assert(taken.size() == 1 && taken[0] == "34");
+    pnum = std::move(taken);
+    assert(taken.get() == nullptr && pnum[0] == "34");
+    pnum = std::move(pnum);
+    assert(pnum[0] == "34");
+}
+
+/** @brief Testuje iterowanie po wynikach zapytań. */
+static void testNumbers() {
+    phfwd::Forward pf;
+    std::vector<std::string> const forwarded = {"1", "2", "3*", "3#", "45"};
+    for (std::string const &num : forwarded)
+        assert(pf.add(num, "9"));
+
+    phfwd::Numbers pnum = pf.reverse("9");
+    std::vector<std::string_view> seen;
+    for (std::string_view num : pnum)
+        seen.push_back(num);
+    assert(seen.size() == pnum.size() && seen.size() == forwarded.size() + 1);
+    for (std::size_t i = 0; i < forwarded.size(); ++i)
+        assert(seen[i] == forwarded[i] && pnum[i] == forwarded[i]);
+    assert(seen.back() == "9" && pnum[pnum.size()].empty());
+
+    phfwd::Numbers::iterator it = pnum.begin();
+    assert(*it++ == "1" && *it == "2" && *++it == "3*");
+    assert(it != pnum.begin() && it != pnum.end());
+
+    pnum = pf.get("a");
+    assert(pnum.empty() && pnum.begin() == pnum.end());
+}
+
+/** @brief Testuje numery podane jako widoki bez znaku '\0' na końcu.
+ * Widoki wskazują na początek dłuższego bufora, także dłuższego niż bufor,
+ * który biblioteka trzyma na stosie.
+ */
+static void testViews() {
+    phfwd::Forward pf;
+    std::string buffer = "123456789";
+    std::string_view view = buffer;
+    assert(pf.add(view.substr(0, 2), view.substr(4, 2)));
+    assert(pf.get(view.substr(0, 3))[0] == "563");
+    assert(pf.get(view.substr(0, 1))[0] == "1");
+    assert(pf.reverse(view.substr(4, 2)).size() == 2);
+    assert(pf.getReverse(view.substr(4, 3))[0] == "127");
+    pf.remove(view.substr(0, 2));
+    assert(pf.get("12")[0] == "12");
+
+    std::string longBuffer(200, '7');
+    std::string_view longView(longBuffer.data(), 100);
+    assert(pf.add(longView, "1"));
+    assert(pf.get(std::string(100, '7'))[0] == "1");
+    assert(pf.get(std::string(101, '7'))[0] == "17");
+    assert(pf.get(std::string_view(longBuffer.data(), 99))[0] == std::string(99, '7'));
+    assert(pf.get(std::string_view("12\0" "3", 4)).empty());
+    assert(!pf.add(std::string_view("4\0" "5", 3), "6"));
+}
+
+/** @brief Testuje zgłaszanie wyjątku std::bad_alloc dla wyniku NULL. */
+static void testBadAlloc() {
+    assert(throwsBadAlloc([] { phfwd::Forward pf(nullptr); }));
+    assert(throwsBadAlloc([] { phfwd::Forward pf(phfwdOpenDisk("/nonexistent", 4096, 0)); }));
+    phfwd::Forward pf(phfwdNewSharded());
+    assert(pf.add("1", "2") && pf.get("1")[0] == "2");
+}
+
+/**
+ * To jest struktura opisująca test.
+ */
+struct Test {
+    std::string_view name; /**< Nazwa testu. */
+    void (*run)(); /**< Funkcja testu. */
+};
+
+/** @brief Uruchamia testy.
+ * @param[in] argc – liczba argumentów;
+ * @param[in] argv – opcjonalnie nazwa testu do uruchomienia.
+ * @return Kod zakończenia programu.
+ */
+int main(int argc, char *argv[]) {
+    Test const tests[] = {
+        {"move", testMove},
+        {"numbers", testNumbers},
+        {"views", testViews},
+        {"bad_alloc", testBadAlloc},
+    };
+
+    bool found = false;
+    for (Test const &test : tests) {
+        if (argc < 2 || test.name == argv[1]) {
+            test.run();
+            found = true;
+        }
+    }
+    return found ? 0 : 1;
+}
@@ -0,0 +1,525 @@
+/** @file
+ * Implementacja wyszukiwania przekierowań w tablicach haszujących prefiksów
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+#define _POSIX_C_SOURCE 200809L /**< Udostępnia blokady pthread_mutex_t. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "prefix_hash.h"
+#include "number_pack.h"
+
+#define NO_KEY SIZE_MAX /**< Oznaczenie pustego miejsca tablicy haszującej. */
+#define INITIAL_CAPACITY 16 /**< Początkowy rozmiar tablicy haszującej. */
+
+/**
+ * To jest struktura reprezentująca element tablicy haszującej.
+ */
+typedef struct PrefixEntry {
+    uint64_t hash; /**< Skrót prefiksu. */
+    size_t key; /**< Indeks prefiksu w ciągu keys lub NO_KEY dla pustego miejsca. */
+    char const *forward; /**< Przekierowanie prefiksu lub NULL dla znacznika. */
+    char const *best; /**< Najdłuższe przekierowanie pasujące do prefiksu lub NULL. */
+    size_t bestLen; /**< Długość prefiksu przekierowania best. */
+    size_t uses; /**< Liczba przekierowań, na których ścieżce wyszukiwania leży element. */
+} PrefixEntry;
+
+/**
+ * To jest struktura reprezentująca tablicę haszującą prefiksów jednej długości.
+ */
+typedef struct PrefixLevel {
+    size_t length; /**< Długość prefiksów. */
+    PrefixEntry *entry; /**< Elementy adresowane otwarcie. */
+    size_t capacity; /**< Rozmiar tablicy entry, potęga dwójki. */
+    size_t count; /**< Liczba zajętych elementów. */
+} PrefixLevel;
+
+/**
+ * To jest struktura przechowująca indeks przekierowań.
+ */
+struct PrefixHash {
+    PrefixLevel *level; /**< Tablice haszujące w kolejności rosnących długości. */
+    size_t levels; /**< Liczba tablic haszujących. */
+    size_t levelsCapacity; /**< Rozmiar tablicy level. */
+    NumberPack keys; /**< Prefiksy wszystkich elementów. */
+    size_t garbage; /**< Liczba prefiksów w keys, których elementy zostały usunięte. */
+    atomic_bool dirty; /**< Flaga mówiąca czy indeks trzeba zbudować ponownie. */
+    pthread_mutex_t mutex; /**< Blokada budowania indeksu. */
+};
+
+/** @brief Liczy skrót prefiksu.
+ * Liczy 64-bitowy skrót FNV-1a pierwszych @p length znaków numeru.
+ * @param[in] num    – wskaźnik na numer;
+ * @param[in] length – długość prefiksu.
+ * @return Skrót prefiksu.
+ */
+static uint64_t prefixHashOf(char const *num, size_t length) {
+    uint64_t hash = 14695981039346656037u;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char) num[i];
+        hash *= 1099511628211u;
+    }
+    return hash;
+}
+
+/** @brief Szuka prefiksu w tablicy haszującej.
+ * @param[in] hash  – wskaźnik na indeks;
+ * @param[in] level – wskaźnik na tablicę haszującą;
+ * @param[in] num   – wskaźnik na numer nie krótszy niż prefiksy tablicy;
+ * @param[in] code  – skrót prefiksu numeru.
+ * @return Wskaźnik na element prefiksu lub na puste miejsce, w którym należy
+ *         go wstawić.
+ */
+static PrefixEntry *levelSlot(PrefixHash const *hash, PrefixLevel const *level, char const *num,
+                              uint64_t code) {
+    size_t mask = level->capacity - 1;
+    for (size_t i = (size_t) code & mask;; i = (i + 1) & mask) {
+        PrefixEntry *entry = &(level->entry[i]);
+        if (entry->key == NO_KEY ||
+            (entry->hash == code && memcmp(numberPackGet(&(hash->keys), entry->key), num, level->length) == 0))
+            return entry;
+    }
+}
+
+/** @brief Zwraca element prefiksu.
+ * @param[in] hash  – wskaźnik na indeks;
+ * @param[in] level – wskaźnik na tablicę haszującą;
+ * @param[in] num   – wskaźnik na numer nie krótszy niż prefiksy tablicy.
+ * @return Wskaźnik na element lub NULL, gdy prefiksu nie ma w tablicy.
+ */
+static PrefixEntry const *levelFind(PrefixHash const *hash, PrefixLevel const *level, char const *num) {
+    PrefixEntry const *entry = levelSlot(hash, level, num, prefixHashOf(num, level->length));
+    return entry->key == NO_KEY ? NULL : entry;
+}
+
+/** @brief Powiększa dwukrotnie tablicę haszującą.
+ * @param[in] hash      – wskaźnik na indeks;
+ * @param[in,out] level – wskaźnik na tablicę haszującą.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool levelGrow(PrefixHash const *hash, PrefixLevel *level) {
+    PrefixLevel grown = {level->length, malloc(2 * level->capacity * sizeof(PrefixEntry)),
+                         2 * level->capacity, level->count};
+    if (!grown.entry)
+        return false;
+    for (size_t i = 0; i < grown.capacity; ++i)
+        grown.entry[i].key = NO_KEY;
+    for (size_t i = 0; i < level->capacity; ++i) {
+        PrefixEntry const *entry = &(level->entry[i]);
+        if (entry->key != NO_KEY)
+            *levelSlot(hash, &grown, numberPackGet(&(hash->keys), entry->key), entry->hash) = *entry;
+    }
+    free(level->entry);
+    *level = grown;
+    return true;
+}
+
+/** @brief Wstawia prefiks do tablicy haszującej.
+ * Nic nie robi, jeśli prefiks już jest w tablicy.
+ * @param[in,out] hash – wskaźnik na indeks;
+ * @param[in] idx      – indeks tablicy haszującej;
+ * @param[in] num      – wskaźnik na numer nie krótszy niż prefiksy tablicy.
+ * @return Wskaźnik na element prefiksu lub NULL, gdy nie udało się alokować
+ *         pamięci.
+ */
+static PrefixEntry *levelInsert(PrefixHash *hash, size_t idx, char const *num) {
+    PrefixLevel *level = &(hash->level[idx]);
+    if (2 * (level->count + 1) > level->capacity && !levelGrow(hash, level))
+        return NULL;
+
+    uint64_t code = prefixHashOf(num, level->length);
+    PrefixEntry *entry = levelSlot(hash, level, num, code);
+    if (entry->key != NO_KEY)
+        return entry;
+    if (!numberPackAppend(&(hash->keys), num, level->length, ""))
+        return NULL;
+    *entry = (PrefixEntry) {code, hash->keys.size - 1, NULL, NULL, 0, 0};
+    ++level->count;
+    return entry;
+}
+
+/** @brief Usuwa element z tablicy haszującej.
+ * Przesuwa wstecz kolejne elementy ciągu zajętych miejsc, tak aby każdy
+ * pozostał osiągalny z miejsca wskazanego przez jego skrót.
+ * @param[in,out] hash  – wskaźnik na indeks;
+ * @param[in,out] level – wskaźnik na tablicę haszującą;
+ * @param[in,out] entry – wskaźnik na usuwany element tablicy @p level.
+ */
+static void levelErase(PrefixHash *hash, PrefixLevel *level, PrefixEntry *entry) {
+    size_t mask = level->capacity - 1, i = (size_t) (entry - level->entry);
+    level->entry[i].key = NO_KEY;
+    for (size_t j = (i + 1) & mask; level->entry[j].key != NO_KEY; j = (j + 1) & mask) {
+        size_t home = (size_t) level->entry[j].hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            level->entry[i] = level->entry[j];
+            level->entry[j].key = NO_KEY;
+            i = j;
+        }
+    }
+    --level->count;
+    ++hash->garbage;
+}
+
+/** @brief Zwraca indeks tablicy haszującej prefiksów danej długości.
+ * @param[in] hash   – wskaźnik na indeks;
+ * @param[in] length – długość prefiksu.
+ * @return Indeks tablicy haszującej lub indeks, pod którym należy ją wstawić.
+ */
+static size_t levelIndex(PrefixHash const *hash, size_t length) {
+    size_t lo = 0, hi = hash->levels;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (hash->level[mid].length < length)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/** @brief Zwalnia tablice haszujące i prefiksy indeksu.
+ * @param[in,out] hash – wskaźnik na indeks.
+ */
+static void clearLevels(PrefixHash *hash) {
+    for (size_t i = 0; i < hash->levels; ++i)
+        free(hash->level[i].entry);
+    free(hash->level);
+    hash->level = NULL;
+    hash->levels = 0;
+    hash->levelsCapacity = 0;
+    hash->garbage = 0;
+    numberPackFree(&(hash->keys));
+}
+
+/** @brief Wyznacza następną tablicę ścieżki wyszukiwania binarnego.
+ * Ścieżka prowadzi do tablicy @p target. Zwracane są tylko tablice krótszych
+ * długości, które wyszukiwanie odwiedza po drodze i w których prefiks musi
+ * mieć znacznik.
+ * @param[in] target  – indeks tablicy, do której prowadzi ścieżka;
+ * @param[in,out] lo  – dolny koniec przedziału wyszukiwania;
+ * @param[in,out] hi  – górny koniec przedziału wyszukiwania;
+ * @param[out] mid    – indeks następnej tablicy ścieżki.
+ * @return Wartość @p false, jeśli ścieżka dotarła do tablicy @p target.
+ */
+static bool pathNext(size_t target, size_t *lo, size_t *hi, size_t *mid) {
+    while (*lo < *hi) {
+        *mid = *lo + (*hi - *lo) / 2;
+        if (*mid == target)
+            return false;
+        if (*mid < target) {
+            *lo = *mid + 1;
+            return true;
+        }
+        *hi = *mid;
+    }
+    return false;
+}
+
+/** @brief Zwraca element prefiksu numeru w tablicy haszującej.
+ * @param[in] hash – wskaźnik na indeks;
+ * @param[in] idx  – indeks tablicy haszującej;
+ * @param[in] num  – wskaźnik na numer nie krótszy niż prefiksy tablicy.
+ * @return Wskaźnik na element lub na puste miejsce, gdy prefiksu nie ma
+ *         w tablicy.
+ */
+static PrefixEntry *levelEntry(PrefixHash const *hash, size_t idx, char const *num) {
+    PrefixLevel const *level = &(hash->level[idx]);
+    return levelSlot(hash, level, num, prefixHashOf(num, level->length));
+}
+
+/** @brief Wstawia przekierowanie i znaczniki jego ścieżki.
+ * Znaczniki są wstawiane do tablic krótszych długości, które wyszukiwanie
+ * binarne odwiedza w drodze do tablicy długości @p num1 i po których
+ * trafieniu musi przejść do dłuższych prefiksów. Liczniki użyć elementów
+ * nie zmieniają się, jeśli przekierowanie zastępuje wcześniejsze. Zakłada,
+ * że tablica długości @p num1 istnieje.
+ * @param[in,out] hash – wskaźnik na indeks;
+ * @param[in] num1     – wskaźnik na numer przekierowywany;
+ * @param[in] num2     – wskaźnik na numer docelowy.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool pathInsert(PrefixHash *hash, char const *num1, char const *num2) {
+    size_t length = strlen(num1), target = levelIndex(hash, length);
+    PrefixEntry *entry = levelInsert(hash, target, num1);
+    if (!entry)
+        return false;
+    bool added = !entry->forward;
+    entry->forward = num2;
+    entry->best = num2;
+    entry->bestLen = length;
+    entry->uses += added;
+
+    for (size_t lo = 0, hi = hash->levels, mid; pathNext(target, &lo, &hi, &mid);) {
+        PrefixEntry *marker = levelInsert(hash, mid, num1);
+        if (!marker)
+            return false;
+        marker->uses += added;
+    }
+    return true;
+}
+
+/** @brief Usuwa przekierowanie i znaczniki jego ścieżki.
+ * Elementy, których nie używa już żadne przekierowanie, są usuwane z tablic.
+ * @param[in,out] hash – wskaźnik na indeks;
+ * @param[in] num      – wskaźnik na numer przekierowywany obecny w indeksie.
+ */
+static void pathRemove(PrefixHash *hash, char const *num) {
+    size_t target = levelIndex(hash, strlen(num));
+    PrefixEntry *entry = levelEntry(hash, target, num);
+    entry->forward = NULL;
+    if (--entry->uses == 0)
+        levelErase(hash, &(hash->level[target]), entry);
+
+    for (size_t lo = 0, hi = hash->levels, mid; pathNext(target, &lo, &hi, &mid);) {
+        PrefixEntry *marker = levelEntry(hash, mid, num);
+        if (--marker->uses == 0)
+            levelErase(hash, &(hash->level[mid]), marker);
+    }
+}
+
+/** @brief Wyznacza najdłuższe przekierowanie pasujące do elementu.
+ * Element z przekierowaniem pasuje sam do siebie. Dla znacznika szuka
+ * przekierowania najdłuższego prefiksu w tablicach krótszych długości.
+ * @param[in,out] hash – wskaźnik na indeks;
+ * @param[in] idx      – indeks tablicy haszującej elementu;
+ * @param[in,out] entry – wskaźnik na element.
+ */
+static void resolveEntry(PrefixHash *hash, size_t idx, PrefixEntry *entry) {
+    if (entry->forward) {
+        entry->best = entry->forward;
+        entry->bestLen = hash->level[idx].length;
+        return;
+    }
+    entry->best = NULL;
+    entry->bestLen = 0;
+    char const *key = numberPackGet(&(hash->keys), entry->key);
+    for (size_t j = idx; j-- > 0;) {
+        PrefixEntry const *shorter = levelFind(hash, &(hash->level[j]), key);
+        if (shorter && shorter->forward) {
+            entry->best = shorter->forward;
+            entry->bestLen = hash->level[j].length;
+            return;
+        }
+    }
+}
+
+/** @brief Dodaje tablicę haszującą dla długości prefiksu przekierowania.
+ * Funkcja typu TrieVisit.
+ * @param[in,out] ctx – wskaźnik na indeks;
+ * @param[in] num1    – wskaźnik na numer przekierowywany;
+ * @param[in] num2    – wskaźnik na numer docelowy.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool addLevel(void *ctx, char const *num1, char const *num2) {
+    (void) num2;
+    PrefixHash *hash = ctx;
+    size_t length = strlen(num1), idx = levelIndex(hash, length);
+    if (idx < hash->levels && hash->level[idx].length == length)
+        return true;
+
+    if (hash->levels == hash->levelsCapacity) {
+        size_t capacity = hash->levelsCapacity ? 2 * hash->levelsCapacity : 8;
+        PrefixLevel *temp = realloc(hash->level, capacity * sizeof(PrefixLevel));
+        if (!temp)
+            return false;
+        hash->level = temp;
+        hash->levelsCapacity = capacity;
+    }
+    PrefixEntry *entry = malloc(INITIAL_CAPACITY * sizeof(PrefixEntry));
+    if (!entry)
+        return false;
+    for (size_t i = 0; i < INITIAL_CAPACITY; ++i)
+        entry[i].key = NO_KEY;
+
+    memmove(&(hash->level[idx + 1]), &(hash->level[idx]), (hash->levels - idx) * sizeof(PrefixLevel));
+    hash->level[idx] = (PrefixLevel) {length, entry, INITIAL_CAPACITY, 0};
+    ++hash->levels;
+    return true;
+}
+
+/** @brief Wstawia przekierowanie i jego znaczniki.
+ * Funkcja typu TrieVisit.
+ * @param[in,out] ctx – wskaźnik na indeks;
+ * @param[in] num1    – wskaźnik na numer przekierowywany;
+ * @param[in] num2    – wskaźnik na numer docelowy.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool addEntries(void *ctx, char const *num1, char const *num2) {
+    return pathInsert(ctx, num1, num2);
+}
+
+/** @brief Wyznacza najdłuższe przekierowania pasujące do elementów.
+ * @param[in,out] hash – wskaźnik na indeks.
+ */
+static void resolveBest(PrefixHash *hash) {
+    for (size_t l = 0; l < hash->levels; ++l) {
+        PrefixLevel *level = &(hash->level[l]);
+        for (size_t i = 0; i < level->capacity; ++i) {
+            if (level->entry[i].key != NO_KEY)
+                resolveEntry(hash, l, &(level->entry[i]));
+        }
+    }
+}
+
+/** @brief Wyznacza przekierowania znaczników ścieżki numeru.
+ * @param[in,out] hash – wskaźnik na indeks;
+ * @param[in] num      – wskaźnik na numer przekierowywany obecny w indeksie.
+ */
+static void resolvePath(PrefixHash *hash, char const *num) {
+    size_t target = levelIndex(hash, strlen(num));
+    for (size_t lo = 0, hi = hash->levels, mid; pathNext(target, &lo, &hi, &mid);)
+        resolveEntry(hash, mid, levelEntry(hash, mid, num));
+}
+
+/** @brief Przypisuje nowe przekierowanie znacznikom ścieżki numeru.
+ * Znaczniki ścieżki numeru @p num dłuższe niż @p length, dla których
+ * przekierowanie prefiksu długości @p length jest najdłuższym pasującym,
+ * dostają przekierowanie @p forward.
+ * @param[in,out] hash – wskaźnik na indeks;
+ * @param[in] num      – wskaźnik na numer przekierowywany obecny w indeksie;
+ * @param[in] length   – długość prefiksu nowego przekierowania;
+ * @param[in] forward  – wskaźnik na nowe przekierowanie.
+ */
+static void raisePath(PrefixHash *hash, char const *num, size_t length, char const *forward) {
+    size_t target = levelIndex(hash, strlen(num));
+    for (size_t lo = 0, hi = hash->levels, mid; pathNext(target, &lo, &hi, &mid);) {
+        if (hash->level[mid].length <= length)
+            continue;
+        PrefixEntry *marker = levelEntry(hash, mid, num);
+        if (!marker->forward && marker->bestLen <= length) {
+            marker->best = forward;
+            marker->bestLen = length;
+        }
+    }
+}
+
+/** @brief Buduje indeks z drzewa.
+ * @param[in,out] hash – wskaźnik na indeks;
+ * @param[in] root     – wskaźnik na korzeń drzewa forward.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci; indeks jest
+ *         wtedy pusty.
+ */
+static bool rebuild(PrefixHash *hash, TrieNode const *root) {
+    clearLevels(hash);
+    if (!trieForEach(root, addLevel, hash) || !trieForEach(root, addEntries, hash)) {
+        clearLevels(hash);
+        return false;
+    }
+    resolveBest(hash);
+    return true;
+}
+
+PrefixHash *prefixHashNew(void) {
+    PrefixHash *hash = malloc(sizeof(PrefixHash));
+    if (!hash)
+        return NULL;
+    if (pthread_mutex_init(&(hash->mutex), NULL) != 0) {
+        free(hash);
+        return NULL;
+    }
+    hash->level = NULL;
+    hash->levels = 0;
+    hash->levelsCapacity = 0;
+    hash->garbage = 0;
+    numberPackInit(&(hash->keys));
+    atomic_init(&(hash->dirty), true);
+    return hash;
+}
+
+void prefixHashDelete(PrefixHash *hash) {
+    if (!hash)
+        return;
+    clearLevels(hash);
+    pthread_mutex_destroy(&(hash->mutex));
+    free(hash);
+}
+
+void prefixHashInvalidate(PrefixHash *hash) {
+    if (hash)
+        atomic_store_explicit(&(hash->dirty), true, memory_order_relaxed);
+}
+
+void prefixHashAdd(PrefixHash *hash, TrieNode const *root, char const *num) {
+    if (!hash || atomic_load_explicit(&(hash->dirty), memory_order_relaxed))
+        return;
+
+    size_t length = strlen(num), target = levelIndex(hash, length);
+    TrieCursor cursor;
+    if (target == hash->levels || hash->level[target].length != length ||
+        !trieCursorInit(&cursor, root, num)) {
+        prefixHashInvalidate(hash);
+        return;
+    }
+
+    char const *num1, *num2, *forward = NULL;
+    bool res = trieCursorNext(&cursor, &num1, &forward) && pathInsert(hash, num, forward);
+    if (res)
+        resolvePath(hash, num);
+    while (res && trieCursorNext(&cursor, &num1, &num2))
+        raisePath(hash, num1, length, forward);
+    if (!res || cursor.next != N)
+        prefixHashInvalidate(hash);
+    trieCursorFree(&cursor);
+}
+
+void prefixHashRemove(PrefixHash *hash, TrieNode const *root, char const *num) {
+    if (!hash || atomic_load_explicit(&(hash->dirty), memory_order_relaxed))
+        return;
+
+    TrieCursor cursor;
+    if (!trieCursorInit(&cursor, root, num)) {
+        prefixHashInvalidate(hash);
+        return;
+    }
+    char const *num1, *num2;
+    while (trieCursorNext(&cursor, &num1, &num2))
+        pathRemove(hash, num1);
+    if (cursor.next != N || 2 * hash->garbage > hash->keys.size)
+        prefixHashInvalidate(hash);
+    trieCursorFree(&cursor);
+}
+
+char *prefixHashFindForward(PrefixHash *hash, TrieNode const *root, char const *num) {
+    if (atomic_load_explicit(&(hash->dirty), memory_order_acquire)) {
+        bool res = true;
+        pthread_mutex_lock(&(hash->mutex));
+        if (atomic_load_explicit(&(hash->dirty), memory_order_relaxed)) {
+            res = rebuild(hash, root);
+            if (res)
+                atomic_store_explicit(&(hash->dirty), false, memory_order_release);
+        }
+        pthread_mutex_unlock(&(hash->mutex));
+        if (!res)
+            return NULL;
+    }
+
+    size_t length = strlen(num), lo = 0, hi = hash->levels, bestLen = 0;
+    char const *best = NULL;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        PrefixLevel const *level = &(hash->level[mid]);
+        PrefixEntry const *entry = level->length <= length ? levelFind(hash, level, num) : NULL;
+        if (entry) {
+            best = entry->best;
+            bestLen = entry->bestLen;
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    size_t bestSize = best ? strlen(best) : 0;
+    char *res = malloc((bestSize + length - bestLen + 1) * sizeof(char));
+    if (!res)
+        return NULL;
+    if (best)
+        memcpy(res, best, bestSize);
+    strcpy(res + bestSize, num + bestLen);
+    return res;
+}
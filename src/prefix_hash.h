@@ -0,0 +1,91 @@
+/** @file
+ * Interfejs wyszukiwania przekierowań w tablicach haszujących prefiksów
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __PREFIX_HASH_H__
+#define __PREFIX_HASH_H__
+
+#include <stdbool.h>
+#include "trie.h"
+
+/**
+ * To jest struktura reprezentująca indeks przekierowań drzewa forward.
+ * Dla każdej długości prefiksu, pod którym jest przekierowanie, indeks ma
+ * osobną tablicę haszującą. Najdłuższy pasujący prefiks jest wyszukiwany
+ * binarnie po długościach. Aby wyszukiwanie binarne nie pomijało dłuższych
+ * prefiksów, tablice krótszych długości zawierają znaczniki, czyli początki
+ * dłuższych prefiksów z przekierowaniami, razem z najdłuższym
+ * przekierowaniem pasującym do znacznika. Każdy element pamięta, ilu
+ * przekierowaniom służy, więc zmiany drzewa są nanoszone na indeks bez jego
+ * przebudowy. Indeks jest budowany z drzewa przy pierwszym wyszukiwaniu,
+ * a także po zmianie, która wymaga tablicy nowej długości lub po której
+ * usunięte prefiksy zajmują więcej pamięci niż pozostałe.
+ */
+struct PrefixHash;
+typedef struct PrefixHash PrefixHash;
+
+/** @brief Tworzy indeks.
+ * Indeks jest pusty i zostanie zbudowany przy pierwszym wyszukiwaniu.
+ * @return Wskaźnik na indeks lub NULL, gdy nie udało się alokować pamięci.
+ */
+PrefixHash *prefixHashNew(void);
+
+/** @brief Usuwa indeks.
+ * Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param[in] hash – wskaźnik na usuwany indeks.
+ */
+void prefixHashDelete(PrefixHash *hash);
+
+/** @brief Oznacza indeks jako nieaktualny.
+ * Wywoływana po zmianie drzewa forward, której nie opisują prefixHashAdd
+ * i prefixHashRemove, na przykład po przeniesieniu jego numerów. Nic nie
+ * robi, jeśli wskaźnik ma wartość NULL. Nie może być wywoływana jednocześnie
+ * z prefixHashFindForward.
+ * @param[in,out] hash – wskaźnik na indeks.
+ */
+void prefixHashInvalidate(PrefixHash *hash);
+
+/** @brief Nanosi na indeks dodane przekierowanie.
+ * Wywoływana po dodaniu przekierowania numeru @p num do drzewa @p root.
+ * Wstawia przekierowanie i znaczniki jego ścieżki, a znacznikom dłuższych
+ * prefiksów @p num przypisuje nowe przekierowanie, jeśli jest najdłuższym
+ * pasującym. Oznacza indeks jako nieaktualny, gdy nie ma tablicy długości
+ * @p num lub nie udało się alokować pamięci. Nic nie robi, jeśli wskaźnik
+ * @p hash ma wartość NULL lub indeks jest nieaktualny. Nie może być
+ * wywoływana jednocześnie z prefixHashFindForward.
+ * @param[in,out] hash – wskaźnik na indeks;
+ * @param[in] root     – wskaźnik na korzeń drzewa forward;
+ * @param[in] num      – wskaźnik na napis reprezentujący poprawny numer.
+ */
+void prefixHashAdd(PrefixHash *hash, TrieNode const *root, char const *num);
+
+/** @brief Usuwa z indeksu przekierowania z prefiksem.
+ * Wywoływana przed usunięciem z drzewa @p root przekierowań numerów
+ * zaczynających się od @p num. Usuwa ich elementy i znaczniki, których nie
+ * używa już żadne przekierowanie. Nic nie robi, jeśli wskaźnik @p hash ma
+ * wartość NULL lub indeks jest nieaktualny. Nie może być wywoływana
+ * jednocześnie z prefixHashFindForward.
+ * @param[in,out] hash – wskaźnik na indeks;
+ * @param[in] root     – wskaźnik na korzeń drzewa forward;
+ * @param[in] num      – wskaźnik na napis reprezentujący poprawny numer.
+ */
+void prefixHashRemove(PrefixHash *hash, TrieNode const *root, char const *num);
+
+/** @brief Zwraca przekierowanie numeru.
+ * Działa tak jak trieFindForward, ale wynik jest zawsze nowo alokowanym
+ * napisem. Jeśli indeks jest nieaktualny, buduje go z drzewa @p root. Może
+ * być wywoływana jednocześnie z wielu wątków, o ile drzewo nie jest
+ * zmieniane.
+ * @param[in,out] hash – wskaźnik na indeks;
+ * @param[in] root     – wskaźnik na korzeń drzewa forward;
+ * @param[in] num      – wskaźnik na napis reprezentujący poprawny numer.
+ * @return Wskaźnik na przekierowanie lub NULL, gdy nie udało się alokować
+ *         pamięci.
+ */
+char *prefixHashFindForward(PrefixHash *hash, TrieNode const *root, char const *num);
+
+#endif /* __PREFIX_HASH_H__ */
@@ -0,0 +1,85 @@
+/** @file
+ * Implementacja blokad fragmentów drzew przekierowań
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+#define _POSIX_C_SOURCE 200809L /**< Udostępnia blokady pthread_rwlock_t. */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "shard_lock.h"
+#include "trie.h"
+
+/**
+ * To jest struktura przechowująca blokady fragmentów drzew forward i reverse.
+ */
+struct ShardLocks {
+    pthread_rwlock_t forward[N]; /**< Blokady dzieci korzenia drzewa forward. */
+    pthread_rwlock_t reverse[N]; /**< Blokady dzieci korzenia drzewa reverse. */
+};
+
+ShardLocks *shardLocksNew(void) {
+    ShardLocks *locks = malloc(sizeof(struct ShardLocks));
+    if (!locks) return NULL;
+
+    for (int i = 0; i < N; ++i) {
+        if (pthread_rwlock_init(&(locks->forward[i]), NULL) != 0) {
+            for (int j = 0; j < i; ++j) {
+                pthread_rwlock_destroy(&(locks->forward[j]));
+                pthread_rwlock_destroy(&(locks->reverse[j]));
+            }
+            free(locks);
+            return NULL;
+        }
+        if (pthread_rwlock_init(&(locks->reverse[i]), NULL) != 0) {
+            pthread_rwlock_destroy(&(locks->forward[i]));
+            for (int j = 0; j < i; ++j) {
+                pthread_rwlock_destroy(&(locks->forward[j]));
+                pthread_rwlock_destroy(&(locks->reverse[j]));
+            }
+            free(locks);
+            return NULL;
+        }
+    }
+    return locks;
+}
+
+void shardLocksDelete(ShardLocks *locks) {
+    if (!locks) return;
+    for (int i = 0; i < N; ++i) {
+        pthread_rwlock_destroy(&(locks->forward[i]));
+        pthread_rwlock_destroy(&(locks->reverse[i]));
+    }
+    free(locks);
+}
+
+void shardLockForward(ShardLocks *locks, int shard, bool write) {
+    if (write)
+        pthread_rwlock_wrlock(&(locks->forward[shard]));
+    else
+        pthread_rwlock_rdlock(&(locks->forward[shard]));
+}
+
+void shardUnlockForward(ShardLocks *locks, int shard) {
+    pthread_rwlock_unlock(&(locks->forward[shard]));
+}
+
+void shardLockReverse(ShardLocks *locks, unsigned mask, bool write) {
+    for (int i = 0; i < N; ++i) {
+        if (!(mask & (1u << i)))
+            continue;
+        if (write)
+            pthread_rwlock_wrlock(&(locks->reverse[i]));
+        else
+            pthread_rwlock_rdlock(&(locks->reverse[i]));
+    }
+}
+
+void shardUnlockReverse(ShardLocks *locks, unsigned mask) {
+    for (int i = N - 1; i >= 0; --i) {
+        if (mask & (1u << i))
+            pthread_rwlock_unlock(&(locks->reverse[i]));
+    }
+}
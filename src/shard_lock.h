@@ -0,0 +1,66 @@
+/** @file
+ * Interfejs blokad fragmentów drzew przekierowań
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __SHARD_LOCK_H__
+#define __SHARD_LOCK_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * To jest struktura przechowująca blokady fragmentów drzew forward i reverse.
+ * Fragment wyznacza pierwsza cyfra numeru, czyli dziecko korzenia drzewa.
+ */
+struct ShardLocks;
+typedef struct ShardLocks ShardLocks;
+
+/** @brief Tworzy nową strukturę.
+ * Tworzy po jednej blokadzie typu czytelnicy-pisarze dla każdego dziecka
+ * korzenia drzewa forward i drzewa reverse.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+ShardLocks *shardLocksNew(void);
+
+/** @brief Usuwa strukturę.
+ * Usuwa strukturę wskazywaną przez @p locks. Nic nie robi, jeśli wskaźnik ten ma
+ * wartość NULL.
+ * @param[in] locks – wskaźnik na usuwaną strukturę.
+ */
+void shardLocksDelete(ShardLocks *locks);
+
+/** @brief Zajmuje blokadę fragmentu drzewa forward.
+ * @param[in,out] locks – wskaźnik na strukturę blokad;
+ * @param[in] shard     – indeks fragmentu;
+ * @param[in] write     – @p true dla blokady pisarza, @p false dla czytelnika.
+ */
+void shardLockForward(ShardLocks *locks, int shard, bool write);
+
+/** @brief Zwalnia blokadę fragmentu drzewa forward.
+ * @param[in,out] locks – wskaźnik na strukturę blokad;
+ * @param[in] shard     – indeks fragmentu.
+ */
+void shardUnlockForward(ShardLocks *locks, int shard);
+
+/** @brief Zajmuje blokady fragmentów drzewa reverse.
+ * Zajmuje blokady wszystkich fragmentów, których bity są ustawione w @p mask,
+ * w kolejności rosnących indeksów. Wątek trzymający blokady drzewa reverse
+ * nie może już zajmować blokad drzewa forward.
+ * @param[in,out] locks – wskaźnik na strukturę blokad;
+ * @param[in] mask      – maska bitowa indeksów fragmentów;
+ * @param[in] write     – @p true dla blokady pisarza, @p false dla czytelnika.
+ */
+void shardLockReverse(ShardLocks *locks, unsigned mask, bool write);
+
+/** @brief Zwalnia blokady fragmentów drzewa reverse.
+ * @param[in,out] locks – wskaźnik na strukturę blokad;
+ * @param[in] mask      – maska bitowa indeksów fragmentów.
+ */
+void shardUnlockReverse(ShardLocks *locks, unsigned mask);
+
+#endif /* __SHARD_LOCK_H__ */
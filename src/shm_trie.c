@@ -0,0 +1,782 @@
+/** @file
+ * Implementacja drzew przekierowań przechowywanych we współdzielonej pamięci
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+#define _POSIX_C_SOURCE 200809L /**< Udostępnia shm_open, mmap i ftruncate. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shm_trie.h"
+
+#define MAGIC "PFSM" /**< Nagłówek segmentu. */
+#define MAGIC_SIZE 4 /**< Długość nagłówka segmentu. */
+#define VERSION 1 /**< Wersja układu segmentu. */
+#define UNIT 8 /**< Jednostka przesunięć i rozmiarów bloków w bajtach. */
+#define SMALL_CLASSES 64 /**< Liczba klas bloków o rozmiarach od 1 do SMALL_CLASSES jednostek. */
+#define CLASSES (SMALL_CLASSES + 33) /**< Liczba klas bloków; większe bloki mają rozmiary
+                                          będące potęgami dwójki. */
+
+/** Przesunięcie bloku od początku segmentu w jednostkach @ref UNIT; 0 oznacza brak. */
+typedef uint32_t Offset;
+
+/**
+ * To jest struktura nagłówka leżącego na początku segmentu.
+ */
+typedef struct ShmHeader {
+    char magic[MAGIC_SIZE]; /**< Napis @ref MAGIC, zapisywany po utworzeniu drzew. */
+    uint32_t version; /**< Wersja układu segmentu. */
+    uint64_t size; /**< Rozmiar segmentu w bajtach. */
+    _Atomic uint64_t sequence; /**< Licznik zmian, nieparzysty w trakcie zmiany. */
+    uint64_t used; /**< Liczba zajętych jednostek. */
+    Offset forwardRoot; /**< Korzeń drzewa forward. */
+    Offset reverseRoot; /**< Korzeń drzewa reverse. */
+    Offset top; /**< Pierwsza jednostka, która nie była jeszcze przydzielona. */
+    Offset freeList[CLASSES]; /**< Listy zwolnionych bloków kolejnych klas. */
+} ShmHeader;
+
+/**
+ * To jest struktura wierzchołka drzewa forward w segmencie.
+ * Wierzchołki z przekierowaniem na ten sam numer tworzą dwukierunkową listę
+ * zaczepioną w wierzchołku tego numeru w drzewie reverse.
+ */
+typedef struct ShmForward {
+    Offset child[N]; /**< Dzieci wierzchołka. */
+    Offset forward; /**< Napis przekierowania lub 0. */
+    Offset reverse; /**< Wierzchołek numeru docelowego w drzewie reverse lub 0. */
+    Offset next; /**< Następny wierzchołek na liście wierzchołka reverse. */
+    Offset prev; /**< Poprzedni wierzchołek na liście wierzchołka reverse. */
+    Offset father; /**< Ojciec wierzchołka lub 0 dla korzenia. */
+    uint32_t depth; /**< Głębokość wierzchołka, czyli długość jego numeru. */
+    uint8_t position; /**< Indeks wierzchołka w tablicy dzieci ojca. */
+} ShmForward;
+
+/**
+ * To jest struktura wierzchołka drzewa reverse w segmencie.
+ */
+typedef struct ShmReverse {
+    Offset child[N]; /**< Dzieci wierzchołka. */
+    Offset list; /**< Pierwszy wierzchołek drzewa forward przekierowany na numer
+                      wierzchołka lub 0. */
+    Offset father; /**< Ojciec wierzchołka lub 0 dla korzenia. */
+    uint8_t position; /**< Indeks wierzchołka w tablicy dzieci ojca. */
+} ShmReverse;
+
+/**
+ * To jest struktura opisująca odwzorowanie segmentu w procesie.
+ */
+struct ShmTrie {
+    unsigned char *base; /**< Adres odwzorowania segmentu. */
+    size_t size; /**< Rozmiar segmentu w bajtach. */
+    Offset forwardRoot; /**< Korzeń drzewa forward. */
+    Offset reverseRoot; /**< Korzeń drzewa reverse. */
+    size_t maxNodes; /**< Największa liczba wierzchołków mieszczących się w segmencie,
+                          ograniczająca przejścia czytelników. */
+};
+
+/** @brief Zamienia rozmiar w bajtach na liczbę jednostek.
+ * @param[in] bytes - rozmiar w bajtach.
+ * @return Liczba jednostek zaokrąglona w górę.
+ */
+static size_t unitsOf(size_t bytes) {
+    return (bytes + UNIT - 1) / UNIT;
+}
+
+/** @brief Zwraca nagłówek segmentu.
+ * @param[in] shm - wskaźnik na strukturę.
+ * @return Wskaźnik na nagłówek.
+ */
+static ShmHeader *header(ShmTrie const *shm) {
+    return (ShmHeader *) shm->base;
+}
+
+/** @brief Zwraca adres bloku.
+ * Używana przez proces piszący, dla którego przesunięcia są zawsze poprawne.
+ * @param[in] shm - wskaźnik na strukturę;
+ * @param[in] off - przesunięcie bloku.
+ * @return Wskaźnik na blok.
+ */
+static void *at(ShmTrie const *shm, Offset off) {
+    return shm->base + (size_t) off * UNIT;
+}
+
+/** @brief Zwraca wierzchołek drzewa forward procesu piszącego.
+ * @param[in] shm - wskaźnik na strukturę;
+ * @param[in] off - przesunięcie wierzchołka.
+ * @return Wskaźnik na wierzchołek.
+ */
+static ShmForward *forwardAt(ShmTrie const *shm, Offset off) {
+    return at(shm, off);
+}
+
+/** @brief Zwraca wierzchołek drzewa reverse procesu piszącego.
+ * @param[in] shm - wskaźnik na strukturę;
+ * @param[in] off - przesunięcie wierzchołka.
+ * @return Wskaźnik na wierzchołek.
+ */
+static ShmReverse *reverseAt(ShmTrie const *shm, Offset off) {
+    return at(shm, off);
+}
+
+/** @brief Zwraca klasę bloku.
+ * @param[in,out] units - wskaźnik na rozmiar bloku w jednostkach, zaokrąglany
+ *                        do rozmiaru klasy.
+ * @return Indeks klasy.
+ */
+static size_t sizeClass(size_t *units) {
+    if (*units <= SMALL_CLASSES)
+        return *units - 1;
+    size_t cls = SMALL_CLASSES, rounded = 1;
+    while (rounded < *units) {
+        rounded *= 2;
+        ++cls;
+    }
+    *units = rounded;
+    return cls;
+}
+
+/** @brief Przydziela wyzerowany blok segmentu.
+ * Bierze blok z listy zwolnionych bloków klasy lub z końca zajętej części.
+ * @param[in,out] shm - wskaźnik na strukturę procesu piszącego;
+ * @param[in] units - rozmiar bloku w jednostkach.
+ * @return Przesunięcie bloku lub 0, gdy zabrakło miejsca w segmencie.
+ */
+static Offset allocate(ShmTrie *shm, size_t units) {
+    ShmHeader *h = header(shm);
+    size_t cls = sizeClass(&units);
+    Offset off = h->freeList[cls];
+    if (off) {
+        memcpy(&(h->freeList[cls]), at(shm, off), sizeof(Offset));
+    } else {
+        if (units > shm->size / UNIT - h->top)
+            return 0;
+        off = h->top;
+        h->top += (Offset) units;
+    }
+    memset(at(shm, off), 0, units * UNIT);
+    h->used += units;
+    return off;
+}
+
+/** @brief Zwalnia blok segmentu.
+ * @param[in,out] shm - wskaźnik na strukturę procesu piszącego;
+ * @param[in] off - przesunięcie bloku;
+ * @param[in] units - rozmiar bloku podany przy przydzieleniu.
+ */
+static void release(ShmTrie *shm, Offset off, size_t units) {
+    ShmHeader *h = header(shm);
+    size_t cls = sizeClass(&units);
+    memcpy(at(shm, off), &(h->freeList[cls]), sizeof(Offset));
+    h->freeList[cls] = off;
+    h->used -= units;
+}
+
+/** @brief Zwalnia napis segmentu.
+ * @param[in,out] shm - wskaźnik na strukturę procesu piszącego;
+ * @param[in] off - przesunięcie napisu.
+ */
+static void releaseString(ShmTrie *shm, Offset off) {
+    release(shm, off, unitsOf(strlen(at(shm, off)) + 1));
+}
+
+/** @brief Sprawdza czy wierzchołek ma dzieci.
+ * @param[in] child - tablica dzieci wierzchołka.
+ * @return Wartość @p true, jeśli któreś dziecko istnieje.
+ */
+static bool hasChildren(Offset const *child) {
+    for (int i = 0; i < N; ++i) {
+        if (child[i])
+            return true;
+    }
+    return false;
+}
+
+/** @brief Rozpoczyna zmianę segmentu.
+ * @param[in,out] shm - wskaźnik na strukturę procesu piszącego.
+ */
+static void writeBegin(ShmTrie *shm) {
+    ShmHeader *h = header(shm);
+    uint64_t seq = atomic_load_explicit(&(h->sequence), memory_order_relaxed);
+    atomic_store_explicit(&(h->sequence), seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+/** @brief Kończy zmianę segmentu.
+ * @param[in,out] shm - wskaźnik na strukturę procesu piszącego.
+ */
+static void writeEnd(ShmTrie *shm) {
+    ShmHeader *h = header(shm);
+    uint64_t seq = atomic_load_explicit(&(h->sequence), memory_order_relaxed);
+    atomic_store_explicit(&(h->sequence), seq + 1, memory_order_release);
+}
+
+/** @brief Rozpoczyna odczyt segmentu.
+ * Czeka, aż proces piszący skończy bieżącą zmianę.
+ * @param[in] shm - wskaźnik na strukturę.
+ * @return Wartość licznika zmian na początku odczytu.
+ */
+static uint64_t readBegin(ShmTrie const *shm) {
+    ShmHeader *h = header(shm);
+    uint64_t seq;
+    while ((seq = atomic_load_explicit(&(h->sequence), memory_order_acquire)) & 1)
+        sched_yield();
+    return seq;
+}
+
+/** @brief Sprawdza czy odczyt segmentu był spójny.
+ * @param[in] shm - wskaźnik na strukturę;
+ * @param[in] seq - wynik readBegin.
+ * @return Wartość @p true, jeśli w trakcie odczytu segment się nie zmienił.
+ */
+static bool readValid(ShmTrie const *shm, uint64_t seq) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&(header(shm)->sequence), memory_order_relaxed) == seq;
+}
+
+/** @brief Zwraca adres bloku odczytywanego przez czytelnika.
+ * @param[in] shm   - wskaźnik na strukturę;
+ * @param[in] off   - przesunięcie bloku;
+ * @param[in] bytes - liczba odczytywanych bajtów.
+ * @return Wskaźnik na blok lub NULL, gdy blok nie leży w segmencie.
+ */
+static void const *locate(ShmTrie const *shm, Offset off, size_t bytes) {
+    if (off == 0 || (uint64_t) off * UNIT + bytes > shm->size)
+        return NULL;
+    return shm->base + (size_t) off * UNIT;
+}
+
+/** @brief Kopiuje wierzchołek drzewa forward.
+ * @param[in] shm   - wskaźnik na strukturę;
+ * @param[in] off   - przesunięcie wierzchołka;
+ * @param[out] node - wskaźnik na kopię wierzchołka.
+ * @return Wartość @p false, jeśli wierzchołek nie leży w segmencie.
+ */
+static bool readForward(ShmTrie const *shm, Offset off, ShmForward *node) {
+    void const *ptr = locate(shm, off, sizeof(ShmForward));
+    if (ptr)
+        memcpy(node, ptr, sizeof(ShmForward));
+    return ptr != NULL;
+}
+
+/** @brief Kopiuje wierzchołek drzewa reverse.
+ * @param[in] shm   - wskaźnik na strukturę;
+ * @param[in] off   - przesunięcie wierzchołka;
+ * @param[out] node - wskaźnik na kopię wierzchołka.
+ * @return Wartość @p false, jeśli wierzchołek nie leży w segmencie.
+ */
+static bool readReverse(ShmTrie const *shm, Offset off, ShmReverse *node) {
+    void const *ptr = locate(shm, off, sizeof(ShmReverse));
+    if (ptr)
+        memcpy(node, ptr, sizeof(ShmReverse));
+    return ptr != NULL;
+}
+
+/** @brief Zwraca napis odczytywany przez czytelnika.
+ * @param[in] shm     - wskaźnik na strukturę;
+ * @param[in] off     - przesunięcie napisu;
+ * @param[out] length - wskaźnik na długość napisu.
+ * @return Wskaźnik na napis lub NULL, gdy napis nie kończy się w segmencie.
+ */
+static char const *readString(ShmTrie const *shm, Offset off, size_t *length) {
+    char const *str = locate(shm, off, 1);
+    if (!str)
+        return NULL;
+    size_t limit = shm->size - (size_t) off * UNIT;
+    *length = strnlen(str, limit);
+    return *length < limit ? str : NULL;
+}
+
+ShmTrie *shmTrieCreate(char const *name, size_t bytes) {
+    size_t forwardUnits = unitsOf(sizeof(ShmForward)), reverseUnits = unitsOf(sizeof(ShmReverse));
+    bytes -= bytes % UNIT;
+    if (!name || bytes < (unitsOf(sizeof(ShmHeader)) + forwardUnits + reverseUnits) * UNIT ||
+        bytes / UNIT > UINT32_MAX)
+        return NULL;
+    ShmTrie *shm = malloc(sizeof(ShmTrie));
+    if (!shm)
+        return NULL;
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        free(shm);
+        return NULL;
+    }
+    void *base = ftruncate(fd, (off_t) bytes) == 0
+                 ? mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (base == MAP_FAILED) {
+        shm_unlink(name);
+        free(shm);
+        return NULL;
+    }
+
+    shm->base = base;
+    shm->size = bytes;
+    shm->maxNodes = bytes / (forwardUnits * UNIT);
+    ShmHeader *h = header(shm);
+    h->version = VERSION;
+    h->size = bytes;
+    atomic_init(&(h->sequence), 0);
+    h->used = h->top = (Offset) unitsOf(sizeof(ShmHeader));
+    h->forwardRoot = shm->forwardRoot = allocate(shm, forwardUnits);
+    h->reverseRoot = shm->reverseRoot = allocate(shm, reverseUnits);
+    atomic_thread_fence(memory_order_release);
+    memcpy(h->magic, MAGIC, MAGIC_SIZE);
+    return shm;
+}
+
+ShmTrie *shmTrieOpen(char const *name) {
+    if (!name)
+        return NULL;
+    ShmTrie *shm = malloc(sizeof(ShmTrie));
+    if (!shm)
+        return NULL;
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    struct stat st;
+    size_t size = fd >= 0 && fstat(fd, &st) == 0 ? (size_t) st.st_size : 0;
+    void *base = size >= sizeof(ShmHeader) ? mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (fd >= 0)
+        close(fd);
+    if (base == MAP_FAILED) {
+        free(shm);
+        return NULL;
+    }
+
+    shm->base = base;
+    shm->size = size;
+    shm->maxNodes = size / (unitsOf(sizeof(ShmForward)) * UNIT);
+    ShmHeader const *h = header(shm);
+    bool valid = memcmp(h->magic, MAGIC, MAGIC_SIZE) == 0 && h->version == VERSION && h->size == size;
+    atomic_thread_fence(memory_order_acquire);
+    if (valid) {
+        shm->forwardRoot = h->forwardRoot;
+        shm->reverseRoot = h->reverseRoot;
+        valid = locate(shm, shm->forwardRoot, sizeof(ShmForward)) &&
+                locate(shm, shm->reverseRoot, sizeof(ShmReverse));
+    }
+    if (!valid) {
+        munmap(base, size);
+        free(shm);
+        return NULL;
+    }
+    return shm;
+}
+
+void shmTrieClose(ShmTrie *shm) {
+    if (shm) {
+        munmap(shm->base, shm->size);
+        free(shm);
+    }
+}
+
+bool shmTrieUnlink(char const *name) {
+    return name && shm_unlink(name) == 0;
+}
+
+/** @brief Usuwa martwą ścieżkę drzewa forward.
+ * Usuwa wierzchołki bez przekierowań i dzieci, idąc od @p off w górę.
+ * @param[in,out] shm - wskaźnik na strukturę procesu piszącego;
+ * @param[in] off - przesunięcie wierzchołka.
+ */
+static void pruneForward(ShmTrie *shm, Offset off) {
+    while (off != shm->forwardRoot) {
+        ShmForward *node = forwardAt(shm, off);
+        if (node->forward || hasChildren(node->child))
+            return;
+        Offset father = node->father;
+        forwardAt(shm, father)->child[node->position] = 0;
+        release(shm, off, unitsOf(sizeof(ShmForward)));
+        off = father;
+    }
+}
+
+/** @brief Usuwa martwą ścieżkę drzewa reverse.
+ * Usuwa wierzchołki bez listy i dzieci, idąc od @p off w górę.
+ * @param[in,out] shm - wskaźnik na strukturę procesu piszącego;
+ * @param[in] off  - przesunięcie wierzchołka;
+ * @param[in] keep - wierzchołek, który ma zostać zachowany, lub 0.
+ */
+static void pruneReverse(ShmTrie *shm, Offset off, Offset keep) {
+    while (off != shm->reverseRoot && off != keep) {
+        ShmReverse *node = reverseAt(shm, off);
+        if (node->list || hasChildren(node->child))
+            return;
+        Offset father = node->father;
+        reverseAt(shm, father)->child[node->position] = 0;
+        release(shm, off, unitsOf(sizeof(ShmReverse)));
+        off = father;
+    }
+}
+
+/** @brief Tworzy ścieżkę numeru w drzewie forward.
+ * @param[in,out] shm - wskaźnik na strukturę procesu piszącego;
+ * @param[in] num - wskaźnik na napis reprezentujący poprawny numer.
+ * @return Przesunięcie wierzchołka numeru lub 0, gdy zabrakło miejsca
+ *         w segmencie; wtedy utworzona część ścieżki jest usuwana.
+ */
+static Offset forwardPath(ShmTrie *shm, char const *num) {
+    Offset off = shm->forwardRoot;
+    for (size_t i = 0; num[i] != '\0'; ++i) {
+        int idx = trieIndex(num[i]);
+        Offset child = forwardAt(shm, off)->child[idx];
+        if (!child) {
+            child = allocate(shm, unitsOf(sizeof(ShmForward)));
+            if (!child) {
+                pruneForward(shm, off);
+                return 0;
+            }
+            ShmForward *node = forwardAt(shm, child);
+            node->father = off;
+            node->depth = (uint32_t) (i + 1);
+            node->position = (uint8_t) idx;
+            forwardAt(shm, off)->child[idx] = child;
+        }
+        off = child;
+    }
+    return off;
+}
+
+/** @brief Tworzy ścieżkę numeru w drzewie reverse.
+ * @param[in,out] shm - wskaźnik na strukturę procesu piszącego;
+ * @param[in] num - wskaźnik na napis reprezentujący poprawny numer.
+ * @return Przesunięcie wierzchołka numeru lub 0, gdy zabrakło miejsca
+ *         w segmencie; wtedy utworzona część ścieżki jest usuwana.
+ */
+static Offset reversePath(ShmTrie *shm, char const *num) {
+    Offset off = shm->reverseRoot;
+    for (size_t i = 0; num[i] != '\0'; ++i) {
+        int idx = trieIndex(num[i]);
+        Offset child = reverseAt(shm, off)->child[idx];
+        if (!child) {
+            child = allocate(shm, unitsOf(sizeof(ShmReverse)));
+            if (!child) {
+                pruneReverse(shm, off, 0);
+                return 0;
+            }
+            ShmReverse *node = reverseAt(shm, child);
+            node->father = off;
+            node->position = (uint8_t) idx;
+            reverseAt(shm, off)->child[idx] = child;
+        }
+        off = child;
+    }
+    return off;
+}
+
+/** @brief Usuwa przekierowanie wierzchołka.
+ * Zwalnia napis przekierowania, odłącza wierzchołek od listy wierzchołka
+ * reverse i usuwa martwą ścieżkę drzewa reverse.
+ * @param[in,out] shm - wskaźnik na strukturę procesu piszącego;
+ * @param[in] off  - przesunięcie wierzchołka z przekierowaniem;
+ * @param[in] keep - wierzchołek drzewa reverse, który ma zostać zachowany, lub 0.
+ */
+static void unlinkForward(ShmTrie *shm, Offset off, Offset keep) {
+    ShmForward *node = forwardAt(shm, off);
+    releaseString(shm, node->forward);
+    if (node->prev)
+        forwardAt(shm, node->prev)->next = node->next;
+    else
+        reverseAt(shm, node->reverse)->list = node->next;
+    if (node->next)
+        forwardAt(shm, node->next)->prev = node->prev;
+
+    Offset reverse = node->reverse;
+    node->forward = node->reverse = node->next = node->prev = 0;
+    pruneReverse(shm, reverse, keep);
+}
+
+bool shmTrieAdd(ShmTrie *shm, char const *num1, char const *num2) {
+    size_t length = strlen(num2);
+    writeBegin(shm);
+    Offset node = forwardPath(shm, num1);
+    Offset target = node ? reversePath(shm, num2) : 0;
+    Offset str = target ? allocate(shm, unitsOf(length + 1)) : 0;
+    if (!str) {
+        if (target)
+            pruneReverse(shm, target, 0);
+        if (node)
+            pruneForward(shm, node);
+        writeEnd(shm);
+        return false;
+    }
+
+    memcpy(at(shm, str), num2, length + 1);
+    if (forwardAt(shm, node)->forward)
+        unlinkForward(shm, node, target);
+    ShmForward *forward = forwardAt(shm, node);
+    ShmReverse *reverse = reverseAt(shm, target);
+    forward->forward = str;
+    forward->reverse = target;
+    forward->prev = 0;
+    forward->next = reverse->list;
+    if (reverse->list)
+        forwardAt(shm, reverse->list)->prev = node;
+    reverse->list = node;
+    writeEnd(shm);
+    return true;
+}
+
+bool shmTrieRemove(ShmTrie *shm, char const *num) {
+    Offset off = shm->forwardRoot;
+    for (size_t i = 0; off && num[i] != '\0'; ++i)
+        off = forwardAt(shm, off)->child[trieIndex(num[i])];
+    if (!off || off == shm->forwardRoot)
+        return false;
+
+    writeBegin(shm);
+    Offset top = off, father = forwardAt(shm, top)->father;
+    while (true) {
+        ShmForward *node = forwardAt(shm, off);
+        int idx = 0;
+        while (idx < N && !node->child[idx])
+            ++idx;
+        if (idx < N) {
+            off = node->child[idx];
+            continue;
+        }
+
+        if (node->forward)
+            unlinkForward(shm, off, 0);
+        Offset up = node->father;
+        forwardAt(shm, up)->child[node->position] = 0;
+        release(shm, off, unitsOf(sizeof(ShmForward)));
+        if (off == top)
+            break;
+        off = up;
+    }
+    pruneForward(shm, father);
+    writeEnd(shm);
+    return true;
+}
+
+/** @brief Wyznacza przekierowanie numeru bez sprawdzania spójności odczytu.
+ * @param[in] shm    - wskaźnik na strukturę;
+ * @param[in] num    - wskaźnik na napis reprezentujący poprawny numer;
+ * @param[in] length - długość numeru.
+ * @return Wskaźnik na przekierowanie lub NULL, gdy nie udało się alokować
+ *         pamięci lub odczytane dane są niepoprawne.
+ */
+static char *lookupForward(ShmTrie const *shm, char const *num, size_t length) {
+    ShmForward node;
+    Offset best = 0;
+    size_t bestLen = 0;
+    if (!readForward(shm, shm->forwardRoot, &node))
+        return NULL;
+    for (size_t i = 0; i < length; ++i) {
+        Offset child = node.child[trieIndex(num[i])];
+        if (!child)
+            break;
+        if (!readForward(shm, child, &node))
+            return NULL;
+        if (node.forward) {
+            best = node.forward;
+            bestLen = i + 1;
+        }
+    }
+
+    size_t prefix = 0;
+    char const *str = best ? readString(shm, best, &prefix) : "";
+    if (!str)
+        return NULL;
+    char *res = malloc((prefix + length - bestLen + 1) * sizeof(char));
+    if (!res)
+        return NULL;
+    memcpy(res, str, prefix);
+    strcpy(res + prefix, num + bestLen);
+    return res;
+}
+
+char *shmTrieFindForward(ShmTrie const *shm, char const *num) {
+    size_t length = strlen(num);
+    while (true) {
+        uint64_t seq = readBegin(shm);
+        char *res = lookupForward(shm, num, length);
+        if (readValid(shm, seq))
+            return res;
+        free(res);
+    }
+}
+
+/** @brief Dopisuje numer do tablicy wyników.
+ * @param[in,out] arr      - wskaźnik na tablicę numerów;
+ * @param[in,out] size     - wskaźnik na liczbę numerów;
+ * @param[in,out] capacity - wskaźnik na rozmiar tablicy;
+ * @param[in] num          - wskaźnik na numer, którego właścicielem staje się
+ *                           tablica, lub NULL.
+ * @return Wartość @p false, jeśli @p num ma wartość NULL lub nie udało się
+ *         alokować pamięci; wtedy numer jest zwalniany.
+ */
+static bool pushNumber(char ***arr, size_t *size, size_t *capacity, char *num) {
+    if (num && *size == *capacity) {
+        char **temp = realloc(*arr, 2 * *capacity * sizeof(char *));
+        if (temp) {
+            *arr = temp;
+            *capacity *= 2;
+        }
+    }
+    if (!num || *size == *capacity) {
+        free(num);
+        return false;
+    }
+    (*arr)[(*size)++] = num;
+    return true;
+}
+
+/** @brief Odtwarza numer wierzchołka drzewa forward i dopisuje do niego sufiks.
+ * @param[in] shm    - wskaźnik na strukturę;
+ * @param[in] node   - wskaźnik na kopię wierzchołka;
+ * @param[in] suffix - wskaźnik na dopisywany sufiks.
+ * @return Wskaźnik na nowo alokowany numer lub NULL, gdy nie udało się
+ *         alokować pamięci lub odczytane dane są niepoprawne.
+ */
+static char *sourceNumber(ShmTrie const *shm, ShmForward const *node, char const *suffix) {
+    size_t depth = node->depth;
+    if (depth == 0 || depth > shm->maxNodes)
+        return NULL;
+    char *res = malloc((depth + strlen(suffix) + 1) * sizeof(char));
+    if (!res)
+        return NULL;
+
+    ShmForward current = *node;
+    bool valid = true;
+    for (size_t i = depth; valid && i > 0; --i) {
+        valid = current.position < N;
+        if (valid)
+            res[i - 1] = trieSymbol(current.position);
+        if (valid && i > 1)
+            valid = readForward(shm, current.father, &current);
+        else if (valid)
+            valid = current.father == shm->forwardRoot;
+    }
+    if (!valid) {
+        free(res);
+        return NULL;
+    }
+    strcpy(res + depth, suffix);
+    return res;
+}
+
+/** @brief Zwalnia tablicę numerów.
+ * @param[in] arr  - tablica numerów lub NULL;
+ * @param[in] size - liczba numerów.
+ */
+static void freeNumbers(char **arr, size_t size) {
+    for (size_t i = 0; arr && i < size; ++i)
+        free(arr[i]);
+    free(arr);
+}
+
+/** @brief Wyznacza numery przekierowywane na numer bez sprawdzania spójności odczytu.
+ * @param[in] shm    - wskaźnik na strukturę;
+ * @param[in] num    - wskaźnik na napis reprezentujący poprawny numer;
+ * @param[in] length - długość numeru;
+ * @param[out] size  - wskaźnik na liczbę numerów.
+ * @return Nieposortowana tablica numerów razem z @p num lub NULL, gdy nie
+ *         udało się alokować pamięci lub odczytane dane są niepoprawne.
+ */
+static char **lookupReverse(ShmTrie const *shm, char const *num, size_t length, size_t *size) {
+    size_t capacity = 8;
+    char **arr = malloc(capacity * sizeof(char *));
+    char *copy = arr ? malloc((length + 1) * sizeof(char)) : NULL;
+    if (copy)
+        strcpy(copy, num);
+    *size = 0;
+    bool res = arr && pushNumber(&arr, size, &capacity, copy);
+
+    ShmReverse node;
+    res = res && readReverse(shm, shm->reverseRoot, &node);
+    for (size_t i = 0; res && i < length; ++i) {
+        Offset child = node.child[trieIndex(num[i])];
+        if (!child)
+            break;
+        res = readReverse(shm, child, &node);
+        Offset current = res ? node.list : 0;
+        for (size_t k = 0; res && current; ++k) {
+            ShmForward forward;
+            res = k < shm->maxNodes && readForward(shm, current, &forward) &&
+                  pushNumber(&arr, size, &capacity, sourceNumber(shm, &forward, num + i + 1));
+            current = res ? forward.next : 0;
+        }
+    }
+
+    if (!res) {
+        freeNumbers(arr, *size);
+        return NULL;
+    }
+    return arr;
+}
+
+char **shmTrieFindReverse(ShmTrie const *shm, char const *num, size_t *size) {
+    size_t length = strlen(num);
+    while (true) {
+        uint64_t seq = readBegin(shm);
+        size_t count = 0;
+        char **arr = lookupReverse(shm, num, length, &count);
+        if (readValid(shm, seq))
+            return arr ? uniqueNumbers(arr, count, size) : NULL;
+        freeNumbers(arr, count);
+    }
+}
+
+bool shmTrieForEach(ShmTrie const *shm, TrieVisit visit, void *ctx) {
+    size_t capacity = 16, depth = 0;
+    char *num = malloc(capacity * sizeof(char));
+    if (!num)
+        return false;
+
+    Offset off = shm->forwardRoot;
+    int from = 0;
+    bool res = true;
+    while (res) {
+        ShmForward const *node = forwardAt(shm, off);
+        int idx = from;
+        while (idx < N && !node->child[idx])
+            ++idx;
+        if (idx == N) {
+            if (off == shm->forwardRoot)
+                break;
+            from = node->position + 1;
+            off = node->father;
+            --depth;
+            continue;
+        }
+
+        if (depth + 2 > capacity) {
+            char *temp = realloc(num, 2 * capacity * sizeof(char));
+            res = temp != NULL;
+            if (!res)
+                break;
+            num = temp;
+            capacity *= 2;
+        }
+        num[depth++] = trieSymbol(idx);
+        num[depth] = '\0';
+        off = node->child[idx];
+        from = 0;
+        ShmForward const *child = forwardAt(shm, off);
+        if (child->forward)
+            res = visit(ctx, num, at(shm, child->forward));
+    }
+    free(num);
+    return res;
+}
+
+void shmTrieUsage(ShmTrie const *shm, size_t *used, size_t *size) {
+    uint64_t seq, units;
+    do {
+        seq = readBegin(shm);
+        units = header(shm)->used;
+    } while (!readValid(shm, seq));
+    *used = (size_t) units * UNIT;
+    *size = shm->size;
+}
@@ -0,0 +1,119 @@
+/** @file
+ * Interfejs drzew przekierowań przechowywanych we współdzielonej pamięci
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __SHM_TRIE_H__
+#define __SHM_TRIE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "trie.h"
+
+/**
+ * To jest struktura reprezentująca odwzorowany nazwany segment współdzielonej
+ * pamięci POSIX z drzewami forward i reverse. Wierzchołki i napisy leżą
+ * w segmencie i wskazują na siebie przesunięciami względem jego początku,
+ * więc segment może być odwzorowany pod różnymi adresami w wielu procesach.
+ * Segment zmienia jeden proces piszący, a pozostałe procesy tylko go czytają.
+ * Każda zmiana zwiększa licznik sekwencyjny w nagłówku segmentu przed i po
+ * modyfikacji drzew, a czytelnik powtarza zapytanie, jeśli w jego trakcie
+ * licznik był nieparzysty lub się zmienił.
+ */
+struct ShmTrie;
+typedef struct ShmTrie ShmTrie;
+
+/** @brief Tworzy segment z pustymi drzewami.
+ * Segment ma stały rozmiar; nie może już istnieć segment o tej nazwie.
+ * @param[in] name  – nazwa segmentu w postaci "/nazwa";
+ * @param[in] bytes – rozmiar segmentu w bajtach.
+ * @return Wskaźnik na strukturę procesu piszącego lub NULL, gdy nie udało się
+ *         utworzyć segmentu, rozmiar jest za mały lub za duży albo nie udało
+ *         się alokować pamięci.
+ */
+ShmTrie *shmTrieCreate(char const *name, size_t bytes);
+
+/** @brief Odwzorowuje istniejący segment do odczytu.
+ * @param[in] name – nazwa segmentu podana przy shmTrieCreate.
+ * @return Wskaźnik na strukturę czytelnika lub NULL, gdy segment nie istnieje,
+ *         ma niepoprawny format lub nie udało się alokować pamięci.
+ */
+ShmTrie *shmTrieOpen(char const *name);
+
+/** @brief Usuwa odwzorowanie segmentu.
+ * Segment istnieje dalej, dopóki nie zostanie usunięty przez shmTrieUnlink.
+ * Nic nie robi, jeśli wskaźnik ma wartość NULL.
+ * @param[in] shm – wskaźnik na strukturę.
+ */
+void shmTrieClose(ShmTrie *shm);
+
+/** @brief Usuwa nazwę segmentu.
+ * Procesy, które odwzorowały segment, mogą go dalej używać.
+ * @param[in] name – nazwa segmentu.
+ * @return Wartość @p false, jeśli segment nie istnieje.
+ */
+bool shmTrieUnlink(char const *name);
+
+/** @brief Dodaje przekierowanie.
+ * Zastępuje wcześniejsze przekierowanie numeru @p num1. Może być wywoływana
+ * tylko przez jeden wątek procesu, który utworzył segment.
+ * @param[in,out] shm – wskaźnik na strukturę procesu piszącego;
+ * @param[in] num1    – wskaźnik na napis reprezentujący poprawny numer;
+ * @param[in] num2    – wskaźnik na napis reprezentujący poprawny numer różny
+ *                      od @p num1.
+ * @return Wartość @p false, jeśli zabrakło miejsca w segmencie.
+ */
+bool shmTrieAdd(ShmTrie *shm, char const *num1, char const *num2);
+
+/** @brief Usuwa przekierowania numerów o danym prefiksie.
+ * Może być wywoływana tylko przez jeden wątek procesu, który utworzył segment.
+ * @param[in,out] shm – wskaźnik na strukturę procesu piszącego;
+ * @param[in] num     – wskaźnik na napis reprezentujący poprawny numer.
+ * @return Wartość @p true, jeśli w drzewie był wierzchołek numeru @p num.
+ */
+bool shmTrieRemove(ShmTrie *shm, char const *num);
+
+/** @brief Zwraca przekierowanie numeru.
+ * Działa tak jak trieFindForward, ale wynik jest zawsze nowo alokowanym
+ * napisem. Może być wywoływana jednocześnie z wielu wątków i procesów.
+ * @param[in] shm – wskaźnik na strukturę;
+ * @param[in] num – wskaźnik na napis reprezentujący poprawny numer.
+ * @return Wskaźnik na przekierowanie lub NULL, gdy nie udało się alokować
+ *         pamięci lub segment jest uszkodzony.
+ */
+char *shmTrieFindForward(ShmTrie const *shm, char const *num);
+
+/** @brief Zwraca numery przekierowywane na dany numer.
+ * Działa tak jak findReverseForwards. Może być wywoływana jednocześnie
+ * z wielu wątków i procesów.
+ * @param[in] shm   – wskaźnik na strukturę;
+ * @param[in] num   – wskaźnik na napis reprezentujący poprawny numer;
+ * @param[out] size – wskaźnik na rozmiar wynikowej tablicy.
+ * @return Posortowana tablica numerów bez powtórzeń lub NULL, gdy nie udało
+ *         się alokować pamięci lub segment jest uszkodzony.
+ */
+char **shmTrieFindReverse(ShmTrie const *shm, char const *num, size_t *size);
+
+/** @brief Wywołuje funkcję dla każdego przekierowania.
+ * Przekierowania są odwiedzane w porządku leksykograficznym numerów. Może
+ * być wywoływana tylko przez proces piszący.
+ * @param[in] shm   – wskaźnik na strukturę procesu piszącego;
+ * @param[in] visit – wywoływana funkcja;
+ * @param[in,out] ctx – wskaźnik przekazywany do funkcji @p visit.
+ * @return Wartość @p false, jeśli funkcja @p visit zwróciła @p false lub nie
+ *         udało się alokować pamięci.
+ */
+bool shmTrieForEach(ShmTrie const *shm, TrieVisit visit, void *ctx);
+
+/** @brief Zwraca zajętość segmentu.
+ * @param[in] shm   – wskaźnik na strukturę;
+ * @param[out] used – wskaźnik na liczbę bajtów zajętych przez nagłówek,
+ *                    wierzchołki i napisy;
+ * @param[out] size – wskaźnik na rozmiar segmentu w bajtach.
+ */
+void shmTrieUsage(ShmTrie const *shm, size_t *used, size_t *size);
+
+#endif /* __SHM_TRIE_H__ */
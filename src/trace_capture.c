@@ -0,0 +1,308 @@
+/** @file
+ * Implementacja zapisu i odczytu śladu wywołań operacji
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+#define _POSIX_C_SOURCE 200809L /**< Udostępnia open, clock_gettime i wątki. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include "trace_capture.h"
+
+#define MAGIC "PFT1" /**< Nagłówek pliku śladu. */
+#define MAGIC_SIZE 4 /**< Długość nagłówka pliku śladu. */
+#define FLUSH_SIZE (1 << 16) /**< Liczba bajtów bufora, po której jest on zapisywany. */
+#define PRELOAD_FLAG 0x80 /**< Bit bajtu operacji oznaczający rekord sprzed zapisu. */
+#define MAX_VARINT 10 /**< Największa długość liczby 64-bitowej w kodowaniu LEB128. */
+
+/**
+ * To jest struktura reprezentująca plik śladu otwarty do dopisywania.
+ */
+struct TraceCapture {
+    int fd; /**< Deskryptor pliku. */
+    unsigned char *buffer; /**< Bufor rekordów. */
+    size_t size; /**< Liczba bajtów w buforze. */
+    size_t capacity; /**< Rozmiar bufora. */
+    uint64_t last; /**< Czas poprzedniego rekordu w nanosekundach. */
+    bool failed; /**< Flaga mówiąca czy wystąpił błąd zapisu lub alokacji. */
+    pthread_mutex_t mutex; /**< Blokada dopisywania z wielu wątków. */
+};
+
+/** @brief Zwraca bieżący czas.
+ * @return Czas monotoniczny w nanosekundach.
+ */
+static uint64_t now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+/** @brief Zapisuje cały bufor do pliku.
+ * @param[in] fd - deskryptor pliku;
+ * @param[in] data - wskaźnik na dane;
+ * @param[in] size - liczba bajtów.
+ * @return Wartość @p false, jeśli wystąpił błąd zapisu.
+ */
+static bool writeAll(int fd, void const *data, size_t size) {
+    unsigned char const *ptr = data;
+    while (size > 0) {
+        ssize_t written = write(fd, ptr, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        ptr += written;
+        size -= (size_t) written;
+    }
+    return true;
+}
+
+/** @brief Zapisuje liczbę w kodowaniu LEB128.
+ * @param[out] dst - wskaźnik na co najmniej @ref MAX_VARINT bajtów;
+ * @param[in] value - zapisywana liczba.
+ * @return Liczba zapisanych bajtów.
+ */
+static size_t storeVarint(unsigned char *dst, uint64_t value) {
+    size_t size = 0;
+    do {
+        unsigned char byte = value & 0x7f;
+        value >>= 7;
+        dst[size++] = (unsigned char) (byte | (value ? 0x80 : 0));
+    } while (value);
+    return size;
+}
+
+/** @brief Odczytuje liczbę w kodowaniu LEB128.
+ * @param[in] data - wskaźnik na dane;
+ * @param[in] size - liczba dostępnych bajtów;
+ * @param[in,out] pos - wskaźnik na pozycję w danych, przesuwaną za liczbę;
+ * @param[out] value - wskaźnik na odczytaną liczbę.
+ * @return Wartość @p false, jeśli liczba jest niepełna lub za długa.
+ */
+static bool loadVarint(unsigned char const *data, size_t size, size_t *pos, uint64_t *value) {
+    *value = 0;
+    for (unsigned shift = 0; *pos < size && shift < 64; shift += 7) {
+        unsigned char byte = data[(*pos)++];
+        *value |= (uint64_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+/** @brief Dopisuje numer do bufora.
+ * Numer jest zapisywany jako jego długość powiększona o 1, a NULL jako 0.
+ * @param[in,out] dst - wskaźnik na bufor;
+ * @param[in] num - numer lub NULL;
+ * @param[in] length - długość numeru.
+ * @return Liczba zapisanych bajtów.
+ */
+static size_t storeNumber(unsigned char *dst, char const *num, size_t length) {
+    size_t size = storeVarint(dst, num ? length + 1 : 0);
+    if (num)
+        memcpy(dst + size, num, length);
+    return size + (num ? length : 0);
+}
+
+TraceCapture *traceCaptureOpen(char const *path) {
+    TraceCapture *capture = malloc(sizeof(TraceCapture));
+    if (!capture)
+        return NULL;
+    capture->capacity = 2 * FLUSH_SIZE;
+    capture->buffer = malloc(capture->capacity);
+    capture->fd = capture->buffer ? open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+    if (capture->fd < 0 || !writeAll(capture->fd, MAGIC, MAGIC_SIZE) ||
+        pthread_mutex_init(&(capture->mutex), NULL) != 0) {
+        if (capture->fd >= 0)
+            close(capture->fd);
+        free(capture->buffer);
+        free(capture);
+        return NULL;
+    }
+    capture->size = 0;
+    capture->last = now();
+    capture->failed = false;
+    return capture;
+}
+
+void traceCaptureRecord(TraceCapture *capture, int op, bool preload, char const *num1, char const *num2) {
+    size_t length1 = num1 ? strlen(num1) : 0, length2 = num2 ? strlen(num2) : 0;
+    size_t needed = 1 + 3 * MAX_VARINT + length1 + length2;
+
+    pthread_mutex_lock(&(capture->mutex));
+    if (capture->size + needed > capture->capacity) {
+        size_t capacity = capture->capacity;
+        while (capture->size + needed > capacity)
+            capacity *= 2;
+        unsigned char *temp = realloc(capture->buffer, capacity);
+        if (temp) {
+            capture->buffer = temp;
+            capture->capacity = capacity;
+        }
+    }
+
+    if (capture->size + needed > capture->capacity) {
+        capture->failed = true;
+    } else {
+        uint64_t time = now();
+        unsigned char *dst = capture->buffer + capture->size;
+        size_t size = 0;
+        dst[size++] = (unsigned char) (op | (preload ? PRELOAD_FLAG : 0));
+        size += storeVarint(dst + size, time - capture->last);
+        size += storeNumber(dst + size, num1, length1);
+        size += storeNumber(dst + size, num2, length2);
+        capture->size += size;
+        capture->last = time;
+    }
+
+    if (capture->size >= FLUSH_SIZE) {
+        if (!capture->failed && !writeAll(capture->fd, capture->buffer, capture->size))
+            capture->failed = true;
+        capture->size = 0;
+    }
+    pthread_mutex_unlock(&(capture->mutex));
+}
+
+bool traceCaptureClose(TraceCapture *capture) {
+    if (!capture)
+        return true;
+    bool res = !capture->failed && writeAll(capture->fd, capture->buffer, capture->size);
+    if (close(capture->fd) != 0)
+        res = false;
+    pthread_mutex_destroy(&(capture->mutex));
+    free(capture->buffer);
+    free(capture);
+    return res;
+}
+
+/** @brief Wczytuje cały plik.
+ * @param[in] path - ścieżka do pliku;
+ * @param[out] size - wskaźnik na liczbę wczytanych bajtów.
+ * @return Wskaźnik na zawartość pliku lub NULL, gdy nie udało się go
+ *         odczytać lub alokować pamięci.
+ */
+static unsigned char *readFile(char const *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+
+    size_t capacity = FLUSH_SIZE;
+    unsigned char *data = malloc(capacity);
+    *size = 0;
+    while (data) {
+        *size += fread(data + *size, 1, capacity - *size, file);
+        if (*size < capacity)
+            break;
+        capacity *= 2;
+        unsigned char *temp = realloc(data, capacity);
+        if (!temp)
+            free(data);
+        data = temp;
+    }
+    if (data && ferror(file)) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    return data;
+}
+
+/** @brief Odczytuje numer rekordu.
+ * @param[in] data - wskaźnik na dane;
+ * @param[in] size - liczba dostępnych bajtów;
+ * @param[in,out] pos - wskaźnik na pozycję w danych, przesuwaną za numer;
+ * @param[in,out] numbers - wskaźnik na ciąg, do którego jest dopisywany numer;
+ * @param[out] idx - wskaźnik na indeks numeru w ciągu lub SIZE_MAX dla NULL.
+ * @return Wartość 1, jeśli numer został odczytany, 0, jeśli jest niepełny,
+ *         lub -1, gdy nie udało się alokować pamięci.
+ */
+static int loadNumber(unsigned char const *data, size_t size, size_t *pos, NumberPack *numbers,
+                      size_t *idx) {
+    uint64_t length;
+    if (!loadVarint(data, size, pos, &length) || length > size - *pos + 1)
+        return 0;
+    *idx = SIZE_MAX;
+    if (length == 0)
+        return 1;
+    if (!numberPackAppend(numbers, (char const *) data + *pos, (size_t) length - 1, ""))
+        return -1;
+    *pos += (size_t) length - 1;
+    *idx = numbers->size - 1;
+    return 1;
+}
+
+bool traceLoad(char const *path, TraceRecords *records) {
+    size_t size;
+    unsigned char *data = readFile(path, &size);
+    if (!data)
+        return false;
+    if (size < MAGIC_SIZE || memcmp(data, MAGIC, MAGIC_SIZE) != 0) {
+        free(data);
+        return false;
+    }
+
+    records->record = NULL;
+    records->count = 0;
+    numberPackInit(&(records->numbers));
+    size_t capacity = 0, pos = MAGIC_SIZE, *index = NULL;
+    uint64_t time = 0;
+    bool res = true;
+    while (res && pos < size) {
+        if (records->count == capacity) {
+            capacity = capacity ? 2 * capacity : 1024;
+            TraceRecord *temp = realloc(records->record, capacity * sizeof(TraceRecord));
+            size_t *tempIndex = temp ? realloc(index, 2 * capacity * sizeof(size_t)) : NULL;
+            if (temp)
+                records->record = temp;
+            if (tempIndex)
+                index = tempIndex;
+            res = temp && tempIndex;
+            if (!res)
+                break;
+        }
+
+        TraceRecord *record = &(records->record[records->count]);
+        unsigned char op = data[pos++];
+        uint64_t delta;
+        if (!loadVarint(data, size, &pos, &delta))
+            break;
+        int first = loadNumber(data, size, &pos, &(records->numbers), &index[2 * records->count]);
+        int second = first > 0 ? loadNumber(data, size, &pos, &(records->numbers),
+                                            &index[2 * records->count + 1]) : first;
+        res = first >= 0 && second >= 0;
+        if (first <= 0 || second <= 0)
+            break;
+        time += delta;
+        record->op = op & ~PRELOAD_FLAG;
+        record->preload = (op & PRELOAD_FLAG) != 0;
+        record->time = time;
+        ++records->count;
+    }
+
+    for (size_t i = 0; res && i < records->count; ++i) {
+        size_t idx1 = index[2 * i], idx2 = index[2 * i + 1];
+        records->record[i].num1 = idx1 == SIZE_MAX ? NULL : numberPackGet(&(records->numbers), idx1);
+        records->record[i].num2 = idx2 == SIZE_MAX ? NULL : numberPackGet(&(records->numbers), idx2);
+    }
+    free(index);
+    free(data);
+    if (!res)
+        traceRecordsFree(records);
+    return res;
+}
+
+void traceRecordsFree(TraceRecords *records) {
+    free(records->record);
+    records->record = NULL;
+    records->count = 0;
+    numberPackFree(&(records->numbers));
+}
@@ -0,0 +1,90 @@
+/** @file
+ * Interfejs zapisu i odczytu śladu wywołań operacji
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __TRACE_CAPTURE_H__
+#define __TRACE_CAPTURE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "number_pack.h"
+
+/**
+ * To jest struktura reprezentująca plik śladu otwarty do dopisywania.
+ * Rekord śladu to bajt operacji, czas od poprzedniego rekordu w nanosekundach
+ * i numery operacji; liczby są zapisane w kodowaniu LEB128.
+ */
+struct TraceCapture;
+typedef struct TraceCapture TraceCapture;
+
+/**
+ * To jest struktura opisująca rekord odczytanego śladu.
+ */
+typedef struct TraceRecord {
+    int op; /**< Operacja, wartość typu PhfwdOp. */
+    bool preload; /**< Flaga mówiąca czy rekord opisuje przekierowanie
+                       istniejące przed rozpoczęciem zapisu. */
+    uint64_t time; /**< Czas od rozpoczęcia zapisu w nanosekundach. */
+    char const *num1; /**< Pierwszy numer operacji lub NULL. */
+    char const *num2; /**< Drugi numer operacji lub NULL. */
+} TraceRecord;
+
+/**
+ * To jest struktura przechowująca odczytany ślad.
+ */
+typedef struct TraceRecords {
+    TraceRecord *record; /**< Rekordy w kolejności zapisu. */
+    size_t count; /**< Liczba rekordów. */
+    NumberPack numbers; /**< Numery wskazywane przez rekordy. */
+} TraceRecords;
+
+/** @brief Tworzy plik śladu.
+ * Tworzy lub nadpisuje plik @p path.
+ * @param[in] path – ścieżka do pliku.
+ * @return Wskaźnik na strukturę lub NULL, gdy nie udało się utworzyć pliku
+ *         lub alokować pamięci.
+ */
+TraceCapture *traceCaptureOpen(char const *path);
+
+/** @brief Dopisuje rekord do śladu.
+ * Zapisuje czas wywołania. Może być wywoływana jednocześnie z wielu wątków;
+ * rekordy są zapisywane w kolejności zajęcia blokady. Błąd zapisu jest
+ * zgłaszany przez traceCaptureClose.
+ * @param[in,out] capture – wskaźnik na strukturę;
+ * @param[in] op          – operacja, wartość typu PhfwdOp;
+ * @param[in] preload     – flaga mówiąca czy rekord opisuje przekierowanie
+ *                          istniejące przed rozpoczęciem zapisu;
+ * @param[in] num1        – pierwszy numer operacji lub NULL;
+ * @param[in] num2        – drugi numer operacji lub NULL.
+ */
+void traceCaptureRecord(TraceCapture *capture, int op, bool preload, char const *num1, char const *num2);
+
+/** @brief Zamyka plik śladu.
+ * Zapisuje rekordy z bufora i zwalnia strukturę. Nic nie robi, jeśli
+ * wskaźnik ma wartość NULL.
+ * @param[in] capture – wskaźnik na strukturę.
+ * @return Wartość @p false, jeśli wystąpił błąd zapisu.
+ */
+bool traceCaptureClose(TraceCapture *capture);
+
+/** @brief Wczytuje ślad.
+ * Niepełny ostatni rekord, pozostawiony na przykład przez przerwany proces,
+ * jest pomijany.
+ * @param[in] path     – ścieżka do pliku śladu;
+ * @param[out] records – wskaźnik na wczytany ślad.
+ * @return Wartość @p false, jeśli nie udało się odczytać pliku, ma on
+ *         niepoprawny format lub nie udało się alokować pamięci.
+ */
+bool traceLoad(char const *path, TraceRecords *records);
+
+/** @brief Zwalnia wczytany ślad.
+ * @param[in,out] records – wskaźnik na ślad.
+ */
+void traceRecordsFree(TraceRecords *records);
+
+#endif /* __TRACE_CAPTURE_H__ */
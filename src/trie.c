@@ -8,36 +8,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
-#include "linked_list.h"
-
-#define N 12 /**< Ilość cyfr, służy do określenia ilości dzieci w drzewie. */
-
-typedef struct TrieNode TrieNode;
-/**
- * To jest struktura reprezentująca drzewo Trie.
- */
-struct TrieNode {
-    union {
-        char *forward;
-        Node *forwardsList;
-    } data; /**< Przekierowanie numeru telefonu.*/
-    TrieNode *child[N]; /**< Tablica dzieci. */
-    TrieNode *father; /**< Wskaźnik na ojca. */
-    TrieNode *reverseNode; /**< Wskaźnik na wierzchołek odpowiadający mu w drzewie reverseTrie. */
-    Node *ptrToList; /**< Wskaźnik na element w liście w drzewie reverseTrie. */
-    size_t lastIndex; /**< Indeks ostatniego usuniętego dziecka w funkcji remove. */
-    bool isReverse; /**< Flaga mówiąca czy drzewo jest typu reverse. */
-};
-
-/** @brief Zwraca czy wierzchołek przechowuje jakiekolwiek dane.
- * Funkcja zwraca czy parametr @p node ma jakieś dane.
- * @param[in] node - wskaźnik na wierzchołek.
- * @return Wartość @p true w przypadku gdy parametr @p node zawiera
- * jakieś informacje a wartość @p false w przeciwnym razie.
- */
-static bool checkData(TrieNode *node) {
-    return node->data.forwardsList || node->data.forward;
-}
+#include <stddef.h>
+#include "trie.h"
+#include "number_pack.h"
 
 /** @brief Zwraca indeks w tablicy dla chara.
  * Funkcja zwraca indeks w tablicy child dla parametru @p c.
@@ -59,12 +32,7 @@ static int findIndex(char c) {
  * @return Indeks odpowiadający którym dzieckiem jest parametr @p node dla swojego ojca.
  */
 static int findChildIndex(TrieNode *node) {
-    int idx = -1;
-    for (int i = 0; i < N; ++i) {
-        if (node->father->child[i] == node)
-            idx = i;
-    }
-    return idx;
+    return node->position;
 }
 
 /** @brief Sprawdza czy wierzchołek posiada jakieś dzieci.
@@ -81,99 +49,611 @@ static bool noChild(TrieNode *node) {
     return true;
 }
 
+/** @brief Sprawdza czy wierzchołek drzewa reverse posiada jakieś dzieci.
+ * @param[in] node - wskaźnik na wierzchołek.
+ * @return Wartość @p true w przypadku gdy @p node nie ma dzieci.
+ */
+static bool reverseNoChild(ReverseNode *node) {
+    for (int i = 0; i < N; ++i) {
+        if (node->child[i])
+            return false;
+    }
+    return true;
+}
+
+/** @brief Zwraca następny wierzchołek w kolejności preorder.
+ * Przechodzi do kolejnego wierzchołka poddrzewa o korzeniu @p top, korzystając
+ * jedynie ze wskaźników na ojca, więc nie modyfikuje drzewa.
+ * @param[in] node - wskaźnik na bieżący wierzchołek.
+ * @param[in] top - wskaźnik na korzeń przeglądanego poddrzewa.
+ * @return Wskaźnik na następny wierzchołek lub NULL, gdy poddrzewo zostało przejrzane.
+ */
+static TrieNode *nextPreorder(TrieNode *node, TrieNode const *top) {
+    for (int i = 0; i < N; ++i) {
+        if (node->child[i])
+            return node->child[i];
+    }
+    while (node != top && node->father) {
+        int idx = findChildIndex(node);
+        for (int i = idx + 1; i < N; ++i) {
+            if (node->father->child[i])
+                return node->father->child[i];
+        }
+        node = node->father;
+    }
+    return NULL;
+}
+
+int trieIndex(char c) {
+    return findIndex(c);
+}
+
+char trieSymbol(int index) {
+    return "0123456789*#"[index];
+}
+
+TrieNode *trieFind(TrieNode *const *root, char const *num) {
+    TrieNode *ptr = *root;
+    if (!ptr) return NULL;
+
+    for (size_t i = 0; num[i] != '\0'; ++i) {
+        ptr = ptr->child[findIndex(num[i])];
+        if (!ptr)
+            return NULL;
+    }
+    return ptr;
+}
+
+unsigned trieTargetShards(TrieNode *node) {
+    unsigned mask = 0;
+    for (TrieNode *ptr = node; ptr; ptr = nextPreorder(ptr, node)) {
+        if (ptr->forward)
+            mask |= 1u << findIndex(ptr->forward[0]);
+    }
+    return mask;
+}
+
+/** @brief Powiększa stos kursora.
+ * @param[in,out] cursor - wskaźnik na kursor.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool cursorGrow(TrieCursor *cursor) {
+    size_t capacity = 2 * cursor->capacity;
+    TrieNode const **stack = realloc(cursor->stack, capacity * sizeof(TrieNode const *));
+    if (!stack) return false;
+    cursor->stack = stack;
+
+    char *num = realloc(cursor->num, (cursor->prefix + capacity + 1) * sizeof(char));
+    if (!num) return false;
+    cursor->num = num;
+    cursor->capacity = capacity;
+    return true;
+}
+
+bool trieCursorInit(TrieCursor *cursor, TrieNode const *root, char const *prefix) {
+    size_t len = strlen(prefix);
+    cursor->prefix = len;
+    cursor->depth = 0;
+    cursor->capacity = 16;
+    cursor->stack = malloc(cursor->capacity * sizeof(TrieNode const *));
+    cursor->num = malloc((len + cursor->capacity + 1) * sizeof(char));
+    if (!cursor->stack || !cursor->num) {
+        trieCursorFree(cursor);
+        return false;
+    }
+
+    TrieNode const *ptr = root;
+    for (size_t i = 0; ptr && i < len; ++i)
+        ptr = ptr->child[findIndex(prefix[i])];
+    memcpy(cursor->num, prefix, len + 1);
+    cursor->stack[0] = ptr;
+    cursor->next = ptr ? (len > 0 && ptr->forward ? -1 : 0) : N;
+    return true;
+}
+
+bool trieCursorNext(TrieCursor *cursor, char const **num1, char const **num2) {
+    if (!cursor->stack)
+        return false;
+
+    TrieNode const *ptr = cursor->stack[cursor->depth];
+    if (cursor->next < 0) {
+        cursor->next = 0;
+        *num1 = cursor->num;
+        *num2 = ptr->forward;
+        return true;
+    }
+
+    int next = cursor->next;
+    while (true) {
+        while (next < N && !ptr->child[next])
+            ++next;
+
+        if (next < N) {
+            if (cursor->depth + 1 == cursor->capacity && !cursorGrow(cursor)) {
+                cursor->next = next;
+                return false;
+            }
+            char *end = cursor->num + cursor->prefix + cursor->depth;
+            end[0] = trieSymbol(next);
+            end[1] = '\0';
+            ptr = ptr->child[next];
+            cursor->stack[++cursor->depth] = ptr;
+            next = 0;
+            if (ptr->forward) {
+                cursor->next = 0;
+                *num1 = cursor->num;
+                *num2 = ptr->forward;
+                return true;
+            }
+        } else if (cursor->depth == 0) {
+            cursor->next = N;
+            return false;
+        } else {
+            char *end = cursor->num + cursor->prefix + --cursor->depth;
+            next = findIndex(end[0]) + 1;
+            end[0] = '\0';
+            ptr = cursor->stack[cursor->depth];
+        }
+    }
+}
+
+void trieCursorFree(TrieCursor *cursor) {
+    free(cursor->stack);
+    free(cursor->num);
+    cursor->stack = NULL;
+    cursor->num = NULL;
+}
+
+bool trieForEach(TrieNode const *root, TrieVisit visit, void *ctx) {
+    TrieCursor cursor;
+    if (!trieCursorInit(&cursor, root, ""))
+        return false;
+
+    char const *num1, *num2;
+    bool res = true;
+    while (res && trieCursorNext(&cursor, &num1, &num2))
+        res = visit(ctx, num1, num2);
+    if (res && cursor.next != N)
+        res = false;
+    trieCursorFree(&cursor);
+    return res;
+}
+
+/**
+ * To jest struktura reprezentująca blok pamięci z wierzchołkami drzew.
+ */
+struct TrieArena {
+    size_t size; /**< Rozmiar bloku w bajtach. */
+    max_align_t data[]; /**< Wierzchołki, elementy list i numery. */
+};
+
+/**
+ * To jest struktura opisująca rozmiar drzew przed kompaktowaniem.
+ */
+typedef struct CompactSize {
+    size_t nodes; /**< Liczba wierzchołków drzewa forward poza korzeniem. */
+    size_t reverseNodes; /**< Liczba wierzchołków drzewa reverse poza korzeniem. */
+    size_t cells; /**< Liczba elementów list drzewa reverse. */
+    size_t chars; /**< Łączna długość numerów razem ze znakami końca. */
+    size_t old; /**< Rozmiar wierzchołków, elementów i numerów spoza bloku. */
+} CompactSize;
+
+/**
+ * To jest struktura opisująca wolne miejsce w nowym bloku.
+ */
+typedef struct CompactState {
+    TrieNode *nodes; /**< Następny wolny wierzchołek drzewa forward. */
+    ReverseNode *reverseNodes; /**< Następny wolny wierzchołek drzewa reverse. */
+    Node *cells; /**< Następny wolny element listy. */
+    char *chars; /**< Następny wolny znak. */
+} CompactState;
+
+/** @brief Zlicza rozmiar drzewa forward.
+ * @param[in] root - wskaźnik na korzeń drzewa;
+ * @param[in,out] size - wskaźnik na zliczany rozmiar.
+ */
+static void compactCount(TrieNode *root, CompactSize *size) {
+    for (TrieNode *ptr = nextPreorder(root, root); ptr; ptr = nextPreorder(ptr, root)) {
+        ++size->nodes;
+        if (!ptr->inArena)
+            size->old += sizeof(TrieNode);
+        if (ptr->forward) {
+            size_t len = strlen(ptr->forward) + 1;
+            size->chars += len;
+            if (!ptr->dataInArena)
+                size->old += len;
+        }
+    }
+}
+
+/** @brief Zlicza rozmiar drzewa reverse.
+ * @param[in] root - wskaźnik na korzeń drzewa;
+ * @param[in,out] size - wskaźnik na zliczany rozmiar.
+ */
+static void compactCountReverse(ReverseNode *root, CompactSize *size) {
+    ReverseNode *ptr = root;
+    int next = 0;
+    while (true) {
+        while (next < N && !ptr->child[next])
+            ++next;
+
+        if (next < N) {
+            ptr = ptr->child[next];
+            next = 0;
+            ++size->reverseNodes;
+            if (!ptr->inArena)
+                size->old += sizeof(ReverseNode);
+            for (Node *cell = ptr->forwardsList; cell; cell = cell->next) {
+                size_t len = strlen(cell->data) + 1;
+                ++size->cells;
+                size->chars += len;
+                if (!cell->inArena)
+                    size->old += sizeof(Node) + len;
+            }
+        } else if (ptr == root) {
+            break;
+        } else {
+            next = ptr->position + 1;
+            ptr = ptr->father;
+        }
+    }
+}
+
+/** @brief Kopiuje numer do nowego bloku.
+ * @param[in,out] state - wskaźnik na wolne miejsce w bloku;
+ * @param[in] num - wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na kopię numeru.
+ */
+static char *compactNumber(CompactState *state, char const *num) {
+    size_t len = strlen(num) + 1;
+    char *res = memcpy(state->chars, num, len);
+    state->chars += len;
+    return res;
+}
+
+/** @brief Kopiuje drzewo reverse do nowego bloku.
+ * Przechodzi nowe drzewo w kolejności preorder, zastępując kolejne dzieci
+ * ich kopiami. Stary wierzchołek zapamiętuje swoją kopię w polu father,
+ * a stary element listy w polu prev; stare wierzchołki są łączone w listę
+ * przez pole child[0], bo ich dzieci nie są już potrzebne.
+ * @param[in,out] root - wskaźnik na korzeń drzewa;
+ * @param[in,out] state - wskaźnik na wolne miejsce w bloku.
+ * @return Lista starych wierzchołków.
+ */
+static ReverseNode *compactReverse(ReverseNode *root, CompactState *state) {
+    ReverseNode *old = NULL, *ptr = root;
+    int next = 0;
+    while (true) {
+        while (next < N && !ptr->child[next])
+            ++next;
+
+        if (next < N) {
+            ReverseNode *src = ptr->child[next], *dst = state->reverseNodes++;
+            *dst = *src;
+            dst->father = ptr;
+            dst->inArena = true;
+            Node *prev = NULL, **tail = &(dst->forwardsList);
+            for (Node *cell = src->forwardsList; cell; cell = cell->next) {
+                Node *copy = state->cells++;
+                copy->data = compactNumber(state, cell->data);
+                copy->prev = prev;
+                copy->next = NULL;
+                copy->inArena = true;
+                *tail = copy;
+                tail = &(copy->next);
+                prev = copy;
+                cell->prev = copy;
+            }
+            src->father = dst;
+            src->child[0] = old;
+            old = src;
+            ptr->child[next] = dst;
+            ptr = dst;
+            next = 0;
+        } else if (ptr == root) {
+            break;
+        } else {
+            next = ptr->position + 1;
+            ptr = ptr->father;
+        }
+    }
+    return old;
+}
+
+/** @brief Kopiuje drzewo forward do nowego bloku.
+ * Przechodzi nowe drzewo w kolejności preorder, zastępując kolejne dzieci
+ * ich kopiami, i od razu zwalnia stare wierzchołki. Kopie dostają wskaźniki
+ * reverseNode i ptrToList na kopie z drzewa reverse, które musi być
+ * skopiowane wcześniej przez compactReverse.
+ * @param[in,out] root - wskaźnik na korzeń drzewa;
+ * @param[in,out] state - wskaźnik na wolne miejsce w bloku.
+ */
+static void compactTree(TrieNode *root, CompactState *state) {
+    TrieNode *ptr = root;
+    int next = 0;
+    while (true) {
+        while (next < N && !ptr->child[next])
+            ++next;
+
+        if (next < N) {
+            TrieNode *src = ptr->child[next], *dst = state->nodes++;
+            *dst = *src;
+            dst->father = ptr;
+            dst->inArena = true;
+            if (src->forward) {
+                dst->forward = compactNumber(state, src->forward);
+                dst->dataInArena = true;
+                if (!src->dataInArena)
+                    free(src->forward);
+            }
+            if (src->reverseNode) {
+                dst->reverseNode = src->reverseNode->father;
+                dst->ptrToList = src->ptrToList->prev;
+            }
+            if (!src->inArena)
+                free(src);
+            ptr->child[next] = dst;
+            ptr = dst;
+            next = 0;
+        } else if (ptr == root) {
+            break;
+        } else {
+            next = ptr->position + 1;
+            ptr = ptr->father;
+        }
+    }
+}
+
+bool trieCompact(TrieNode *forwardRoot, ReverseNode *reverseRoot, TrieArena **arena, size_t *reclaimed) {
+    CompactSize size = {0, 0, 0, 0, *arena ? (*arena)->size : 0};
+    compactCount(forwardRoot, &size);
+    compactCountReverse(reverseRoot, &size);
+
+    size_t bytes = sizeof(TrieArena) + size.nodes * sizeof(TrieNode)
+                   + size.reverseNodes * sizeof(ReverseNode)
+                   + size.cells * sizeof(Node) + size.chars * sizeof(char);
+    TrieArena *fresh = malloc(bytes);
+    if (!fresh) return false;
+    fresh->size = bytes;
+
+    CompactState state;
+    state.nodes = (TrieNode *) fresh->data;
+    state.reverseNodes = (ReverseNode *) (state.nodes + size.nodes);
+    state.cells = (Node *) (state.reverseNodes + size.reverseNodes);
+    state.chars = (char *) (state.cells + size.cells);
+
+    ReverseNode *old = compactReverse(reverseRoot, &state);
+    compactTree(forwardRoot, &state);
+    while (old) {
+        ReverseNode *temp = old->child[0];
+        for (Node *cell = old->forwardsList; cell; ) {
+            Node *nextCell = cell->next;
+            if (!cell->inArena) {
+                free(cell->data);
+                free(cell);
+            }
+            cell = nextCell;
+        }
+        if (!old->inArena)
+            free(old);
+        old = temp;
+    }
+
+    trieArenaFree(*arena);
+    *arena = fresh;
+    *reclaimed = size.old > bytes ? size.old - bytes : 0;
+    return true;
+}
+
+void trieArenaFree(TrieArena *arena) {
+    free(arena);
+}
+
 void deletePath(TrieNode *root) {
     TrieNode *ptr = root;
     if (!ptr) return;
 
-    while (ptr->father && !checkData(ptr) && noChild(ptr)) {
+    while (ptr->father && !ptr->forward && noChild(ptr)) {
         int position = findChildIndex(ptr);
         TrieNode *temp = ptr->father;
         ptr->father = NULL;
-        free(ptr);
+        if (!ptr->inArena)
+            free(ptr);
+        temp->child[position] = NULL;
+        ptr = temp;
+    }
+}
+
+void reverseDeletePath(ReverseNode *node) {
+    ReverseNode *ptr = node;
+    if (!ptr) return;
+
+    while (ptr->father && !ptr->forwardsList && reverseNoChild(ptr)) {
+        int position = ptr->position;
+        ReverseNode *temp = ptr->father;
+        ptr->father = NULL;
+        if (!ptr->inArena)
+            free(ptr);
         temp->child[position] = NULL;
         ptr = temp;
     }
 }
 
+void trieUnlinkReverse(TrieNode *node) {
+    if (node->reverseNode) {
+        deleteNode(&(node->reverseNode->forwardsList), node->ptrToList);
+        reverseDeletePath(node->reverseNode);
+        node->reverseNode = NULL;
+        node->ptrToList = NULL;
+    }
+}
+
 void freeData(TrieNode *node) {
     if (!node)
         return;
-    if (!node->isReverse) {
-        if (node->reverseNode) {
-            deleteNode(&(node->reverseNode->data.forwardsList), node->ptrToList);
-            deletePath(node->reverseNode);
-            node->reverseNode = NULL;
-            node->ptrToList = NULL;
-        }
-        if (node->data.forward) {
-            free(node->data.forward);
-            node->data.forward = NULL;
-        }
+    trieUnlinkReverse(node);
+    if (node->forward) {
+        if (!node->dataInArena)
+            free(node->forward);
+        node->forward = NULL;
+        node->dataInArena = false;
     }
 }
 
-TrieNode *trieNew(bool isReverse) {
+TrieNode *trieNew(void) {
     TrieNode *trieNode = malloc(sizeof(struct TrieNode));
 
     if (trieNode) {
         for (size_t i = 0; i < N; ++i)
             trieNode->child[i] = NULL;
+        trieNode->forward = NULL;
         trieNode->father = NULL;
-        trieNode->lastIndex = 0;
-        trieNode->isReverse = isReverse;
-        if (isReverse)
-            trieNode->data.forwardsList = NULL;
-        else
-            trieNode->data.forward = NULL;
         trieNode->reverseNode = NULL;
+        trieNode->ptrToList = NULL;
+        trieNode->position = 0;
+        trieNode->inArena = false;
+        trieNode->dataInArena = false;
     }
 
     return trieNode;
 }
 
+ReverseNode *reverseTrieNew(void) {
+    ReverseNode *reverseNode = malloc(sizeof(struct ReverseNode));
+
+    if (reverseNode) {
+        for (size_t i = 0; i < N; ++i)
+            reverseNode->child[i] = NULL;
+        reverseNode->forwardsList = NULL;
+        reverseNode->father = NULL;
+        reverseNode->position = 0;
+        reverseNode->inArena = false;
+    }
+
+    return reverseNode;
+}
+
 void trieDelete(TrieNode **root) {
-    TrieNode *ptr = *root;
+    TrieNode *top = *root, *ptr = top;
+    int next = 0;
     while (ptr) {
-        for (size_t i = ptr->lastIndex; i < N; ++i) {
-            if (ptr->child[i]) {
-                ptr->lastIndex = i;
-                break;
-            }
+        while (next < N && !ptr->child[next])
+            ++next;
+
+        if (next < N) {
+            ptr = ptr->child[next];
+            next = 0;
+        } else if (ptr == top) {
+            break;
+        } else {
+            TrieNode *father = ptr->father;
+            next = ptr->position + 1;
+            father->child[ptr->position] = NULL;
+            freeData(ptr);
+            if (!ptr->inArena)
+                free(ptr);
+            ptr = father;
         }
-        if (!ptr->child[ptr->lastIndex]) {
-            if (!ptr->father)
-                break;
-            ptr = ptr->father;
-            freeData(ptr->child[ptr->lastIndex]);
-            free(ptr->child[ptr->lastIndex]);
-            ptr->child[ptr->lastIndex] = NULL;
-        } else
-            ptr = ptr->child[ptr->lastIndex];
-    }
-    freeData(*root);
-    free(*root);
+    }
+    freeData(top);
+    if (top && !top->inArena)
+        free(top);
     *root = NULL;
 }
 
-
-TrieNode *trieAdd(TrieNode **root, char const *num) {
+TrieNode *triePath(TrieNode **root, char const *num) {
     TrieNode *ptr = *root;
 
     int position;
     for (size_t i = 0; num[i] != '\0'; ++i) {
         position = findIndex(num[i]);
         if (!ptr->child[position]) {
-            ptr->child[position] = trieNew(ptr->isReverse);
-            if (!ptr->child[position]) return false;
+            ptr->child[position] = trieNew();
+            if (!ptr->child[position]) return NULL;
             ptr->child[position]->father = ptr;
+            ptr->child[position]->position = (unsigned char) position;
         }
         ptr = ptr->child[position];
     }
+    return ptr;
+}
+
+TrieNode *trieAdd(TrieNode **root, char const *num) {
+    TrieNode *ptr = triePath(root, num);
     freeData(ptr);
+    return ptr;
+}
+
+ReverseNode *reverseTrieAdd(ReverseNode **root, char const *num) {
+    ReverseNode *ptr = *root;
 
+    int position;
+    for (size_t i = 0; num[i] != '\0'; ++i) {
+        position = findIndex(num[i]);
+        if (!ptr->child[position]) {
+            ptr->child[position] = reverseTrieNew();
+            if (!ptr->child[position]) return NULL;
+            ptr->child[position]->father = ptr;
+            ptr->child[position]->position = (unsigned char) position;
+        }
+        ptr = ptr->child[position];
+    }
     return ptr;
 }
 
+/**
+ * To jest struktura przekazywana funkcjom budującym drzewo reverse.
+ */
+typedef struct ReverseBuild {
+    TrieNode *forwardRoot; /**< Korzeń drzewa forward. */
+    ReverseNode *reverseRoot; /**< Korzeń budowanego drzewa reverse. */
+} ReverseBuild;
+
+/** @brief Dodaje przekierowanie do drzewa reverse.
+ * Funkcja typu TrieVisit.
+ * @param[in,out] ctx - wskaźnik na strukturę ReverseBuild;
+ * @param[in] num1 - wskaźnik na numer przekierowywany;
+ * @param[in] num2 - wskaźnik na numer docelowy.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool linkReverse(void *ctx, char const *num1, char const *num2) {
+    ReverseBuild *build = ctx;
+    TrieNode *node = trieFind(&(build->forwardRoot), num1);
+    ReverseNode *reverseNode = reverseTrieAdd(&(build->reverseRoot), num2);
+    if (!reverseNode)
+        return false;
+
+    node->ptrToList = push(&(reverseNode->forwardsList), num1);
+    if (!node->ptrToList) {
+        reverseDeletePath(reverseNode);
+        return false;
+    }
+    node->reverseNode = reverseNode;
+    return true;
+}
+
+/** @brief Odłącza przekierowanie od drzewa reverse.
+ * Funkcja typu TrieVisit.
+ * @param[in,out] ctx - wskaźnik na strukturę ReverseBuild;
+ * @param[in] num1 - wskaźnik na numer przekierowywany;
+ * @param[in] num2 - wskaźnik na numer docelowy.
+ * @return Wartość @p true.
+ */
+static bool unlinkReverse(void *ctx, char const *num1, char const *num2) {
+    (void) num2;
+    ReverseBuild *build = ctx;
+    trieUnlinkReverse(trieFind(&(build->forwardRoot), num1));
+    return true;
+}
+
+bool trieBuildReverse(TrieNode *forwardRoot, ReverseNode *reverseRoot) {
+    ReverseBuild build = {forwardRoot, reverseRoot};
+    if (trieForEach(forwardRoot, linkReverse, &build))
+        return true;
+    trieForEach(forwardRoot, unlinkReverse, &build);
+    return false;
+}
+
 void trieRemove(TrieNode **root, char const *num) {
     TrieNode *ptr = *root;
 
@@ -194,19 +674,50 @@ void trieRemove(TrieNode **root, char const *num) {
     deletePath(temp);
 }
 
+/** @brief Porównuje numery.
+ * Porównuje leksykograficznie numery wskazywane przez @p a i @p b, przyjmując
+ * kolejność cyfr taką jak w tablicy child.
+ * @param[in] a - wskaźnik na wskaźnik na pierwszy numer.
+ * @param[in] b - wskaźnik na wskaźnik na drugi numer.
+ * @return Liczba ujemna, zero lub dodatnia, gdy pierwszy numer jest
+ * odpowiednio mniejszy, równy lub większy od drugiego.
+ */
+static int comparator(const void *a, const void *b) {
+    char *num1 = *(char **) a;
+    char *num2 = *(char **) b;
+    size_t pos = 0;
+
+    while (true) {
+        if (num1[pos] == '\0' && num2[pos] == '\0')
+            return 0;
+        else if (num1[pos] == '\0')
+            return -1;
+        else if (num2[pos] == '\0')
+            return 1;
+        else if (num1[pos] == num2[pos])
+            pos++;
+        else
+            return findIndex(num1[pos]) - findIndex(num2[pos]);
+    }
+}
+
 char *trieFindForward(TrieNode *const *root, char const *num) {
-    TrieNode *ptr = *root;
-    if (!ptr) return NULL;
-    TrieNode *res = NULL;
+    if (!*root) return NULL;
+    return trieFindForwardFrom(*root, num, 0, NULL, 0);
+}
+
+char *trieFindForwardFrom(TrieNode const *node, char const *num, size_t depth,
+                          TrieNode const *best, size_t bestLen) {
+    TrieNode const *ptr = node, *res = best;
 
     int position;
-    size_t len = 0;
-    for (size_t i = 0; num[i] != '\0'; ++i) {
+    size_t len = bestLen;
+    for (size_t i = depth; num[i] != '\0'; ++i) {
         position = findIndex(num[i]);
         if (!ptr->child[position])
             break;
         ptr = ptr->child[position];
-        if (checkData(ptr)) {
+        if (ptr->forward) {
             res = ptr;
             len = i + 1;
         }
@@ -214,12 +725,12 @@ char *trieFindForward(TrieNode *const *root, char const *num) {
 
     if (res) {
         size_t size1 = strlen(num);
-        size_t size2 = strlen(res->data.forward);
+        size_t size2 = strlen(res->forward);
         char *info = malloc((size1 - len + size2 + 1) * sizeof(char));
         if (!info)
             return NULL;
         for (size_t i = 0; i < size2; ++i)
-            info[i] = res->data.forward[i];
+            info[i] = res->forward[i];
         for (size_t i = len; i <= size1; ++i)
             info[i - len + size2] = num[i];
         return info;
@@ -227,24 +738,118 @@ char *trieFindForward(TrieNode *const *root, char const *num) {
     return (char *) num;
 }
 
+size_t trieMatch(TrieNode *const *root, char const *num) {
+    TrieNode const *ptr = *root;
+    size_t len = 0;
+    while (ptr && num[len] != '\0') {
+        ptr = ptr->child[findIndex(num[len])];
+        if (ptr)
+            ++len;
+    }
+    return len;
+}
 
-static int comparator(const void *a, const void *b) {
-    char *num1 = *(char **) a;
-    char *num2 = *(char **) b;
-    size_t pos = 0;
+char **uniqueNumbers(char **arr, size_t size, size_t *pnumSize) {
+    qsort(arr, size, sizeof(char *), comparator);
 
-    while (true) {
-        if (num1[pos] == '\0' && num2[pos] == '\0')
-            return 0;
-        else if (num1[pos] == '\0')
-            return -1;
-        else if (num2[pos] == '\0')
-            return 1;
-        else if (num1[pos] == num2[pos])
-            pos++;
+    size_t idx = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (idx > 0 && strcmp(arr[i], arr[idx - 1]) == 0)
+            free(arr[i]);
         else
-            return findIndex(num1[pos]) - findIndex(num2[pos]);
+            arr[idx++] = arr[i];
+    }
+
+    *pnumSize = idx;
+    return arr;
+}
+
+/**
+ * To jest struktura opisująca numer w zapytaniu wsadowym.
+ */
+typedef struct BatchItem {
+    char const *num; /**< Numer, musi być pierwszym polem dla funkcji comparator. */
+    size_t idx; /**< Pozycja numeru w zapytaniu. */
+} BatchItem;
+
+/** @brief Tworzy przekierowany numer.
+ * Zastępuje prefiks długości @p len numeru @p num przekierowaniem wierzchołka
+ * @p res lub kopiuje numer, gdy @p res ma wartość NULL.
+ * @param[in] res - wskaźnik na wierzchołek z przekierowaniem lub NULL;
+ * @param[in] len - długość prefiksu;
+ * @param[in] num - wskaźnik na numer.
+ * @return Wskaźnik na nowy napis lub NULL, gdy nie udało się alokować pamięci.
+ */
+static char *forwardNumber(TrieNode const *res, size_t len, char const *num) {
+    char const *prefix = res ? res->forward : "";
+    size_t size1 = strlen(num), size2 = strlen(prefix);
+    char *info = malloc((size1 - len + size2 + 1) * sizeof(char));
+    if (!info)
+        return NULL;
+    memcpy(info, prefix, size2);
+    memcpy(info + size2, num + len, size1 - len + 1);
+    return info;
+}
+
+bool trieFindForwardBatch(TrieNode *const *root, char const *const *nums, size_t count, char **results) {
+    size_t maxLen = 0;
+    for (size_t i = 0; i < count; ++i) {
+        results[i] = NULL;
+        size_t len = strlen(nums[i]);
+        if (len > maxLen)
+            maxLen = len;
+    }
+
+    BatchItem *items = malloc((count ? count : 1) * sizeof(BatchItem));
+    TrieNode **path = malloc((maxLen + 1) * sizeof(TrieNode *));
+    TrieNode **best = malloc((maxLen + 1) * sizeof(TrieNode *));
+    size_t *bestLen = malloc((maxLen + 1) * sizeof(size_t));
+    bool res = items && path && best && bestLen;
+
+    if (res) {
+        for (size_t i = 0; i < count; ++i) {
+            items[i].num = nums[i];
+            items[i].idx = i;
+        }
+        qsort(items, count, sizeof(BatchItem), comparator);
+
+        path[0] = *root;
+        best[0] = NULL;
+        bestLen[0] = 0;
+        size_t depth = 0;
+        char const *prev = "";
+        for (size_t k = 0; res && k < count; ++k) {
+            char const *num = items[k].num;
+            size_t common = 0;
+            while (common < depth && prev[common] == num[common])
+                ++common;
+
+            for (depth = common; num[depth] != '\0'; ++depth) {
+                TrieNode *next = path[depth]->child[findIndex(num[depth])];
+                if (!next)
+                    break;
+                path[depth + 1] = next;
+                best[depth + 1] = next->forward ? next : best[depth];
+                bestLen[depth + 1] = next->forward ? depth + 1 : bestLen[depth];
+            }
+
+            results[items[k].idx] = forwardNumber(best[depth], bestLen[depth], num);
+            res = results[items[k].idx] != NULL;
+            prev = num;
+        }
+    }
+
+    if (!res) {
+        for (size_t i = 0; i < count; ++i) {
+            free(results[i]);
+            results[i] = NULL;
+        }
     }
+    free(items);
+    free(path);
+    free(best);
+    free(bestLen);
+    return res;
 }
 
 /** @brief Liczy rozmiar tablicy reverse.
@@ -255,8 +860,8 @@ static int comparator(const void *a, const void *b) {
  * @return Wartość ile numerów jest przekierowywanych na @p num,
  * według definicji reverse.
  */
-static size_t countSize(TrieNode *const *root, char const *num) {
-    TrieNode *ptr = *root;
+static size_t countSize(ReverseNode *const *root, char const *num) {
+    ReverseNode *ptr = *root;
 
     int position;
     size_t size = 1;
@@ -265,13 +870,13 @@ static size_t countSize(TrieNode *const *root, char const *num) {
         if (!ptr->child[position])
             break;
         ptr = ptr->child[position];
-        size += listSize(ptr->data.forwardsList);
+        size += listSize(ptr->forwardsList);
     }
     return size;
 }
 
-char **findReverseForwards(TrieNode *const *node, char const *num, size_t *pnumSize) {
-    TrieNode *ptr = *node;
+char **findReverseForwards(ReverseNode *const *node, char const *num, size_t *pnumSize) {
+    ReverseNode *ptr = *node;
     if (!ptr) return NULL;
 
     size_t size = countSize(node, num), numLength = strlen(num);
@@ -295,8 +900,8 @@ char **findReverseForwards(TrieNode *const *node, char const *num, size_t *pnumS
             break;
 
         ptr = ptr->child[position];
-        if (ptr->data.forwardsList) {
-            Node *head = ptr->data.forwardsList;
+        if (ptr->forwardsList) {
+            Node *head = ptr->forwardsList;
             while (head) {
                 size_t tempLen = strlen(head->data);
                 arr[idx] = malloc((tempLen + numLength - i) * sizeof(char));
@@ -319,48 +924,136 @@ char **findReverseForwards(TrieNode *const *node, char const *num, size_t *pnumS
         }
     }
 
-    qsort(arr, size, sizeof(char *), comparator);
+    return uniqueNumbers(arr, size, pnumSize);
+}
 
-    size_t repeats = 0;
-    for (size_t i = 1; i < size; ++i) {
-        if (strcmp(arr[i], arr[i - 1]) == 0)
-            ++repeats;
-    }
+/**
+ * To jest struktura przechowująca źródła przekierowań zebrane na ścieżce
+ * w drzewie reverse, wspólne dla numerów o wspólnym prefiksie.
+ */
+typedef struct ReverseSources {
+    Node const **node; /**< Elementy list wierzchołków ścieżki. */
+    size_t *depth; /**< Głębokości wierzchołków, z których pochodzą elementy. */
+    size_t size; /**< Liczba zebranych elementów. */
+    size_t capacity; /**< Rozmiar tablic. */
+} ReverseSources;
 
-    *pnumSize = size - repeats;
-    char **result = (char **) malloc(*pnumSize * sizeof(char *));
+/** @brief Dodaje listę wierzchołka do źródeł.
+ * @param[in,out] sources - wskaźnik na źródła;
+ * @param[in] head - wskaźnik na początek listy wierzchołka;
+ * @param[in] depth - głębokość wierzchołka.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool pushSources(ReverseSources *sources, Node const *head, size_t depth) {
+    for (; head; head = head->next) {
+        if (sources->size == sources->capacity) {
+            size_t capacity = sources->capacity ? 2 * sources->capacity : 16;
+            Node const **node = realloc(sources->node, capacity * sizeof(Node const *));
+            if (!node) return false;
+            sources->node = node;
+            size_t *depths = realloc(sources->depth, capacity * sizeof(size_t));
+            if (!depths) return false;
+            sources->depth = depths;
+            sources->capacity = capacity;
+        }
+        sources->node[sources->size] = head;
+        sources->depth[sources->size++] = depth;
+    }
+    return true;
+}
 
-    if (!result) {
-        for (size_t j = 0; j < size; ++j)
-            free(arr[j]);
-        free(arr);
-        return NULL;
+/** @brief Sortuje i usuwa powtórzenia końcowych numerów ciągu.
+ * Działa tak jak uniqueNumbers dla numerów ciągu @p pack od indeksu @p from.
+ * @param[in,out] pack - wskaźnik na ciąg;
+ * @param[in] from - indeks pierwszego sortowanego numeru;
+ * @param[in,out] scratch - wskaźnik na pomocniczą tablicę;
+ * @param[in,out] capacity - wskaźnik na rozmiar pomocniczej tablicy.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool sortPacked(NumberPack *pack, size_t from, char const ***scratch, size_t *capacity) {
+    size_t size = pack->size - from;
+    if (size > *capacity) {
+        char const **temp = realloc(*scratch, size * sizeof(char const *));
+        if (!temp) return false;
+        *scratch = temp;
+        *capacity = size;
     }
 
-    idx = 0;
+    for (size_t i = 0; i < size; ++i)
+        (*scratch)[i] = numberPackGet(pack, from + i);
+    qsort(*scratch, size, sizeof(char const *), comparator);
+
+    size_t idx = from;
     for (size_t i = 0; i < size; ++i) {
-        if (i == 0 || strcmp(arr[i], arr[i - 1]) != 0) {
-            numLength = strlen(arr[i]);
-            result[idx] = (char *) malloc((numLength + 1) * sizeof(char));
-            if (!result[idx]) {
-                for (size_t j = 0; j < idx; ++j)
-                    free(result[j]);
-                free(result);
-
-                for (size_t j = 0; j < size; ++j)
-                    free(arr[j]);
-                free(arr);
-
-                return NULL;
+        if (i > 0 && strcmp((*scratch)[i], (*scratch)[i - 1]) == 0)
+            continue;
+        pack->offsets[idx++] = (size_t) ((*scratch)[i] - pack->chars);
+    }
+    pack->size = idx;
+    return true;
+}
+
+bool trieReverseBatch(ReverseNode *const *root, char const *const *nums, size_t count,
+                      NumberPack *pack, size_t *start, size_t *size) {
+    size_t maxLen = 0;
+    for (size_t i = 0; i < count; ++i) {
+        size_t len = strlen(nums[i]);
+        if (len > maxLen)
+            maxLen = len;
+    }
+
+    BatchItem *items = malloc((count ? count : 1) * sizeof(BatchItem));
+    ReverseNode **path = malloc((maxLen + 1) * sizeof(ReverseNode *));
+    size_t *mark = malloc((maxLen + 1) * sizeof(size_t));
+    ReverseSources sources = {NULL, NULL, 0, 0};
+    char const **scratch = NULL;
+    size_t scratchCapacity = 0;
+    bool res = items && path && mark;
+
+    if (res) {
+        for (size_t i = 0; i < count; ++i) {
+            items[i].num = nums[i];
+            items[i].idx = i;
+        }
+        qsort(items, count, sizeof(BatchItem), comparator);
+
+        path[0] = *root;
+        mark[0] = 0;
+        size_t depth = 0;
+        char const *prev = "";
+        for (size_t k = 0; res && k < count; ++k) {
+            char const *num = items[k].num;
+            size_t common = 0;
+            while (common < depth && prev[common] == num[common])
+                ++common;
+
+            sources.size = mark[common];
+            for (depth = common; res && num[depth] != '\0'; ++depth) {
+                ReverseNode *next = path[depth]->child[findIndex(num[depth])];
+                if (!next)
+                    break;
+                path[depth + 1] = next;
+                res = pushSources(&sources, next->forwardsList, depth + 1);
+                mark[depth + 1] = sources.size;
             }
-            for (size_t j = 0; j <= numLength; ++j)
-                result[idx][j] = arr[i][j];
-            ++idx;
+
+            size_t from = pack->size;
+            res = res && numberPackAppend(pack, num, 0, num);
+            for (size_t i = 0; res && i < sources.size; ++i)
+                res = numberPackAppend(pack, sources.node[i]->data, strlen(sources.node[i]->data),
+                                       num + sources.depth[i]);
+            res = res && sortPacked(pack, from, &scratch, &scratchCapacity);
+            start[items[k].idx] = from;
+            size[items[k].idx] = pack->size - from;
+            prev = num;
         }
     }
 
-    for (size_t j = 0; j < size; ++j)
-        free(arr[j]);
-    free(arr);
-    return result;
+    free(items);
+    free(path);
+    free(mark);
+    free(sources.node);
+    free(sources.depth);
+    free(scratch);
+    return res;
 }
@@ -12,34 +12,80 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include "linked_list.h"
+#include "number_pack.h"
 
 #define N 12 /**< Ilość cyfr, służy do określenia ilości dzieci w drzewie. */
 
 typedef struct TrieNode TrieNode;
+typedef struct ReverseNode ReverseNode;
 
 /**
- * To jest struktura reprezentująca drzewo Trie.
+ * To jest struktura reprezentująca wierzchołek drzewa forward.
  */
 struct TrieNode {
-    union {
-        char *forward;
-        Node *forwardsList;
-    } data; /**< Przekierowanie numeru telefonu.*/
+    char *forward; /**< Przekierowanie numeru telefonu lub NULL. */
     TrieNode *child[N]; /**< Tablica dzieci. */
     TrieNode *father; /**< Wskaźnik na ojca. */
-    TrieNode *reverseNode; /**< Wskaźnik na wierzchołek odpowiadający mu w drzewie reverseTrie. */
+    ReverseNode *reverseNode; /**< Wskaźnik na wierzchołek odpowiadający mu w drzewie reverseTrie. */
     Node *ptrToList; /**< Wskaźnik na element w liście w drzewie reverseTrie. */
-    size_t lastIndex; /**< Indeks ostatniego usuniętego dziecka w funkcji remove. */
-    bool isReverse; /**< Flaga mówiąca czy drzewo jest typu reverse. */
+    unsigned char position; /**< Indeks wierzchołka w tablicy child ojca. */
+    bool inArena; /**< Flaga mówiąca czy wierzchołek leży w bloku po kompaktowaniu. */
+    bool dataInArena; /**< Flaga mówiąca czy przekierowanie leży w bloku po kompaktowaniu. */
+};
+
+/**
+ * To jest struktura reprezentująca wierzchołek drzewa reverse.
+ */
+struct ReverseNode {
+    Node *forwardsList; /**< Lista numerów przekierowywanych na numer wierzchołka. */
+    ReverseNode *child[N]; /**< Tablica dzieci. */
+    ReverseNode *father; /**< Wskaźnik na ojca. */
+    unsigned char position; /**< Indeks wierzchołka w tablicy child ojca. */
+    bool inArena; /**< Flaga mówiąca czy wierzchołek leży w bloku po kompaktowaniu. */
+};
+
+/**
+ * To jest struktura reprezentująca blok pamięci, do którego są przenoszone
+ * wierzchołki drzew podczas kompaktowania.
+ */
+struct TrieArena;
+typedef struct TrieArena TrieArena;
+
+/** @brief Funkcja wywoływana dla przekierowania.
+ * @param[in,out] ctx – wskaźnik przekazany do funkcji przeglądającej drzewo;
+ * @param[in] num1    – wskaźnik na numer przekierowywany;
+ * @param[in] num2    – wskaźnik na numer, na który jest wykonywane przekierowanie.
+ * @return Wartość @p false, jeśli przeglądanie ma zostać przerwane.
+ */
+typedef bool (*TrieVisit)(void *ctx, char const *num1, char const *num2);
+
+typedef struct TrieCursor TrieCursor;
+/**
+ * To jest struktura reprezentująca kursor przeglądający przekierowania poddrzewa.
+ * Kursor trzyma jawny stos wierzchołków, więc nie modyfikuje drzewa.
+ */
+struct TrieCursor {
+    TrieNode const **stack; /**< Stos wierzchołków od korzenia poddrzewa do bieżącego. */
+    char *num; /**< Numer bieżącego wierzchołka. */
+    size_t prefix; /**< Długość numeru korzenia poddrzewa. */
+    size_t depth; /**< Głębokość bieżącego wierzchołka w poddrzewie. */
+    size_t capacity; /**< Rozmiar stosu. */
+    int next; /**< Indeks następnego dziecka do odwiedzenia lub -1, gdy przekierowanie
+                   bieżącego wierzchołka nie zostało jeszcze zwrócone. */
 };
 
 /** @brief Tworzy nową strukturę.
- * Otrzymuje parametr @p i tworzy nową strukturę bez żadnych wierzchołków tylko ze wskaźnikiem na korzeń.
- * W zależności od parametru @p drzewo jest typu Reverse lub Forward.
+ * Tworzy korzeń drzewa forward bez żadnych innych wierzchołków.
  * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
  *         alokować pamięci.
  */
-TrieNode *trieNew(bool isReverse);
+TrieNode *trieNew(void);
+
+/** @brief Tworzy nowe drzewo reverse.
+ * Tworzy korzeń drzewa reverse bez żadnych innych wierzchołków.
+ * @return Wskaźnik na korzeń lub NULL, gdy nie udało się alokować pamięci.
+ */
+ReverseNode *reverseTrieNew(void);
 
 /** @brief Usuwa strukturę.
  * Usuwa strukturę wskazywaną przez @p root. Nic nie robi, jeśli wskaźnik ten ma wartość NULL.
@@ -52,13 +98,27 @@ void trieDelete(TrieNode **root);
  * ostatnią cyfrę numeru telefonu @p num1 trzyma informacje o przekierowaniu na @p num2.
  * @param[in] root – wskaźnik na strukturę reprezentująca drzewo Trie.
  * @param[in] num1 – wskaźnik na napis reprezentujący numer.
- * @param[in] num2 – wskaźnik na napis reprezentujący numer.
- * @return Wartość @p true, jeśli przekierowanie zostało dodane.
- *         Wartość @p false, jeśli wystąpił błąd, np. nie udało
- *         się alokować pamięci.
+ * @return Wskaźnik na wierzchołek numeru @p num1 bez przekierowania lub NULL,
+ *         gdy nie udało się alokować pamięci.
  */
 TrieNode *trieAdd(TrieNode **root, char const *num1);
 
+/** @brief Zwraca wierzchołek numeru, tworząc brakujące wierzchołki.
+ * Działa tak jak trieAdd, ale nie usuwa przekierowania wierzchołka.
+ * @param[in] root – wskaźnik na strukturę reprezentująca drzewo Trie.
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na wierzchołek lub NULL, gdy nie udało się alokować pamięci.
+ */
+TrieNode *triePath(TrieNode **root, char const *num);
+
+/** @brief Zwraca wierzchołek drzewa reverse, tworząc brakujące wierzchołki.
+ * @param[in] root – wskaźnik na korzeń drzewa reverse.
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na wierzchołek numeru @p num lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+ReverseNode *reverseTrieAdd(ReverseNode **root, char const *num);
+
 /** @brief Usuwanie przekierowanie numeru telefonu.
  * Usuwa całe poddrzewo którego początkowa ścieżka od korzenia jest reprezentacją
  * numeru @p num, usuwa je od ostatniego wierzchołka reprezentującego @p num aż do liści.
@@ -75,6 +135,41 @@ void trieRemove(TrieNode **root, char const *num);
  */
 char *trieFindForward(TrieNode *const *root, char const *num);
 
+/** @brief Zwraca przekierowanie numeru, zaczynając od danego wierzchołka.
+ * Działa tak jak trieFindForward, ale zaczyna przechodzenie od wierzchołka
+ * @p node reprezentującego pierwsze @p depth znaków numeru @p num.
+ * @param[in] node – wskaźnik na wierzchołek drzewa forward;
+ * @param[in] num – wskaźnik na napis reprezentujący numer;
+ * @param[in] depth – głębokość wierzchołka @p node;
+ * @param[in] best – najgłębszy wierzchołek z przekierowaniem na ścieżce do
+ *                   @p node włącznie lub NULL;
+ * @param[in] bestLen – głębokość wierzchołka @p best.
+ * @return Wynik taki jak dla trieFindForward.
+ */
+char *trieFindForwardFrom(TrieNode const *node, char const *num, size_t depth,
+                          TrieNode const *best, size_t bestLen);
+
+/** @brief Zwraca długość istniejącej ścieżki numeru.
+ * @param[in] root – wskaźnik na strukturę reprezentująca drzewo Trie.
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Liczba początkowych znaków @p num, dla których istnieje ścieżka od korzenia.
+ */
+size_t trieMatch(TrieNode *const *root, char const *num);
+
+/** @brief Zwraca przekierowania wielu numerów.
+ * Wyznacza przekierowania numerów @p nums tak jak trieFindForward, ale
+ * przetwarza je w kolejności leksykograficznej i zaczyna przechodzenie
+ * drzewa od końca wspólnego prefiksu z poprzednim numerem.
+ * @param[in] root – wskaźnik na strukturę reprezentująca drzewo Trie.
+ * @param[in] nums – tablica wskaźników na napisy reprezentujące poprawne numery.
+ * @param[in] count – rozmiar tablicy @p nums.
+ * @param[out] results – tablica rozmiaru @p count, do której trafiają nowe
+ *                       napisy z przekierowaniami w kolejności numerów @p nums.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci; tablica
+ *         @p results zawiera wtedy same wartości NULL.
+ */
+bool trieFindForwardBatch(TrieNode *const *root, char const *const *nums, size_t count, char **results);
+
 /** @brief Zwraca wskaźnik na tablice numerów.
  * Wskaźnik na tablice numerów które są wynikiem funkcji phfwdReverse dla danego numeru @p num
  * oraz drzewa przekierowań o korzeniu @p root.
@@ -84,7 +179,126 @@ char *trieFindForward(TrieNode *const *root, char const *num);
  * która zostanie utworzona.
  * @return Wskaźnik na tablice numerów lub NULL, gdy nie udało się alokować pamięci.
  */
-char **findReverseForwards(TrieNode *const *root, char const *num, size_t *pnumSize);
+char **findReverseForwards(ReverseNode *const *root, char const *num, size_t *pnumSize);
+
+/** @brief Wyznacza wyniki phfwdReverse dla wielu numerów.
+ * Przetwarza numery @p nums w kolejności leksykograficznej i zaczyna
+ * przechodzenie drzewa reverse od końca wspólnego prefiksu z poprzednim
+ * numerem, korzystając z zebranych już list wierzchołków tego prefiksu.
+ * Posortowane wyniki każdego numeru są dopisywane do @p pack jako spójny
+ * fragment ciągu.
+ * @param[in] root – wskaźnik na strukturę reprezentująca drzewo reverseTrie.
+ * @param[in] nums – tablica wskaźników na napisy reprezentujące poprawne numery.
+ * @param[in] count – rozmiar tablicy @p nums.
+ * @param[in,out] pack – wskaźnik na ciąg, do którego są dopisywane wyniki.
+ * @param[out] start – tablica rozmiaru @p count z indeksami pierwszych wyników
+ *                     numerów w @p pack.
+ * @param[out] size – tablica rozmiaru @p count z liczbami wyników numerów.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+bool trieReverseBatch(ReverseNode *const *root, char const *const *nums, size_t count,
+                      NumberPack *pack, size_t *start, size_t *size);
+
+/** @brief Zwraca indeks cyfry.
+ * Zwraca indeks w tablicy child odpowiadający znakowi @p c.
+ * @param[in] c - znak numeru telefonu.
+ * @return Indeks z przedziału od 0 do N - 1.
+ */
+int trieIndex(char c);
+
+/** @brief Zwraca cyfrę o danym indeksie.
+ * Funkcja odwrotna do @ref trieIndex.
+ * @param[in] index - indeks z przedziału od 0 do N - 1.
+ * @return Znak numeru telefonu odpowiadający indeksowi @p index.
+ */
+char trieSymbol(int index);
+
+/** @brief Wyszukuje wierzchołek numeru.
+ * Zwraca wierzchołek, na którym kończy się ścieżka od korzenia reprezentująca @p num.
+ * @param[in] root – wskaźnik na strukturę reprezentująca drzewo Trie.
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na wierzchołek lub NULL, gdy taka ścieżka nie istnieje.
+ */
+TrieNode *trieFind(TrieNode *const *root, char const *num);
+
+/** @brief Wyznacza fragmenty drzewa reverse używane przez poddrzewo.
+ * Dla każdego przekierowania w poddrzewie drzewa forward o korzeniu @p node ustawia
+ * bit odpowiadający pierwszej cyfrze numeru, na który jest ono wykonywane.
+ * @param[in] node - wskaźnik na korzeń poddrzewa drzewa forward.
+ * @return Maska bitowa indeksów dzieci korzenia drzewa reverse.
+ */
+unsigned trieTargetShards(TrieNode *node);
+
+/** @brief Przegląda przekierowania.
+ * Wywołuje @p visit dla każdego przekierowania drzewa forward @p root
+ * w kolejności leksykograficznej numerów przekierowywanych.
+ * @param[in] root – wskaźnik na korzeń drzewa forward;
+ * @param[in] visit – funkcja wywoływana dla przekierowań;
+ * @param[in,out] ctx – wskaźnik przekazywany do @p visit.
+ * @return Wartość @p false, jeśli @p visit przerwała przeglądanie lub nie
+ *         udało się alokować pamięci.
+ */
+bool trieForEach(TrieNode const *root, TrieVisit visit, void *ctx);
+
+/** @brief Ustawia kursor na poddrzewie.
+ * Przygotowuje @p cursor do przeglądania przekierowań numerów zaczynających się
+ * od @p prefix w drzewie forward @p root.
+ * @param[out] cursor – wskaźnik na kursor;
+ * @param[in] root – wskaźnik na korzeń drzewa forward;
+ * @param[in] prefix – wskaźnik na napis reprezentujący poprawny numer lub pusty napis.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+bool trieCursorInit(TrieCursor *cursor, TrieNode const *root, char const *prefix);
+
+/** @brief Przesuwa kursor na następne przekierowanie.
+ * Przekierowania są zwracane w kolejności leksykograficznej numerów przekierowywanych.
+ * Zwrócone napisy są ważne do następnego wywołania tej funkcji lub zmiany drzewa.
+ * @param[in,out] cursor – wskaźnik na kursor;
+ * @param[out] num1 – wskaźnik na numer przekierowywany;
+ * @param[out] num2 – wskaźnik na numer, na który jest wykonywane przekierowanie.
+ * @return Wartość @p false, jeśli przekierowania się skończyły lub nie udało
+ *         się alokować pamięci.
+ */
+bool trieCursorNext(TrieCursor *cursor, char const **num1, char const **num2);
+
+/** @brief Zwalnia pamięć kursora.
+ * @param[in,out] cursor – wskaźnik na kursor.
+ */
+void trieCursorFree(TrieCursor *cursor);
+
+/** @brief Przenosi drzewa do jednego bloku pamięci.
+ * Kopiuje wierzchołki drzew @p forwardRoot i @p reverseRoot poza korzeniami,
+ * ich listy oraz numery do nowego bloku w kolejności preorder, poprawia
+ * wskaźniki father, reverseNode i ptrToList, a następnie zwalnia stare
+ * wierzchołki i poprzedni blok @p *arena. Wierzchołki w bloku nie są
+ * zwalniane pojedynczo, więc drzewa można dalej modyfikować.
+ * @param[in,out] forwardRoot – wskaźnik na korzeń drzewa forward;
+ * @param[in,out] reverseRoot – wskaźnik na korzeń drzewa reverse;
+ * @param[in,out] arena – wskaźnik na blok z poprzedniego kompaktowania lub NULL.
+ * @param[out] reclaimed – wskaźnik na liczbę zwolnionych bajtów, o którą
+ *                         zmniejszył się rozmiar wierzchołków, list i numerów.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci; drzewa
+ *         nie są wtedy zmieniane.
+ */
+bool trieCompact(TrieNode *forwardRoot, ReverseNode *reverseRoot, TrieArena **arena, size_t *reclaimed);
+
+/** @brief Zwalnia blok pamięci.
+ * Zwalnia blok utworzony przez trieCompact. Wierzchołki, które w nim leżą,
+ * muszą być wcześniej usunięte z drzew. Nic nie robi, jeśli wskaźnik ma
+ * wartość NULL.
+ * @param[in] arena – wskaźnik na blok.
+ */
+void trieArenaFree(TrieArena *arena);
+
+/** @brief Sortuje numery i usuwa powtórzenia.
+ * Sortuje leksykograficznie tablicę @p arr numerów zaalokowanych przez malloc
+ * i zwalnia powtarzające się numery, przesuwając pozostałe na początek tablicy.
+ * @param[in,out] arr - wskaźnik na tablice numerów;
+ * @param[in] size - rozmiar tablicy;
+ * @param[out] pnumSize - wskaźnik na liczbę różnych numerów.
+ * @return Wskaźnik @p arr.
+ */
+char **uniqueNumbers(char **arr, size_t size, size_t *pnumSize);
 
 /** @brief Usuwa martwą ścieżkę.
  * Dla parametru @p node usuwa martwą ścieżkę tzn. taką która prowadzi od pewnego wierzchołka
@@ -94,10 +308,35 @@ char **findReverseForwards(TrieNode *const *root, char const *num, size_t *pnumS
  */
 void deletePath(TrieNode *root);
 
+/** @brief Usuwa martwą ścieżkę drzewa reverse.
+ * Działa tak jak deletePath dla wierzchołka @p node drzewa reverse.
+ * @param[in] node - wskaźnik na wierzchołek.
+ */
+void reverseDeletePath(ReverseNode *node);
+
 /** @brief Usuwa wierzchołek.
  * Dla parametru @p node usuwa wszystkie jego informacje i zwalnia go z pamięci.
  * @param[in] node - wskaźnik na wierzchołek.
  */
 void freeData(TrieNode *node);
 
+/** @brief Odłącza wierzchołek od drzewa reverse.
+ * Usuwa numer wierzchołka @p node drzewa forward z listy jego wierzchołka
+ * w drzewie reverse i usuwa martwą ścieżkę drzewa reverse. Przekierowanie
+ * wierzchołka pozostaje bez zmian. Nic nie robi, jeśli wierzchołek nie jest
+ * połączony z drzewem reverse.
+ * @param[in,out] node - wskaźnik na wierzchołek drzewa forward.
+ */
+void trieUnlinkReverse(TrieNode *node);
+
+/** @brief Buduje drzewo reverse z drzewa forward.
+ * Dodaje do pustego drzewa reverse @p reverseRoot wszystkie przekierowania
+ * drzewa forward @p forwardRoot i łączy z nim wierzchołki drzewa forward.
+ * @param[in,out] forwardRoot - wskaźnik na korzeń drzewa forward;
+ * @param[in,out] reverseRoot - wskaźnik na korzeń pustego drzewa reverse.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci; drzewo
+ *         reverse pozostaje wtedy puste.
+ */
+bool trieBuildReverse(TrieNode *forwardRoot, ReverseNode *reverseRoot);
+
 #endif
\ No newline at end of file
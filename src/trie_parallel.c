@@ -0,0 +1,473 @@
+/** @file
+ * Implementacja równoległego budowania i usuwania drzew Trie
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+#define _POSIX_C_SOURCE 200809L /**< Udostępnia wątki i sysconf. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "trie_parallel.h"
+#include "linked_list.h"
+
+#define BUCKETS_PER_THREAD 4 /**< Liczba części przypadających na wątek, do której dzielone są pary. */
+#define SPLIT_DEPTH 8 /**< Długość najdłuższego prefiksu, według którego dzielone są pary. */
+#define QUEUE_SIZE 1024 /**< Pojemność kolejki poddrzew do usunięcia. */
+
+/**
+ * To jest struktura opisująca jedną fazę budowania drzew.
+ */
+typedef struct BuildPhase {
+    TrieNode **forwardRoot; /**< Wskaźnik na korzeń drzewa forward. */
+    ReverseNode **reverseRoot; /**< Wskaźnik na korzeń drzewa reverse. */
+    char const *const *num1; /**< Tablica numerów przekierowywanych. */
+    char const *const *num2; /**< Tablica numerów docelowych. */
+    TrieNode **nodes; /**< Wierzchołki drzewa forward odpowiadające parom lub NULL
+                           dla par zastąpionych późniejszym przekierowaniem. */
+    size_t *order; /**< Indeksy par pogrupowane według części. */
+    size_t *start; /**< Początki części w tablicy order i koniec ostatniej części. */
+    size_t buckets; /**< Liczba części. */
+    atomic_size_t next; /**< Indeks następnej części do pobrania. */
+    atomic_bool failed; /**< Flaga mówiąca czy nie udało się alokować pamięci. */
+    bool isReverse; /**< Flaga mówiąca czy budowane jest drzewo reverse. */
+} BuildPhase;
+
+/**
+ * To jest struktura opisująca poddrzewo do usunięcia. Dokładnie jeden
+ * wskaźnik jest różny od NULL.
+ */
+typedef struct DeleteTask {
+    TrieNode *forward; /**< Korzeń poddrzewa drzewa forward. */
+    ReverseNode *reverse; /**< Korzeń poddrzewa drzewa reverse. */
+} DeleteTask;
+
+/**
+ * To jest struktura przechowująca kolejkę poddrzew do usunięcia.
+ */
+typedef struct DeleteQueue {
+    DeleteTask tasks[QUEUE_SIZE]; /**< Stos poddrzew. */
+    size_t size; /**< Liczba poddrzew na stosie. */
+    size_t active; /**< Liczba wątków usuwających poddrzewo. */
+    atomic_size_t waiting; /**< Liczba wątków czekających na pracę. */
+    pthread_mutex_t mutex; /**< Blokada kolejki. */
+    pthread_cond_t cond; /**< Zmienna warunkowa, na której czekają wątki. */
+} DeleteQueue;
+
+/** @brief Wyznacza liczbę wątków.
+ * @param[in] threads - liczba wątków podana przez użytkownika lub 0.
+ * @return Liczba wątków, co najmniej 1.
+ */
+static size_t threadCount(size_t threads) {
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (size_t) cpus : 1;
+    }
+    return threads;
+}
+
+/** @brief Uruchamia funkcję na wielu wątkach.
+ * Uruchamia @p routine z argumentem @p arg na @p threads wątkach i czeka na
+ * ich zakończenie. Jeśli nie uda się utworzyć wątku, jego pracę wykonuje
+ * wątek wywołujący.
+ * @param[in] routine - funkcja wątku;
+ * @param[in] arg     - argument funkcji;
+ * @param[in] threads - liczba wątków.
+ */
+static void runThreads(void *(*routine)(void *), void *arg, size_t threads) {
+    pthread_t *ids = malloc(threads * sizeof(pthread_t));
+    size_t created = 0;
+    if (ids) {
+        while (created + 1 < threads && pthread_create(&ids[created], NULL, routine, arg) == 0)
+            ++created;
+    }
+    routine(arg);
+    for (size_t i = 0; i < created; ++i)
+        pthread_join(ids[i], NULL);
+    free(ids);
+}
+
+/** @brief Zwraca grupę, do której numer trafia przy podziale według prefiksu.
+ * @param[in] num   - wskaźnik na numer o długości co najmniej @p depth;
+ * @param[in] depth - długość wspólnego prefiksu dzielonych numerów.
+ * @return Wartość 0 dla numeru równego prefiksowi, a w przeciwnym razie
+ *         indeks jego następnego symbolu powiększony o 1.
+ */
+static size_t slotOf(char const *num, size_t depth) {
+    return num[depth] == '\0' ? 0 : (size_t) trieIndex(num[depth]) + 1;
+}
+
+/** @brief Dzieli pary o wspólnym prefiksie na części.
+ * Zakres, który ma co najwyżej @p limit par, jest jedną częścią. Większy
+ * zakres jest stabilnie sortowany według symbolu na pozycji @p depth: numery
+ * równe prefiksowi tworzą jedną część, a pozostałe grupy są dzielone dalej.
+ * Przed zejściem do grupy tworzony jest wierzchołek jej prefiksu, więc wątki
+ * budujące różne części tworzą wierzchołki w rozłącznych poddrzewach, nawet
+ * gdy większość numerów ma ten sam początek.
+ * @param[in,out] phase - wskaźnik na opis fazy;
+ * @param[in] keys      - tablica numerów, według których dzielone są pary;
+ * @param[in] begin     - początek zakresu w tablicy order;
+ * @param[in] end       - koniec zakresu w tablicy order;
+ * @param[in] depth     - długość wspólnego prefiksu numerów zakresu;
+ * @param[in] limit     - największy rozmiar części;
+ * @param[in,out] tmp   - tablica pomocnicza rozmiaru tablicy order.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool splitRange(BuildPhase *phase, char const *const *keys, size_t begin, size_t end,
+                       size_t depth, size_t limit, size_t *tmp) {
+    if (end - begin <= limit || depth == SPLIT_DEPTH) {
+        phase->start[++phase->buckets] = end;
+        return true;
+    }
+
+    size_t fill[N + 2] = {0};
+    for (size_t k = begin; k < end; ++k)
+        ++fill[slotOf(keys[phase->order[k]], depth) + 1];
+    fill[0] = begin;
+    for (size_t slot = 0; slot <= N; ++slot)
+        fill[slot + 1] += fill[slot];
+    memcpy(tmp + begin, phase->order + begin, (end - begin) * sizeof(size_t));
+    for (size_t k = begin; k < end; ++k)
+        phase->order[fill[slotOf(keys[tmp[k]], depth)]++] = tmp[k];
+
+    size_t from = begin;
+    for (size_t slot = 0; slot <= N; ++slot) {
+        size_t to = fill[slot];
+        if (from == to)
+            continue;
+        if (slot == 0) {
+            phase->start[++phase->buckets] = to;
+        } else {
+            char prefix[SPLIT_DEPTH + 2];
+            memcpy(prefix, keys[phase->order[from]], depth + 1);
+            prefix[depth + 1] = '\0';
+            if ((phase->isReverse ? !reverseTrieAdd(phase->reverseRoot, prefix)
+                                  : !triePath(phase->forwardRoot, prefix))
+                || !splitRange(phase, keys, from, to, depth + 1, limit, tmp))
+                return false;
+        }
+        from = to;
+    }
+    return true;
+}
+
+/** @brief Dodaje przekierowania jednej części.
+ * W fazie forward przegląda pary od końca i zapisuje numer docelowy tylko
+ * w wierzchołku, który jeszcze go nie ma, więc wygrywa ostatnia para z danym
+ * numerem; wcześniejszym parom odpowiada wartość NULL w tablicy nodes.
+ * W fazie reverse łączy wierzchołek drzewa forward z listą w drzewie reverse.
+ * @param[in,out] phase - wskaźnik na opis fazy;
+ * @param[in] bucket    - indeks części.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool buildBucket(BuildPhase *phase, size_t bucket) {
+    if (!phase->isReverse) {
+        for (size_t k = phase->start[bucket + 1]; k > phase->start[bucket]; --k) {
+            size_t i = phase->order[k - 1];
+            TrieNode *node = triePath(phase->forwardRoot, phase->num1[i]);
+            if (!node)
+                return false;
+            phase->nodes[i] = node->forward ? NULL : node;
+            if (node->forward)
+                continue;
+            node->forward = malloc((strlen(phase->num2[i]) + 1) * sizeof(char));
+            if (!node->forward)
+                return false;
+            strcpy(node->forward, phase->num2[i]);
+        }
+        return true;
+    }
+
+    for (size_t k = phase->start[bucket]; k < phase->start[bucket + 1]; ++k) {
+        size_t i = phase->order[k];
+        TrieNode *node = phase->nodes[i];
+        ReverseNode *reverseNode = reverseTrieAdd(phase->reverseRoot, phase->num2[i]);
+        if (!reverseNode)
+            return false;
+        node->ptrToList = push(&(reverseNode->forwardsList), phase->num1[i]);
+        if (!node->ptrToList)
+            return false;
+        node->reverseNode = reverseNode;
+    }
+    return true;
+}
+
+/** @brief Funkcja wątku budującego drzewo.
+ * @param[in,out] arg - wskaźnik na opis fazy.
+ * @return NULL.
+ */
+static void *buildWorker(void *arg) {
+    BuildPhase *phase = arg;
+    size_t bucket;
+    while (!atomic_load(&(phase->failed)) && (bucket = atomic_fetch_add(&(phase->next), 1)) < phase->buckets) {
+        if (!buildBucket(phase, bucket))
+            atomic_store(&(phase->failed), true);
+    }
+    return NULL;
+}
+
+/** @brief Wykonuje jedną fazę budowania.
+ * Dzieli wybrane pary na części funkcją splitRange, zachowując ich kolejność
+ * w każdej części, a następnie buduje części na wielu wątkach. Części mają
+ * najwyżej 1 / (BUCKETS_PER_THREAD * @p threads) wybranych par, o ile nie
+ * dzielą prefiksu dłuższego niż SPLIT_DEPTH.
+ * @param[in,out] phase - wskaźnik na opis fazy;
+ * @param[in] selected  - tablica flag wybranych par;
+ * @param[in] count     - rozmiar tablic;
+ * @param[in] threads   - liczba wątków.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool buildPhase(BuildPhase *phase, bool const *selected, size_t count, size_t threads) {
+    char const *const *keys = phase->isReverse ? phase->num2 : phase->num1;
+
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (selected[i])
+            phase->order[total++] = i;
+    }
+    size_t *tmp = malloc(count * sizeof(size_t));
+    if (!tmp)
+        return false;
+    size_t limit = threads > 1 ? total / (threads * BUCKETS_PER_THREAD) + 1 : total;
+    phase->start[0] = 0;
+    phase->buckets = 0;
+    bool res = total == 0 || splitRange(phase, keys, 0, total, 0, limit, tmp);
+    free(tmp);
+    if (!res)
+        return false;
+
+    atomic_init(&(phase->next), 0);
+    atomic_init(&(phase->failed), false);
+    runThreads(buildWorker, phase, threads);
+    return !atomic_load(&(phase->failed));
+}
+
+bool trieAddParallel(TrieNode **forwardRoot, ReverseNode **reverseRoot,
+                     char const *const *num1, char const *const *num2,
+                     bool const *valid, size_t count, size_t threads) {
+    if (count == 0)
+        return true;
+    threads = threadCount(threads);
+
+    BuildPhase *phase = malloc(sizeof(BuildPhase));
+    bool *live = malloc(count * sizeof(bool));
+    if (phase) {
+        phase->nodes = malloc(count * sizeof(TrieNode *));
+        phase->order = malloc(count * sizeof(size_t));
+        phase->start = malloc((count + 1) * sizeof(size_t));
+    }
+    if (!phase || !live || !phase->nodes || !phase->order || !phase->start) {
+        if (phase) {
+            free(phase->nodes);
+            free(phase->order);
+            free(phase->start);
+        }
+        free(phase);
+        free(live);
+        return false;
+    }
+    phase->num1 = num1;
+    phase->num2 = num2;
+    phase->forwardRoot = forwardRoot;
+    phase->reverseRoot = reverseRoot;
+
+    phase->isReverse = false;
+    bool res = buildPhase(phase, valid, count, threads);
+
+    if (res) {
+        for (size_t i = 0; i < count; ++i)
+            live[i] = valid[i] && phase->nodes[i];
+
+        phase->isReverse = true;
+        res = buildPhase(phase, live, count, threads);
+    }
+
+    free(phase->nodes);
+    free(phase->order);
+    free(phase->start);
+    free(phase);
+    free(live);
+    return res;
+}
+
+/** @brief Oddaje nieodwiedzone dzieci wierzchołka czekającym wątkom.
+ * Przenosi do kolejki dzieci o indeksach większych od @p i, jeśli jakiś wątek
+ * czeka na pracę.
+ * @param[in,out] queue - wskaźnik na kolejkę;
+ * @param[in,out] forward - tablica dzieci wierzchołka drzewa forward lub NULL;
+ * @param[in,out] reverse - tablica dzieci wierzchołka drzewa reverse lub NULL;
+ * @param[in] i - indeks odwiedzanego dziecka.
+ */
+static void shareChildren(DeleteQueue *queue, TrieNode **forward, ReverseNode **reverse, size_t i) {
+    if (atomic_load_explicit(&(queue->waiting), memory_order_relaxed) == 0)
+        return;
+    pthread_mutex_lock(&(queue->mutex));
+    for (size_t j = i + 1; j < N && queue->size < QUEUE_SIZE; ++j) {
+        if (forward && forward[j]) {
+            queue->tasks[queue->size++] = (DeleteTask) {forward[j], NULL};
+            forward[j] = NULL;
+        } else if (reverse && reverse[j]) {
+            queue->tasks[queue->size++] = (DeleteTask) {NULL, reverse[j]};
+            reverse[j] = NULL;
+        }
+    }
+    pthread_cond_broadcast(&(queue->cond));
+    pthread_mutex_unlock(&(queue->mutex));
+}
+
+/** @brief Usuwa poddrzewo drzewa forward, oddając część pracy innym wątkom.
+ * Przechodzi poddrzewo o korzeniu @p top tak jak trieDelete, nie aktualizując
+ * powiązań z drzewem reverse. Jeśli jakiś wątek czeka na pracę, nieodwiedzone
+ * dzieci bieżącego wierzchołka trafiają do kolejki.
+ * @param[in,out] queue - wskaźnik na kolejkę;
+ * @param[in] top       - wskaźnik na korzeń usuwanego poddrzewa.
+ */
+static void deleteForward(DeleteQueue *queue, TrieNode *top) {
+    TrieNode *ptr = top;
+    size_t i = 0;
+    while (true) {
+        while (i < N && !ptr->child[i])
+            ++i;
+
+        if (i < N) {
+            shareChildren(queue, ptr->child, NULL, i);
+            ptr = ptr->child[i];
+            i = 0;
+        } else {
+            TrieNode *father = ptr == top ? NULL : ptr->father;
+            if (father) {
+                i = ptr->position + 1;
+                father->child[ptr->position] = NULL;
+            }
+            if (!ptr->dataInArena)
+                free(ptr->forward);
+            if (!ptr->inArena)
+                free(ptr);
+            if (!father)
+                return;
+            ptr = father;
+        }
+    }
+}
+
+/** @brief Usuwa poddrzewo drzewa reverse, oddając część pracy innym wątkom.
+ * Działa tak jak deleteForward dla poddrzewa drzewa reverse i zwalnia listy
+ * jego wierzchołków.
+ * @param[in,out] queue - wskaźnik na kolejkę;
+ * @param[in] top       - wskaźnik na korzeń usuwanego poddrzewa.
+ */
+static void deleteReverse(DeleteQueue *queue, ReverseNode *top) {
+    ReverseNode *ptr = top;
+    size_t i = 0;
+    while (true) {
+        while (i < N && !ptr->child[i])
+            ++i;
+
+        if (i < N) {
+            shareChildren(queue, NULL, ptr->child, i);
+            ptr = ptr->child[i];
+            i = 0;
+        } else {
+            ReverseNode *father = ptr == top ? NULL : ptr->father;
+            if (father) {
+                i = ptr->position + 1;
+                father->child[ptr->position] = NULL;
+            }
+            listDelete(&(ptr->forwardsList));
+            if (!ptr->inArena)
+                free(ptr);
+            if (!father)
+                return;
+            ptr = father;
+        }
+    }
+}
+
+/** @brief Usuwa poddrzewo zadania.
+ * @param[in,out] queue - wskaźnik na kolejkę;
+ * @param[in] task      - zadanie.
+ */
+static void deleteTask(DeleteQueue *queue, DeleteTask task) {
+    if (task.forward)
+        deleteForward(queue, task.forward);
+    else
+        deleteReverse(queue, task.reverse);
+}
+
+/** @brief Funkcja wątku usuwającego drzewa.
+ * @param[in,out] arg - wskaźnik na kolejkę.
+ * @return NULL.
+ */
+static void *deleteWorker(void *arg) {
+    DeleteQueue *queue = arg;
+
+    pthread_mutex_lock(&(queue->mutex));
+    while (true) {
+        while (queue->size == 0 && queue->active > 0) {
+            atomic_fetch_add(&(queue->waiting), 1);
+            pthread_cond_wait(&(queue->cond), &(queue->mutex));
+            atomic_fetch_sub(&(queue->waiting), 1);
+        }
+        if (queue->size == 0)
+            break;
+
+        DeleteTask task = queue->tasks[--queue->size];
+        ++queue->active;
+        pthread_mutex_unlock(&(queue->mutex));
+
+        deleteTask(queue, task);
+
+        pthread_mutex_lock(&(queue->mutex));
+        --queue->active;
+        if (queue->active == 0 && queue->size == 0)
+            pthread_cond_broadcast(&(queue->cond));
+    }
+    pthread_mutex_unlock(&(queue->mutex));
+    return NULL;
+}
+
+void trieDeleteParallel(TrieNode **forwardRoot, ReverseNode **reverseRoot, size_t threads) {
+    DeleteQueue queue;
+    queue.size = 0;
+    queue.active = 0;
+    atomic_init(&(queue.waiting), 0);
+
+    for (size_t i = 0; *forwardRoot && i < N; ++i) {
+        if ((*forwardRoot)->child[i]) {
+            queue.tasks[queue.size++] = (DeleteTask) {(*forwardRoot)->child[i], NULL};
+            (*forwardRoot)->child[i] = NULL;
+        }
+    }
+    for (size_t i = 0; *reverseRoot && i < N; ++i) {
+        if ((*reverseRoot)->child[i]) {
+            queue.tasks[queue.size++] = (DeleteTask) {NULL, (*reverseRoot)->child[i]};
+            (*reverseRoot)->child[i] = NULL;
+        }
+    }
+    if (*forwardRoot)
+        deleteForward(&queue, *forwardRoot);
+    if (*reverseRoot)
+        deleteReverse(&queue, *reverseRoot);
+    *forwardRoot = NULL;
+    *reverseRoot = NULL;
+
+    if (pthread_mutex_init(&(queue.mutex), NULL) != 0) {
+        while (queue.size > 0)
+            deleteTask(&queue, queue.tasks[--queue.size]);
+        return;
+    }
+    if (pthread_cond_init(&(queue.cond), NULL) != 0) {
+        pthread_mutex_destroy(&(queue.mutex));
+        while (queue.size > 0)
+            deleteTask(&queue, queue.tasks[--queue.size]);
+        return;
+    }
+
+    runThreads(deleteWorker, &queue, threadCount(threads));
+    pthread_cond_destroy(&(queue.cond));
+    pthread_mutex_destroy(&(queue.mutex));
+}
@@ -0,0 +1,51 @@
+/** @file
+ * Interfejs równoległego budowania i usuwania drzew Trie
+ *
+ * @author Paweł Preibisch <pp438687@mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __TRIE_PARALLEL_H__
+#define __TRIE_PARALLEL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "trie.h"
+
+/** @brief Dodaje wiele przekierowań równolegle.
+ * Wstawia do pustych drzew @p forwardRoot i @p reverseRoot przekierowania
+ * @p num1[i] na @p num2[i] dla wszystkich @p i, dla których @p valid[i] jest
+ * prawdą. Późniejsze przekierowanie z tym samym numerem @p num1 zastępuje
+ * wcześniejsze, tak jak przy kolejnych wywołaniach phfwdAdd. Najpierw budowane
+ * jest drzewo forward, potem drzewo reverse; w każdej fazie praca jest dzielona
+ * według prefiksów numerów, a części większe od ułamka wszystkich par są
+ * dzielone według kolejnych cyfr, więc numery o wspólnym początku też trafiają
+ * do wielu wątków. Wątki pobierają kolejne części dynamicznie.
+ * @param[in,out] forwardRoot – wskaźnik na korzeń drzewa forward;
+ * @param[in,out] reverseRoot – wskaźnik na korzeń drzewa reverse;
+ * @param[in] num1    – tablica numerów przekierowywanych;
+ * @param[in] num2    – tablica numerów, na które są wykonywane przekierowania;
+ * @param[in] valid   – tablica flag mówiących, czy dana para ma być dodana;
+ * @param[in] count   – rozmiar tablic;
+ * @param[in] threads – liczba wątków lub 0, by użyć wszystkich procesorów.
+ * @return Wartość @p true, jeśli wszystkie przekierowania zostały dodane.
+ *         Wartość @p false, jeśli nie udało się alokować pamięci; drzewa
+ *         należy wtedy usunąć funkcją @ref trieDeleteParallel.
+ */
+bool trieAddParallel(TrieNode **forwardRoot, ReverseNode **reverseRoot,
+                     char const *const *num1, char const *const *num2,
+                     bool const *valid, size_t count, size_t threads);
+
+/** @brief Usuwa oba drzewa równolegle.
+ * Usuwa drzewa @p forwardRoot i @p reverseRoot wraz z korzeniami, nie
+ * aktualizując powiązań między nimi. Początkowo zadaniami są poddrzewa dzieci
+ * obu korzeni; wątek, który zauważy, że inne wątki czekają na pracę, oddaje im
+ * nieodwiedzone jeszcze dzieci bieżącego wierzchołka.
+ * @param[in,out] forwardRoot – wskaźnik na korzeń drzewa forward;
+ * @param[in,out] reverseRoot – wskaźnik na korzeń drzewa reverse;
+ * @param[in] threads – liczba wątków lub 0, by użyć wszystkich procesorów.
+ */
+void trieDeleteParallel(TrieNode **forwardRoot, ReverseNode **reverseRoot, size_t threads);
+
+#endif /* __TRIE_PARALLEL_H__ */